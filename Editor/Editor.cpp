@@ -390,6 +390,9 @@ void EditorComponent::ResizeLayout()
 	saveModeComboBox.SetSize(XMFLOAT2(120, 20));
 	saveModeComboBox.SetPos(XMFLOAT2(screenW - 140, 70));
 
+	saveCompressionComboBox.SetSize(XMFLOAT2(120, 20));
+	saveCompressionComboBox.SetPos(XMFLOAT2(screenW - 140, 95));
+
 	sceneGraphView.SetSize(XMFLOAT2(260, 300));
 	sceneGraphView.SetPos(XMFLOAT2(0, screenH - sceneGraphView.scale_local.y));
 }
@@ -683,6 +686,8 @@ void EditorComponent::Load()
 					wiResourceManager::MODE embed_mode = (wiResourceManager::MODE)saveModeComboBox.GetItemUserData(saveModeComboBox.GetSelected());
 					wiResourceManager::SetMode(embed_mode);
 
+					archive.SetCompression((wiCompression::Level)saveCompressionComboBox.GetItemUserData(saveCompressionComboBox.GetSelected()));
+
 					scene.Serialize(archive);
 
 					ResetHistory();
@@ -923,6 +928,16 @@ void EditorComponent::Load()
 	saveModeComboBox.SetTooltip("Choose whether to embed resources (textures, sounds...) in the scene file when saving, or keep them as separate files");
 	GetGUI().AddWidget(&saveModeComboBox);
 
+	saveCompressionComboBox.Create("Compression: ");
+	saveCompressionComboBox.SetColor(wiColor(0, 198, 101, 180), wiWidget::WIDGETSTATE::IDLE);
+	saveCompressionComboBox.SetColor(wiColor(0, 255, 140, 255), wiWidget::WIDGETSTATE::FOCUS);
+	saveCompressionComboBox.AddItem("None", (uint64_t)wiCompression::Level::None);
+	saveCompressionComboBox.AddItem("Fast", (uint64_t)wiCompression::Level::Fast);
+	saveCompressionComboBox.AddItem("Default", (uint64_t)wiCompression::Level::Default);
+	saveCompressionComboBox.AddItem("High", (uint64_t)wiCompression::Level::High);
+	saveCompressionComboBox.SetTooltip("Choose the compression of the scene file when saving. Higher compression is slower to save, but loading speed is the same");
+	GetGUI().AddWidget(&saveCompressionComboBox);
+
 
 	// Renderer and Postprocess windows are created in ChangeRenderPath(), because they deal with
 	//	RenderPath related information as well, so it's easier to reset them when changing
@@ -91,6 +91,7 @@ public:
 	wiCheckBox isTranslatorCheckBox;
 	wiButton saveButton;
 	wiComboBox saveModeComboBox;
+	wiComboBox saveCompressionComboBox;
 	wiButton modelButton;
 	wiButton scriptButton;
 	wiButton clearButton;
@@ -247,7 +247,7 @@ void MeshWindow::Create(EditorComponent* editor)
 	AddWidget(&flipNormalsButton);
 
 	computeNormalsSmoothButton.Create("Compute Normals [SMOOTH]");
-	computeNormalsSmoothButton.SetTooltip("Compute surface normals of the mesh. Resulting normals will be unique per vertex. This can reduce vertex count, but is slow.");
+	computeNormalsSmoothButton.SetTooltip("Compute surface normals of the mesh. Resulting normals will be unique per vertex. This can reduce vertex count by welding identical vertices.");
 	computeNormalsSmoothButton.SetSize(XMFLOAT2(240, hei));
 	computeNormalsSmoothButton.SetPos(XMFLOAT2(x - 50, y += step));
 	computeNormalsSmoothButton.OnClick([&](wiEventArgs args) {
@@ -1254,13 +1254,19 @@ Texture PaintToolWindow::GetEditTextureSlot(const MaterialComponent& material, i
 	{
 		return Texture();
 	}
+	const Texture* texture = material.textures[sel].resource->GetTexture(); // nullptr while it's loading
+	if (texture == nullptr)
+	{
+		return Texture();
+	}
 	if (uvset)
 		*uvset = material.textures[sel].uvset;
-	return material.textures[sel].resource->texture;
+	return *texture;
 }
 void PaintToolWindow::ReplaceEditTextureSlot(wiScene::MaterialComponent& material, const Texture& texture)
 {
 	uint64_t sel = textureSlotComboBox.GetItemUserData(textureSlotComboBox.GetSelected());
 	material.textures[sel].resource->texture = texture;
+	material.textures[sel].resource->texture_version.fetch_add(1);
 	material.SetDirty();
 }
@@ -1,10 +1,13 @@
 #include "stdafx.h"
 #include "Tests.h"
 
+#include "Utility/stb_image.h"
+
 #include <string>
 #include <sstream>
 #include <fstream>
 #include <thread>
+#include <filesystem>
 
 using namespace wiECS;
 using namespace wiScene;
@@ -119,6 +122,18 @@ void TestsRenderer::Load()
 	testSelector.AddItem("Controller Test");
 	testSelector.AddItem("Inverse Kinematics");
 	testSelector.AddItem("65k Instances");
+	testSelector.AddItem("Frustum Culling Test");
+	testSelector.AddItem("ECS Lookup Test");
+	testSelector.AddItem("Hierarchy Update Test");
+	testSelector.AddItem("Scene Query Test");
+	testSelector.AddItem("Archive Test");
+	testSelector.AddItem("Archive Compression Test");
+	testSelector.AddItem("Async Resource Loading Test");
+	testSelector.AddItem("Resource Memory Budget Test");
+	testSelector.AddItem("Texture Streaming Test");
+	testSelector.AddItem("Texture Cooker Test");
+	testSelector.AddItem("Mesh Normals Test");
+	testSelector.AddItem("CPU Path Tracer Test");
 	testSelector.SetMaxVisibleItemCount(10);
 	testSelector.OnSelect([=](wiEventArgs args) {
 
@@ -290,6 +305,43 @@ void TestsRenderer::Load()
 		}
 		break;
 
+		case 19:
+			RunFrustumCullingTest();
+			break;
+		case 20:
+			RunECSLookupTest();
+			break;
+		case 21:
+			RunHierarchyUpdateTest();
+			break;
+		case 22:
+			RunSceneQueryTest();
+			break;
+		case 23:
+			RunArchiveTest();
+			break;
+		case 24:
+			RunArchiveCompressionTest();
+			break;
+		case 25:
+			RunAsyncResourceLoadingTest();
+			break;
+		case 26:
+			RunResourceBudgetTest();
+			break;
+		case 27:
+			RunTextureStreamingTest();
+			break;
+		case 28:
+			RunTextureCookerTest();
+			break;
+		case 29:
+			RunMeshNormalsTest();
+			break;
+		case 30:
+			RunCPUPathTracerTest();
+			break;
+
 		default:
 			assert(0);
 			break;
@@ -434,6 +486,1157 @@ void TestsRenderer::RunJobSystemTest()
 		ss << "wiJobSystem::Dispatch() took " << time << " milliseconds" << std::endl;
 	}
 
+	ss << std::endl;
+	ss << "3) Dispatch overhead test:" << std::endl;
+
+	// Empty jobs, each in its own group, so only the scheduling cost is measured:
+	{
+		const uint32_t jobCount = 100000;
+		timer.record();
+		wiJobSystem::Dispatch(ctx, jobCount, 1, [](wiJobArgs args) {});
+		wiJobSystem::Wait(ctx);
+		double time = timer.elapsed();
+		ss << "Dispatching " << jobCount << " empty jobs took " << time << " milliseconds (" << time * 1000000.0 / jobCount << " nanoseconds per job)" << std::endl;
+	}
+
+	ss << std::endl;
+	ss << "4) Scaling test:" << std::endl;
+
+	// The same workload is split into an increasing number of groups, so at most that many threads can work on it:
+	{
+		const uint32_t maxThreads = wiJobSystem::GetThreadCount() + 1; // +1: the waiting thread also works
+		std::vector<wiScene::CameraComponent> dataSet(itemCount);
+		double baseline = 0;
+		for (uint32_t threads = 1; ; threads = std::min(threads * 2, maxThreads))
+		{
+			timer.record();
+			wiJobSystem::Dispatch(ctx, itemCount, wiJobSystem::DispatchGroupCount(itemCount, threads), [&](wiJobArgs args) {
+				dataSet[args.jobIndex].UpdateCamera();
+			});
+			wiJobSystem::Wait(ctx);
+			double time = timer.elapsed();
+			if (threads == 1)
+			{
+				baseline = time;
+			}
+			ss << threads << " thread(s): " << time << " milliseconds (speedup: " << baseline / std::max(time, 0.001) << "x)" << std::endl;
+			if (threads == maxThreads)
+			{
+				break;
+			}
+		}
+	}
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunFrustumCullingTest()
+{
+	wiTimer timer;
+
+	// This will compare culling random bounding boxes one by one against culling them in batches and with the bounding volume hierarchy
+	std::stringstream ss("");
+	ss << "Frustum culling performance test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunFrustumCullingTest() function." << std::endl << std::endl;
+
+	CameraComponent camera;
+	camera.CreatePerspective(1920, 1080, 0.1f, 1000);
+	camera.UpdateCamera();
+	Frustum frustum = camera.frustum;
+
+	for (uint32_t itemCount : { 10000u, 100000u, 1000000u })
+	{
+		// Boxes are scattered around the camera, so roughly a tenth of them are visible:
+		std::vector<AABB> dataSet(itemCount);
+		for (uint32_t i = 0; i < itemCount; ++i)
+		{
+			XMFLOAT3 center = XMFLOAT3((float)wiRandom::getRandom(-1000, 1000), (float)wiRandom::getRandom(-1000, 1000), (float)wiRandom::getRandom(-1000, 1000));
+			dataSet[i].createFromHalfWidth(center, XMFLOAT3(1, 1, 1));
+		}
+
+		ss << itemCount << " boxes:" << std::endl;
+
+		uint32_t visible = 0;
+		timer.record();
+		for (uint32_t i = 0; i < itemCount; ++i)
+		{
+			if (frustum.CheckBoxFast(dataSet[i]))
+			{
+				visible++;
+			}
+		}
+		double time = timer.elapsed();
+		ss << "Simple loop took " << time << " milliseconds (" << visible << " visible)" << std::endl;
+
+		AABB_SoA soa;
+		soa.resize(itemCount);
+		for (uint32_t i = 0; i < itemCount; ++i)
+		{
+			soa.set(i, dataSet[i]);
+		}
+		std::vector<uint32_t> visibility_mask(soa.capacity / 32);
+		visible = 0;
+		timer.record();
+		frustum.CheckBoxesFast(soa, visibility_mask.data());
+		for (uint32_t mask : visibility_mask)
+		{
+			for (; mask != 0; mask &= mask - 1)
+			{
+				visible++;
+			}
+		}
+		time = timer.elapsed();
+		ss << "Frustum::CheckBoxesFast() took " << time << " milliseconds (" << visible << " visible)" << std::endl;
+
+		wiBVH bvh;
+		timer.record();
+		bvh.Build(dataSet.data(), itemCount);
+		time = timer.elapsed();
+		ss << "wiBVH::Build() took " << time << " milliseconds" << std::endl;
+
+		for (AABB& aabb : dataSet)
+		{
+			aabb = aabb.transform(XMMatrixTranslation(0.1f, 0, 0));
+		}
+		timer.record();
+		bvh.Refit(dataSet.data());
+		time = timer.elapsed();
+		ss << "wiBVH::Refit() took " << time << " milliseconds" << std::endl;
+
+		visible = 0;
+		timer.record();
+		bvh.Cull(frustum, [&](uint32_t index, bool fully_inside) {
+			if (fully_inside || frustum.CheckBoxFast(dataSet[index]))
+			{
+				visible++;
+			}
+		});
+		time = timer.elapsed();
+		ss << "wiBVH::Cull() took " << time << " milliseconds (" << visible << " visible)" << std::endl;
+
+		// Streaming: boxes are added and removed a few at a time (removed like in a ComponentManager, the last one is moved into its place)
+		//	Update() puts the new boxes next to the tree and refits it, instead of building a new tree every time
+		const uint32_t streamCount = std::max(1u, itemCount / 1000);
+		const uint32_t updateCount = 100;
+		timer.record();
+		for (uint32_t update = 0; update < updateCount; ++update)
+		{
+			for (uint32_t i = 0; i < streamCount; ++i)
+			{
+				if (update % 2 == 0)
+				{
+					XMFLOAT3 center = XMFLOAT3((float)wiRandom::getRandom(-1000, 1000), (float)wiRandom::getRandom(-1000, 1000), (float)wiRandom::getRandom(-1000, 1000));
+					dataSet.emplace_back().createFromHalfWidth(center, XMFLOAT3(1, 1, 1));
+				}
+				else
+				{
+					dataSet[wiRandom::getRandom(0, (int)dataSet.size() - 1)] = dataSet.back();
+					dataSet.pop_back();
+				}
+			}
+			bvh.Update(dataSet.data(), (uint32_t)dataSet.size());
+		}
+		time = timer.elapsed();
+		ss << "wiBVH::Update() with " << streamCount << " boxes added or removed took " << time / updateCount << " milliseconds per update" << std::endl;
+
+		visible = 0;
+		bvh.Cull(frustum, [&](uint32_t index, bool fully_inside) {
+			if (fully_inside || frustum.CheckBoxFast(dataSet[index]))
+			{
+				visible++;
+			}
+		});
+		uint32_t expected = 0;
+		for (const AABB& aabb : dataSet)
+		{
+			if (frustum.CheckBoxFast(aabb))
+			{
+				expected++;
+			}
+		}
+		ss << "wiBVH::Cull() after streaming: " << visible << " visible (" << expected << " expected)" << std::endl << std::endl;
+	}
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunECSLookupTest()
+{
+	wiTimer timer;
+
+	// This will compare the paged entity lookup table of component managers against the default hash map based one
+	std::stringstream ss("");
+	ss << "ECS entity lookup performance test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunECSLookupTest() function." << std::endl << std::endl;
+
+	const uint32_t itemCount = 1000000;
+	std::vector<wiECS::Entity> entities(itemCount);
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		entities[i] = wiECS::CreateEntity();
+	}
+	std::vector<wiECS::Entity> shuffled = entities;
+	for (uint32_t i = itemCount - 1; i > 0; --i)
+	{
+		std::swap(shuffled[i], shuffled[wiRandom::getRandom(0, (int)i)]);
+	}
+
+	auto test = [&](auto& manager, const char* name) {
+		ss << name << ":" << std::endl;
+
+		timer.record();
+		for (wiECS::Entity entity : entities)
+		{
+			manager.Create(entity).layerMask = 1;
+		}
+		double time = timer.elapsed();
+		ss << "Create() took " << time << " milliseconds" << std::endl;
+
+		uint32_t sum = 0;
+		timer.record();
+		for (wiECS::Entity entity : shuffled)
+		{
+			sum += manager.GetComponent(entity)->layerMask;
+		}
+		time = timer.elapsed();
+		ss << "GetComponent() in random order took " << time << " milliseconds (" << sum << " found)" << std::endl;
+
+		timer.record();
+		for (wiECS::Entity entity : shuffled)
+		{
+			manager.Remove(entity);
+		}
+		time = timer.elapsed();
+		ss << "Remove() in random order took " << time << " milliseconds" << std::endl << std::endl;
+	};
+
+	{
+		wiECS::ComponentManager<wiScene::LayerComponent, wiECS::EntityLookup> manager;
+		test(manager, "wiECS::EntityLookup");
+	}
+	{
+		wiECS::ComponentManager<wiScene::LayerComponent, wiECS::EntityHashLookup> manager;
+		test(manager, "wiECS::EntityHashLookup");
+	}
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunHierarchyUpdateTest()
+{
+	wiTimer timer;
+
+	// This will compare the serial transform hierarchy update against the parallel one that processes the hierarchy level by level
+	std::stringstream ss("");
+	ss << "Hierarchy update test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunHierarchyUpdateTest() function." << std::endl << std::endl;
+
+	// Two identical scenes, each with a lot of random trees:
+	const uint32_t itemCount = 100000;
+	wiScene::Scene scenes[2];
+	for (uint32_t i = 0; i < itemCount; ++i)
+	{
+		wiECS::Entity entity = wiECS::CreateEntity();
+		const XMFLOAT3 translation = XMFLOAT3((float)wiRandom::getRandom(-10, 10), (float)wiRandom::getRandom(-10, 10), (float)wiRandom::getRandom(-10, 10));
+		const XMFLOAT3 rotation = XMFLOAT3(wiRandom::getRandom(0, 100) * 0.01f, wiRandom::getRandom(0, 100) * 0.01f, 0);
+		const uint32_t layerMask = wiRandom::getRandom(1u, ~0u);
+		// Parents are created before children, so the hierarchy can be created directly in the correct order:
+		const bool attached = i > 0 && wiRandom::getRandom(0, 99) > 0;
+		const size_t parent = attached ? (size_t)wiRandom::getRandom(std::max(0, (int)i - 100), (int)i - 1) : 0;
+		for (wiScene::Scene& scene : scenes)
+		{
+			TransformComponent& transform = scene.transforms.Create(entity);
+			transform.Translate(translation);
+			transform.RotateRollPitchYaw(rotation);
+			transform.UpdateTransform();
+			scene.layers.Create(entity).layerMask = layerMask;
+			if (attached)
+			{
+				scene.hierarchy.Create(entity).parentID = scene.transforms.GetEntity(parent);
+			}
+		}
+	}
+
+	// Reference serial update in component order:
+	wiScene::Scene& reference = scenes[0];
+	timer.record();
+	for (size_t i = 0; i < reference.hierarchy.GetCount(); ++i)
+	{
+		const HierarchyComponent& parentcomponent = reference.hierarchy[i];
+		wiECS::Entity entity = reference.hierarchy.GetEntity(i);
+
+		TransformComponent* transform_child = reference.transforms.GetComponent(entity);
+		TransformComponent* transform_parent = reference.transforms.GetComponent(parentcomponent.parentID);
+		if (transform_child != nullptr && transform_parent != nullptr)
+		{
+			transform_child->UpdateTransform_Parented(*transform_parent);
+		}
+
+		LayerComponent* layer_child = reference.layers.GetComponent(entity);
+		LayerComponent* layer_parent = reference.layers.GetComponent(parentcomponent.parentID);
+		if (layer_child != nullptr && layer_parent != nullptr)
+		{
+			layer_child->propagationMask = layer_parent->GetLayerMask();
+		}
+	}
+	double time = timer.elapsed();
+	ss << "Serial update of " << reference.hierarchy.GetCount() << " nodes took " << time << " milliseconds" << std::endl;
+
+	wiScene::Scene& scene = scenes[1];
+	wiJobSystem::context ctx;
+	timer.record();
+	scene.RunHierarchyUpdateSystem(ctx);
+	wiJobSystem::Wait(ctx);
+	time = timer.elapsed();
+	ss << "Scene::RunHierarchyUpdateSystem() took " << time << " milliseconds (" << scene.hierarchy_level_offsets.size() - 1 << " levels)" << std::endl;
+
+	timer.record();
+	scene.RunHierarchyUpdateSystem(ctx);
+	wiJobSystem::Wait(ctx);
+	time = timer.elapsed();
+	ss << "Scene::RunHierarchyUpdateSystem() with cached levels took " << time << " milliseconds" << std::endl;
+
+	bool match = true;
+	for (size_t i = 0; i < itemCount; ++i)
+	{
+		match &= std::memcmp(&reference.transforms[i].world, &scene.transforms[i].world, sizeof(XMFLOAT4X4)) == 0;
+		match &= reference.layers[i].propagationMask == scene.layers[i].propagationMask;
+	}
+	ss << "Results are " << (match ? "bit exact" : "DIFFERENT") << std::endl;
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunSceneQueryTest()
+{
+	wiTimer timer;
+
+	// This will measure the Pick, PickAny, SceneIntersectSphere and SceneIntersectCapsule scene queries against high poly meshes
+	std::stringstream ss("");
+	ss << "Scene query test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunSceneQueryTest() function." << std::endl << std::endl;
+
+	// 4 random terrain patches, about 1 million triangles in total:
+	const uint32_t patchCount = 4;
+	const uint32_t quadCount = 354; // quads per side of a patch
+	const float patchSize = 100;
+	wiScene::Scene scene;
+	Entity material = scene.Entity_CreateMaterial("material");
+	for (uint32_t patch = 0; patch < patchCount; ++patch)
+	{
+		Entity meshEntity = scene.Entity_CreateMesh("mesh");
+		MeshComponent& mesh = *scene.meshes.GetComponent(meshEntity);
+		XMFLOAT3 _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint32_t y = 0; y <= quadCount; ++y)
+		{
+			for (uint32_t x = 0; x <= quadCount; ++x)
+			{
+				const XMFLOAT3 pos = XMFLOAT3(x * patchSize / quadCount, wiRandom::getRandom(0, 100) * 0.01f, y * patchSize / quadCount);
+				mesh.vertex_positions.push_back(pos);
+				mesh.vertex_normals.push_back(XMFLOAT3(0, 1, 0));
+				_min = wiMath::Min(_min, pos);
+				_max = wiMath::Max(_max, pos);
+			}
+		}
+		for (uint32_t y = 0; y < quadCount; ++y)
+		{
+			for (uint32_t x = 0; x < quadCount; ++x)
+			{
+				const uint32_t i = y * (quadCount + 1) + x;
+				mesh.indices.push_back(i);
+				mesh.indices.push_back(i + quadCount + 1);
+				mesh.indices.push_back(i + 1);
+				mesh.indices.push_back(i + 1);
+				mesh.indices.push_back(i + quadCount + 1);
+				mesh.indices.push_back(i + quadCount + 2);
+			}
+		}
+		mesh.subsets.emplace_back();
+		mesh.subsets.back().materialID = material;
+		mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size();
+		mesh.aabb = AABB(_min, _max);
+
+		Entity objectEntity = scene.Entity_CreateObject("object");
+		scene.objects.GetComponent(objectEntity)->meshID = meshEntity;
+		scene.transforms.GetComponent(objectEntity)->Translate(XMFLOAT3((patch % 2) * patchSize, 0, (patch / 2) * patchSize));
+	}
+	scene.Update(0);
+	ss << "Scene has " << patchCount * quadCount * quadCount * 2 << " triangles" << std::endl;
+
+	// The first query builds the triangle BVH of the meshes that it touches, this is measured separately:
+	timer.record();
+	for (uint32_t patch = 0; patch < patchCount; ++patch)
+	{
+		const XMFLOAT3 origin = XMFLOAT3((patch % 2 + 0.5f) * patchSize, 10, (patch / 2 + 0.5f) * patchSize);
+		Pick(RAY(origin, XMFLOAT3(0, -1, 0)), RENDERTYPE_ALL, ~0u, scene);
+	}
+	double time = timer.elapsed();
+	ss << "Building the triangle BVHs took " << time << " milliseconds" << std::endl;
+
+	const uint32_t queryCounts[] = { 1000, 10000, 100000 };
+	for (uint32_t queryCount : queryCounts)
+	{
+		std::vector<XMFLOAT3> positions(queryCount);
+		for (XMFLOAT3& pos : positions)
+		{
+			pos = XMFLOAT3(wiRandom::getRandom(0, 1000) * 0.002f * patchSize, wiRandom::getRandom(0, 100) * 0.01f, wiRandom::getRandom(0, 1000) * 0.002f * patchSize);
+		}
+
+		uint32_t hits = 0;
+		timer.record();
+		for (const XMFLOAT3& pos : positions)
+		{
+			PickResult result = Pick(RAY(XMFLOAT3(pos.x, 10, pos.z), XMFLOAT3(0.1f, -1, 0.1f)), RENDERTYPE_ALL, ~0u, scene);
+			hits += result.entity != INVALID_ENTITY ? 1 : 0;
+		}
+		time = timer.elapsed();
+		ss << queryCount << " Pick: " << time << " milliseconds, " << hits << " hits" << std::endl;
+
+		// The same rays as a batch, distributed on the job system:
+		std::vector<RayQuery> queries(queryCount);
+		for (uint32_t i = 0; i < queryCount; ++i)
+		{
+			queries[i].ray = RAY(XMFLOAT3(positions[i].x, 10, positions[i].z), XMFLOAT3(0.1f, -1, 0.1f));
+			queries[i].renderTypeMask = RENDERTYPE_ALL;
+		}
+		std::vector<PickResult> results(queryCount);
+		timer.record();
+		Pick(queries.data(), queryCount, results.data(), scene);
+		time = timer.elapsed();
+		hits = 0;
+		for (const PickResult& result : results)
+		{
+			hits += result.entity != INVALID_ENTITY ? 1 : 0;
+		}
+		ss << queryCount << " batched Pick: " << time << " milliseconds, " << hits << " hits" << std::endl;
+
+		std::unique_ptr<bool[]> occluded(new bool[queryCount]);
+		timer.record();
+		PickAny(queries.data(), queryCount, occluded.get(), scene);
+		time = timer.elapsed();
+		hits = 0;
+		for (uint32_t i = 0; i < queryCount; ++i)
+		{
+			hits += occluded[i] ? 1 : 0;
+		}
+		ss << queryCount << " batched PickAny: " << time << " milliseconds, " << hits << " hits" << std::endl;
+
+		hits = 0;
+		timer.record();
+		for (const XMFLOAT3& pos : positions)
+		{
+			SceneIntersectSphereResult result = SceneIntersectSphere(SPHERE(pos, 0.5f), RENDERTYPE_ALL, ~0u, scene);
+			hits += result.entity != INVALID_ENTITY ? 1 : 0;
+		}
+		time = timer.elapsed();
+		ss << queryCount << " SceneIntersectSphere: " << time << " milliseconds, " << hits << " hits" << std::endl;
+
+		hits = 0;
+		timer.record();
+		for (const XMFLOAT3& pos : positions)
+		{
+			SceneIntersectSphereResult result = SceneIntersectCapsule(CAPSULE(SPHERE(pos, 0.5f), 2), RENDERTYPE_ALL, ~0u, scene);
+			hits += result.entity != INVALID_ENTITY ? 1 : 0;
+		}
+		time = timer.elapsed();
+		ss << queryCount << " SceneIntersectCapsule: " << time << " milliseconds, " << hits << " hits" << std::endl;
+	}
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunArchiveTest()
+{
+	wiTimer timer;
+
+	// This will compare the loading of a scene file in an older archive version against the same scene saved in the current version
+	std::stringstream ss("");
+	ss << "Archive test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunArchiveTest() function." << std::endl << std::endl;
+
+	const std::string fileName = "../Content/models/volumetric_test.wiscene";
+	std::vector<uint8_t> filedata;
+	timer.record();
+	wiHelper::FileRead(fileName, filedata);
+	double time = timer.elapsed();
+	ss << "Reading the whole file took " << time << " milliseconds" << std::endl;
+
+	// Where the file can be mapped into memory, opening the archive doesn't read the file up front:
+	timer.record();
+	{
+		wiArchive archive(fileName);
+	}
+	time = timer.elapsed();
+	ss << "Opening the archive took " << time << " milliseconds" << std::endl;
+
+	const int iterations = 10;
+	time = 0;
+	uint64_t version = 0;
+	wiScene::Scene scene;
+	for (int i = 0; i < iterations; ++i)
+	{
+		scene.Clear();
+		timer.record();
+		wiArchive archive(fileName);
+		scene.Serialize(archive);
+		time += timer.elapsed();
+		version = archive.GetVersion();
+	}
+	ss << "Archive version " << version << ": " << filedata.size() << " bytes, loaded in " << time / iterations << " milliseconds" << std::endl;
+
+	wiArchive archive;
+	scene.Serialize(archive);
+	const size_t size = archive.GetSize();
+	time = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		wiScene::Scene scene_current;
+		archive.SetReadModeAndResetPos(true);
+		timer.record();
+		scene_current.Serialize(archive);
+		time += timer.elapsed();
+	}
+	ss << "Archive version " << archive.GetVersion() << ": " << size << " bytes, loaded in " << time / iterations << " milliseconds" << std::endl;
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunArchiveCompressionTest()
+{
+	wiTimer timer;
+
+	// This will compress the sample scenes (serialized with the current archive version) with each compression level,
+	//	then compare loading a scene file without and with compression
+	std::stringstream ss("");
+	ss << "Archive compression test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunArchiveCompressionTest() function." << std::endl << std::endl;
+
+	const char* fileNames[] = {
+		"../Content/models/volumetric_test.wiscene",
+		"../Content/models/teapot.wiscene",
+		"../Content/models/blend_instancing_test.wiscene",
+		"../Content/models/cloth_test.wiscene",
+		"../Content/models/shadows_test.wiscene",
+		"../Content/models/emitter_skinned.wiscene",
+		"../Content/models/girl.wiscene",
+		"../Content/models/playground.wiscene",
+	};
+	std::vector<wiArchive> archives;
+	size_t total_size = 0;
+	for (auto& fileName : fileNames)
+	{
+		wiScene::Scene scene;
+		wiArchive file(fileName);
+		scene.Serialize(file);
+		archives.emplace_back();
+		scene.Serialize(archives.back());
+		total_size += archives.back().GetSize();
+	}
+	ss << archives.size() << " scenes, " << total_size / 1024 << " KB in total" << std::endl;
+
+	// Single threaded, in the same sized blocks that the archive files use:
+	const size_t block_size = 256 * 1024;
+	const wiCompression::Level levels[] = { wiCompression::Level::Fast, wiCompression::Level::Default, wiCompression::Level::High };
+	const char* level_names[] = { "Fast", "Default", "High" };
+	for (size_t l = 0; l < arraysize(levels); ++l)
+	{
+		size_t compressed_size = 0;
+		double compress_time = 0;
+		double decompress_time = 0;
+		std::vector<uint8_t> compressed(wiCompression::CompressBound(block_size));
+		std::vector<uint8_t> decompressed(block_size);
+		for (auto& archive : archives)
+		{
+			for (size_t offset = 0; offset < archive.GetSize(); offset += block_size)
+			{
+				const uint8_t* src = archive.GetData() + offset;
+				const size_t src_size = std::min(block_size, archive.GetSize() - offset);
+
+				timer.record();
+				const size_t size = wiCompression::Compress(src, src_size, compressed.data(), compressed.size(), levels[l]);
+				compress_time += timer.elapsed();
+				compressed_size += size;
+
+				timer.record();
+				bool success = wiCompression::Decompress(compressed.data(), size, decompressed.data(), src_size);
+				decompress_time += timer.elapsed();
+				assert(success && memcmp(src, decompressed.data(), src_size) == 0);
+			}
+		}
+		const double megabytes = double(total_size) / (1024.0 * 1024.0);
+		ss << level_names[l] << ": ratio " << double(total_size) / double(compressed_size);
+		ss << ", compress " << megabytes / (compress_time / 1000.0) << " MB/s";
+		ss << ", decompress " << megabytes / (decompress_time / 1000.0) << " MB/s" << std::endl;
+	}
+	ss << std::endl;
+
+	// Loading from files, compressed files are decompressed on the job system while the scene is read:
+	const std::string tempFileName = "archive_compression_test.wiscene";
+	const int iterations = 10;
+	for (auto level : { wiCompression::Level::None, wiCompression::Level::Fast, wiCompression::Level::High })
+	{
+		archives[0].SetReadModeAndResetPos(true);
+		{
+			wiScene::Scene scene;
+			scene.Serialize(archives[0]);
+			wiArchive file(tempFileName, false);
+			file.SetCompression(level);
+			scene.Serialize(file);
+		}
+		std::vector<uint8_t> filedata;
+		wiHelper::FileRead(tempFileName, filedata);
+
+		double time = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			wiScene::Scene scene;
+			timer.record();
+			wiArchive file(tempFileName);
+			scene.Serialize(file);
+			time += timer.elapsed();
+		}
+		const char* name = level == wiCompression::Level::None ? "None" : level_names[int(level) - int(wiCompression::Level::Fast)];
+		ss << "Compression " << name << ": " << fileNames[0] << " is " << filedata.size() / 1024 << " KB, loaded in " << time / iterations << " milliseconds" << std::endl;
+	}
+	std::remove(tempFileName.c_str());
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunAsyncResourceLoadingTest()
+{
+	wiTimer timer;
+
+	// This will load the Sponza textures with the synchronous Load() and the asynchronous LoadAsync(),
+	//	then measure how long the main thread was blocked and how long it took until every texture was ready
+	std::stringstream ss("");
+	ss << "Async resource loading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunAsyncResourceLoadingTest() function." << std::endl << std::endl;
+
+	std::vector<std::string> fileNames;
+	for (auto& entry : std::filesystem::directory_iterator("../Content/models/Sponza/textures"))
+	{
+		fileNames.push_back(entry.path().string());
+	}
+	std::sort(fileNames.begin(), fileNames.end());
+	ss << fileNames.size() << " textures" << std::endl;
+
+	std::vector<std::shared_ptr<wiResource>> resources;
+	resources.reserve(fileNames.size());
+
+	// Synchronous, the caller is blocked until everything is loaded:
+	wiResourceManager::Clear();
+	timer.record();
+	for (auto& fileName : fileNames)
+	{
+		resources.push_back(wiResourceManager::Load(fileName));
+	}
+	const double sync_time = timer.elapsed();
+	ss << "Load(): " << sync_time << " milliseconds" << std::endl;
+	resources.clear();
+
+	// Asynchronous, the requests return immediately and the textures are decoded in the background:
+	wiResourceManager::Clear();
+	timer.record();
+	for (auto& fileName : fileNames)
+	{
+		resources.push_back(wiResourceManager::LoadAsync(fileName));
+	}
+	const double request_time = timer.elapsed();
+	wiResourceManager::WaitAsyncLoads();
+	const double async_time = timer.elapsed();
+	size_t ready = 0;
+	for (auto& resource : resources)
+	{
+		ready += resource->IsReady() ? 1 : 0;
+	}
+	ss << "LoadAsync(): requests returned in " << request_time << " milliseconds, " << ready << " textures ready after " << async_time << " milliseconds" << std::endl;
+	resources.clear();
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunResourceBudgetTest()
+{
+	wiTimer timer;
+
+	// This will load the Sponza textures, release them and see how the memory budget keeps them in memory,
+	//	then lower the budget so that the least recently used ones are evicted, and request every texture again
+	std::stringstream ss("");
+	ss << "Resource memory budget test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunResourceBudgetTest() function." << std::endl << std::endl;
+
+	auto print_stats = [&](const char* title) {
+		const wiResourceManager::Stats stats = wiResourceManager::GetStats();
+		ss << title << ": " << stats.texture_count << " textures (" << stats.texture_memory / (1024 * 1024) << " MB), ";
+		ss << stats.cached_count << " cached (" << stats.cached_memory / (1024 * 1024) << " MB), ";
+		ss << stats.evicted_count << " evicted, " << stats.reloaded_count << " reloaded, budget: " << stats.budget / (1024 * 1024) << " MB" << std::endl;
+	};
+
+	std::vector<std::string> fileNames;
+	for (auto& entry : std::filesystem::directory_iterator("../Content/models/Sponza/textures"))
+	{
+		fileNames.push_back(entry.path().string());
+	}
+	std::sort(fileNames.begin(), fileNames.end());
+
+	const size_t budget = wiResourceManager::GetMemoryBudget();
+	wiResourceManager::Clear();
+	wiResourceManager::SetMemoryBudget(1024ull * 1024ull * 1024ull);
+
+	std::vector<std::shared_ptr<wiResource>> resources;
+	timer.record();
+	for (auto& fileName : fileNames)
+	{
+		resources.push_back(wiResourceManager::Load(fileName));
+	}
+	const double load_time = timer.elapsed();
+	print_stats("Loaded");
+
+	// Released resources stay in memory within the budget:
+	resources.clear();
+	wiResourceManager::UpdateMemoryBudget();
+	print_stats("Released");
+
+	timer.record();
+	for (auto& fileName : fileNames)
+	{
+		resources.push_back(wiResourceManager::Load(fileName));
+	}
+	const double cached_time = timer.elapsed();
+	resources.clear();
+	wiResourceManager::UpdateMemoryBudget();
+
+	// With a lower budget, the least recently used are evicted and loaded again when requested:
+	wiResourceManager::SetMemoryBudget(64ull * 1024ull * 1024ull);
+	wiResourceManager::UpdateMemoryBudget();
+	print_stats("Budget lowered");
+
+	timer.record();
+	for (auto& fileName : fileNames)
+	{
+		resources.push_back(wiResourceManager::Load(fileName));
+	}
+	const double reload_time = timer.elapsed();
+	print_stats("Requested again");
+	resources.clear();
+
+	ss << std::endl << "Load: " << load_time << " ms, requested from cache: " << cached_time << " ms, requested after eviction: " << reload_time << " ms" << std::endl;
+
+	wiResourceManager::SetMemoryBudget(budget);
+	wiResourceManager::UpdateMemoryBudget();
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunTextureStreamingTest()
+{
+	// This will simulate a camera moving through an open level with textured objects, and make streaming decisions every frame
+	//	Then compare the resident texture memory to the full mip chains, and count the frames where a texture had less resolution than requested
+	std::stringstream ss("");
+	ss << "Texture streaming test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunTextureStreamingTest() function." << std::endl << std::endl;
+
+	const uint32_t textureCount = 1000;
+	const uint32_t frameCount = 1000;
+	const float screenHeight = 1080;
+	const float screenScale = screenHeight / std::tan(XM_PI / 6.0f);
+
+	struct StreamingObject
+	{
+		XMFLOAT3 position;
+		float radius;
+	};
+	std::vector<StreamingObject> objects(textureCount);
+	std::vector<wiTextureStreaming::Texture> textures(textureCount);
+	size_t full_memory = 0;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		objects[i].position = XMFLOAT3(wiRandom::getRandom(-1000, 1000) * 1.0f, 0, wiRandom::getRandom(-1000, 1000) * 1.0f);
+		objects[i].radius = wiRandom::getRandom(1, 10) * 1.0f;
+
+		auto& texture = textures[i];
+		texture.width = 1024u << wiRandom::getRandom(0, 2);
+		texture.height = texture.width;
+		texture.mip_count = (uint32_t)std::log2(texture.width) + 1;
+		texture.block_size = 4; // BC7
+		texture.block_bytes = 16;
+		full_memory += wiTextureStreaming::ComputeMemorySize(texture, 0);
+	}
+
+	wiTextureStreaming::Settings settings;
+	for (auto& texture : textures)
+	{
+		texture.resident_lod = wiTextureStreaming::GetMaxLOD(texture, settings); // only the low mips are loaded initially
+	}
+
+	size_t memory_sum = 0;
+	size_t memory_max = 0;
+	uint32_t changes = 0;
+	uint32_t underresolved = 0;
+	wiTimer timer;
+	double time = 0;
+	for (uint32_t frame = 0; frame < frameCount; ++frame)
+	{
+		// The camera moves along the level, it sees objects in front of it up to a distance:
+		const XMFLOAT3 eye = XMFLOAT3(-1000.0f + 2000.0f * frame / frameCount, 2, 0);
+		for (uint32_t i = 0; i < textureCount; ++i)
+		{
+			auto& texture = textures[i];
+			const float distance = std::max(wiMath::Distance(eye, objects[i].position) - objects[i].radius, 0.1f);
+			const bool visible = objects[i].position.x > eye.x && distance < 500;
+			texture.requested_resolution = visible ? objects[i].radius / distance * screenScale : 0;
+			if (visible && (std::max(texture.width, texture.height) >> texture.resident_lod) < std::min(texture.requested_resolution, (float)texture.width) * 0.5f)
+			{
+				underresolved++; // less than half the requested resolution is resident
+			}
+		}
+
+		timer.record();
+		const size_t memory = wiTextureStreaming::Update(textures.data(), textures.size(), settings);
+		time += timer.elapsed();
+
+		// The decisions are applied immediately in this simulation:
+		for (auto& texture : textures)
+		{
+			changes += texture.target_lod != texture.resident_lod ? 1 : 0;
+			texture.resident_lod = texture.target_lod;
+		}
+		memory_sum += memory;
+		memory_max = std::max(memory_max, memory);
+	}
+
+	ss << textureCount << " textures, " << frameCount << " frames" << std::endl;
+	ss << "Full mip chains: " << full_memory / (1024 * 1024) << " MB" << std::endl;
+	ss << "Streaming: average " << memory_sum / frameCount / (1024 * 1024) << " MB, peak " << memory_max / (1024 * 1024) << " MB" << std::endl;
+	ss << "Mip level changes: " << changes << ", underresolved texture frames: " << underresolved << std::endl;
+	ss << "Streaming decisions: " << time / frameCount << " milliseconds per frame" << std::endl;
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunTextureCookerTest()
+{
+	wiTimer timer;
+
+	// This will compress a Sponza texture with every block compression format of the texture cooker,
+	//	measure the throughput and the quality (PSNR of the decompressed image), then cook it with mips and load the cooked file with the resource manager
+	std::stringstream ss("");
+	ss << "Texture cooker test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunTextureCookerTest() function." << std::endl << std::endl;
+
+	const std::string sourceFileName = "../Content/models/Sponza/textures/background.png";
+	std::vector<uint8_t> filedata;
+	int width = 0, height = 0, bpp = 0;
+	uint8_t* rgba = nullptr;
+	if (wiHelper::FileRead(sourceFileName, filedata))
+	{
+		rgba = stbi_load_from_memory(filedata.data(), (int)filedata.size(), &width, &height, &bpp, 4);
+	}
+	if (rgba == nullptr)
+	{
+		ss << "Failed to load " << sourceFileName << std::endl;
+	}
+	else
+	{
+		const uint32_t threadCount = wiJobSystem::GetThreadCount();
+		const double megapixels = double(width) * double(height) / 1000000.0;
+		ss << width << " x " << height << " image, " << threadCount << " threads" << std::endl;
+
+		struct Test
+		{
+			wiGraphics::FORMAT format;
+			const char* name;
+			uint32_t channels; // compared channels for PSNR
+		};
+		const Test tests[] = {
+			{ wiGraphics::FORMAT_BC1_UNORM, "BC1", 3 },
+			{ wiGraphics::FORMAT_BC3_UNORM, "BC3", 4 },
+			{ wiGraphics::FORMAT_BC5_UNORM, "BC5", 2 },
+			{ wiGraphics::FORMAT_BC7_UNORM, "BC7", 4 },
+		};
+		for (auto& test : tests)
+		{
+			std::vector<uint8_t> blocks(wiTextureCooker::GetCompressedSize(width, height, test.format));
+			timer.record();
+			wiTextureCooker::Compress(rgba, width, height, test.format, wiTextureCooker::Quality::Default, blocks.data());
+			const double time = timer.elapsed();
+
+			std::vector<uint8_t> decompressed;
+			wiTextureCooker::Decompress(blocks.data(), width, height, test.format, decompressed);
+			double error = 0;
+			for (size_t i = 0; i < size_t(width) * size_t(height); ++i)
+			{
+				for (uint32_t c = 0; c < test.channels; ++c)
+				{
+					const double d = double(rgba[i * 4 + c]) - double(decompressed[i * 4 + c]);
+					error += d * d;
+				}
+			}
+			error /= double(width) * double(height) * test.channels;
+			const double psnr = error > 0 ? 10.0 * std::log10(255.0 * 255.0 / error) : 99.0;
+
+			const double throughput = megapixels / (time / 1000.0);
+			ss << test.name << ": " << time << " ms, " << throughput << " Mpixels/s (" << throughput / threadCount << " per core), PSNR: " << psnr << " dB" << std::endl;
+		}
+
+		// Cook with mips and compare with the RGBA8 texture that the source image would be loaded as:
+		wiTextureCooker::Settings settings;
+		settings.format = wiGraphics::FORMAT_BC7_UNORM;
+		std::vector<uint8_t> cooked;
+		timer.record();
+		wiTextureCooker::Cook(rgba, width, height, settings, cooked);
+		const double cook_time = timer.elapsed();
+		const size_t rgba_size = size_t(width) * size_t(height) * 4 * 4 / 3;
+		ss << std::endl << "Cooked BC7 with mips: " << cook_time << " ms, " << cooked.size() / 1024 << " KB (RGBA8 with mips: " << rgba_size / 1024 << " KB)" << std::endl;
+
+		// The resource manager loads the cooked file instead of the source image:
+		const std::string testFileName = (std::filesystem::temp_directory_path() / "wiTextureCookerTest.png").string();
+		const std::string cookedFileName = wiTextureCooker::GetCookedFileName(testFileName);
+		wiHelper::FileWrite(testFileName, filedata.data(), filedata.size());
+		wiResourceManager::Clear();
+		timer.record();
+		auto resource = wiResourceManager::Load(testFileName);
+		const double source_time = timer.elapsed();
+		resource.reset();
+		wiResourceManager::Clear();
+
+		wiHelper::FileWrite(cookedFileName, cooked.data(), cooked.size());
+		timer.record();
+		resource = wiResourceManager::Load(testFileName);
+		const double cooked_time = timer.elapsed();
+		const bool cooked_format = resource != nullptr && resource->texture.GetDesc().Format == wiGraphics::FORMAT_BC7_UNORM;
+		resource.reset();
+		wiResourceManager::Clear();
+
+		// When the source image is modified after cooking, the cooked file is not used:
+		std::filesystem::last_write_time(testFileName, std::filesystem::last_write_time(cookedFileName) + std::chrono::hours(1));
+		resource = wiResourceManager::Load(testFileName);
+		const bool stale_skipped = resource != nullptr && resource->texture.GetDesc().Format != wiGraphics::FORMAT_BC7_UNORM;
+		resource.reset();
+		wiResourceManager::Clear();
+		std::filesystem::remove(testFileName);
+		std::filesystem::remove(cookedFileName);
+		ss << "Load source image: " << source_time << " ms, load cooked: " << cooked_time << " ms" << (cooked_format ? "" : " (the cooked file was not used!)") << (stale_skipped ? "" : " (the outdated cooked file was used!)") << std::endl;
+
+		stbi_image_free(rgba);
+	}
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::RunMeshNormalsTest()
+{
+	wiTimer timer;
+
+	// This will create unwelded triangle meshes (like a 3D scan) of increasing size, and compute smooth normals, which also welds the vertices
+	//	On the smallest mesh, the result is also compared with the previous implementation, which compared every vertex with every triangle and every other vertex
+	std::stringstream ss("");
+	ss << "Mesh normals test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMeshNormalsTest() function." << std::endl << std::endl;
+
+	auto create_mesh = [](wiScene::MeshComponent& mesh, uint32_t size) {
+		auto position = [](uint32_t x, uint32_t y) {
+			return XMFLOAT3(float(x), std::sin(x * 0.3f) * std::cos(y * 0.2f), float(y));
+		};
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const uint32_t corners[6][2] = { {x,y}, {x + 1,y}, {x,y + 1}, {x + 1,y}, {x + 1,y + 1}, {x,y + 1} };
+				for (auto& corner : corners)
+				{
+					mesh.indices.push_back((uint32_t)mesh.vertex_positions.size());
+					mesh.vertex_positions.push_back(position(corner[0], corner[1]));
+					mesh.vertex_normals.push_back(XMFLOAT3(0, 0, 0));
+					mesh.vertex_uvset_0.push_back(XMFLOAT2(corner[0] * 0.1f, corner[1] * 0.1f));
+				}
+			}
+		}
+		mesh.subsets.emplace_back();
+		mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size();
+	};
+
+	// The previous COMPUTE_NORMALS_SMOOTH implementation, for the vertex streams of the test mesh:
+	auto compute_normals_reference = [](wiScene::MeshComponent& mesh) {
+		auto match = [](const XMFLOAT3& a, const XMFLOAT3& b) {
+			return std::abs(a.x - b.x) < FLT_EPSILON && std::abs(a.y - b.y) < FLT_EPSILON && std::abs(a.z - b.z) < FLT_EPSILON;
+		};
+		for (auto& normal : mesh.vertex_normals)
+		{
+			normal = XMFLOAT3(0, 0, 0);
+		}
+		for (size_t i = 0; i < mesh.vertex_positions.size(); ++i)
+		{
+			for (size_t face = 0; face < mesh.indices.size() / 3; ++face)
+			{
+				const XMFLOAT3& v0 = mesh.vertex_positions[mesh.indices[face * 3 + 0]];
+				const XMFLOAT3& v1 = mesh.vertex_positions[mesh.indices[face * 3 + 1]];
+				const XMFLOAT3& v2 = mesh.vertex_positions[mesh.indices[face * 3 + 2]];
+				if (match(mesh.vertex_positions[i], v0) || match(mesh.vertex_positions[i], v1) || match(mesh.vertex_positions[i], v2))
+				{
+					XMVECTOR N = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&v2) - XMLoadFloat3(&v0), XMLoadFloat3(&v1) - XMLoadFloat3(&v0)));
+					XMStoreFloat3(&mesh.vertex_normals[i], XMLoadFloat3(&mesh.vertex_normals[i]) + N);
+				}
+			}
+		}
+		for (auto& subset : mesh.subsets)
+		{
+			for (uint32_t i = 0; i < subset.indexCount - 1; i++)
+			{
+				const uint32_t ind0 = mesh.indices[subset.indexOffset + i];
+				for (uint32_t j = i + 1; j < subset.indexCount; j++)
+				{
+					const uint32_t ind1 = mesh.indices[subset.indexOffset + j];
+					if (ind1 == ind0)
+						continue;
+					const XMFLOAT2& u0 = mesh.vertex_uvset_0[ind0];
+					const XMFLOAT2& u1 = mesh.vertex_uvset_0[ind1];
+					if (match(mesh.vertex_positions[ind0], mesh.vertex_positions[ind1]) && std::abs(u0.x - u1.x) < FLT_EPSILON && std::abs(u0.y - u1.y) < FLT_EPSILON)
+					{
+						mesh.vertex_positions.erase(mesh.vertex_positions.begin() + ind1);
+						mesh.vertex_normals.erase(mesh.vertex_normals.begin() + ind1);
+						mesh.vertex_uvset_0.erase(mesh.vertex_uvset_0.begin() + ind1);
+						for (auto& index : mesh.indices)
+						{
+							if (index > ind1 && index > 0)
+							{
+								index--;
+							}
+							else if (index == ind1)
+							{
+								index = ind0;
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	for (uint32_t size : { 30u, 100u, 300u })
+	{
+		wiScene::MeshComponent mesh;
+		create_mesh(mesh, size);
+		const size_t vertexCount = mesh.vertex_positions.size();
+
+		wiScene::MeshComponent reference;
+		double reference_time = 0;
+		if (size == 30)
+		{
+			reference = mesh;
+			timer.record();
+			compute_normals_reference(reference);
+			reference_time = timer.elapsed();
+		}
+
+		timer.record();
+		mesh.ComputeNormals(wiScene::MeshComponent::COMPUTE_NORMALS_SMOOTH);
+		const double time = timer.elapsed();
+		ss << vertexCount << " vertices, hash grid: " << time << " ms, welded vertex count: " << mesh.vertex_positions.size() << std::endl;
+
+		if (reference_time > 0)
+		{
+			// Every triangle corner must have the same position, uv and normal direction in both results:
+			size_t mismatches = 0;
+			const bool same_counts = reference.vertex_positions.size() == mesh.vertex_positions.size() && reference.indices.size() == mesh.indices.size();
+			for (size_t i = 0; same_counts && i < mesh.indices.size(); ++i)
+			{
+				const uint32_t a = reference.indices[i];
+				const uint32_t b = mesh.indices[i];
+				const float NdotN = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&reference.vertex_normals[a])), XMVector3Normalize(XMLoadFloat3(&mesh.vertex_normals[b]))));
+				if (a != b ||
+					std::memcmp(&reference.vertex_positions[a], &mesh.vertex_positions[b], sizeof(XMFLOAT3)) != 0 ||
+					std::memcmp(&reference.vertex_uvset_0[a], &mesh.vertex_uvset_0[b], sizeof(XMFLOAT2)) != 0 ||
+					NdotN < 0.9999f)
+				{
+					mismatches++;
+				}
+			}
+			ss << vertexCount << " vertices, previous implementation: " << reference_time << " ms, welded vertex count: " << reference.vertex_positions.size();
+			if (!same_counts)
+			{
+				ss << " (vertex or index count differs!)";
+			}
+			else if (mismatches > 0)
+			{
+				ss << " (" << mismatches << " triangle corners differ!)";
+			}
+			else
+			{
+				ss << " (identical result)";
+			}
+			ss << std::endl;
+		}
+	}
+
 	static wiSpriteFont font;
 	font = wiSpriteFont(ss.str());
 	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
@@ -900,3 +2103,53 @@ void TestsRenderer::RunNetworkTest()
 	font.params.size = 24;
 	AddFont(&font);
 }
+void TestsRenderer::RunCPUPathTracerTest()
+{
+	wiTimer timer;
+
+	// This will trace the teapot scene with the CPU path tracer, without using the GPU
+	//	The result could be compared with RenderPath3D_PathTracing, or used as a reference image
+	std::stringstream ss("");
+	ss << "CPU path tracer test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunCPUPathTracerTest() function." << std::endl << std::endl;
+
+	wiScene::Scene scene;
+	wiScene::LoadModel(scene, "../Content/models/teapot.wiscene");
+	scene.Update(0);
+
+	CameraComponent camera;
+	camera.CreatePerspective(480, 270, 0.1f, 800);
+	TransformComponent transform;
+	transform.Translate(XMFLOAT3(0, 2.f, -4.5f));
+	transform.RotateRollPitchYaw(XMFLOAT3(0.3f, 0, 0));
+	transform.UpdateTransform();
+	camera.TransformCamera(transform);
+	camera.UpdateCamera();
+
+	wiCPUPathTracer tracer;
+	timer.record();
+	tracer.Build(scene);
+	ss << "BVH build: " << timer.elapsed() << " ms, triangles: " << tracer.GetTriangleCount() << std::endl;
+
+	const uint32_t samples = 16;
+	double seconds = 0;
+	uint64_t rays = 0;
+	for (uint32_t sample = 0; sample < samples; ++sample)
+	{
+		tracer.Trace(camera, 480, 270, sample, 4);
+		seconds += tracer.GetStatistics().seconds;
+		rays += tracer.GetStatistics().rays;
+	}
+	const uint32_t threads = tracer.GetStatistics().threads;
+	ss << samples << " samples at 480x270, 4 bounces: " << seconds * 1000 << " ms, " << threads << " threads" << std::endl;
+	ss << "Performance: " << double(rays) / seconds / 1000000.0 << " Mrays/s, " << double(rays) / seconds / threads / 1000000.0 << " Mrays/s per core" << std::endl;
+
+	static wiSpriteFont font;
+	font = wiSpriteFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
@@ -13,6 +13,18 @@ public:
 	void ResizeLayout() override;
 
 	void RunJobSystemTest();
+	void RunFrustumCullingTest();
+	void RunECSLookupTest();
+	void RunHierarchyUpdateTest();
+	void RunSceneQueryTest();
+	void RunArchiveTest();
+	void RunArchiveCompressionTest();
+	void RunAsyncResourceLoadingTest();
+	void RunResourceBudgetTest();
+	void RunTextureStreamingTest();
+	void RunTextureCookerTest();
+	void RunMeshNormalsTest();
+	void RunCPUPathTracerTest();
 	void RunFontTest();
 	void RunSpriteTest();
 	void RunNetworkTest();
@@ -34,6 +34,8 @@ void LoadingScreen::onFinished(std::function<void()> finishFunction)
 
 void LoadingScreen::Start()
 {
+	// Loading tasks are long running, they shouldn't hold back per-frame work:
+	ctx.priority = wiJobSystem::Priority::Background;
 	for (auto& x : tasks)
 	{
 		wiJobSystem::Execute(ctx, x);
@@ -19,6 +19,7 @@
 #include "wiGraphicsDevice_DX11.h"
 #include "wiGraphicsDevice_DX12.h"
 #include "wiGraphicsDevice_Vulkan.h"
+#include "wiGraphicsDevice_Null.h"
 
 #include "Utility/replace_new.h"
 
@@ -334,6 +335,13 @@ void MainComponent::SetWindow(wiPlatform::window_type window, bool fullscreen)
 	{
 		bool debugdevice = wiStartupArguments::HasArgument("debugdevice");
 
+		if (wiStartupArguments::HasArgument("nulldevice"))
+		{
+			// Headless mode, nothing will be rendered:
+			wiRenderer::SetDevice(std::make_shared<GraphicsDevice_Null>(window, fullscreen, debugdevice));
+			return;
+		}
+
 		bool use_dx11 = wiStartupArguments::HasArgument("dx11");
 		bool use_dx12 = wiStartupArguments::HasArgument("dx12");
 		bool use_vulkan = wiStartupArguments::HasArgument("vulkan");
@@ -525,6 +525,19 @@ void RenderPath3D::ResizeBuffers()
 	RenderPath2D::ResizeBuffers();
 }
 
+void RenderPath3D::Load()
+{
+	RenderPath2D::Load();
+
+	// The render passes were created by ResizeBuffers() at this point, so the object pipelines can be compiled while the loading screen is still up:
+	if (wiRenderer::GetPipelinePrewarmEnabled() && renderpass_main.IsValid())
+	{
+		wiRenderer::PrewarmObjectPipelineStates(RENDERPASS_PREPASS, false, &renderpass_depthprepass);
+		wiRenderer::PrewarmObjectPipelineStates(RENDERPASS_MAIN, false, &renderpass_main);
+		wiRenderer::PrewarmObjectPipelineStates(RENDERPASS_MAIN, true, &renderpass_transparent);
+	}
+}
+
 void RenderPath3D::PreUpdate()
 {
 	camera_previous = *camera;
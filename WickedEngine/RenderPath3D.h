@@ -262,6 +262,7 @@ public:
 
 	virtual void setMSAASampleCount(uint32_t value) { if (msaaSampleCount != value) { msaaSampleCount = value; ResizeBuffers(); } }
 
+	void Load() override;
 	void PreUpdate() override;
 	void Update(float dt) override;
 	void Render() const override;
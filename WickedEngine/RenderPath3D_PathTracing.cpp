@@ -60,10 +60,51 @@ void RenderPath3D_PathTracing::ResizeBuffers()
 		device->CreateRenderPass(&desc, &renderpass_debugbvh);
 	}
 
+	CreateCPUTracingBuffers();
+
 	// also reset accumulation buffer state:
 	sam = -1;
 }
 
+void RenderPath3D_PathTracing::CreateCPUTracingBuffers()
+{
+	if (!cpuTracingEnabled || !traceResult.IsValid())
+	{
+		traceResult_cpu = Texture();
+		for (auto& x : traceResult_cpu_upload)
+		{
+			x = Texture();
+		}
+		return;
+	}
+
+	GraphicsDevice* device = wiRenderer::GetDevice();
+
+	TextureDesc desc = traceResult.GetDesc();
+	desc.BindFlags = BIND_SHADER_RESOURCE;
+	device->CreateTexture(&desc, nullptr, &traceResult_cpu);
+	device->SetName(&traceResult_cpu, "traceResult_cpu");
+
+	desc.BindFlags = 0;
+	desc.Usage = USAGE_STAGING;
+	desc.CPUAccessFlags = CPU_ACCESS_WRITE;
+	for (auto& x : traceResult_cpu_upload)
+	{
+		device->CreateTexture(&desc, nullptr, &x);
+		device->SetName(&x, "traceResult_cpu_upload");
+	}
+}
+
+void RenderPath3D_PathTracing::setCPUTracingEnabled(bool value)
+{
+	if (cpuTracingEnabled != value)
+	{
+		cpuTracingEnabled = value;
+		CreateCPUTracingBuffers();
+	}
+	sam = -1;
+}
+
 void RenderPath3D_PathTracing::Update(float dt)
 {
 	setOcclusionCullingEnabled(false);
@@ -108,6 +149,40 @@ void RenderPath3D_PathTracing::Update(float dt)
 	}
 
 	RenderPath3D::Update(dt);
+
+	if (cpuTracingEnabled)
+	{
+		auto range = wiProfiler::BeginRangeCPU("CPU Path Tracing");
+
+		if (sam == 0)
+		{
+			cpuTracer.Build(*scene);
+		}
+		cpuTracer.Trace(*camera, GetInternalResolution().x, GetInternalResolution().y, (uint32_t)sam, wiRenderer::GetRaytraceBounceCount());
+
+		// The result is written into the upload texture of this frame, and it is copied to traceResult_cpu in Render():
+		GraphicsDevice* device = wiRenderer::GetDevice();
+		const Texture& upload = traceResult_cpu_upload[device->GetFrameIndex()];
+		const size_t row_size = cpuTracer.GetWidth() * sizeof(XMFLOAT4);
+		Mapping mapping;
+		mapping._flags = Mapping::FLAG_WRITE;
+		mapping.size = row_size * cpuTracer.GetHeight();
+		if (upload.IsValid())
+		{
+			device->Map(&upload, &mapping);
+		}
+		if (mapping.data != nullptr)
+		{
+			const size_t dst_pitch = std::max(size_t(mapping.rowpitch), row_size);
+			for (uint32_t y = 0; y < cpuTracer.GetHeight(); ++y)
+			{
+				std::memcpy((uint8_t*)mapping.data + y * dst_pitch, (const uint8_t*)cpuTracer.GetResult() + y * row_size, row_size);
+			}
+			device->Unmap(&upload);
+		}
+
+		wiProfiler::EndRange(range); // CPU Path Tracing
+	}
 }
 
 void RenderPath3D_PathTracing::Render() const
@@ -122,7 +197,10 @@ void RenderPath3D_PathTracing::Render() const
 
 		wiRenderer::UpdateRenderData(visibility_main, frameCB, cmd);
 
-		wiRenderer::UpdateRaytracingAccelerationStructures(*scene, cmd);
+		if (!cpuTracingEnabled)
+		{
+			wiRenderer::UpdateRaytracingAccelerationStructures(*scene, cmd);
+		}
 	});
 
 	// Main scene:
@@ -139,7 +217,24 @@ void RenderPath3D_PathTracing::Render() const
 		);
 		wiRenderer::BindCommonResources(cmd);
 
-		if (wiRenderer::GetRaytraceDebugBVHVisualizerEnabled())
+		if (cpuTracingEnabled)
+		{
+			// The scene was traced on the CPU in Update(), only the result is copied:
+			{
+				GPUBarrier barriers[] = {
+					GPUBarrier::Image(&traceResult_cpu, traceResult_cpu.desc.layout, IMAGE_LAYOUT_COPY_DST)
+				};
+				device->Barrier(barriers, arraysize(barriers), cmd);
+			}
+			device->CopyResource(&traceResult_cpu, &traceResult_cpu_upload[device->GetFrameIndex()], cmd);
+			{
+				GPUBarrier barriers[] = {
+					GPUBarrier::Image(&traceResult_cpu, IMAGE_LAYOUT_COPY_DST, traceResult_cpu.desc.layout)
+				};
+				device->Barrier(barriers, arraysize(barriers), cmd);
+			}
+		}
+		else if (wiRenderer::GetRaytraceDebugBVHVisualizerEnabled())
 		{
 			device->RenderPassBegin(&renderpass_debugbvh, cmd);
 
@@ -163,7 +258,7 @@ void RenderPath3D_PathTracing::Render() const
 		}
 
 		wiRenderer::Postprocess_Tonemap(
-			traceResult,
+			cpuTracingEnabled ? traceResult_cpu : traceResult,
 			rtPostprocess_LDR[0],
 			cmd,
 			getExposure(),
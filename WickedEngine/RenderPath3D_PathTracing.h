@@ -1,5 +1,6 @@
 #pragma once
 #include "RenderPath3D.h"
+#include "wiCPUPathTracer.h"
 
 
 class RenderPath3D_PathTracing :
@@ -7,17 +8,28 @@ class RenderPath3D_PathTracing :
 {
 private:
 	int sam = -1;
+	bool cpuTracingEnabled = false;
 
 protected:
 	wiGraphics::Texture traceResult;
+	wiGraphics::Texture traceResult_cpu; // result of the CPU path tracer, copied from the upload texture every frame
+	wiGraphics::Texture traceResult_cpu_upload[wiGraphics::GraphicsDevice::GetBackBufferCount()]; // CPU writable staging textures, one per frame in flight
+
+	wiCPUPathTracer cpuTracer;
 
 	wiGraphics::RenderPass renderpass_debugbvh;
 
 	void ResizeBuffers() override;
+	void CreateCPUTracingBuffers(); // creates or releases the CPU tracing textures, depending on whether CPU tracing is enabled
 
 public:
 	const wiGraphics::Texture* GetDepthStencil() const override { return nullptr; };
 
+	// Trace the scene with the multithreaded CPU path tracer instead of the GPU (see wiCPUPathTracer)
+	void setCPUTracingEnabled(bool value);
+	bool getCPUTracingEnabled() const { return cpuTracingEnabled; }
+	const wiCPUPathTracer& getCPUTracer() const { return cpuTracer; }
+
 	void Update(float dt) override;
 	void Render() const override;
 	void Compose(wiGraphics::CommandList cmd) const override;
@@ -55,6 +55,11 @@
 #include "wiOcean.h"
 #include "wiStartupArguments.h"
 #include "wiGPUBVH.h"
+#include "wiCPUPathTracer.h"
+#include "wiBVH.h"
+#include "wiCompression.h"
+#include "wiTextureStreaming.h"
+#include "wiTextureCooker.h"
 #include "wiGPUSortLib.h"
 #include "wiJobSystem.h"
 #include "wiNetwork.h"
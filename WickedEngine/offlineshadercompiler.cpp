@@ -29,6 +29,7 @@ int main(int argc, char* argv[])
 	std::cout << "\tspirv : \tCompile shaders to spirv (vulkan) format (using dxcompiler)" << std::endl;
 	std::cout << "\trebuild : \tAll shaders will be rebuilt, regardless if they are outdated or not" << std::endl;
 	std::cout << "\tshaderdump : \tShaders will be saved to wiShaderDump.h C++ header file (rebuild is assumed)" << std::endl;
+	std::cout << "\tshadercache=<path> : \tCompiled shaders are stored in and reused from this (local or shared) directory, by the hash of their source" << std::endl;
 	std::cout << "Command arguments used: ";
 
 	wiStartupArguments::Parse(argc, argv);
@@ -62,6 +63,12 @@ int main(int argc, char* argv[])
 		std::cout << "rebuild ";
 	}
 
+	std::string shadercache = wiStartupArguments::GetArgumentValue("shadercache");
+	if (!shadercache.empty())
+	{
+		std::cout << "shadercache=" << shadercache << " ";
+	}
+
 	std::cout << std::endl;
 
 	if (targets.empty())
@@ -480,6 +487,12 @@ int main(int argc, char* argv[])
 
 	std::cout << "[Wicked Engine Offline Shader Compiler] Finished in " << std::setprecision(4) << timer.elapsed_seconds() << " seconds" << std::endl;
 
+	if (!wiShaderCompiler::GetCacheDirectory().empty())
+	{
+		wiShaderCompiler::CacheStatistics statistics = wiShaderCompiler::GetCacheStatistics();
+		std::cout << "[Wicked Engine Offline Shader Compiler] Shader cache: " << statistics.hits << " hits, " << statistics.misses << " misses (hit rate: " << std::setprecision(3) << statistics.GetHitRate() * 100 << "%), " << statistics.writes << " shaders stored" << std::endl;
+	}
+
 	if (shaderdump_enabled)
 	{
 		std::cout << "[Wicked Engine Offline Shader Compiler] Creating ShaderDump..." << std::endl;
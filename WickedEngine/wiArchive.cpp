@@ -1,17 +1,89 @@
 #include "wiArchive.h"
 #include "wiHelper.h"
+#include "wiJobSystem.h"
 
 #include <fstream>
+#include <cassert>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 
 using namespace std;
 
 // this should always be only INCREMENTED and only if a new serialization is implemeted somewhere!
-uint64_t __archiveVersion = 65;
+uint64_t __archiveVersion = 68;
 // this is the version number of which below the archive is not compatible with the current version
 uint64_t __archiveVersionBarrier = 22;
+// archives starting from this version use the compact layout (native size integers, bulk copied arrays)
+uint64_t __archiveVersionCompact = 66;
+// archives starting from this version have a flags field after the version number, which tells if the file is compressed
+uint64_t __archiveVersionCompressed = 68;
+
+static constexpr uint32_t ARCHIVE_FLAG_COMPRESSED = 1 << 0;
+static constexpr size_t COMPRESSION_BLOCK_SIZE = 256 * 1024;
+static constexpr uint32_t COMPRESSION_BLOCK_STORED = 1u << 31; // set in the block size if the block couldn't be compressed
 
 // version history is logged in ArchiveVersionHistory.txt file!
 
+struct wiArchive::BlockDecoder
+{
+	enum STATE
+	{
+		STATE_PENDING,
+		STATE_DECODING,
+		STATE_DONE,
+	};
+	struct Block
+	{
+		size_t source_offset = 0;
+		size_t source_size = 0;
+		bool stored = false;
+		size_t offset = 0; // offset in the decoded archive
+		size_t size = 0;
+	};
+
+	// The compressed file (either of these):
+	std::shared_ptr<const uint8_t> source_mapping;
+	std::vector<uint8_t> source_data;
+	const uint8_t* source = nullptr;
+
+	std::shared_ptr<uint8_t> decoded;
+	size_t header_size = 0;
+	size_t block_size = 0;
+	std::vector<Block> blocks;
+	std::unique_ptr<std::atomic<uint32_t>[]> states;
+	std::atomic<bool> corrupted{ false };
+	wiJobSystem::context ctx;
+
+	~BlockDecoder()
+	{
+		wiJobSystem::Wait(ctx);
+	}
+
+	// Decodes a block if no other thread started it, returns false otherwise
+	bool Decode(size_t index)
+	{
+		uint32_t expected = STATE_PENDING;
+		if (!states[index].compare_exchange_strong(expected, STATE_DECODING))
+		{
+			return false;
+		}
+		const Block& block = blocks[index];
+		uint8_t* dst = decoded.get() + block.offset;
+		if (block.stored)
+		{
+			memcpy(dst, source + block.source_offset, block.size);
+		}
+		else if (!wiCompression::Decompress(source + block.source_offset, block.source_size, dst, block.size))
+		{
+			memset(dst, 0, block.size);
+			corrupted.store(true);
+		}
+		states[index].store(STATE_DONE, std::memory_order_release);
+		return true;
+	}
+};
+
 wiArchive::wiArchive()
 {
 	CreateEmpty();
@@ -23,9 +95,11 @@ wiArchive::wiArchive(const std::string& fileName, bool readMode) : fileName(file
 		directory = wiHelper::GetDirectoryFromPath(fileName);
 		if (readMode)
 		{
-			if (wiHelper::FileRead(fileName, DATA))
+			// The file is mapped if possible, so that it's not copied to memory as a whole before parsing:
+			if (wiHelper::FileMap(fileName, mapping, mapping_size) || wiHelper::FileRead(fileName, DATA))
 			{
 				(*this) >> version;
+				SetVersion(version);
 				if (version < __archiveVersionBarrier)
 				{
 					string ss = "The archive version (" + std::to_string(version) + ") is no longer supported!";
@@ -38,6 +112,15 @@ wiArchive::wiArchive(const std::string& fileName, bool readMode) : fileName(file
 					wiHelper::messageBox(ss.c_str(), "Error!");
 					Close();
 				}
+				if (IsOpen() && version >= __archiveVersionCompressed)
+				{
+					uint32_t flags;
+					(*this) >> flags;
+					if (flags & ARCHIVE_FLAG_COMPRESSED)
+					{
+						OpenCompressed();
+					}
+				}
 			}
 		}
 		else
@@ -52,30 +135,193 @@ void wiArchive::CreateEmpty()
 	readMode = false;
 	pos = 0;
 
-	version = __archiveVersion;
+	SetVersion(__archiveVersion);
 	DATA.resize(128); // starting size
-	(*this) << version;
+	SerializeHeader();
 }
 
-void wiArchive::SetReadModeAndResetPos(bool isReadMode)
+void wiArchive::SetVersion(uint64_t value)
 {
-	readMode = isReadMode; 
-	pos = 0;
+	version = value;
+	compact = version >= __archiveVersionCompact;
+}
 
+void wiArchive::SerializeHeader()
+{
+	// The flags are always zero in memory, they are only used in the files:
 	if (readMode)
 	{
 		(*this) >> version;
+		SetVersion(version);
+		if (version >= __archiveVersionCompressed)
+		{
+			uint32_t flags;
+			(*this) >> flags;
+		}
 	}
 	else
 	{
 		(*this) << version;
+		if (version >= __archiveVersionCompressed)
+		{
+			(*this) << uint32_t(0);
+		}
+	}
+}
+
+void wiArchive::OpenCompressed()
+{
+	auto fail = [&] {
+		wiHelper::messageBox("The archive (" + fileName + ") is corrupted!", "Error!");
+		Close();
+	};
+
+	const size_t header_size = pos;
+	const size_t source_size = mapping != nullptr ? mapping_size : DATA.size();
+	uint64_t payload_size;
+	uint32_t block_size;
+	uint32_t block_count;
+	if (pos + sizeof(payload_size) + sizeof(block_size) + sizeof(block_count) > source_size)
+	{
+		fail();
+		return;
+	}
+	(*this) >> payload_size;
+	(*this) >> block_size;
+	(*this) >> block_count;
+	if (block_size == 0 || block_count != (payload_size + block_size - 1) / block_size || pos + block_count * sizeof(uint32_t) > source_size)
+	{
+		fail();
+		return;
+	}
+
+	auto decoder = std::make_shared<BlockDecoder>();
+	decoder->header_size = header_size;
+	decoder->block_size = block_size;
+	decoder->blocks.resize(block_count);
+	size_t source_offset = pos + block_count * sizeof(uint32_t);
+	for (uint32_t i = 0; i < block_count; ++i)
+	{
+		uint32_t value;
+		(*this) >> value;
+		BlockDecoder::Block& block = decoder->blocks[i];
+		block.stored = (value & COMPRESSION_BLOCK_STORED) != 0;
+		block.source_size = value & ~COMPRESSION_BLOCK_STORED;
+		block.source_offset = source_offset;
+		block.offset = header_size + (size_t)i * block_size;
+		block.size = (size_t)std::min(payload_size - (uint64_t)i * block_size, (uint64_t)block_size);
+		source_offset += block.source_size;
+		if (source_offset > source_size || (block.stored && block.source_size != block.size))
+		{
+			fail();
+			return;
+		}
+	}
+	decoder->states.reset(new std::atomic<uint32_t>[block_count]);
+	for (uint32_t i = 0; i < block_count; ++i)
+	{
+		decoder->states[i].store(BlockDecoder::STATE_PENDING);
+	}
+
+	// The decoder keeps the compressed file alive:
+	decoder->source_mapping = std::move(mapping);
+	decoder->source_data = std::move(DATA);
+	decoder->source = decoder->source_mapping != nullptr ? decoder->source_mapping.get() : decoder->source_data.data();
+	DATA.clear();
+
+	// The decoded archive starts with the uncompressed header:
+	const size_t decoded_size = header_size + (size_t)payload_size;
+	decoder->decoded = std::shared_ptr<uint8_t>(new uint8_t[decoded_size], std::default_delete<uint8_t[]>());
+	memcpy(decoder->decoded.get(), decoder->source, header_size);
+	const uint32_t flags = 0;
+	memcpy(decoder->decoded.get() + header_size - sizeof(flags), &flags, sizeof(flags));
+	mapping = decoder->decoded;
+	mapping_size = decoded_size;
+	pos = header_size;
+	decoded_end = header_size;
+	this->decoder = decoder;
+
+	if (wiJobSystem::GetThreadCount() > 0)
+	{
+		BlockDecoder* ptr = decoder.get();
+		wiJobSystem::Dispatch(decoder->ctx, block_count, 1, [ptr](wiJobArgs args) {
+			ptr->Decode(args.jobIndex);
+		});
+	}
+}
+
+bool wiArchive::WaitDecoded(size_t end)
+{
+	if (decoder == nullptr)
+	{
+		if (!IsOpen())
+		{
+			return false;
+		}
+		decoded_end = ~size_t(0);
+		return true;
+	}
+	BlockDecoder& d = *decoder;
+
+	// Blocks are needed in order, the reader decodes the block itself if no job started it yet:
+	size_t index = (decoded_end - d.header_size) / d.block_size;
+	while (index < d.blocks.size() && d.blocks[index].offset < end)
+	{
+		if (!d.Decode(index))
+		{
+			while (d.states[index].load(std::memory_order_acquire) != BlockDecoder::STATE_DONE)
+			{
+				std::this_thread::yield();
+			}
+		}
+		index++;
+	}
+
+	if (d.corrupted.load())
+	{
+		// Same as the header errors, the archive is closed and the remaining reads are skipped:
+		wiHelper::messageBox("The archive (" + fileName + ") is corrupted!", "Error!");
+		Close();
+		return false;
+	}
+
+	if (index < d.blocks.size())
+	{
+		decoded_end = d.blocks[index].offset;
+	}
+	else
+	{
+		// Everything is decoded, the compressed file is released:
+		decoded_end = ~size_t(0);
+		decoder.reset();
 	}
+	return true;
+}
+
+void wiArchive::SetReadModeAndResetPos(bool isReadMode)
+{
+	if (!isReadMode && mapping != nullptr)
+	{
+		// The file mapping is read only, so it's copied for writing (this is done in read mode, so a corrupted archive is not saved when it's closed):
+		if (WaitDecoded(~size_t(0)))
+		{
+			const uint8_t* data = mapping.get();
+			DATA.assign(data, data + mapping_size);
+		}
+		mapping.reset();
+		mapping_size = 0;
+	}
+
+	readMode = isReadMode; 
+	pos = 0;
+
+	SerializeHeader();
 }
 
 bool wiArchive::IsOpen()
 {
-	// when it is open, DATA is not null because it contains the version number at least!
-	return !DATA.empty();
+	// when it is open, DATA (or the file mapping) is not null because it contains the version number at least!
+	return !DATA.empty() || mapping != nullptr;
 }
 
 void wiArchive::Close()
@@ -85,11 +331,77 @@ void wiArchive::Close()
 		SaveFile(fileName);
 	}
 	DATA.clear();
+	decoder.reset();
+	decoded_end = 0; // reads are skipped until the archive is opened again
+	mapping.reset();
+	mapping_size = 0;
 }
 
 bool wiArchive::SaveFile(const std::string& fileName)
 {
-	return wiHelper::FileWrite(fileName, DATA.data(), pos);
+	const size_t header_size = sizeof(uint64_t) + sizeof(uint32_t);
+	if (compression == wiCompression::Level::None || version < __archiveVersionCompressed || pos < header_size)
+	{
+		return wiHelper::FileWrite(fileName, DATA.data(), pos);
+	}
+
+	// The data after the header is compressed in blocks:
+	const uint8_t* payload = DATA.data() + header_size;
+	const uint64_t payload_size = pos - header_size;
+	const uint32_t block_count = (uint32_t)((payload_size + COMPRESSION_BLOCK_SIZE - 1) / COMPRESSION_BLOCK_SIZE);
+	std::vector<std::vector<uint8_t>> blocks(block_count);
+	std::vector<uint32_t> block_sizes(block_count);
+	auto compress_block = [&](uint32_t i) {
+		const uint8_t* src = payload + (size_t)i * COMPRESSION_BLOCK_SIZE;
+		const size_t src_size = std::min((size_t)payload_size - (size_t)i * COMPRESSION_BLOCK_SIZE, COMPRESSION_BLOCK_SIZE);
+		blocks[i].resize(wiCompression::CompressBound(src_size));
+		// Blocks are only compressed if they get smaller:
+		const size_t size = wiCompression::Compress(src, src_size, blocks[i].data(), src_size - 1, compression);
+		if (size == 0)
+		{
+			blocks[i].assign(src, src + src_size);
+			block_sizes[i] = (uint32_t)src_size | COMPRESSION_BLOCK_STORED;
+		}
+		else
+		{
+			blocks[i].resize(size);
+			block_sizes[i] = (uint32_t)size;
+		}
+	};
+	if (wiJobSystem::GetThreadCount() > 0)
+	{
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, block_count, 1, [&](wiJobArgs args) {
+			compress_block(args.jobIndex);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < block_count; ++i)
+		{
+			compress_block(i);
+		}
+	}
+
+	std::vector<uint8_t> file;
+	auto append = [&](const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		file.insert(file.end(), bytes, bytes + size);
+	};
+	const uint32_t flags = ARCHIVE_FLAG_COMPRESSED;
+	const uint32_t block_size = (uint32_t)COMPRESSION_BLOCK_SIZE;
+	append(&version, sizeof(version));
+	append(&flags, sizeof(flags));
+	append(&payload_size, sizeof(payload_size));
+	append(&block_size, sizeof(block_size));
+	append(&block_count, sizeof(block_count));
+	append(block_sizes.data(), block_sizes.size() * sizeof(uint32_t));
+	for (auto& block : blocks)
+	{
+		append(block.data(), block.size());
+	}
+	return wiHelper::FileWrite(fileName, file.data(), file.size());
 }
 
 const string& wiArchive::GetSourceDirectory() const
@@ -101,3 +413,45 @@ const string& wiArchive::GetSourceFileName() const
 {
 	return fileName;
 }
+
+wiArchive wiArchive::CreateChunk() const
+{
+	wiArchive chunk;
+	chunk.directory = directory; // paths are made relative to the parent archive
+	return chunk;
+}
+
+void wiArchive::WriteChunk(const wiArchive& chunk)
+{
+	assert(!readMode && !chunk.readMode);
+	if (chunk.GetSize() > 0)
+	{
+		_write(*chunk.GetData(), chunk.GetSize());
+	}
+}
+
+wiArchive wiArchive::ReadChunk(size_t size)
+{
+	assert(readMode);
+	if (pos + size > decoded_end && !WaitDecoded(pos + size))
+	{
+		// The archive is closed, so is the chunk:
+		wiArchive chunk;
+		chunk.Close();
+		chunk.readMode = true;
+		return chunk;
+	}
+	wiArchive chunk;
+	chunk.DATA.clear();
+	chunk.pos = 0;
+	chunk.readMode = true;
+	chunk.fileName = fileName;
+	chunk.directory = directory;
+	// The chunk doesn't own the data. It only keeps the file mapping alive if there is one:
+	chunk.mapping = std::shared_ptr<const uint8_t>(mapping, GetData() + pos);
+	chunk.mapping_size = size;
+	pos += size;
+
+	chunk.SerializeHeader();
+	return chunk;
+}
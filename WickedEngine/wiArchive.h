@@ -1,22 +1,39 @@
 #pragma once
 #include "CommonInclude.h"
+#include "wiCompression.h"
 #include <stdint.h>
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <type_traits>
 
 class wiArchive
 {
 private:
 	uint64_t version = 0;
 	bool readMode = false;
+	bool compact = false; // integers are stored at their native size, and arrays of plain data are copied in one go (depends on version)
 	size_t pos = 0;
 	std::vector<uint8_t> DATA;
+	std::shared_ptr<const uint8_t> mapping; // read only file mapping, used instead of DATA when the file could be mapped
+	size_t mapping_size = 0;
+
+	// Compressed files are decompressed block by block on the job system while the archive is being read
+	//	Reading waits only for the blocks up to the current position, so decompression overlaps with parsing
+	struct BlockDecoder;
+	std::shared_ptr<BlockDecoder> decoder;
+	size_t decoded_end = ~size_t(0); // data is readable up to this position without waiting (0 when closed)
+	wiCompression::Level compression = wiCompression::Level::None;
 
 	std::string fileName; // save to this file on closing if not empty
 	std::string directory;
 
 	void CreateEmpty();
+	void SetVersion(uint64_t value);
+	void SerializeHeader();
+	void OpenCompressed();
+	bool WaitDecoded(size_t end); // returns false if the archive is closed, reading must be skipped then
 
 public:
 	// Create empty arhive for writing
@@ -30,7 +47,7 @@ public:
 	wiArchive& operator=(const wiArchive&) = default;
 	wiArchive& operator=(wiArchive&&) = default;
 
-	const uint8_t* GetData() const { return DATA.data(); }
+	const uint8_t* GetData() const { return mapping != nullptr ? mapping.get() : DATA.data(); }
 	size_t GetSize() const { return pos; }
 	uint64_t GetVersion() const { return version; }
 	bool IsReadMode() const { return readMode; }
@@ -41,6 +58,18 @@ public:
 	const std::string& GetSourceDirectory() const;
 	const std::string& GetSourceFileName() const;
 
+	// Set the compression of the file when it's saved (archive version 68+). The archive stays uncompressed in memory
+	//	The file is compressed in independent blocks, so it can be decompressed in parallel and while it is being read
+	void SetCompression(wiCompression::Level level) { compression = level; }
+	wiCompression::Level GetCompression() const { return compression; }
+
+	// Chunks are archives that are embedded into an other archive, so that they can be read independently (for example on multiple threads)
+	//	Write: create the chunk with CreateChunk(), serialize into it, then append it with WriteChunk(). The chunk size must be stored by the caller
+	//	Read: ReadChunk() returns the next chunk of the given size as a read only view into this archive, which must stay alive while the chunk is used
+	wiArchive CreateChunk() const;
+	void WriteChunk(const wiArchive& chunk);
+	wiArchive ReadChunk(size_t size);
+
 	// It could be templated but we have to be extremely careful of different datasizes on different platforms
 	// because serialized data should be interchangeable!
 	// So providing exact copy operations for exact types enforces platform agnosticism
@@ -63,12 +92,26 @@ public:
 	}
 	inline wiArchive& operator<<(int data)
 	{
-		_write((int64_t)data);
+		if (compact)
+		{
+			_write((int32_t)data);
+		}
+		else
+		{
+			_write((int64_t)data);
+		}
 		return *this;
 	}
 	inline wiArchive& operator<<(unsigned int data)
 	{
-		_write((uint64_t)data);
+		if (compact)
+		{
+			_write((uint32_t)data);
+		}
+		else
+		{
+			_write((uint64_t)data);
+		}
 		return *this;
 	}
 	inline wiArchive& operator<<(long data)
@@ -158,6 +201,18 @@ public:
 	{
 		// Here we will use the << operator so that non-specified types will have compile error!
 		(*this) << data.size();
+		if constexpr (IsRawSerializable<T>())
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "raw serialized types must be trivially copyable");
+			if (IsRawSerialized<T>())
+			{
+				if (!data.empty())
+				{
+					_write(*data.data(), data.size());
+				}
+				return *this;
+			}
+		}
 		for (const T& x : data)
 		{
 			(*this) << x;
@@ -165,6 +220,21 @@ public:
 		return *this;
 	}
 
+	// Returns a byte array that was serialized as std::vector<uint8_t> without copying it out of the archive (read mode only)
+	//	The data stays valid until the archive is closed. For file mapped archives, copies of the archive also keep it valid
+	inline void ReadView(const uint8_t*& data, size_t& size)
+	{
+		(*this) >> size;
+		if (pos + size > decoded_end && !WaitDecoded(pos + size))
+		{
+			data = nullptr;
+			size = 0;
+			return;
+		}
+		data = GetData() + pos;
+		pos += size;
+	}
+
 	// Read operations
 	inline wiArchive& operator >> (bool& data)
 	{
@@ -189,16 +259,34 @@ public:
 	}
 	inline wiArchive& operator >> (int& data)
 	{
-		int64_t temp;
-		_read(temp);
-		data = (int)temp;
+		if (compact)
+		{
+			int32_t temp;
+			_read(temp);
+			data = (int)temp;
+		}
+		else
+		{
+			int64_t temp;
+			_read(temp);
+			data = (int)temp;
+		}
 		return *this;
 	}
 	inline wiArchive& operator >> (unsigned int& data)
 	{
-		uint64_t temp;
-		_read(temp);
-		data = (unsigned int)temp;
+		if (compact)
+		{
+			uint32_t temp;
+			_read(temp);
+			data = (unsigned int)temp;
+		}
+		else
+		{
+			uint64_t temp;
+			_read(temp);
+			data = (unsigned int)temp;
+		}
 		return *this;
 	}
 	inline wiArchive& operator >> (long& data)
@@ -288,6 +376,11 @@ public:
 	{
 		uint64_t len;
 		_read(len);
+		if (len == 0)
+		{
+			data.clear(); // the archive is closed
+			return *this;
+		}
 		char* str = new char[(size_t)len];
 		memset(str, '\0', (size_t)(sizeof(char)*len));
 		_read(*str, len);
@@ -302,6 +395,18 @@ public:
 		size_t count;
 		(*this) >> count;
 		data.resize(count);
+		if constexpr (IsRawSerializable<T>())
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "raw serialized types must be trivially copyable");
+			if (IsRawSerialized<T>())
+			{
+				if (count > 0)
+				{
+					_read(*data.data(), count);
+				}
+				return *this;
+			}
+		}
 		for (size_t i = 0; i < count; ++i)
 		{
 			(*this) >> data[i];
@@ -313,6 +418,41 @@ public:
 
 private:
 
+	// Returns true if the type can be serialized as its exact memory representation, so that arrays of it can be copied in one go
+	template<typename T>
+	static constexpr bool IsRawSerializable()
+	{
+		return
+			std::is_same<T, int>::value ||
+			std::is_same<T, unsigned int>::value ||
+			std::is_same<T, char>::value ||
+			std::is_same<T, unsigned char>::value ||
+			(sizeof(long) == sizeof(int64_t) && (std::is_same<T, long>::value || std::is_same<T, unsigned long>::value)) ||
+			std::is_same<T, long long>::value ||
+			std::is_same<T, unsigned long long>::value ||
+			std::is_same<T, float>::value ||
+			std::is_same<T, double>::value ||
+			std::is_same<T, XMFLOAT2>::value ||
+			std::is_same<T, XMFLOAT3>::value ||
+			std::is_same<T, XMFLOAT4>::value ||
+			std::is_same<T, XMFLOAT3X3>::value ||
+			std::is_same<T, XMFLOAT4X3>::value ||
+			std::is_same<T, XMFLOAT4X4>::value ||
+			std::is_same<T, XMUINT2>::value ||
+			std::is_same<T, XMUINT3>::value ||
+			std::is_same<T, XMUINT4>::value;
+	}
+	// Returns true if the type is serialized as its exact memory representation in this archive
+	template<typename T>
+	inline bool IsRawSerialized() const
+	{
+		if (std::is_same<T, int>::value || std::is_same<T, unsigned int>::value)
+		{
+			return compact; // these were widened to 64 bits before the compact layout
+		}
+		return IsRawSerializable<T>();
+	}
+
 	// This should not be exposed to avoid misaligning data by mistake
 	// Any specific type serialization should be implemented by hand
 	// But these can be used as helper functions inside this class
@@ -335,8 +475,14 @@ private:
 	template<typename T>
 	inline void _read(T& data, uint64_t count = 1)
 	{
-		memcpy(&data, reinterpret_cast<void*>((uint64_t)DATA.data() + (uint64_t)pos), (size_t)(sizeof(data)*count));
-		pos += (size_t)(sizeof(data)*count);
+		const size_t _size = (size_t)(sizeof(data)*count);
+		if (pos + _size > decoded_end && !WaitDecoded(pos + _size))
+		{
+			memset(&data, 0, _size); // the archive is closed, the data is zeroed
+			return;
+		}
+		memcpy(&data, GetData() + pos, _size);
+		pos += _size;
 	}
 };
 
@@ -371,6 +371,14 @@ namespace wiAudio
 
 		return true;
 	}
+	size_t GetSoundMemorySize(const Sound* sound)
+	{
+		if (!sound->IsValid())
+		{
+			return 0;
+		}
+		return to_internal(sound)->audioData.size();
+	}
 	bool CreateSoundInstance(const Sound* sound, SoundInstance* instance)
 	{
 		HRESULT hr;
@@ -593,6 +601,7 @@ namespace wiAudio
 	bool CreateSound(const std::string& filename, Sound* sound) { return false; }
 	bool CreateSound(const std::vector<uint8_t>& data, Sound* sound) { return false; }
 	bool CreateSound(const uint8_t* data, size_t size, Sound* sound) { return false; }
+	size_t GetSoundMemorySize(const Sound* sound) { return 0; }
 	bool CreateSoundInstance(const Sound* sound, SoundInstance* instance) { return false; }
 
 	void Play(SoundInstance* instance) {}
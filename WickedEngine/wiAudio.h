@@ -49,6 +49,8 @@ namespace wiAudio
 	bool CreateSound(const std::vector<uint8_t>& data, Sound* sound);
 	bool CreateSound(const uint8_t* data, size_t size, Sound* sound);
 	bool CreateSoundInstance(const Sound* sound, SoundInstance* instance);
+	// Returns the size of the decoded audio data in bytes
+	size_t GetSoundMemorySize(const Sound* sound);
 
 	void Play(SoundInstance* instance);
 	void Pause(SoundInstance* instance);
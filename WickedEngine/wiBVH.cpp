@@ -0,0 +1,353 @@
+#include "wiBVH.h"
+
+#include <algorithm>
+
+namespace wiBVH_internal
+{
+	inline float surface_area(const AABB& aabb)
+	{
+		const float x = aabb._max.x - aabb._min.x;
+		const float y = aabb._max.y - aabb._min.y;
+		const float z = aabb._max.z - aabb._min.z;
+		if (x < 0 || y < 0 || z < 0)
+			return 0; // empty box
+		return 2 * (x * y + y * z + z * x);
+	}
+	inline float axis_value(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+	inline XMFLOAT3 centroid(const AABB& aabb)
+	{
+		return XMFLOAT3(
+			(aabb._min.x + aabb._max.x) * 0.5f,
+			(aabb._min.y + aabb._max.y) * 0.5f,
+			(aabb._min.z + aabb._max.z) * 0.5f
+		);
+	}
+	inline void grow(AABB& aabb, const XMFLOAT3& p)
+	{
+		aabb._min = XMFLOAT3(std::min(aabb._min.x, p.x), std::min(aabb._min.y, p.y), std::min(aabb._min.z, p.z));
+		aabb._max = XMFLOAT3(std::max(aabb._max.x, p.x), std::max(aabb._max.y, p.y), std::max(aabb._max.z, p.z));
+	}
+	inline bool contains(const AABB& aabb, const AABB& other)
+	{
+		return
+			other._min.x >= aabb._min.x && other._min.y >= aabb._min.y && other._min.z >= aabb._min.z &&
+			other._max.x <= aabb._max.x && other._max.y <= aabb._max.y && other._max.z <= aabb._max.z;
+	}
+	inline void grow(AABB& aabb, const AABB& other)
+	{
+		// Not growing by the corner points, so that empty boxes are handled correctly
+		aabb._min = XMFLOAT3(std::min(aabb._min.x, other._min.x), std::min(aabb._min.y, other._min.y), std::min(aabb._min.z, other._min.z));
+		aabb._max = XMFLOAT3(std::max(aabb._max.x, other._max.x), std::max(aabb._max.y, other._max.y), std::max(aabb._max.z, other._max.z));
+	}
+
+	static constexpr uint32_t tree_root = 1; // the root of the built tree
+	static constexpr uint32_t append_leaf = 2; // the leaf of the primitives that were added after the build
+	static constexpr int bin_count = 16;
+	static constexpr uint32_t max_sah_depth = 32; // deeper than this, median splits are used (32 + log2(4 billion) levels fit in the traversal stack)
+	struct Bin
+	{
+		AABB aabb;
+		uint32_t count = 0;
+	};
+}
+using namespace wiBVH_internal;
+
+void wiBVH::Build(const AABB* aabbs, uint32_t count)
+{
+	Clear();
+	if (count == 0)
+		return;
+
+	primitive_count = count;
+	primitives.resize(count);
+	std::vector<XMFLOAT3> centroids(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		primitives[i] = i;
+		centroids[i] = centroid(aabbs[i]);
+	}
+
+	nodes.reserve(count * 2 + 1);
+	nodes.resize(3);
+	nodes[0].left = tree_root;
+	nodes[0].offset = 0;
+	nodes[0].count = count;
+	nodes[tree_root].offset = 0;
+	nodes[tree_root].count = count;
+	nodes[append_leaf].offset = count;
+	nodes[append_leaf].count = 0;
+
+	struct Item
+	{
+		uint32_t nodeIndex;
+		uint32_t depth;
+	};
+	std::vector<Item> stack;
+	stack.push_back({ tree_root, 0 });
+	while (!stack.empty())
+	{
+		const uint32_t nodeIndex = stack.back().nodeIndex;
+		const uint32_t depth = stack.back().depth;
+		stack.pop_back();
+
+		// Note: nodes can be reallocated in this loop, so it is only referenced by index
+		const uint32_t offset = nodes[nodeIndex].offset;
+		const uint32_t primcount = nodes[nodeIndex].count;
+
+		AABB aabb;
+		AABB centroid_bounds;
+		for (uint32_t i = offset; i < offset + primcount; ++i)
+		{
+			grow(aabb, aabbs[primitives[i]]);
+			grow(centroid_bounds, centroids[primitives[i]]);
+		}
+		nodes[nodeIndex].aabb = aabb;
+
+		if (primcount <= max_leaf_size)
+			continue;
+
+		// Find the best split plane with the binned surface area heuristic:
+		int best_axis = -1;
+		int best_split = 0;
+		float best_cost = FLT_MAX;
+		for (int axis = 0; axis < 3 && depth < max_sah_depth; ++axis)
+		{
+			const float bmin = axis_value(centroid_bounds._min, axis);
+			const float bmax = axis_value(centroid_bounds._max, axis);
+			if (bmax - bmin <= FLT_EPSILON)
+				continue;
+			const float scale = bin_count / (bmax - bmin);
+
+			Bin bins[bin_count];
+			for (uint32_t i = offset; i < offset + primcount; ++i)
+			{
+				const uint32_t prim = primitives[i];
+				const int bin = std::min(bin_count - 1, int((axis_value(centroids[prim], axis) - bmin) * scale));
+				bins[bin].count++;
+				grow(bins[bin].aabb, aabbs[prim]);
+			}
+
+			// Sweep from the right to gather the costs of the right sides, then from the left to evaluate the splits:
+			float right_area[bin_count - 1];
+			uint32_t right_count[bin_count - 1];
+			AABB right_box;
+			uint32_t right_sum = 0;
+			for (int i = bin_count - 1; i > 0; --i)
+			{
+				right_sum += bins[i].count;
+				grow(right_box, bins[i].aabb);
+				right_count[i - 1] = right_sum;
+				right_area[i - 1] = surface_area(right_box);
+			}
+			AABB left_box;
+			uint32_t left_sum = 0;
+			for (int i = 0; i < bin_count - 1; ++i)
+			{
+				left_sum += bins[i].count;
+				grow(left_box, bins[i].aabb);
+				const float cost = left_sum * surface_area(left_box) + right_count[i] * right_area[i];
+				if (left_sum > 0 && right_count[i] > 0 && cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_split = i;
+				}
+			}
+		}
+
+		uint32_t left_count = 0;
+		if (best_axis >= 0)
+		{
+			const float bmin = axis_value(centroid_bounds._min, best_axis);
+			const float bmax = axis_value(centroid_bounds._max, best_axis);
+			const float scale = bin_count / (bmax - bmin);
+			auto it = std::partition(primitives.begin() + offset, primitives.begin() + offset + primcount, [&](uint32_t prim) {
+				const int bin = std::min(bin_count - 1, int((axis_value(centroids[prim], best_axis) - bmin) * scale));
+				return bin <= best_split;
+			});
+			left_count = uint32_t(it - (primitives.begin() + offset));
+		}
+		if (left_count == 0 || left_count == primcount)
+		{
+			// No useful split was found, or the tree got too deep: split in the middle of the longest axis
+			//	This guarantees that the depth stays within the traversal stack size
+			const XMFLOAT3 extent = XMFLOAT3(
+				centroid_bounds._max.x - centroid_bounds._min.x,
+				centroid_bounds._max.y - centroid_bounds._min.y,
+				centroid_bounds._max.z - centroid_bounds._min.z
+			);
+			const int axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+			left_count = primcount / 2;
+			std::nth_element(primitives.begin() + offset, primitives.begin() + offset + left_count, primitives.begin() + offset + primcount, [&](uint32_t a, uint32_t b) {
+				return axis_value(centroids[a], axis) < axis_value(centroids[b], axis);
+			});
+		}
+
+		const uint32_t left = (uint32_t)nodes.size();
+		nodes[nodeIndex].left = left;
+		nodes.emplace_back();
+		nodes.emplace_back();
+		nodes[left].offset = offset;
+		nodes[left].count = left_count;
+		nodes[left + 1].offset = offset + left_count;
+		nodes[left + 1].count = primcount - left_count;
+		stack.push_back({ left + 1, depth + 1 });
+		stack.push_back({ left, depth + 1 });
+	}
+	nodes[0].aabb = nodes[tree_root].aabb;
+
+	build_cost = 0;
+	for (const Node& node : nodes)
+	{
+		if (!node.IsLeaf())
+		{
+			build_cost += surface_area(node.aabb);
+		}
+	}
+}
+
+bool wiBVH::Refit(const AABB* aabbs)
+{
+	// Children are always placed after their parents, so a reverse iteration updates the tree bottom-up:
+	float cost = 0;
+	for (size_t i = nodes.size(); i > 0; --i)
+	{
+		Node& node = nodes[i - 1];
+		if (node.IsLeaf())
+		{
+			AABB aabb;
+			for (uint32_t j = node.offset; j < node.offset + node.count; ++j)
+			{
+				if (primitives[j] != invalid_primitive)
+				{
+					grow(aabb, aabbs[primitives[j]]);
+				}
+			}
+			node.aabb = aabb;
+		}
+		else
+		{
+			node.aabb = nodes[node.left].aabb;
+			grow(node.aabb, nodes[node.left + 1].aabb);
+			cost += surface_area(node.aabb);
+		}
+	}
+
+	// When objects moved far from where they were at build time, the nodes overlap more and more:
+	return cost <= build_cost * 2;
+}
+
+void wiBVH::Update(const AABB* aabbs, uint32_t count)
+{
+	if (nodes.empty() || count == 0)
+	{
+		Build(aabbs, count);
+		return;
+	}
+
+	if (count > primitive_count)
+	{
+		// Added primitives are put into the append leaf at the end of the primitive list:
+		for (uint32_t i = primitive_count; i < count; ++i)
+		{
+			primitives.push_back(i);
+		}
+		nodes[0].count += count - primitive_count;
+		nodes[append_leaf].count += count - primitive_count;
+	}
+	else if (count < primitive_count)
+	{
+		// The last boxes are expected to be moved into the places of the removed ones (like in a ComponentManager),
+		//	so a box that is no longer inside its leaf is probably in the leaf of a removed primitive, it is moved there:
+		struct Slot
+		{
+			uint32_t index;
+			uint32_t leaf;
+		};
+		std::vector<Slot> removed_slots;
+		std::vector<Slot> moved_slots;
+		for (uint32_t nodeIndex = 0; nodeIndex < (uint32_t)nodes.size(); ++nodeIndex)
+		{
+			const Node& node = nodes[nodeIndex];
+			if (!node.IsLeaf())
+				continue;
+			for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+			{
+				const uint32_t primitive = primitives[i];
+				if (primitive == invalid_primitive)
+					continue;
+				if (primitive >= count)
+				{
+					removed_slots.push_back({ i, nodeIndex });
+				}
+				else if (!contains(node.aabb, aabbs[primitive]))
+				{
+					moved_slots.push_back({ i, nodeIndex });
+				}
+			}
+		}
+		for (Slot& removed : removed_slots)
+		{
+			for (Slot& moved : moved_slots)
+			{
+				if (moved.index != ~0u && contains(nodes[removed.leaf].aabb, aabbs[primitives[moved.index]]))
+				{
+					primitives[removed.index] = primitives[moved.index];
+					removed.index = moved.index;
+					moved.index = ~0u;
+					break;
+				}
+			}
+			primitives[removed.index] = invalid_primitive;
+		}
+	}
+	primitive_count = count;
+
+	// Appended primitives are not sorted spatially and removed ones still take up places, so the tree is rebuilt when there are too many of them:
+	const uint32_t unsorted_count = nodes[append_leaf].count + (uint32_t)primitives.size() - count;
+	if (unsorted_count > std::max(max_leaf_size * 4, count / 8) || !Refit(aabbs))
+	{
+		Build(aabbs, count);
+	}
+}
+
+void wiBVH::Clear()
+{
+	nodes.clear();
+	primitives.clear();
+	primitive_count = 0;
+	build_cost = 0;
+}
+
+uint32_t wiBVH::GetSubtrees(uint32_t* subtrees, uint32_t count) const
+{
+	if (nodes.empty() || count == 0)
+		return 0;
+
+	// Keep splitting the biggest subtree until there are enough of them:
+	uint32_t subtree_count = 0;
+	subtrees[subtree_count++] = 0;
+	while (subtree_count < count)
+	{
+		uint32_t biggest = ~0u;
+		uint32_t biggest_count = 0;
+		for (uint32_t i = 0; i < subtree_count; ++i)
+		{
+			const Node& node = nodes[subtrees[i]];
+			if (!node.IsLeaf() && node.count > biggest_count)
+			{
+				biggest = i;
+				biggest_count = node.count;
+			}
+		}
+		if (biggest == ~0u)
+			break;
+		const uint32_t left = nodes[subtrees[biggest]].left;
+		subtrees[biggest] = left;
+		subtrees[subtree_count++] = left + 1;
+	}
+	return subtree_count;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiIntersect.h"
+
+#include <vector>
+
+// CPU bounding volume hierarchy over a set of AABBs (for example scene objects)
+//	The tree is built with the binned surface area heuristic, and it can be refitted
+//	cheaply when the AABBs move without changing the tree structure.
+//	The root has two children: the built tree and a leaf of the primitives that were added by Update() since the build
+class wiBVH
+{
+public:
+	struct Node
+	{
+		AABB aabb;
+		uint32_t left = 0;		// index of the left child, the right child is left + 1. Zero for leaf nodes (the root is never a child)
+		uint32_t offset = 0;	// first index into the primitive list
+		uint32_t count = 0;		// number of primitives in the subtree
+
+		constexpr bool IsLeaf() const { return left == 0; }
+	};
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primitives; // primitive indices (into the source AABB array), ordered by leaf
+
+	static constexpr uint32_t max_leaf_size = 4;
+	static constexpr uint32_t invalid_primitive = ~0u; // a primitive that was removed by Update() keeps its place in the list with this value until the next build
+
+	// Build a new tree from scratch
+	void Build(const AABB* aabbs, uint32_t count);
+
+	// Update the bounds of every node bottom-up after the AABBs moved, but keep the tree structure
+	//	Returns false if the tree quality degraded too much and it should be rebuilt instead
+	bool Refit(const AABB* aabbs);
+
+	// Refit the tree, or build it if it's empty or the refitted tree became inefficient
+	//	When the count changed, the primitives are expected to be added at the end of the array and removed by moving the last ones into their places (like in a ComponentManager)
+	//	Added primitives are put into the leaf next to the tree and removed ones are invalidated in their leaves, so the tree is not rebuilt each time
+	void Update(const AABB* aabbs, uint32_t count);
+
+	void Clear();
+
+	inline bool IsValid() const { return !nodes.empty(); }
+	inline uint32_t GetPrimitiveCount() const { return primitive_count; }
+
+	// Traverse the tree and call the visitor for every primitive whose AABB is possibly visible by the frustum
+	//	Subtrees that are fully inside are accepted without testing every primitive individually
+	//	Subtrees that are fully outside are rejected as a whole
+	//	visitor		: void(uint32_t primitiveIndex, bool fully_inside) - if fully_inside is false, the primitive's own AABB still needs to be checked
+	//	root		: the traversal can start from any subtree
+	template<typename F>
+	void Cull(const Frustum& frustum, F&& visitor, uint32_t root = 0) const
+	{
+		if (nodes.empty())
+			return;
+
+		uint32_t stack[64];
+		uint32_t stackpos = 0;
+		stack[stackpos++] = root;
+		while (stackpos > 0)
+		{
+			const Node& node = nodes[stack[--stackpos]];
+			switch (frustum.CheckBoxFastIntersect(node.aabb))
+			{
+			case Frustum::BOX_FRUSTUM_OUTSIDE:
+				break;
+			case Frustum::BOX_FRUSTUM_INSIDE:
+				for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+				{
+					if (primitives[i] != invalid_primitive)
+					{
+						visitor(primitives[i], true);
+					}
+				}
+				break;
+			default:
+				if (node.IsLeaf())
+				{
+					for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+					{
+						if (primitives[i] != invalid_primitive)
+						{
+							visitor(primitives[i], false);
+						}
+					}
+				}
+				else
+				{
+					assert(stackpos + 2 <= arraysize(stack));
+					stack[stackpos++] = node.left + 1;
+					stack[stackpos++] = node.left;
+				}
+				break;
+			}
+		}
+	}
+
+	// Traverse the tree with a custom bounding box test, and call the visitor for every primitive of the leaves that passed the test
+	//	intersects	: bool(const AABB& aabb) - whether a subtree needs to be visited
+	//	visitor		: bool(uint32_t primitiveIndex) - return false to stop the traversal
+	template<typename I, typename F>
+	void Intersect(I&& intersects, F&& visitor) const
+	{
+		if (nodes.empty())
+			return;
+
+		uint32_t stack[64];
+		uint32_t stackpos = 0;
+		stack[stackpos++] = 0;
+		while (stackpos > 0)
+		{
+			const Node& node = nodes[stack[--stackpos]];
+			if (!intersects(node.aabb))
+				continue;
+			if (node.IsLeaf())
+			{
+				for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+				{
+					if (primitives[i] != invalid_primitive && !visitor(primitives[i]))
+						return;
+				}
+			}
+			else
+			{
+				assert(stackpos + 2 <= arraysize(stack));
+				stack[stackpos++] = node.left + 1;
+				stack[stackpos++] = node.left;
+			}
+		}
+	}
+
+	// Fills the subtrees array with subtree roots that together contain every primitive, to distribute the traversal to multiple threads
+	//	Returns the number of subtrees, which is the requested count if the tree is big enough
+	uint32_t GetSubtrees(uint32_t* subtrees, uint32_t count) const;
+
+private:
+	uint32_t primitive_count = 0;
+	float build_cost = 0; // sum of interior node surface areas right after the build
+};
@@ -0,0 +1,940 @@
+#include "wiCPUPathTracer.h"
+#include "wiScene.h"
+#include "wiJobSystem.h"
+#include "wiTimer.h"
+#include "wiMath.h"
+#include "wiColor.h"
+#include "wiHelper.h"
+#include "wiRenderer.h"
+#include "wiResourceManager.h"
+#include "wiTextureCooker.h"
+#include "Utility/stb_image.h"
+#include "Utility/tinyddsloader.h"
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <unordered_map>
+
+using namespace wiScene;
+
+namespace wiCPUPathTracer_Internal
+{
+	// Per pixel random number generator (PCG hash), the GPU sin() hash is not reproducible across compilers
+	struct RNG
+	{
+		uint32_t state;
+
+		RNG(uint32_t pixel, uint32_t sample)
+		{
+			state = pixel * 9781u + sample * 6271u + 0x9E3779B9u;
+			next();
+		}
+		inline uint32_t next()
+		{
+			state = state * 747796405u + 2891336453u;
+			uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+			return (word >> 22u) ^ word;
+		}
+		// Uniform random number in [0, 1)
+		inline float rand()
+		{
+			return float(next() >> 8) * (1.0f / 16777216.0f);
+		}
+	};
+
+	// Cosine weighted hemisphere point, same as hemispherepoint_cos() in globals.hlsli
+	inline XMVECTOR hemispherepoint_cos(float u, float v)
+	{
+		const float phi = v * XM_2PI;
+		const float cosTheta = std::sqrt(1 - u);
+		const float sinTheta = std::sqrt(1 - cosTheta * cosTheta);
+		return XMVectorSet(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta, 0);
+	}
+	// Same as SampleHemisphere_cos() in globals.hlsli
+	inline XMVECTOR SampleHemisphere_cos(XMVECTOR N, RNG& rng)
+	{
+		const float u = rng.rand();
+		const float v = rng.rand();
+		XMVECTOR helper = std::abs(XMVectorGetX(N)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(1, 0, 0, 0);
+		XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, helper));
+		XMVECTOR B = XMVector3Normalize(XMVector3Cross(N, T));
+		XMVECTOR H = hemispherepoint_cos(u, v);
+		return T * XMVectorGetX(H) + B * XMVectorGetY(H) + N * XMVectorGetZ(H);
+	}
+
+	inline float pow5(float x)
+	{
+		const float x2 = x * x;
+		return x2 * x2 * x;
+	}
+	inline XMVECTOR F_Schlick(XMVECTOR f0, float f90, float VoH)
+	{
+		return f0 + (XMVectorReplicate(f90) - f0) * pow5(1 - VoH);
+	}
+	inline XMVECTOR F_Schlick(XMVECTOR f0, float VoH)
+	{
+		const float f = pow5(1 - VoH);
+		return XMVectorReplicate(f) + f0 * (1 - f);
+	}
+	inline float D_GGX(float roughness, float NoH)
+	{
+		const float oneMinusNoHSquared = 1 - NoH * NoH;
+		const float a = NoH * roughness;
+		const float k = roughness / (oneMinusNoHSquared + a * a);
+		return std::min(k * k * (1.0f / XM_PI), 65504.0f);
+	}
+	inline float V_SmithGGXCorrelated(float roughness, float NoV, float NoL)
+	{
+		const float a2 = roughness * roughness;
+		const float lambdaV = NoL * std::sqrt((NoV - a2 * NoV) * NoV + a2);
+		const float lambdaL = NoV * std::sqrt((NoL - a2 * NoL) * NoL + a2);
+		return std::min(0.5f / (lambdaV + lambdaL), 65504.0f);
+	}
+
+	// Surface properties at a ray hit, same as the Surface in brdf.hlsli
+	struct Surface
+	{
+		XMVECTOR P;
+		XMVECTOR N;
+		XMVECTOR V;
+		XMVECTOR albedo;
+		XMVECTOR f0;
+		XMVECTOR emissive;
+		float roughness;
+		float roughnessBRDF;
+		float opacity;
+		float transmission;
+		float NdotV;
+		float f90;
+	};
+
+	// 4-wide Moller-Trumbore ray-triangle test, returns the bitmask of triangles that were hit and their distances and barycentrics
+	//	cull	: if true, back facing triangles are rejected, like the GPU with RAY_BACKFACE_CULLING
+	template<typename Packet>
+	inline int IntersectPacket(
+		const Packet& packet,
+		XMVECTOR ox, XMVECTOR oy, XMVECTOR oz,
+		XMVECTOR dx, XMVECTOR dy, XMVECTOR dz,
+		float tmin, float tmax,
+		bool cull,
+		XMFLOAT4A& t_out, XMFLOAT4A& u_out, XMFLOAT4A& v_out
+	)
+	{
+		const XMVECTOR e1x = XMLoadFloat4A(&packet.e1[0]);
+		const XMVECTOR e1y = XMLoadFloat4A(&packet.e1[1]);
+		const XMVECTOR e1z = XMLoadFloat4A(&packet.e1[2]);
+		const XMVECTOR e2x = XMLoadFloat4A(&packet.e2[0]);
+		const XMVECTOR e2y = XMLoadFloat4A(&packet.e2[1]);
+		const XMVECTOR e2z = XMLoadFloat4A(&packet.e2[2]);
+
+		// pvec = cross(direction, e2)
+		const XMVECTOR px = dy * e2z - dz * e2y;
+		const XMVECTOR py = dz * e2x - dx * e2z;
+		const XMVECTOR pz = dx * e2y - dy * e2x;
+		const XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+		const XMVECTOR epsilon = XMVectorReplicate(0.000001f);
+		XMVECTOR mask = cull ? XMVectorGreaterOrEqual(det, epsilon) : XMVectorGreaterOrEqual(XMVectorAbs(det), epsilon);
+		const XMVECTOR invDet = XMVectorReciprocal(det);
+
+		// tvec = origin - v0
+		const XMVECTOR tx = ox - XMLoadFloat4A(&packet.v0[0]);
+		const XMVECTOR ty = oy - XMLoadFloat4A(&packet.v0[1]);
+		const XMVECTOR tz = oz - XMLoadFloat4A(&packet.v0[2]);
+		const XMVECTOR u = (tx * px + ty * py + tz * pz) * invDet;
+
+		// qvec = cross(tvec, e1)
+		const XMVECTOR qx = ty * e1z - tz * e1y;
+		const XMVECTOR qy = tz * e1x - tx * e1z;
+		const XMVECTOR qz = tx * e1y - ty * e1x;
+		const XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+		const XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+		const XMVECTOR zero = XMVectorZero();
+		const XMVECTOR one = XMVectorSplatOne();
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+		mask = XMVectorAndInt(mask, XMVectorLessOrEqual(u + v, one));
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(t, XMVectorReplicate(tmin)));
+		mask = XMVectorAndInt(mask, XMVectorLessOrEqual(t, XMVectorReplicate(tmax)));
+
+		uint32_t lanes[4];
+		XMStoreInt4(lanes, mask);
+		const int bits = (lanes[0] ? 1 : 0) | (lanes[1] ? 2 : 0) | (lanes[2] ? 4 : 0) | (lanes[3] ? 8 : 0);
+		if (bits != 0)
+		{
+			XMStoreFloat4A(&t_out, t);
+			XMStoreFloat4A(&u_out, u);
+			XMStoreFloat4A(&v_out, v);
+		}
+		return bits;
+	}
+
+	// SIMD slab test, returns the entry distance, or FLT_MAX if the box is missed
+	inline float IntersectBox(const AABB& aabb, XMVECTOR origin, XMVECTOR invdir, float tmin, float tmax)
+	{
+		const XMVECTOR t0 = (XMLoadFloat3(&aabb._min) - origin) * invdir;
+		const XMVECTOR t1 = (XMLoadFloat3(&aabb._max) - origin) * invdir;
+		const XMVECTOR tnear3 = XMVectorMin(t0, t1);
+		const XMVECTOR tfar3 = XMVectorMax(t0, t1);
+		const XMVECTOR tnear = XMVectorMax(XMVectorMax(XMVectorSplatX(tnear3), XMVectorSplatY(tnear3)), XMVectorMax(XMVectorSplatZ(tnear3), XMVectorReplicate(tmin)));
+		const XMVECTOR tfar = XMVectorMin(XMVectorMin(XMVectorSplatX(tfar3), XMVectorSplatY(tfar3)), XMVectorMin(XMVectorSplatZ(tfar3), XMVectorReplicate(tmax)));
+		return XMVector4LessOrEqual(tnear, tfar) ? XMVectorGetX(tnear) : FLT_MAX;
+	}
+
+	inline XMVECTOR GetInverseDirection(const XMFLOAT3& direction)
+	{
+		// Avoid infinities, because 0 * inf would be NaN in the slab test:
+		auto safe = [](float x) { return std::abs(x) < 1e-20f ? (x < 0 ? -1e-20f : 1e-20f) : x; };
+		return XMVectorReciprocal(XMVectorSet(safe(direction.x), safe(direction.y), safe(direction.z), 1));
+	}
+
+	// Decodes the top mip of an image file into RGBA8 pixels, the file formats are the same as in the resource manager
+	//	DDS files are supported with uncompressed 8-bit RGBA formats and the block compressed formats that the texture cooker can decompress
+	bool DecodeImage(const uint8_t* filedata, size_t filesize, uint32_t& width, uint32_t& height, std::vector<uint32_t>& pixels)
+	{
+		if (filesize >= 4 && std::memcmp(filedata, "DDS ", 4) == 0)
+		{
+			tinyddsloader::DDSFile dds;
+			if (dds.Load(filedata, filesize) != tinyddsloader::Result::Success)
+				return false;
+			const tinyddsloader::DDSFile::ImageData* image = dds.GetImageData(0, 0);
+			if (image == nullptr)
+				return false;
+			width = dds.GetWidth();
+			height = dds.GetHeight();
+			pixels.resize(size_t(width) * size_t(height));
+
+			wiGraphics::FORMAT format;
+			switch (dds.GetFormat())
+			{
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm:
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm_SRGB:
+			case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm:
+			case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm_SRGB:
+			{
+				const bool bgra = dds.GetFormat() == tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm || dds.GetFormat() == tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm_SRGB;
+				for (uint32_t y = 0; y < height; ++y)
+				{
+					const uint32_t* row = (const uint32_t*)((const uint8_t*)image->m_mem + size_t(y) * image->m_memPitch);
+					for (uint32_t x = 0; x < width; ++x)
+					{
+						const uint32_t color = row[x];
+						pixels[size_t(y) * width + x] = bgra ? ((color & 0xFF00FF00) | ((color >> 16) & 0xFF) | ((color & 0xFF) << 16)) : color;
+					}
+				}
+				return true;
+			}
+			case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm: format = wiGraphics::FORMAT_BC1_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm_SRGB: format = wiGraphics::FORMAT_BC1_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm: format = wiGraphics::FORMAT_BC3_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm_SRGB: format = wiGraphics::FORMAT_BC3_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC4_UNorm: format = wiGraphics::FORMAT_BC4_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC5_UNorm: format = wiGraphics::FORMAT_BC5_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm: format = wiGraphics::FORMAT_BC7_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm_SRGB: format = wiGraphics::FORMAT_BC7_UNORM_SRGB; break;
+			default:
+				return false;
+			}
+			std::vector<uint8_t> rgba;
+			if (!wiTextureCooker::Decompress((const uint8_t*)image->m_mem, width, height, format, rgba))
+				return false;
+			std::memcpy(pixels.data(), rgba.data(), rgba.size());
+			return true;
+		}
+
+		// png, tga, jpg, etc.
+		int w, h, bpp;
+		std::unique_ptr<unsigned char, void(*)(void*)> rgba(stbi_load_from_memory(filedata, (int)filesize, &w, &h, &bpp, 4), stbi_image_free);
+		if (rgba == nullptr)
+			return false;
+		width = uint32_t(w);
+		height = uint32_t(h);
+		pixels.resize(size_t(width) * size_t(height));
+		std::memcpy(pixels.data(), rgba.get(), pixels.size() * sizeof(uint32_t));
+		return true;
+	}
+
+	// Same as DEGAMMA() in globals.hlsli, the alpha is not changed
+	inline XMVECTOR DeGamma(XMVECTOR color, float gamma)
+	{
+		return XMVectorSelect(color, XMVectorPow(XMVectorAbs(color), XMVectorReplicate(gamma)), g_XMSelect1110);
+	}
+
+	// Every Trace() gets a unique id, and every thread remembers the last one it was tracing for
+	//	This counts the threads that executed tiles, including the thread that waits for the jobs and helps executing them
+	std::atomic<uint64_t> trace_id{ 0 };
+	thread_local uint64_t thread_trace_id = 0;
+}
+using namespace wiCPUPathTracer_Internal;
+
+XMVECTOR wiCPUPathTracer::Texture::Sample(float u, float v) const
+{
+	// Texel centers are at half coordinates, like with the GPU linear sampler:
+	const float x = (u - std::floor(u)) * width - 0.5f;
+	const float y = (v - std::floor(v)) * height - 0.5f;
+	const float x0 = std::floor(x);
+	const float y0 = std::floor(y);
+	auto fetch = [&](float fx, float fy) {
+		const int px = ((int)fx % (int)width + (int)width) % (int)width;
+		const int py = ((int)fy % (int)height + (int)height) % (int)height;
+		const uint32_t color = pixels[size_t(py) * width + px];
+		return XMVectorSet(float(color & 0xFF), float((color >> 8) & 0xFF), float((color >> 16) & 0xFF), float(color >> 24)) * (1.0f / 255.0f);
+	};
+	const float tx = x - x0;
+	const float ty = y - y0;
+	return XMVectorLerp(
+		XMVectorLerp(fetch(x0, y0), fetch(x0 + 1, y0), tx),
+		XMVectorLerp(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1), tx),
+		ty
+	);
+}
+
+void wiCPUPathTracer::Clear()
+{
+	triangles.clear();
+	materials.clear();
+	textures.clear();
+	material_textures.clear();
+	packets.clear();
+	leaf_packets.clear();
+	bvh.Clear();
+	lights.clear();
+}
+
+void wiCPUPathTracer::Build(const Scene& scene)
+{
+	Clear();
+
+	std::vector<XMFLOAT3> positions;
+	std::vector<AABB> aabbs;
+
+	// Every texture file is decoded only once, even if it's used by multiple materials:
+	std::unordered_map<std::string, int> texture_lookup;
+	std::vector<const MaterialComponent::TextureMap*> texture_maps;
+	auto add_texture = [&](const MaterialComponent::TextureMap& map, MaterialTexture& dest) {
+		if (map.name.empty())
+			return;
+		auto it = texture_lookup.find(map.name);
+		if (it == texture_lookup.end())
+		{
+			it = texture_lookup.emplace(map.name, (int)texture_maps.size()).first;
+			texture_maps.push_back(&map);
+		}
+		dest.index = it->second;
+		dest.uvset = map.uvset;
+	};
+
+	for (size_t i = 0; i < scene.objects.GetCount(); ++i)
+	{
+		const ObjectComponent& object = scene.objects[i];
+		if (object.meshID == wiECS::INVALID_ENTITY)
+			continue;
+		const MeshComponent* mesh = scene.meshes.GetComponent(object.meshID);
+		if (mesh == nullptr)
+			continue;
+
+		const XMMATRIX W = XMLoadFloat4x4(object.transform_index >= 0 ? &scene.transforms[object.transform_index].world : &IDENTITYMATRIX);
+
+		for (auto& subset : mesh->subsets)
+		{
+			const MaterialComponent* material = scene.materials.GetComponent(subset.materialID);
+			if (material == nullptr)
+				continue;
+
+			const uint32_t materialIndex = (uint32_t)materials.size();
+			materials.emplace_back();
+			material->WriteShaderMaterial(&materials.back());
+			const bool vertexcolors = material->IsUsingVertexColors() && !mesh->vertex_colors.empty();
+
+			MaterialTextures& mattex = material_textures.emplace_back();
+			add_texture(material->textures[MaterialComponent::BASECOLORMAP], mattex.basecolormap);
+			add_texture(material->textures[MaterialComponent::SURFACEMAP], mattex.surfacemap);
+			add_texture(material->textures[MaterialComponent::EMISSIVEMAP], mattex.emissivemap);
+			add_texture(material->textures[MaterialComponent::NORMALMAP], mattex.normalmap);
+
+			// Same as the uv sets of the GPU BVH primitives (bvh_primitivesCS.hlsl):
+			const XMFLOAT4 texMulAdd = material->texMulAdd;
+			auto get_uvsets = [&](uint32_t i) {
+				XMFLOAT4 uvsets = XMFLOAT4(0, 0, 0, 0);
+				if (i < mesh->vertex_uvset_0.size())
+				{
+					uvsets.x = mesh->vertex_uvset_0[i].x * texMulAdd.x + texMulAdd.z;
+					uvsets.y = mesh->vertex_uvset_0[i].y * texMulAdd.y + texMulAdd.w;
+				}
+				if (i < mesh->vertex_uvset_1.size())
+				{
+					uvsets.z = mesh->vertex_uvset_1[i].x;
+					uvsets.w = mesh->vertex_uvset_1[i].y;
+				}
+				return uvsets;
+			};
+
+			for (uint32_t index = subset.indexOffset; index + 2 < subset.indexOffset + subset.indexCount; index += 3)
+			{
+				const uint32_t i0 = mesh->indices[index + 0];
+				const uint32_t i1 = mesh->indices[index + 1];
+				const uint32_t i2 = mesh->indices[index + 2];
+
+				const XMVECTOR P0 = XMVector3Transform(XMLoadFloat3(&mesh->vertex_positions[i0]), W);
+				const XMVECTOR P1 = XMVector3Transform(XMLoadFloat3(&mesh->vertex_positions[i1]), W);
+				const XMVECTOR P2 = XMVector3Transform(XMLoadFloat3(&mesh->vertex_positions[i2]), W);
+
+				Triangle tri;
+				if (mesh->vertex_normals.empty())
+				{
+					XMStoreFloat3(&tri.n0, XMVector3Normalize(XMVector3Cross(P1 - P0, P2 - P0)));
+					tri.n1 = tri.n0;
+					tri.n2 = tri.n0;
+				}
+				else
+				{
+					XMStoreFloat3(&tri.n0, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&mesh->vertex_normals[i0]), W)));
+					XMStoreFloat3(&tri.n1, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&mesh->vertex_normals[i1]), W)));
+					XMStoreFloat3(&tri.n2, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&mesh->vertex_normals[i2]), W)));
+				}
+				tri.c0 = object.color;
+				tri.c1 = object.color;
+				tri.c2 = object.color;
+				if (vertexcolors)
+				{
+					const XMFLOAT4 vertexcolor0 = wiColor(mesh->vertex_colors[i0]);
+					const XMFLOAT4 vertexcolor1 = wiColor(mesh->vertex_colors[i1]);
+					const XMFLOAT4 vertexcolor2 = wiColor(mesh->vertex_colors[i2]);
+					XMStoreFloat4(&tri.c0, XMLoadFloat4(&tri.c0) * XMLoadFloat4(&vertexcolor0));
+					XMStoreFloat4(&tri.c1, XMLoadFloat4(&tri.c1) * XMLoadFloat4(&vertexcolor1));
+					XMStoreFloat4(&tri.c2, XMLoadFloat4(&tri.c2) * XMLoadFloat4(&vertexcolor2));
+				}
+				tri.u0 = get_uvsets(i0);
+				tri.u1 = get_uvsets(i1);
+				tri.u2 = get_uvsets(i2);
+
+				// Tangent space for normal mapping, same as in bvh_primitivesCS.hlsl:
+				{
+					const XMVECTOR facenormal = XMVector3Normalize(XMLoadFloat3(&tri.n0) + XMLoadFloat3(&tri.n1) + XMLoadFloat3(&tri.n2));
+					const float s1 = tri.u1.x - tri.u0.x;
+					const float s2 = tri.u2.x - tri.u0.x;
+					const float t1 = tri.u1.y - tri.u0.y;
+					const float t2 = tri.u2.y - tri.u0.y;
+					float r = 1.0f / (s1 * t2 - s2 * t1);
+					if (!std::isfinite(r))
+					{
+						r = 0; // no uv mapping, the normal map will only scale the normal
+					}
+					const XMVECTOR sdir = ((P1 - P0) * t2 - (P2 - P0) * t1) * r;
+					const XMVECTOR tdir = ((P2 - P0) * s1 - (P1 - P0) * s2) * r;
+					const XMVECTOR T = XMVector3Normalize(sdir - facenormal * XMVector3Dot(facenormal, sdir));
+					const float w = XMVectorGetX(XMVector3Dot(XMVector3Cross(T, facenormal), tdir)) < 0 ? -1.0f : 1.0f;
+					XMStoreFloat3(&tri.tangent, T);
+					XMStoreFloat3(&tri.binormal, XMVector3Normalize(XMVector3Cross(T, facenormal) * w));
+				}
+
+				tri.materialIndex = materialIndex;
+				triangles.push_back(tri);
+
+				XMFLOAT3 p0, p1, p2;
+				XMStoreFloat3(&p0, P0);
+				XMStoreFloat3(&p1, P1);
+				XMStoreFloat3(&p2, P2);
+				positions.push_back(p0);
+				positions.push_back(p1);
+				positions.push_back(p2);
+				aabbs.push_back(AABB(wiMath::Min(p0, wiMath::Min(p1, p2)), wiMath::Max(p0, wiMath::Max(p1, p2))));
+			}
+		}
+	}
+
+	// The textures are decoded in parallel, from the file data that the resource retained, or from the file if it was not retained:
+	textures.resize(texture_maps.size());
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)texture_maps.size(), 1, [&](wiJobArgs args) {
+		const MaterialComponent::TextureMap& map = *texture_maps[args.jobIndex];
+		Texture& texture = textures[args.jobIndex];
+		std::vector<uint8_t> filedata;
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		if (map.resource != nullptr && map.resource->IsReady() && !map.resource->filedata.empty())
+		{
+			data = map.resource->filedata.data();
+			size = map.resource->filedata.size();
+		}
+		else if (wiHelper::FileRead(map.name, filedata))
+		{
+			data = filedata.data();
+			size = filedata.size();
+		}
+		if (data == nullptr || !DecodeImage(data, size, texture.width, texture.height, texture.pixels))
+		{
+			texture = Texture(); // the material is traced without this texture
+		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	bvh.Build(aabbs.data(), (uint32_t)aabbs.size());
+
+	// Every leaf has at most 4 triangles, those are repacked into SoA layout:
+	static_assert(wiBVH::max_leaf_size <= 4, "The triangle packets can hold 4 triangles");
+	leaf_packets.resize(bvh.nodes.size());
+	for (size_t i = 0; i < bvh.nodes.size(); ++i)
+	{
+		const wiBVH::Node& node = bvh.nodes[i];
+		if (!node.IsLeaf())
+			continue;
+		leaf_packets[i] = (uint32_t)packets.size();
+		TrianglePacket& packet = packets.emplace_back();
+		float* v0[3] = { &packet.v0[0].x, &packet.v0[1].x, &packet.v0[2].x };
+		float* e1[3] = { &packet.e1[0].x, &packet.e1[1].x, &packet.e1[2].x };
+		float* e2[3] = { &packet.e2[0].x, &packet.e2[1].x, &packet.e2[2].x };
+		for (uint32_t lane = 0; lane < 4; ++lane)
+		{
+			// Unused lanes are degenerate triangles that will never be hit:
+			XMFLOAT3 p0 = XMFLOAT3(0, 0, 0);
+			XMFLOAT3 p1 = p0;
+			XMFLOAT3 p2 = p0;
+			packet.triangles[lane] = ~0u;
+			if (lane < node.count)
+			{
+				const uint32_t triangle = bvh.primitives[node.offset + lane];
+				p0 = positions[triangle * 3 + 0];
+				p1 = positions[triangle * 3 + 1];
+				p2 = positions[triangle * 3 + 2];
+				packet.triangles[lane] = triangle;
+			}
+			const float p0_[3] = { p0.x, p0.y, p0.z };
+			const float p1_[3] = { p1.x, p1.y, p1.z };
+			const float p2_[3] = { p2.x, p2.y, p2.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				v0[axis][lane] = p0_[axis];
+				e1[axis][lane] = p1_[axis] - p0_[axis];
+				e2[axis][lane] = p2_[axis] - p0_[axis];
+			}
+		}
+	}
+
+	for (size_t i = 0; i < scene.lights.GetCount(); ++i)
+	{
+		const LightComponent& light = scene.lights[i];
+		if (light.GetType() >= LightComponent::LIGHTTYPE_COUNT)
+			continue;
+		Light& dest = lights.emplace_back();
+		dest.type = light.GetType();
+		dest.position = light.position;
+		dest.direction = light.direction;
+		dest.color = XMFLOAT3(light.color.x * light.energy, light.color.y * light.energy, light.color.z * light.energy);
+		dest.range = light.GetRange();
+		dest.coneAngleCos = std::cos(light.fov * 0.5f);
+	}
+
+	horizon = scene.weather.horizon;
+	zenith = scene.weather.zenith;
+}
+
+bool wiCPUPathTracer::TraceClosest(const Ray& ray, Hit& hit) const
+{
+	if (!bvh.IsValid())
+		return false;
+
+	const XMVECTOR origin = XMLoadFloat3(&ray.origin);
+	const XMVECTOR direction = XMLoadFloat3(&ray.direction);
+	if (XMVector3IsNaN(direction) || XMVector3IsNaN(origin))
+		return false; // NaN would pass every box test in the traversal (for example with an uninitialized camera)
+	const XMVECTOR invdir = GetInverseDirection(ray.direction);
+	const XMVECTOR ox = XMVectorSplatX(origin);
+	const XMVECTOR oy = XMVectorSplatY(origin);
+	const XMVECTOR oz = XMVectorSplatZ(origin);
+	const XMVECTOR dx = XMVectorSplatX(direction);
+	const XMVECTOR dy = XMVectorSplatY(direction);
+	const XMVECTOR dz = XMVectorSplatZ(direction);
+
+	hit.distance = ray.TMax;
+	hit.triangle = ~0u;
+
+	uint32_t stack[64];
+	uint32_t stackpos = 0;
+	if (IntersectBox(bvh.nodes[0].aabb, origin, invdir, ray.TMin, hit.distance) < FLT_MAX)
+	{
+		stack[stackpos++] = 0;
+	}
+	while (stackpos > 0)
+	{
+		const wiBVH::Node& node = bvh.nodes[stack[--stackpos]];
+		if (node.IsLeaf())
+		{
+			XMFLOAT4A t, u, v;
+			const int bits = IntersectPacket(packets[leaf_packets[&node - bvh.nodes.data()]], ox, oy, oz, dx, dy, dz, ray.TMin, hit.distance, true, t, u, v);
+			const float* t_ = &t.x;
+			const float* u_ = &u.x;
+			const float* v_ = &v.x;
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				if ((bits & (1 << lane)) && t_[lane] <= hit.distance)
+				{
+					hit.distance = t_[lane];
+					hit.triangle = packets[leaf_packets[&node - bvh.nodes.data()]].triangles[lane];
+					hit.bary = XMFLOAT2(u_[lane], v_[lane]);
+				}
+			}
+			continue;
+		}
+
+		// Visit the closer child first, so the far one can be culled by the shrinking hit distance:
+		const float tleft = IntersectBox(bvh.nodes[node.left].aabb, origin, invdir, ray.TMin, hit.distance);
+		const float tright = IntersectBox(bvh.nodes[node.left + 1].aabb, origin, invdir, ray.TMin, hit.distance);
+		assert(stackpos + 2 <= arraysize(stack));
+		if (tleft < tright)
+		{
+			if (tright < FLT_MAX)
+				stack[stackpos++] = node.left + 1;
+			stack[stackpos++] = node.left;
+		}
+		else
+		{
+			if (tleft < FLT_MAX)
+				stack[stackpos++] = node.left;
+			if (tright < FLT_MAX)
+				stack[stackpos++] = node.left + 1;
+		}
+	}
+
+	return hit.triangle != ~0u;
+}
+
+bool wiCPUPathTracer::TraceAny(const Ray& ray) const
+{
+	if (!bvh.IsValid())
+		return false;
+
+	const XMVECTOR origin = XMLoadFloat3(&ray.origin);
+	const XMVECTOR direction = XMLoadFloat3(&ray.direction);
+	if (XMVector3IsNaN(direction) || XMVector3IsNaN(origin))
+		return false; // NaN would pass every box test in the traversal (for example with an uninitialized camera)
+	const XMVECTOR invdir = GetInverseDirection(ray.direction);
+	const XMVECTOR ox = XMVectorSplatX(origin);
+	const XMVECTOR oy = XMVectorSplatY(origin);
+	const XMVECTOR oz = XMVectorSplatZ(origin);
+	const XMVECTOR dx = XMVectorSplatX(direction);
+	const XMVECTOR dy = XMVectorSplatY(direction);
+	const XMVECTOR dz = XMVectorSplatZ(direction);
+
+	bool occluded = false;
+	uint32_t stack[64];
+	uint32_t stackpos = 0;
+	stack[stackpos++] = 0;
+	while (stackpos > 0 && !occluded)
+	{
+		const uint32_t nodeIndex = stack[--stackpos];
+		const wiBVH::Node& node = bvh.nodes[nodeIndex];
+		if (IntersectBox(node.aabb, origin, invdir, ray.TMin, ray.TMax) == FLT_MAX)
+			continue;
+		if (!node.IsLeaf())
+		{
+			assert(stackpos + 2 <= arraysize(stack));
+			stack[stackpos++] = node.left + 1;
+			stack[stackpos++] = node.left;
+			continue;
+		}
+
+		const TrianglePacket& packet = packets[leaf_packets[nodeIndex]];
+		XMFLOAT4A t, u, v;
+		const int bits = IntersectPacket(packet, ox, oy, oz, dx, dy, dz, ray.TMin, ray.TMax, false, t, u, v);
+		const float* u_ = &u.x;
+		const float* v_ = &v.x;
+		for (int lane = 0; lane < 4 && !occluded; ++lane)
+		{
+			if ((bits & (1 << lane)) == 0)
+				continue;
+			const Triangle& tri = triangles[packet.triangles[lane]];
+			const ShaderMaterial& material = materials[tri.materialIndex];
+			if ((material.options & SHADERMATERIAL_OPTION_BIT_CAST_SHADOW) == 0)
+				continue;
+
+			// Alpha test, same as IntersectTriangleANY() in raytracingHF.hlsli:
+			const float w = 1 - u_[lane] - v_[lane];
+			const float alpha = material.baseColor.w * (tri.c0.w * w + tri.c1.w * u_[lane] + tri.c2.w * v_[lane]);
+			occluded = alpha > material.alphaTest;
+		}
+	}
+	return occluded;
+}
+
+void wiCPUPathTracer::Trace(const CameraComponent& camera, uint32_t width, uint32_t height, uint32_t sample, uint32_t bounces)
+{
+	wiTimer timer;
+
+	if (this->width != width || this->height != height)
+	{
+		this->width = width;
+		this->height = height;
+		result.resize(size_t(width) * size_t(height));
+		sample = 0;
+	}
+	if (sample == 0)
+	{
+		std::fill(result.begin(), result.end(), XMFLOAT4(0, 0, 0, 0));
+	}
+
+	const XMMATRIX InvVP = camera.GetInvViewProjection();
+	const XMVECTOR camPos = XMLoadFloat3(&camera.Eye);
+	const XMVECTOR camAt = XMLoadFloat3(&camera.At);
+	const XMVECTOR camUp = XMLoadFloat3(&camera.Up);
+	const XMVECTOR camRight = XMVector3Cross(camUp, camAt);
+	const XMFLOAT4& halton = wiMath::GetHaltonSequence((int)sample);
+	const float accumulation = 1.0f / (float(sample) + 1.0f);
+	const uint32_t bouncelimit = std::min(bounces, 16u);
+	const XMVECTOR horizonColor = XMLoadFloat3(&horizon);
+	const XMVECTOR zenithColor = XMLoadFloat3(&zenith);
+	const float gamma = wiRenderer::GetGamma();
+	const bool albedomaps = !wiRenderer::IsDisableAlbedoMaps();
+
+	const uint32_t tileCountX = (width + tile_size - 1) / tile_size;
+	const uint32_t tileCountY = (height + tile_size - 1) / tile_size;
+	std::atomic<uint64_t> raycount{ 0 };
+	std::atomic<uint32_t> threadcount{ 0 };
+	const uint64_t current_trace_id = trace_id.fetch_add(1) + 1;
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, tileCountX * tileCountY, 1, [&](wiJobArgs args) {
+		if (thread_trace_id != current_trace_id)
+		{
+			thread_trace_id = current_trace_id;
+			threadcount.fetch_add(1, std::memory_order_relaxed);
+		}
+		const uint32_t tileX = args.jobIndex % tileCountX;
+		const uint32_t tileY = args.jobIndex / tileCountX;
+		uint64_t rays = 0;
+
+		for (uint32_t y = tileY * tile_size; y < std::min(height, (tileY + 1) * tile_size); ++y)
+		{
+			for (uint32_t x = tileX * tile_size; x < std::min(width, (tileX + 1) * tile_size); ++x)
+			{
+				RNG rng(y * width + x, sample);
+				XMVECTOR result_color = XMVectorZero();
+				XMVECTOR energy = XMVectorSplatOne();
+
+				// Camera ray, same as CreateCameraRay() in raytracingHF.hlsli:
+				const float u = ((x + halton.x) / float(width) * 2 - 1);
+				const float v = -((y + halton.y) / float(height) * 2 - 1);
+				const XMVECTOR unprojected = XMVector3TransformCoord(XMVectorSet(u, v, 0, 1), InvVP);
+				XMVECTOR origin = camPos;
+				XMVECTOR direction = XMVector3Normalize(unprojected - origin);
+
+				// Depth of field:
+				const XMVECTOR focal_point = origin + direction * camera.focal_length;
+				const float coc_u = rng.rand();
+				const float coc_v = rng.rand();
+				const XMVECTOR coc_point = hemispherepoint_cos(coc_u, coc_v);
+				XMVECTOR coc = camRight * (XMVectorGetX(coc_point) * camera.aperture_shape.x) + camUp * (XMVectorGetY(coc_point) * camera.aperture_shape.y);
+				coc *= camera.focal_length * camera.aperture_size * 0.1f;
+				origin += coc;
+				direction = focal_point - origin;
+
+				uint32_t pathbounces = bouncelimit;
+				for (uint32_t bounce = 0; bounce < std::min(pathbounces, 16u) && !XMVector3Equal(energy, XMVectorZero()); ++bounce)
+				{
+					direction = XMVector3Normalize(direction);
+
+					Ray ray;
+					XMStoreFloat3(&ray.origin, origin);
+					XMStoreFloat3(&ray.direction, direction);
+					Hit hit;
+					rays++;
+					if (!TraceClosest(ray, hit))
+					{
+						const float gradient = saturate(XMVectorGetY(direction) * 0.5f + 0.5f);
+						const XMVECTOR envColor = XMVectorLerp(horizonColor, zenithColor, gradient);
+						result_color += XMVectorMax(XMVectorZero(), energy * envColor);
+						break;
+					}
+
+					// Evaluate the surface, same as EvaluateObjectSurface() in raytracingHF.hlsli:
+					const Triangle& tri = triangles[hit.triangle];
+					const ShaderMaterial& material = materials[tri.materialIndex];
+					const MaterialTextures& mattex = material_textures[tri.materialIndex];
+					const float bu = hit.bary.x;
+					const float bv = hit.bary.y;
+					const float bw = 1 - bu - bv;
+					const XMVECTOR color = XMLoadFloat4(&tri.c0) * bw + XMLoadFloat4(&tri.c1) * bu + XMLoadFloat4(&tri.c2) * bv;
+					XMFLOAT4 uvsets;
+					XMStoreFloat4(&uvsets, XMLoadFloat4(&tri.u0) * bw + XMLoadFloat4(&tri.u1) * bu + XMLoadFloat4(&tri.u2) * bv);
+					auto sample_texture = [&](const MaterialTexture& map, XMVECTOR& value) {
+						if (map.index < 0 || textures[map.index].pixels.empty())
+							return false;
+						value = map.uvset == 0 ? textures[map.index].Sample(uvsets.x, uvsets.y) : textures[map.index].Sample(uvsets.z, uvsets.w);
+						return true;
+					};
+
+					XMVECTOR baseColor = XMLoadFloat4(&material.baseColor) * color;
+					XMVECTOR baseColorMap;
+					if (albedomaps && sample_texture(mattex.basecolormap, baseColorMap))
+					{
+						baseColor *= DeGamma(baseColorMap, gamma);
+					}
+					XMVECTOR surfaceMap = XMVectorSplatOne();
+					sample_texture(mattex.surfacemap, surfaceMap);
+
+					Surface surface;
+					origin = origin + direction * hit.distance;
+					surface.P = origin;
+					surface.N = XMVector3Normalize(XMLoadFloat3(&tri.n0) * bw + XMLoadFloat3(&tri.n1) * bu + XMLoadFloat3(&tri.n2) * bv);
+					XMVECTOR normalMap;
+					if (sample_texture(mattex.normalmap, normalMap))
+					{
+						normalMap = normalMap * 2 - XMVectorSplatOne();
+						const XMVECTOR N = XMVectorGetX(normalMap) * XMLoadFloat3(&tri.tangent) + XMVectorGetY(normalMap) * XMLoadFloat3(&tri.binormal) + XMVectorGetZ(normalMap) * surface.N;
+						surface.N = XMVector3Normalize(XMVectorLerp(surface.N, N, material.normalMapStrength));
+					}
+					surface.V = XMVector3Normalize(camPos - surface.P);
+					surface.opacity = XMVectorGetW(baseColor);
+					surface.roughness = material.roughness;
+					surface.f0 = XMLoadFloat4(&material.specularColor) * material.specularColor.w;
+					if (material.options & SHADERMATERIAL_OPTION_BIT_SPECULARGLOSSINESS_WORKFLOW)
+					{
+						surface.roughness *= saturate(1 - XMVectorGetW(surfaceMap));
+						surface.f0 *= DeGamma(surfaceMap, gamma);
+						surface.albedo = baseColor;
+					}
+					else
+					{
+						surface.roughness *= XMVectorGetY(surfaceMap);
+						const float metalness = material.metalness * XMVectorGetZ(surfaceMap);
+						const float reflectance = material.reflectance * XMVectorGetW(surfaceMap);
+						surface.albedo = XMVectorLerp(XMVectorLerp(baseColor, XMVectorZero(), reflectance), XMVectorZero(), metalness);
+						surface.f0 *= XMVectorLerp(XMVectorLerp(XMVectorZero(), XMVectorSplatOne(), reflectance), baseColor, metalness);
+					}
+					XMVECTOR emissiveColor = XMLoadFloat4(&material.emissiveColor);
+					XMVECTOR emissiveMap;
+					if (material.emissiveColor.w > 0 && sample_texture(mattex.emissivemap, emissiveMap))
+					{
+						emissiveColor *= DeGamma(emissiveMap, gamma);
+					}
+					surface.emissive = emissiveColor * XMVectorGetW(emissiveColor);
+					surface.transmission = material.transmission;
+					surface.roughness = wiMath::Clamp(surface.roughness, 0.045f, 1);
+					surface.roughnessBRDF = surface.roughness * surface.roughness;
+					surface.NdotV = saturate(std::abs(XMVectorGetX(XMVector3Dot(surface.N, surface.V))) + 1e-5f);
+					surface.f90 = saturate(50 * XMVectorGetX(XMVector3Dot(surface.f0, XMVectorReplicate(0.33f))));
+
+					const XMVECTOR current_energy = energy;
+					result_color += XMVectorMax(XMVectorZero(), current_energy * surface.emissive);
+
+					if (rng.rand() < 1 - surface.opacity)
+					{
+						// Alpha blending, add a new bounce iteration, otherwise the transparent effect can disappear:
+						pathbounces++;
+						continue;
+					}
+					if (rng.rand() < surface.transmission)
+					{
+						// Refraction:
+						const XMVECTOR R = XMVector3Refract(direction, surface.N, 1 - material.refraction);
+						direction = XMVectorLerp(R, SampleHemisphere_cos(R, rng), surface.roughnessBRDF);
+						energy *= surface.albedo;
+						pathbounces++;
+					}
+					else
+					{
+						const XMVECTOR F = F_Schlick(surface.f0, saturate(XMVectorGetX(XMVector3Dot(-direction, surface.N))));
+						const float specChance = XMVectorGetX(XMVector3Dot(F, XMVectorReplicate(0.333f)));
+
+						if (rng.rand() < specChance)
+						{
+							// Specular reflection:
+							const XMVECTOR R = XMVector3Reflect(direction, surface.N);
+							direction = XMVectorLerp(R, SampleHemisphere_cos(R, rng), surface.roughnessBRDF);
+							energy *= F / specChance;
+						}
+						else
+						{
+							// Diffuse reflection:
+							direction = SampleHemisphere_cos(surface.N, rng);
+							energy *= surface.albedo / (1 - specChance);
+						}
+
+						if (XMVectorGetX(XMVector3Dot(direction, surface.N)) <= 0)
+						{
+							// Interpolated normal is the face normal here, no more bounces below the surface:
+							energy = XMVectorZero();
+						}
+					}
+
+					// Light sampling:
+					for (const Light& light : lights)
+					{
+						XMVECTOR L = XMVectorZero();
+						float dist = 0;
+						XMVECTOR lightColor = XMVectorZero();
+
+						switch (light.type)
+						{
+						case LightComponent::DIRECTIONAL:
+						{
+							dist = FLT_MAX;
+							L = XMLoadFloat3(&light.direction);
+							lightColor = XMLoadFloat3(&light.color);
+						}
+						break;
+						case LightComponent::POINT:
+						case LightComponent::SPOT:
+						{
+							L = XMLoadFloat3(&light.position) - surface.P;
+							const float dist2 = XMVectorGetX(XMVector3LengthSq(L));
+							const float range2 = light.range * light.range;
+							if (dist2 < range2)
+							{
+								dist = std::sqrt(dist2);
+								L /= dist;
+
+								const float att = saturate(1 - (dist2 / range2));
+								float attenuation = att * att;
+								if (light.type == LightComponent::SPOT)
+								{
+									const float SpotFactor = XMVectorGetX(XMVector3Dot(L, XMLoadFloat3(&light.direction)));
+									const float spotCutOff = light.coneAngleCos;
+									attenuation = SpotFactor > spotCutOff ? attenuation * saturate(1 - (1 - SpotFactor) / (1 - spotCutOff)) : 0;
+								}
+								lightColor = XMLoadFloat3(&light.color) * attenuation;
+							}
+						}
+						break;
+						}
+
+						const float NdotL = saturate(XMVectorGetX(XMVector3Dot(L, surface.N)));
+						if (NdotL <= 0 || dist <= 0 || XMVector3Equal(lightColor, XMVectorZero()))
+							continue;
+
+						Ray shadowray;
+						XMStoreFloat3(&shadowray.origin, surface.P);
+						const XMVECTOR sampling_offset = XMVectorSet(rng.rand(), rng.rand(), rng.rand(), 0) * 2 - XMVectorSplatOne();
+						XMStoreFloat3(&shadowray.direction, XMVector3Normalize(L + sampling_offset * 0.025f));
+						shadowray.TMax = dist;
+						rays++;
+						if (TraceAny(shadowray))
+							continue;
+
+						// BRDF, same as BRDF_GetSpecular() and BRDF_GetDiffuse() in brdf.hlsli:
+						const XMVECTOR H = XMVector3Normalize(L + surface.V);
+						const float NdotH = saturate(XMVectorGetX(XMVector3Dot(surface.N, H)));
+						const float VdotH = saturate(XMVectorGetX(XMVector3Dot(surface.V, H)));
+						const XMVECTOR F = F_Schlick(surface.f0, surface.f90, VdotH);
+						const XMVECTOR specular = F * (D_GGX(surface.roughnessBRDF, NdotH) * V_SmithGGXCorrelated(surface.roughnessBRDF, surface.NdotV, NdotL));
+						const XMVECTOR diffuse = (XMVectorSplatOne() - F) / XM_PI;
+
+						const XMVECTOR shadow = current_energy * NdotL;
+						result_color += XMVectorMax(XMVectorZero(), shadow * lightColor * (surface.albedo * diffuse + specular));
+					}
+				}
+
+				XMFLOAT4& dest = result[y * width + x];
+				XMStoreFloat4(&dest, XMVectorLerp(XMLoadFloat4(&dest), XMVectorSetW(result_color, 1), accumulation));
+			}
+		}
+
+		raycount.fetch_add(rays, std::memory_order_relaxed);
+	});
+	wiJobSystem::Wait(ctx);
+
+	statistics.rays = raycount.load();
+	statistics.seconds = timer.elapsed_seconds();
+	statistics.threads = std::max(1u, threadcount.load());
+}
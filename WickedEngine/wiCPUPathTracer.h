@@ -0,0 +1,142 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiBVH.h"
+#include "wiScene_Decl.h"
+#include "shaders/ShaderInterop_Renderer.h"
+
+#include <vector>
+
+// Multithreaded CPU reference path tracer
+//	It follows the GPU path tracer (raytraceCS.hlsl): same camera rays, ShaderMaterial surface model, light sampling and progressive accumulation
+//	It doesn't need a GPU, so it can generate ground truth images on machines without one (for example with the null graphics device), or validate GPU output
+//	Material textures (base color, surface, emissive and normal maps) are decoded on the CPU from the file data that the texture resources retain, or from the texture files (embedded textures without a file need wiResourceManager::MODE_ALLOW_RETAIN_FILEDATA)
+//	Limitations: only the top mip is sampled, textures that can't be decoded (like BC2 or BC6H) are ignored, skinned meshes are traced in bind pose, the sky is the simple horizon-zenith gradient
+class wiCPUPathTracer
+{
+public:
+	struct Statistics
+	{
+		uint64_t rays = 0;		// camera, bounce and shadow rays that were traced in the last Trace()
+		double seconds = 0;		// wall clock time of the last Trace()
+		uint32_t threads = 1;	// number of threads that traced at least one tile, including the calling thread
+
+		// Million rays per second for a single CPU core
+		inline double GetMraysPerSecondPerCore() const
+		{
+			return seconds > 0 ? double(rays) / seconds / double(threads) / 1000000.0 : 0;
+		}
+	};
+
+	static constexpr uint32_t tile_size = 16; // pixels are traced in square tiles, one tile per job
+
+	// Gather the world space triangles, materials, textures and lights of the scene and build the BVH
+	//	The scene must be updated beforehand, so that the world matrices are valid
+	void Build(const wiScene::Scene& scene);
+
+	// Trace one path per pixel and accumulate it into the result
+	//	sample	: accumulation sample index, 0 clears the previous result
+	//	bounces	: maximum path length, clamped to 16 like on the GPU
+	void Trace(const wiScene::CameraComponent& camera, uint32_t width, uint32_t height, uint32_t sample, uint32_t bounces);
+
+	// Accumulated radiance in RGBA 32-bit float format, top row first
+	inline const XMFLOAT4* GetResult() const { return result.data(); }
+	inline uint32_t GetWidth() const { return width; }
+	inline uint32_t GetHeight() const { return height; }
+
+	inline const Statistics& GetStatistics() const { return statistics; }
+	inline uint32_t GetTriangleCount() const { return (uint32_t)triangles.size(); }
+	inline uint32_t GetTextureCount() const { return (uint32_t)textures.size(); }
+
+	void Clear();
+
+	struct Ray
+	{
+		XMFLOAT3 origin;
+		XMFLOAT3 direction;
+		float TMin = 0.001f;
+		float TMax = FLT_MAX;
+	};
+	struct Hit
+	{
+		float distance = FLT_MAX;
+		uint32_t triangle = ~0u;
+		XMFLOAT2 bary = XMFLOAT2(0, 0);
+	};
+
+	// Find the closest front facing triangle along the ray. Returns false on miss
+	bool TraceClosest(const Ray& ray, Hit& hit) const;
+	// Check whether any shadow casting triangle occludes the ray between TMin and TMax
+	bool TraceAny(const Ray& ray) const;
+
+private:
+	struct Triangle
+	{
+		XMFLOAT3 n0, n1, n2;
+		XMFLOAT4 c0, c1, c2;	// instance color * vertex color
+		XMFLOAT4 u0, u1, u2;	// uv set 0 (with the material texMulAdd applied) and uv set 1
+		XMFLOAT3 tangent;
+		XMFLOAT3 binormal;
+		uint32_t materialIndex;
+	};
+	std::vector<Triangle> triangles;
+	std::vector<ShaderMaterial> materials;
+
+	// Top mip of a material texture in RGBA8 format
+	struct Texture
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint32_t> pixels;
+
+		// Bilinear sample with wrap addressing, the result is in [0, 1] range
+		XMVECTOR Sample(float u, float v) const;
+	};
+	std::vector<Texture> textures;
+
+	// Texture index and uv set for the texture slots that are sampled, the index is -1 if there is no texture
+	struct MaterialTexture
+	{
+		int index = -1;
+		uint32_t uvset = 0;
+	};
+	struct MaterialTextures
+	{
+		MaterialTexture basecolormap;
+		MaterialTexture surfacemap;
+		MaterialTexture emissivemap;
+		MaterialTexture normalmap;
+	};
+	std::vector<MaterialTextures> material_textures; // for every material
+
+	// Up to 4 triangles of a BVH leaf in SoA layout, so that they can be intersected at once
+	struct alignas(16) TrianglePacket
+	{
+		XMFLOAT4A v0[3];
+		XMFLOAT4A e1[3];
+		XMFLOAT4A e2[3];
+		uint32_t triangles[4];
+	};
+	std::vector<TrianglePacket> packets;
+	std::vector<uint32_t> leaf_packets; // packet index for every BVH node
+	wiBVH bvh;
+
+	struct Light
+	{
+		uint32_t type;
+		XMFLOAT3 position;
+		XMFLOAT3 direction;
+		XMFLOAT3 color;			// color * energy
+		float range;
+		float coneAngleCos;
+	};
+	std::vector<Light> lights;
+
+	XMFLOAT3 horizon = XMFLOAT3(0, 0, 0);
+	XMFLOAT3 zenith = XMFLOAT3(0, 0, 0);
+
+	std::vector<XMFLOAT4> result;
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	Statistics statistics;
+};
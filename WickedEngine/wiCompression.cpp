@@ -0,0 +1,334 @@
+#include "wiCompression.h"
+
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
+
+namespace wiCompression
+{
+	static constexpr size_t MINMATCH = 4;			// shortest back reference
+	static constexpr size_t LASTLITERALS = 5;		// the last bytes are always literals
+	static constexpr size_t MFLIMIT = 12;			// a match can't start within this many bytes from the end
+	static constexpr size_t MAX_DISTANCE = 65535;	// offsets are 16 bit
+	static constexpr uint32_t HASH_BITS = 16;
+	static constexpr uint32_t NO_POSITION = ~0u;
+
+	inline uint32_t read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	inline uint64_t read64(const uint8_t* p)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	// Returns the number of equal bytes of a and b, b is compared until b_end
+	inline size_t count_match(const uint8_t* a, const uint8_t* b, const uint8_t* b_end)
+	{
+		const uint8_t* const b_start = b;
+		while (b + 8 <= b_end)
+		{
+			const uint64_t diff = read64(a) ^ read64(b);
+			if (diff != 0)
+			{
+#if defined(_MSC_VER)
+				unsigned long index;
+				_BitScanForward64(&index, diff);
+				return size_t(b - b_start) + (index >> 3);
+#else
+				return size_t(b - b_start) + (__builtin_ctzll(diff) >> 3); // little endian
+#endif // _MSC_VER
+			}
+			a += 8;
+			b += 8;
+		}
+		while (b < b_end && *a == *b)
+		{
+			a++;
+			b++;
+		}
+		return size_t(b - b_start);
+	}
+	inline uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Match finder state: hash heads and a chain of previous positions with the same hash in a 64 KB window
+	//	These are reused by each thread, because they are too large to be reallocated and cleared for every block
+	struct MatchFinder
+	{
+		std::vector<uint32_t> head;
+		std::vector<uint16_t> chain;
+
+		void reset()
+		{
+			head.assign(1u << HASH_BITS, NO_POSITION);
+			chain.resize(MAX_DISTANCE + 1);
+		}
+		inline void insert(const uint8_t* src, uint32_t pos)
+		{
+			const uint32_t h = hash(read32(src + pos));
+			const uint32_t prev = head[h];
+			chain[pos & MAX_DISTANCE] = prev == NO_POSITION ? 0 : (uint16_t)std::min(pos - prev, (uint32_t)MAX_DISTANCE);
+			head[h] = pos;
+		}
+	};
+
+	size_t CompressBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	size_t Compress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity, Level level)
+	{
+		if (src_size > NO_POSITION)
+		{
+			return 0; // positions are 32 bit, large data must be compressed in blocks
+		}
+
+		uint32_t attempts;
+		bool fast;
+		switch (level)
+		{
+		case Level::Fast:
+			attempts = 1;
+			fast = true;
+			break;
+		case Level::High:
+			attempts = 256;
+			fast = false;
+			break;
+		default:
+			attempts = 16;
+			fast = false;
+			break;
+		}
+
+		static thread_local MatchFinder finder;
+		finder.reset();
+
+		uint8_t* op = dst;
+		uint8_t* const oend = dst + dst_capacity;
+		size_t anchor = 0;
+
+		auto write_length = [&](size_t length) {
+			while (length >= 255)
+			{
+				*op++ = 255;
+				length -= 255;
+			}
+			*op++ = (uint8_t)length;
+		};
+		// Literal run followed by a back reference (offset == 0 means that it's the last literal run of the block):
+		auto write_sequence = [&](size_t literal_end, size_t offset, size_t match_length) {
+			const size_t literal_length = literal_end - anchor;
+			const size_t ml = match_length - MINMATCH;
+			const size_t required = 1 + literal_length / 255 + 1 + literal_length + (offset > 0 ? 2 + ml / 255 + 1 : 0);
+			if (required > size_t(oend - op))
+			{
+				return false;
+			}
+			uint8_t* token = op++;
+			*token = (uint8_t)(std::min(literal_length, size_t(15)) << 4);
+			if (literal_length >= 15)
+			{
+				write_length(literal_length - 15);
+			}
+			if (literal_length > 0)
+			{
+				memcpy(op, src + anchor, literal_length); // src can be null for empty input
+			}
+			op += literal_length;
+			if (offset > 0)
+			{
+				*op++ = (uint8_t)(offset & 0xFF);
+				*op++ = (uint8_t)(offset >> 8);
+				*token |= (uint8_t)std::min(ml, size_t(15));
+				if (ml >= 15)
+				{
+					write_length(ml - 15);
+				}
+			}
+			return true;
+		};
+
+		if (src_size >= MFLIMIT + 1)
+		{
+			const size_t match_limit = src_size - LASTLITERALS;
+			const size_t mf_limit = src_size - MFLIMIT;
+			size_t ip = 0;
+			while (ip <= mf_limit)
+			{
+				const uint32_t sequence = read32(src + ip);
+				size_t best_length = 0;
+				size_t best_offset = 0;
+				uint32_t candidate = finder.head[hash(sequence)];
+				for (uint32_t i = 0; i < attempts && candidate != NO_POSITION; ++i)
+				{
+					const size_t distance = ip - candidate;
+					if (distance > MAX_DISTANCE)
+					{
+						break;
+					}
+					if (read32(src + candidate) == sequence)
+					{
+						const size_t length = MINMATCH + count_match(src + candidate + MINMATCH, src + ip + MINMATCH, src + match_limit);
+						if (length > best_length)
+						{
+							best_length = length;
+							best_offset = distance;
+						}
+					}
+					const uint16_t delta = finder.chain[candidate & MAX_DISTANCE];
+					if (delta == 0)
+					{
+						break;
+					}
+					candidate -= delta;
+				}
+				finder.insert(src, (uint32_t)ip);
+
+				if (best_length == 0)
+				{
+					// The fast mode is skipping faster the longer it didn't find a match:
+					ip += fast ? 1 + ((ip - anchor) >> 6) : 1;
+					continue;
+				}
+
+				if (!write_sequence(ip, best_offset, best_length))
+				{
+					return 0;
+				}
+				const size_t match_end = ip + best_length;
+				if (fast)
+				{
+					if (match_end - 2 > ip && match_end - 2 <= mf_limit)
+					{
+						finder.insert(src, (uint32_t)(match_end - 2));
+					}
+				}
+				else
+				{
+					for (size_t pos = ip + 1; pos < match_end && pos <= mf_limit; ++pos)
+					{
+						finder.insert(src, (uint32_t)pos);
+					}
+				}
+				ip = match_end;
+				anchor = ip;
+			}
+		}
+
+		if (!write_sequence(src_size, 0, MINMATCH))
+		{
+			return 0;
+		}
+		return size_t(op - dst);
+	}
+
+	bool Decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* const iend = src + src_size;
+		uint8_t* op = dst;
+		uint8_t* const oend = dst + dst_size;
+
+		auto read_length = [&](size_t& length) {
+			uint8_t value;
+			do
+			{
+				if (ip >= iend)
+				{
+					return false;
+				}
+				value = *ip++;
+				length += value;
+			} while (value == 255);
+			return true;
+		};
+
+		while (ip < iend)
+		{
+			const uint8_t token = *ip++;
+
+			size_t literal_length = token >> 4;
+			if (literal_length == 15 && !read_length(literal_length))
+			{
+				return false;
+			}
+			if (literal_length > size_t(iend - ip) || literal_length > size_t(oend - op))
+			{
+				return false;
+			}
+			if (literal_length <= 16 && iend - ip >= 16 && oend - op >= 16)
+			{
+				memcpy(op, ip, 16); // short literal runs are copied with a fixed size, the extra bytes are overwritten later
+			}
+			else if (literal_length > 0)
+			{
+				memcpy(op, ip, literal_length); // the pointers can be null for empty buffers
+			}
+			op += literal_length;
+			ip += literal_length;
+
+			if (ip == iend)
+			{
+				return op == oend; // the last sequence only has literals
+			}
+
+			if (iend - ip < 2)
+			{
+				return false;
+			}
+			const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > size_t(op - dst))
+			{
+				return false;
+			}
+
+			size_t match_length = token & 15;
+			if (match_length == 15 && !read_length(match_length))
+			{
+				return false;
+			}
+			match_length += MINMATCH;
+			if (match_length > size_t(oend - op))
+			{
+				return false;
+			}
+
+			const uint8_t* match = op - offset;
+			if (offset >= 8 && size_t(oend - op) >= match_length + 8)
+			{
+				// Copy in 8 byte steps, this can write past the match, but that is overwritten later:
+				uint8_t* const copy_end = op + match_length;
+				while (op < copy_end)
+				{
+					memcpy(op, match, 8);
+					op += 8;
+					match += 8;
+				}
+				op = copy_end;
+			}
+			else
+			{
+				// Overlapping copy repeats the pattern byte by byte:
+				for (size_t i = 0; i < match_length; ++i)
+				{
+					op[i] = match[i];
+				}
+				op += match_length;
+			}
+		}
+		return false;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Fast LZ compression of memory blocks
+//	The compressed data uses the LZ4 block format: sequences of literals and back references (up to 64 KB behind) without framing
+//	The decompressor validates the input, so corrupted data can't make it read or write out of bounds
+namespace wiCompression
+{
+	// Speed versus ratio setting for compression. The decompression speed doesn't depend on it
+	enum class Level
+	{
+		None,		// no compression
+		Fast,		// single hash probe with skipping over incompressible data
+		Default,	// short hash chain search
+		High,		// long hash chain search, slowest compression and best ratio
+	};
+
+	// Returns the worst case compressed size of the data (incompressible data grows slightly)
+	size_t CompressBound(size_t size);
+
+	// Compresses src into dst, returns the compressed size or 0 if it didn't fit into dst_capacity
+	size_t Compress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity, Level level = Level::Default);
+
+	// Decompresses src into dst, which must be exactly the size of the original data. Returns false if the data was corrupted
+	bool Decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+}
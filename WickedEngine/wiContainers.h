@@ -1,6 +1,11 @@
 #pragma once
 #include "wiSpinLock.h"
 
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
 namespace wiContainers
 {
 	// Fixed size very simple thread safe ring buffer
@@ -49,4 +54,135 @@ namespace wiContainers
 		size_t tail = 0;
 		wiSpinLock lock;
 	};
+
+	// Unbounded lock-free work stealing deque (Chase-Lev)
+	//	The owner thread can push_back() and pop_back() at the bottom end
+	//	Any other thread can steal() from the top end
+	//	T must be trivially copyable, because items can be read concurrently by the owner and thieves
+	template <typename T>
+	class WorkStealingDeque
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque item type must be trivially copyable!");
+	public:
+		WorkStealingDeque(size_t initial_capacity = 256)
+		{
+			size_t capacity = 1;
+			while (capacity < initial_capacity)
+			{
+				capacity <<= 1;
+			}
+			buffers.emplace_back(std::make_unique<Buffer>(capacity));
+			buffer.store(buffers.back().get(), std::memory_order_relaxed);
+		}
+
+		// Push an item to the bottom. Only the owner thread can call this.
+		//	The storage grows if there is not enough space, so this always succeeds
+		inline void push_back(const T& item)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_acquire);
+			Buffer* buf = buffer.load(std::memory_order_relaxed);
+			if (b - t > (int64_t)buf->mask)
+			{
+				buf = grow(buf, t, b);
+			}
+			buf->put(b, item);
+			std::atomic_thread_fence(std::memory_order_release);
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		// Get the most recently pushed item. Only the owner thread can call this.
+		//	Returns true if succesful
+		//	Returns false if there are no items
+		inline bool pop_back(T& item)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			Buffer* buf = buffer.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+
+			bool result = false;
+			if (t <= b)
+			{
+				item = buf->get(b);
+				result = true;
+				if (t == b)
+				{
+					// Last item, race against thieves:
+					if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					{
+						result = false;
+					}
+					bottom.store(b + 1, std::memory_order_relaxed);
+				}
+			}
+			else
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return result;
+		}
+
+		// Get the oldest item. Any thread can call this.
+		//	Returns true if succesful
+		//	Returns false if there are no items or the item was taken by an other thread concurrently
+		inline bool steal(T& item)
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = bottom.load(std::memory_order_acquire);
+
+			if (t < b)
+			{
+				Buffer* buf = buffer.load(std::memory_order_acquire);
+				T candidate = buf->get(t);
+				if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					item = candidate;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Returns true if there are no items at the moment. The result is only a hint when other threads are working on the deque.
+		inline bool empty() const
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_relaxed);
+			return b <= t;
+		}
+
+	private:
+		struct Buffer
+		{
+			size_t mask;
+			std::unique_ptr<T[]> data;
+
+			Buffer(size_t capacity) : mask(capacity - 1), data(new T[capacity]) {}
+
+			inline void put(int64_t index, const T& item) { data[(size_t)index & mask] = item; }
+			inline T get(int64_t index) const { return data[(size_t)index & mask]; }
+		};
+
+		// Double the storage size. Old buffers are retained because thieves could still be reading them
+		inline Buffer* grow(Buffer* buf, int64_t t, int64_t b)
+		{
+			auto bigger = std::make_unique<Buffer>((buf->mask + 1) * 2);
+			for (int64_t i = t; i < b; ++i)
+			{
+				bigger->put(i, buf->get(i));
+			}
+			Buffer* result = bigger.get();
+			buffers.push_back(std::move(bigger));
+			buffer.store(result, std::memory_order_release);
+			return result;
+		}
+
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		alignas(64) std::atomic<Buffer*> buffer{ nullptr };
+		std::vector<std::unique_ptr<Buffer>> buffers; // owned by the owner thread only
+	};
 }
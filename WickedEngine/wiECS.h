@@ -3,18 +3,20 @@
 
 #include "wiArchive.h"
 #include "wiJobSystem.h"
+#include "wiSpinLock.h"
 
 #include <cstdint>
 #include <cassert>
 #include <vector>
 #include <unordered_map>
 #include <atomic>
+#include <algorithm>
 
 namespace wiECS
 {
 	using Entity = uint32_t;
 	static const Entity INVALID_ENTITY = 0;
-	static std::atomic<Entity> next{INVALID_ENTITY + 1};
+	inline std::atomic<Entity> next{INVALID_ENTITY + 1}; // inline variable, so every translation unit uses the same counter
 	// Runtime can create a new entity with this
 	inline Entity CreateEntity()
 	{
@@ -27,6 +29,16 @@ namespace wiECS
 		std::unordered_map<uint64_t, Entity> remap;
 		bool allow_remap = true;
 
+		// When chunks of an archive are read in parallel, the remap table is filled up front from the entity table of the archive and then it is only read
+		//	Entities that are missing from the entity table are remapped separately under a lock
+		bool remap_readonly = false;
+		std::unordered_map<uint64_t, Entity> remap_late;
+		wiSpinLock remap_locker;
+
+		// When writing chunks, the remap table collects the serialized entities, so that the entity table can be created
+		//	Otherwise the remap table is not used when writing
+		bool remap_collect = false;
+
 		~EntitySerializer()
 		{
 			wiJobSystem::Wait(ctx); // automatically wait for all subtasks after serialization
@@ -44,14 +56,29 @@ namespace wiECS
 			if (seri.allow_remap)
 			{
 				auto it = seri.remap.find(mem);
-				if (it == seri.remap.end())
+				if (it != seri.remap.end())
 				{
-					entity = CreateEntity();
-					seri.remap[mem] = entity;
+					entity = it->second;
+				}
+				else if (seri.remap_readonly)
+				{
+					seri.remap_locker.lock();
+					auto it_late = seri.remap_late.find(mem);
+					if (it_late == seri.remap_late.end())
+					{
+						entity = CreateEntity();
+						seri.remap_late[mem] = entity;
+					}
+					else
+					{
+						entity = it_late->second;
+					}
+					seri.remap_locker.unlock();
 				}
 				else
 				{
-					entity = it->second;
+					entity = CreateEntity();
+					seri.remap[mem] = entity;
 				}
 			}
 			else
@@ -61,11 +88,128 @@ namespace wiECS
 		}
 		else
 		{
-			archive << entity;
+			archive << (uint64_t)entity;
+			if (seri.remap_collect)
+			{
+				seri.remap.emplace(entity, entity);
+			}
 		}
 	}
 
-	template<typename Component>
+	// Entity -> component index lookup table without hashing
+	//	Entities are created sequentially, so the table is an array indexed by the entity, split into pages that are only allocated when used
+	//	A page is 16 KB for 4096 consecutive entities, which is 4 bytes per entity if most of them have the component (a hash map node is around 40 bytes),
+	//	but it's 16 KB for a single entity in the range, so this is only worth for component managers that most entities are part of
+	class EntityLookup
+	{
+	public:
+		static constexpr uint32_t page_bits = 12;
+		static constexpr uint32_t page_size = 1u << page_bits;
+		static constexpr uint32_t invalid_index = ~0u;
+
+		// Returns the index of the entity (if not exists, returns ~0 value)
+		inline size_t find(Entity entity) const
+		{
+			const size_t page = entity >> page_bits;
+			if (page < pages.size() && pages[page].count > 0)
+			{
+				const uint32_t index = pages[page].indices[entity & (page_size - 1)];
+				if (index != invalid_index)
+				{
+					return index;
+				}
+			}
+			return ~size_t(0);
+		}
+		inline bool contains(Entity entity) const
+		{
+			return find(entity) != ~size_t(0);
+		}
+		inline void set(Entity entity, size_t index)
+		{
+			assert(index < invalid_index);
+			const size_t page = entity >> page_bits;
+			if (page >= pages.size())
+			{
+				pages.resize(page + 1);
+			}
+			Page& p = pages[page];
+			if (p.count == 0)
+			{
+				p.indices.assign(page_size, invalid_index);
+			}
+			uint32_t& value = p.indices[entity & (page_size - 1)];
+			if (value == invalid_index)
+			{
+				p.count++;
+				count++;
+			}
+			value = (uint32_t)index;
+		}
+		inline void erase(Entity entity)
+		{
+			const size_t page = entity >> page_bits;
+			if (page < pages.size() && pages[page].count > 0)
+			{
+				Page& p = pages[page];
+				uint32_t& value = p.indices[entity & (page_size - 1)];
+				if (value != invalid_index)
+				{
+					value = invalid_index;
+					count--;
+					if (--p.count == 0)
+					{
+						p.indices.clear();
+						p.indices.shrink_to_fit(); // entities are not reused, so empty pages are released
+					}
+				}
+			}
+		}
+		inline void clear()
+		{
+			pages.clear();
+			count = 0;
+		}
+		inline void reserve(size_t) {}
+		inline size_t size() const { return count; }
+
+	private:
+		struct Page
+		{
+			std::vector<uint32_t> indices;
+			uint32_t count = 0;
+		};
+		std::vector<Page> pages;
+		size_t count = 0;
+	};
+
+	// Entity -> component index lookup table with a hash map
+	//	This is the default, it uses less memory than EntityLookup if a component manager only holds a few entities that are far apart
+	class EntityHashLookup
+	{
+	public:
+		inline size_t find(Entity entity) const
+		{
+			auto it = lookup.find(entity);
+			if (it != lookup.end())
+			{
+				return it->second;
+			}
+			return ~size_t(0);
+		}
+		inline bool contains(Entity entity) const { return lookup.find(entity) != lookup.end(); }
+		inline void set(Entity entity, size_t index) { lookup[entity] = index; }
+		inline void erase(Entity entity) { lookup.erase(entity); }
+		inline void clear() { lookup.clear(); }
+		inline void reserve(size_t count) { lookup.reserve(count); }
+		inline size_t size() const { return lookup.size(); }
+
+	private:
+		std::unordered_map<Entity, size_t> lookup;
+	};
+
+	// Lookup : the entity -> component index lookup table implementation (EntityHashLookup or EntityLookup)
+	template<typename Component, typename Lookup = EntityHashLookup>
 	class ComponentManager
 	{
 	public:
@@ -84,10 +228,11 @@ namespace wiECS
 			components.clear();
 			entities.clear();
 			lookup.clear();
+			generation++;
 		}
 
 		// Perform deep copy of all the contents of "other" into this
-		inline void Copy(const ComponentManager<Component>& other)
+		inline void Copy(const ComponentManager<Component, Lookup>& other)
 		{
 			Clear();
 			components = other.components;
@@ -98,7 +243,7 @@ namespace wiECS
 		// Merge in an other component manager of the same type to this. 
 		//	The other component manager MUST NOT contain any of the same entities!
 		//	The other component manager is not retained after this operation!
-		inline void Merge(ComponentManager<Component>& other)
+		inline void Merge(ComponentManager<Component, Lookup>& other)
 		{
 			components.reserve(GetCount() + other.GetCount());
 			entities.reserve(GetCount() + other.GetCount());
@@ -109,9 +254,10 @@ namespace wiECS
 				Entity entity = other.entities[i];
 				assert(!Contains(entity));
 				entities.push_back(entity);
-				lookup[entity] = components.size();
+				lookup.set(entity, components.size());
 				components.push_back(std::move(other.components[i]));
 			}
+			generation++;
 
 			other.Clear();
 		}
@@ -138,7 +284,7 @@ namespace wiECS
 					Entity entity;
 					SerializeEntity(archive, entity, seri);
 					entities[i] = entity;
-					lookup[entity] = i;
+					lookup.set(entity, i);
 				}
 			}
 			else
@@ -155,6 +301,47 @@ namespace wiECS
 			}
 		}
 
+		// Chunked serialization: the entities and the components are serialized separately,
+		//	and ranges of components can be serialized independently of each other (and in parallel when reading)
+		//	When reading, SerializeEntities() must be called first, which also allocates the components
+		inline void SerializeEntities(wiArchive& archive, EntitySerializer& seri)
+		{
+			if (archive.IsReadMode())
+			{
+				Clear(); // If we deserialize, we start from empty
+
+				size_t count;
+				archive >> count;
+
+				components.resize(count);
+				entities.resize(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					Entity entity;
+					SerializeEntity(archive, entity, seri);
+					entities[i] = entity;
+					lookup.set(entity, i);
+				}
+			}
+			else
+			{
+				archive << entities.size();
+				for (Entity entity : entities)
+				{
+					SerializeEntity(archive, entity, seri);
+				}
+			}
+		}
+		inline void SerializeComponents(wiArchive& archive, EntitySerializer& seri, size_t offset, size_t count)
+		{
+			assert(offset + count <= components.size());
+			const size_t end = std::min(offset + count, components.size());
+			for (size_t i = offset; i < end; ++i)
+			{
+				components[i].Serialize(archive, seri);
+			}
+		}
+
 		// Create a new component and retrieve a reference to it
 		inline Component& Create(Entity entity)
 		{
@@ -162,14 +349,14 @@ namespace wiECS
 			assert(entity != INVALID_ENTITY);
 
 			// Only one of this component type per entity is allowed!
-			assert(lookup.find(entity) == lookup.end());
+			assert(!lookup.contains(entity));
 
 			// Entity count must always be the same as the number of coponents!
 			assert(entities.size() == components.size());
 			assert(lookup.size() == components.size());
 
 			// Update the entity lookup table:
-			lookup[entity] = components.size();
+			lookup.set(entity, components.size());
 
 			// New components are always pushed to the end:
 			components.emplace_back();
@@ -177,18 +364,18 @@ namespace wiECS
 			// Also push corresponding entity:
 			entities.push_back(entity);
 
+			generation++;
+
 			return components.back();
 		}
 
 		// Remove a component of a certain entity if it exists
 		inline void Remove(Entity entity)
 		{
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~size_t(0))
 			{
 				// Directly index into components and entities array:
-				const size_t index = it->second;
-				const Entity entity = entities[index];
 
 				if (index < components.size() - 1)
 				{
@@ -197,25 +384,25 @@ namespace wiECS
 					entities[index] = entities.back();
 
 					// Update the lookup table:
-					lookup[entities[index]] = index;
+					lookup.set(entities[index], index);
 				}
 
 				// Shrink the container:
 				components.pop_back();
 				entities.pop_back();
 				lookup.erase(entity);
+
+				generation++;
 			}
 		}
 
 		// Remove a component of a certain entity if it exists while keeping the current ordering
 		inline void Remove_KeepSorted(Entity entity)
 		{
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~size_t(0))
 			{
 				// Directly index into components and entities array:
-				const size_t index = it->second;
-				const Entity entity = entities[index];
 
 				if (index < components.size() - 1)
 				{
@@ -228,7 +415,7 @@ namespace wiECS
 					for (size_t i = index + 1; i < entities.size(); ++i)
 					{
 						entities[i - 1] = entities[i];
-						lookup[entities[i - 1]] = i - 1;
+						lookup.set(entities[i - 1], i - 1);
 					}
 				}
 
@@ -236,6 +423,8 @@ namespace wiECS
 				components.pop_back();
 				entities.pop_back();
 				lookup.erase(entity);
+
+				generation++;
 			}
 		}
 
@@ -260,28 +449,30 @@ namespace wiECS
 				const size_t next = i + direction;
 				components[i] = std::move(components[next]);
 				entities[i] = entities[next];
-				lookup[entities[i]] = i;
+				lookup.set(entities[i], i);
 			}
 
 			// Saved entity-component moved to the required position:
 			components[index_to] = std::move(component);
 			entities[index_to] = entity;
-			lookup[entity] = index_to;
+			lookup.set(entity, index_to);
+
+			generation++;
 		}
 
 		// Check if a component exists for a given entity or not
 		inline bool Contains(Entity entity) const
 		{
-			return lookup.find(entity) != lookup.end();
+			return lookup.contains(entity);
 		}
 
 		// Retrieve a [read/write] component specified by an entity (if it exists, otherwise nullptr)
 		inline Component* GetComponent(Entity entity)
 		{
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~size_t(0))
 			{
-				return &components[it->second];
+				return &components[index];
 			}
 			return nullptr;
 		}
@@ -289,10 +480,10 @@ namespace wiECS
 		// Retrieve a [read only] component specified by an entity (if it exists, otherwise nullptr)
 		inline const Component* GetComponent(Entity entity) const
 		{
-			const auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~size_t(0))
 			{
-				return &components[it->second];
+				return &components[index];
 			}
 			return nullptr;
 		}
@@ -300,17 +491,16 @@ namespace wiECS
 		// Retrieve component index by entity handle (if not exists, returns ~0 value)
 		inline size_t GetIndex(Entity entity) const 
 		{
-			const auto it = lookup.find(entity);
-			if (it != lookup.end())
-			{
-				return it->second;
-			}
-			return ~0;
+			return lookup.find(entity);
 		}
 
 		// Retrieve the number of existing entries
 		inline size_t GetCount() const { return components.size(); }
 
+		// Retrieve a counter that changes every time entries are added, removed or reordered
+		//	Data that refers to components by index (like a bounding volume hierarchy) can compare this to know whether it is out of date
+		inline uint64_t GetGeneration() const { return generation; }
+
 		// Directly index a specific component without indirection
 		//	0 <= index < GetCount()
 		inline Entity GetEntity(size_t index) const { return entities[index]; }
@@ -329,7 +519,9 @@ namespace wiECS
 		// This is a linear array of entities corresponding to each alive component
 		std::vector<Entity> entities;
 		// This is a lookup table for entities
-		std::unordered_map<Entity, size_t> lookup;
+		Lookup lookup;
+		// This is incremented every time the component indices change
+		uint64_t generation = 0;
 
 		// Disallow this to be copied by mistake
 		ComponentManager(const ComponentManager&) = delete;
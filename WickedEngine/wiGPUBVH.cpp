@@ -49,19 +49,19 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 			{
 				const MaterialComponent& material = *scene.materials.GetComponent(subset.materialID);
 
-				if (material.textures[MaterialComponent::BASECOLORMAP].resource != nullptr)
+				if (material.textures[MaterialComponent::BASECOLORMAP].resource != nullptr && material.textures[MaterialComponent::BASECOLORMAP].resource->IsReady())
 				{
 					sceneTextures.insert(material.textures[MaterialComponent::BASECOLORMAP].resource);
 				}
-				if (material.textures[MaterialComponent::SURFACEMAP].resource != nullptr)
+				if (material.textures[MaterialComponent::SURFACEMAP].resource != nullptr && material.textures[MaterialComponent::SURFACEMAP].resource->IsReady())
 				{
 					sceneTextures.insert(material.textures[MaterialComponent::SURFACEMAP].resource);
 				}
-				if (material.textures[MaterialComponent::EMISSIVEMAP].resource != nullptr)
+				if (material.textures[MaterialComponent::EMISSIVEMAP].resource != nullptr && material.textures[MaterialComponent::EMISSIVEMAP].resource->IsReady())
 				{
 					sceneTextures.insert(material.textures[MaterialComponent::EMISSIVEMAP].resource);
 				}
-				if (material.textures[MaterialComponent::NORMALMAP].resource != nullptr)
+				if (material.textures[MaterialComponent::NORMALMAP].resource != nullptr && material.textures[MaterialComponent::NORMALMAP].resource->IsReady())
 				{
 					sceneTextures.insert(material.textures[MaterialComponent::NORMALMAP].resource);
 				}
@@ -78,11 +78,20 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 			continue;
 		}
 
-		if (storedTextures.find(res) == storedTextures.end())
+		const Texture* texture = res->GetTexture();
+		if (texture == nullptr)
 		{
-			// we need to pack this texture into the atlas
-			rect_xywh newRect = rect_xywh(0, 0, res->texture.desc.Width + atlasWrapBorder * 2, res->texture.desc.Height + atlasWrapBorder * 2);
-			storedTextures[res] = newRect;
+			continue;
+		}
+
+		const uint32_t texture_version = res->texture_version.load();
+		auto it = storedTextures.find(res);
+		if (it == storedTextures.end() || it->second.texture_version != texture_version)
+		{
+			// we need to pack this texture into the atlas (again if its texture was replaced, it can have a different size)
+			AtlasTexture& stored = storedTextures[res];
+			stored.rect = rect_xywh(0, 0, texture->desc.Width + atlasWrapBorder * 2, texture->desc.Height + atlasWrapBorder * 2);
+			stored.texture_version = texture_version;
 
 			repackAtlas = true;
 		}
@@ -95,7 +104,7 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 		int i = 0;
 		for (auto& it : storedTextures)
 		{
-			out_rects[i] = &it.second;
+			out_rects[i] = &it.second.rect;
 			i++;
 		}
 
@@ -145,9 +154,10 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 				// Add extended properties:
 				const TextureDesc& desc = globalMaterialAtlas.GetDesc();
 
-				if (material.textures[MaterialComponent::BASECOLORMAP].resource != nullptr)
+				auto basecolormap = storedTextures.find(material.textures[MaterialComponent::BASECOLORMAP].resource);
+				if (basecolormap != storedTextures.end())
 				{
-					rect_xywh rect = storedTextures[material.textures[MaterialComponent::BASECOLORMAP].resource];
+					rect_xywh rect = basecolormap->second.rect;
 					// eliminate border expansion:
 					rect.x += atlasWrapBorder;
 					rect.y += atlasWrapBorder;
@@ -157,9 +167,10 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 						(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
 				}
 
-				if (material.textures[MaterialComponent::SURFACEMAP].resource != nullptr)
+				auto surfacemap = storedTextures.find(material.textures[MaterialComponent::SURFACEMAP].resource);
+				if (surfacemap != storedTextures.end())
 				{
-					rect_xywh rect = storedTextures[material.textures[MaterialComponent::SURFACEMAP].resource];
+					rect_xywh rect = surfacemap->second.rect;
 					// eliminate border expansion:
 					rect.x += atlasWrapBorder;
 					rect.y += atlasWrapBorder;
@@ -169,9 +180,10 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 						(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
 				}
 
-				if (material.textures[MaterialComponent::EMISSIVEMAP].resource != nullptr)
+				auto emissivemap = storedTextures.find(material.textures[MaterialComponent::EMISSIVEMAP].resource);
+				if (emissivemap != storedTextures.end())
 				{
-					rect_xywh rect = storedTextures[material.textures[MaterialComponent::EMISSIVEMAP].resource];
+					rect_xywh rect = emissivemap->second.rect;
 					// eliminate border expansion:
 					rect.x += atlasWrapBorder;
 					rect.y += atlasWrapBorder;
@@ -181,9 +193,10 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene)
 						(float)rect.x / (float)desc.Width, (float)rect.y / (float)desc.Height);
 				}
 
-				if (material.textures[MaterialComponent::NORMALMAP].resource != nullptr)
+				auto normalmap = storedTextures.find(material.textures[MaterialComponent::NORMALMAP].resource);
+				if (normalmap != storedTextures.end())
 				{
-					rect_xywh rect = storedTextures[material.textures[MaterialComponent::NORMALMAP].resource];
+					rect_xywh rect = normalmap->second.rect;
 					// eliminate border expansion:
 					rect.x += atlasWrapBorder;
 					rect.y += atlasWrapBorder;
@@ -367,7 +380,11 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd) const
 	{
 		for (auto& it : storedTextures)
 		{
-			wiRenderer::CopyTexture2D(globalMaterialAtlas, -1, it.second.x + atlasWrapBorder, it.second.y + atlasWrapBorder, it.first->texture, 0, cmd, wiRenderer::BORDEREXPAND_WRAP);
+			const Texture* texture = it.first->GetTexture();
+			if (texture != nullptr)
+			{
+				wiRenderer::CopyTexture2D(globalMaterialAtlas, -1, it.second.rect.x + atlasWrapBorder, it.second.rect.y + atlasWrapBorder, *texture, 0, cmd, wiRenderer::BORDEREXPAND_WRAP);
+			}
 		}
 	}
 	device->UpdateBuffer(&globalMaterialBuffer, materialArray.data(), cmd, sizeof(ShaderMaterial) * (int)materialArray.size());
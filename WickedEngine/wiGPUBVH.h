@@ -28,7 +28,12 @@ private:
 	wiGraphics::GPUBuffer globalMaterialBuffer;
 	wiGraphics::Texture globalMaterialAtlas;
 	std::vector<ShaderMaterial> materialArray;
-	std::unordered_map<std::shared_ptr<wiResource>, wiRectPacker::rect_xywh> storedTextures;
+	struct AtlasTexture
+	{
+		wiRectPacker::rect_xywh rect;
+		uint32_t texture_version = 0; // the texture is packed again when the resource's texture is replaced (streaming, editing)
+	};
+	std::unordered_map<std::shared_ptr<wiResource>, AtlasTexture> storedTextures;
 	std::unordered_set<std::shared_ptr<wiResource>> sceneTextures;
 	bool repackAtlas = false;
 	void UpdateGlobalMaterialResources(const wiScene::Scene& scene);
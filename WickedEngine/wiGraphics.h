@@ -31,6 +31,7 @@ namespace wiGraphics
 		SHADERFORMAT_HLSL5,
 		SHADERFORMAT_HLSL6,
 		SHADERFORMAT_SPIRV,
+		SHADERFORMAT_COUNT,
 	};
 	enum SHADERMODEL
 	{
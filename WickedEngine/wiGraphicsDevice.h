@@ -72,6 +72,11 @@ namespace wiGraphics
 
 		virtual void WaitForGPU() = 0;
 		virtual void ClearPipelineStateCache() {};
+		// Compile pipeline states for a render pass ahead of time on job threads (for example during a loading screen), so that the first draw with them doesn't stall
+		//	renderpass	: the render pass that they will be used in, nullptr means the back buffer
+		//	strides		: vertex buffer strides that will be bound with BindVertexBuffers() when drawing (only used for pipeline states with input layout)
+		//	The pipeline states and render pass are copied, so they can be destroyed or recreated while compiling. Devices that create pipelines at CreatePipelineState() ignore this
+		virtual void PrewarmPipelineStates(const PipelineState* const* psos, uint32_t count, const RenderPass* renderpass, const uint32_t* strides = nullptr, uint32_t strideCount = 0) {}
 
 		inline bool GetVSyncEnabled() const { return VSYNC; }
 		virtual void SetVSyncEnabled(bool value) { VSYNC = value; }
@@ -0,0 +1,348 @@
+#include "wiGraphicsDevice_Null.h"
+
+#include "wiBackLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace wiGraphics
+{
+
+namespace Null_Internal
+{
+	// CPU memory of a resource, only allocated if it can be accessed by the application
+	struct Resource_Null
+	{
+		std::vector<uint8_t> data;
+		uint32_t rowpitch = 0;
+		// Next subresource index for every SUBRESOURCE_TYPE, the first view of a type is the default view (-1), like in the other devices
+		int subresources[DSV + 1] = { -1, -1, -1, -1, -1 };
+	};
+
+	Resource_Null* to_internal(const GPUResource* param)
+	{
+		return static_cast<Resource_Null*>(param->internal_state.get());
+	}
+
+	bool IsCPUAccessible(USAGE usage)
+	{
+		return usage == USAGE_DYNAMIC || usage == USAGE_STAGING;
+	}
+}
+using namespace Null_Internal;
+
+GraphicsDevice_Null::GraphicsDevice_Null(wiPlatform::window_type window, bool fullscreen, bool debuglayer)
+{
+	FULLSCREEN = fullscreen;
+	DEBUGDEVICE = debuglayer;
+
+	// Without a window, the "back buffer" has a fixed size, it is only used to size the render paths:
+	RESOLUTIONWIDTH = 1920;
+	RESOLUTIONHEIGHT = 1080;
+#if defined(PLATFORM_WINDOWS_DESKTOP)
+	if (window != nullptr)
+	{
+		dpi = GetDpiForWindow(window);
+		RECT rect;
+		GetClientRect(window, &rect);
+		RESOLUTIONWIDTH = rect.right - rect.left;
+		RESOLUTIONHEIGHT = rect.bottom - rect.top;
+	}
+#elif SDL2
+	if (window != nullptr)
+	{
+		int width, height;
+		SDL_GetWindowSize(window, &width, &height);
+		RESOLUTIONWIDTH = width;
+		RESOLUTIONHEIGHT = height;
+	}
+#endif // _WIN32
+
+	BACKBUFFER_FORMAT = FORMAT_R10G10B10A2_UNORM;
+
+	emptyresource = std::make_shared<EmptyResourceHandle>();
+
+	wiBackLog::post("Created GraphicsDevice_Null (no GPU rendering)");
+}
+
+bool GraphicsDevice_Null::CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *pBuffer) const
+{
+	auto internal_state = std::make_shared<Resource_Null>();
+	pBuffer->internal_state = internal_state;
+	pBuffer->type = GPUResource::GPU_RESOURCE_TYPE::BUFFER;
+
+	pBuffer->desc = *pDesc;
+
+	if (IsCPUAccessible(pDesc->Usage))
+	{
+		internal_state->data.resize(pDesc->ByteWidth);
+		internal_state->rowpitch = pDesc->ByteWidth;
+		if (pInitialData != nullptr && pInitialData->pSysMem != nullptr)
+		{
+			std::memcpy(internal_state->data.data(), pInitialData->pSysMem, pDesc->ByteWidth);
+		}
+	}
+
+	if (pDesc->BindFlags & BIND_SHADER_RESOURCE)
+	{
+		CreateSubresource(pBuffer, SRV, 0);
+	}
+	if (pDesc->BindFlags & BIND_UNORDERED_ACCESS)
+	{
+		CreateSubresource(pBuffer, UAV, 0);
+	}
+
+	return true;
+}
+bool GraphicsDevice_Null::CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const
+{
+	auto internal_state = std::make_shared<Resource_Null>();
+	pTexture->internal_state = internal_state;
+	pTexture->type = GPUResource::GPU_RESOURCE_TYPE::TEXTURE;
+
+	pTexture->desc = *pDesc;
+
+	if (pTexture->desc.MipLevels == 0)
+	{
+		pTexture->desc.MipLevels = (uint32_t)log2(std::max(pTexture->desc.Width, pTexture->desc.Height)) + 1;
+	}
+
+	if (IsCPUAccessible(pDesc->Usage))
+	{
+		// Only the first subresource can be mapped:
+		const bool bc = IsFormatBlockCompressed(pDesc->Format);
+		const uint32_t width = bc ? (pDesc->Width + 3) / 4 : pDesc->Width;
+		const uint32_t height = bc ? (pDesc->Height + 3) / 4 : pDesc->Height;
+		internal_state->rowpitch = width * GetFormatStride(pDesc->Format);
+		internal_state->data.resize(size_t(internal_state->rowpitch) * height * std::max(1u, pDesc->Depth));
+		if (pInitialData != nullptr && pInitialData->pSysMem != nullptr)
+		{
+			const uint32_t srcpitch = pInitialData->SysMemPitch > 0 ? pInitialData->SysMemPitch : internal_state->rowpitch;
+			const uint32_t cpysize = std::min(srcpitch, internal_state->rowpitch);
+			for (uint32_t i = 0; i < height; ++i)
+			{
+				std::memcpy(internal_state->data.data() + size_t(i) * internal_state->rowpitch, (const uint8_t*)pInitialData->pSysMem + size_t(i) * srcpitch, cpysize);
+			}
+		}
+	}
+
+	if (pTexture->desc.BindFlags & BIND_RENDER_TARGET)
+	{
+		CreateSubresource(pTexture, RTV, 0, -1, 0, -1);
+	}
+	if (pTexture->desc.BindFlags & BIND_DEPTH_STENCIL)
+	{
+		CreateSubresource(pTexture, DSV, 0, -1, 0, -1);
+	}
+	if (pTexture->desc.BindFlags & BIND_SHADER_RESOURCE)
+	{
+		CreateSubresource(pTexture, SRV, 0, -1, 0, -1);
+	}
+	if (pTexture->desc.BindFlags & BIND_UNORDERED_ACCESS)
+	{
+		CreateSubresource(pTexture, UAV, 0, -1, 0, -1);
+	}
+
+	return true;
+}
+bool GraphicsDevice_Null::CreateShader(SHADERSTAGE stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const
+{
+	// The bytecode is not needed, it is also accepted if it is empty
+	pShader->internal_state = emptyresource;
+	pShader->stage = stage;
+
+	return true;
+}
+bool GraphicsDevice_Null::CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const
+{
+	pSamplerState->internal_state = emptyresource;
+
+	pSamplerState->desc = *pSamplerDesc;
+
+	return true;
+}
+bool GraphicsDevice_Null::CreateQueryHeap(const GPUQueryHeapDesc* pDesc, GPUQueryHeap* pQueryHeap) const
+{
+	pQueryHeap->internal_state = emptyresource;
+
+	pQueryHeap->desc = *pDesc;
+
+	return true;
+}
+bool GraphicsDevice_Null::CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const
+{
+	pso->internal_state = emptyresource;
+
+	pso->desc = *pDesc;
+
+	return true;
+}
+bool GraphicsDevice_Null::CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const
+{
+	renderpass->internal_state = emptyresource;
+
+	renderpass->desc = *pDesc;
+
+	return true;
+}
+
+int GraphicsDevice_Null::CreateSubresource(Texture* texture, SUBRESOURCE_TYPE type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const
+{
+	return to_internal(texture)->subresources[type]++;
+}
+int GraphicsDevice_Null::CreateSubresource(GPUBuffer* buffer, SUBRESOURCE_TYPE type, uint64_t offset, uint64_t size) const
+{
+	return to_internal(buffer)->subresources[type]++;
+}
+
+void GraphicsDevice_Null::Map(const GPUResource* resource, Mapping* mapping) const
+{
+	auto internal_state = to_internal(resource);
+
+	std::scoped_lock lock(map_locker);
+	if (internal_state->data.empty())
+	{
+		// Resource was not created as CPU accessible, but the application wants to access it, so allocate the memory now:
+		if (resource->IsBuffer())
+		{
+			const GPUBuffer* buffer = (const GPUBuffer*)resource;
+			internal_state->data.resize(buffer->desc.ByteWidth);
+			internal_state->rowpitch = buffer->desc.ByteWidth;
+		}
+		else
+		{
+			internal_state->data.resize(mapping->offset + mapping->size);
+			internal_state->rowpitch = (uint32_t)internal_state->data.size();
+		}
+	}
+
+	if (mapping->offset < internal_state->data.size())
+	{
+		mapping->data = internal_state->data.data() + mapping->offset;
+		mapping->rowpitch = internal_state->rowpitch;
+	}
+	else
+	{
+		mapping->data = nullptr;
+		mapping->rowpitch = 0;
+	}
+}
+void GraphicsDevice_Null::QueryRead(const GPUQueryHeap* heap, uint32_t index, uint32_t count, uint64_t* results) const
+{
+	// Nothing was executed, all timestamps and occlusion results are zero
+	std::memset(results, 0, sizeof(uint64_t) * count);
+}
+
+void GraphicsDevice_Null::PresentEnd(CommandList cmd)
+{
+	SubmitCommandLists();
+}
+
+CommandList GraphicsDevice_Null::BeginCommandList()
+{
+	CommandList cmd = cmd_count.fetch_add(1);
+	assert(cmd < COMMANDLIST_COUNT);
+
+	if (!frame_allocators[cmd].buffer.IsValid())
+	{
+		frame_allocators[cmd].buffer.internal_state = std::make_shared<Resource_Null>();
+		frame_allocators[cmd].buffer.type = GPUResource::GPU_RESOURCE_TYPE::BUFFER;
+		frame_allocators[cmd].buffer.desc.ByteWidth = 1024 * 1024;
+		frame_allocators[cmd].buffer.desc.BindFlags = BIND_SHADER_RESOURCE | BIND_INDEX_BUFFER | BIND_VERTEX_BUFFER;
+		frame_allocators[cmd].buffer.desc.Usage = USAGE_DYNAMIC;
+		frame_allocators[cmd].buffer.desc.CPUAccessFlags = CPU_ACCESS_WRITE;
+		frame_allocators[cmd].buffer.desc.MiscFlags = RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS;
+	}
+
+	return cmd;
+}
+void GraphicsDevice_Null::SubmitCommandLists()
+{
+	CommandList cmd_last = cmd_count.load();
+	cmd_count.store(0);
+	for (CommandList cmd = 0; cmd < cmd_last; ++cmd)
+	{
+		frame_allocators[cmd].retired.clear();
+		frame_allocators[cmd].byteOffset = 0;
+	}
+
+	FRAMECOUNT++;
+}
+
+void GraphicsDevice_Null::SetResolution(int width, int height)
+{
+	if (width != RESOLUTIONWIDTH || height != RESOLUTIONHEIGHT)
+	{
+		RESOLUTIONWIDTH = width;
+		RESOLUTIONHEIGHT = height;
+	}
+}
+
+Texture GraphicsDevice_Null::GetBackBuffer()
+{
+	Texture result;
+	result.type = GPUResource::GPU_RESOURCE_TYPE::TEXTURE;
+	result.internal_state = std::make_shared<Resource_Null>();
+	result.desc.type = TextureDesc::TEXTURE_2D;
+	result.desc.Width = RESOLUTIONWIDTH;
+	result.desc.Height = RESOLUTIONHEIGHT;
+	result.desc.Format = BACKBUFFER_FORMAT;
+	return result;
+}
+
+void GraphicsDevice_Null::CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd)
+{
+	// Only copies between CPU accessible resources have an observable result (eg. readback of a dynamic buffer):
+	auto internal_state_dst = to_internal(pDst);
+	auto internal_state_src = to_internal(pSrc);
+	std::scoped_lock lock(map_locker);
+	const size_t size = std::min(internal_state_dst->data.size(), internal_state_src->data.size());
+	if (size > 0)
+	{
+		std::memcpy(internal_state_dst->data.data(), internal_state_src->data.data(), size);
+	}
+}
+void GraphicsDevice_Null::UpdateBuffer(const GPUBuffer* buffer, const void* data, CommandList cmd, int dataSize)
+{
+	auto internal_state = to_internal(buffer);
+	std::scoped_lock lock(map_locker);
+	if (!internal_state->data.empty())
+	{
+		const size_t size = dataSize < 0 ? internal_state->data.size() : std::min(internal_state->data.size(), (size_t)dataSize);
+		std::memcpy(internal_state->data.data(), data, size);
+	}
+}
+
+GraphicsDevice::GPUAllocation GraphicsDevice_Null::AllocateGPU(size_t dataSize, CommandList cmd)
+{
+	GPUAllocation result;
+	if (dataSize == 0)
+	{
+		return result;
+	}
+
+	GPUAllocator& allocator = frame_allocators[cmd];
+
+	const size_t alignment = 256;
+	size_t offset = (allocator.byteOffset + alignment - 1) / alignment * alignment;
+	if (offset + dataSize > allocator.data.size())
+	{
+		// The previous block can still be referenced by earlier allocations, so it is kept until submit:
+		const size_t size = std::max(std::max(dataSize, allocator.data.size() * 2), size_t(allocator.buffer.desc.ByteWidth));
+		if (!allocator.data.empty())
+		{
+			allocator.retired.push_back(std::move(allocator.data));
+		}
+		allocator.data = std::vector<uint8_t>(size);
+		offset = 0;
+	}
+	allocator.byteOffset = offset + dataSize;
+
+	result.data = allocator.data.data() + offset;
+	result.buffer = &allocator.buffer;
+	result.offset = (uint32_t)offset;
+	return result;
+}
+
+}
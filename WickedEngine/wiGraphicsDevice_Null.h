@@ -0,0 +1,111 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiPlatform.h"
+#include "wiGraphicsDevice.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace wiGraphics
+{
+
+	// Graphics device that doesn't use a GPU, it can be used to run the engine headless (dedicated servers, CPU benchmarks)
+	//	Resources are only created as placeholders, draws and dispatches are discarded
+	//	CPU memory is only allocated where the application can access it: mapped resources, readback and AllocateGPU()
+	//	Shaders are not loaded, the device reports SHADERFORMAT_NONE
+	class GraphicsDevice_Null : public GraphicsDevice
+	{
+	protected:
+		struct GPUAllocator
+		{
+			GPUBuffer buffer;
+			std::vector<uint8_t> data;
+			std::vector<std::vector<uint8_t>> retired; // full blocks are kept alive until the command list is submitted
+			size_t byteOffset = 0;
+		} frame_allocators[COMMANDLIST_COUNT];
+
+		std::atomic<CommandList> cmd_count{ 0 };
+
+		mutable std::mutex map_locker;
+
+		struct EmptyResourceHandle {}; // only care about control-block
+		std::shared_ptr<EmptyResourceHandle> emptyresource;
+
+	public:
+		GraphicsDevice_Null(wiPlatform::window_type window, bool fullscreen = false, bool debuglayer = false);
+
+		bool CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *pBuffer) const override;
+		bool CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const override;
+		bool CreateShader(SHADERSTAGE stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const override;
+		bool CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const override;
+		bool CreateQueryHeap(const GPUQueryHeapDesc *pDesc, GPUQueryHeap *pQueryHeap) const override;
+		bool CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const override;
+		bool CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const override;
+
+		int CreateSubresource(Texture* texture, SUBRESOURCE_TYPE type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const override;
+		int CreateSubresource(GPUBuffer* buffer, SUBRESOURCE_TYPE type, uint64_t offset, uint64_t size = ~0) const override;
+
+		void Map(const GPUResource* resource, Mapping* mapping) const override;
+		void Unmap(const GPUResource* resource) const override {}
+		void QueryRead(const GPUQueryHeap* heap, uint32_t index, uint32_t count, uint64_t* results) const override;
+
+		void SetCommonSampler(const StaticSampler* sam) override {}
+
+		void SetName(GPUResource* pResource, const char* name) override {}
+
+		void PresentBegin(CommandList cmd) override {}
+		void PresentEnd(CommandList cmd) override;
+
+		void WaitForGPU() override {}
+
+		CommandList BeginCommandList() override;
+		void SubmitCommandLists() override;
+
+		void SetResolution(int width, int height) override;
+
+		Texture GetBackBuffer() override;
+
+		SHADERFORMAT GetShaderFormat() const override { return SHADERFORMAT_NONE; }
+
+		///////////////Thread-sensitive////////////////////////
+
+		void RenderPassBegin(const RenderPass* renderpass, CommandList cmd) override {}
+		void RenderPassEnd(CommandList cmd) override {}
+		void BindScissorRects(uint32_t numRects, const Rect* rects, CommandList cmd) override {}
+		void BindViewports(uint32_t NumViewports, const Viewport* pViewports, CommandList cmd) override {}
+		void BindResource(SHADERSTAGE stage, const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override {}
+		void BindResources(SHADERSTAGE stage, const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override {}
+		void BindUAV(SHADERSTAGE stage, const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override {}
+		void BindUAVs(SHADERSTAGE stage, const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override {}
+		void UnbindResources(uint32_t slot, uint32_t num, CommandList cmd) override {}
+		void UnbindUAVs(uint32_t slot, uint32_t num, CommandList cmd) override {}
+		void BindSampler(SHADERSTAGE stage, const Sampler* sampler, uint32_t slot, CommandList cmd) override {}
+		void BindConstantBuffer(SHADERSTAGE stage, const GPUBuffer* buffer, uint32_t slot, CommandList cmd) override {}
+		void BindVertexBuffers(const GPUBuffer *const* vertexBuffers, uint32_t slot, uint32_t count, const uint32_t* strides, const uint32_t* offsets, CommandList cmd) override {}
+		void BindIndexBuffer(const GPUBuffer* indexBuffer, const INDEXBUFFER_FORMAT format, uint32_t offset, CommandList cmd) override {}
+		void BindStencilRef(uint32_t value, CommandList cmd) override {}
+		void BindBlendFactor(float r, float g, float b, float a, CommandList cmd) override {}
+		void BindPipelineState(const PipelineState* pso, CommandList cmd) override {}
+		void BindComputeShader(const Shader* cs, CommandList cmd) override {}
+		void Draw(uint32_t vertexCount, uint32_t startVertexLocation, CommandList cmd) override {}
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, uint32_t baseVertexLocation, CommandList cmd) override {}
+		void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override {}
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, uint32_t baseVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override {}
+		void DrawInstancedIndirect(const GPUBuffer* args, uint32_t args_offset, CommandList cmd) override {}
+		void DrawIndexedInstancedIndirect(const GPUBuffer* args, uint32_t args_offset, CommandList cmd) override {}
+		void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override {}
+		void DispatchIndirect(const GPUBuffer* args, uint32_t args_offset, CommandList cmd) override {}
+		void CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd) override;
+		void UpdateBuffer(const GPUBuffer* buffer, const void* data, CommandList cmd, int dataSize = -1) override;
+		void QueryBegin(const GPUQueryHeap* heap, uint32_t index, CommandList cmd) override {}
+		void QueryEnd(const GPUQueryHeap* heap, uint32_t index, CommandList cmd) override {}
+		void Barrier(const GPUBarrier* barriers, uint32_t numBarriers, CommandList cmd) override {}
+
+		GPUAllocation AllocateGPU(size_t dataSize, CommandList cmd) override;
+
+		void EventBegin(const char* name, CommandList cmd) override {}
+		void EventEnd(CommandList cmd) override {}
+		void SetMarker(const char* name, CommandList cmd) override {}
+	};
+
+}
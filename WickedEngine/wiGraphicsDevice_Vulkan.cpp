@@ -21,6 +21,8 @@
 #include <iostream>
 #include <set>
 #include <algorithm>
+#include <filesystem>
+#include <cstdlib>
 
 #ifdef SDL2
 #include <SDL2/SDL_vulkan.h>
@@ -851,7 +853,6 @@ namespace Vulkan_Internal
 		VkRect2D scissor = {};
 		VkPipelineViewportStateCreateInfo viewportState = {};
 		VkPipelineDepthStencilStateCreateInfo depthstencil = {};
-		VkSampleMask samplemask = {};
 		VkPipelineTessellationStateCreateInfo tessellationInfo = {};
 	};
 	struct RenderPass_Vulkan
@@ -953,6 +954,36 @@ namespace Vulkan_Internal
 	{
 		return static_cast<RTPipelineState_Vulkan*>(param->internal_state.get());
 	}
+
+	// Header of the pipeline cache file, the VkPipelineCache data follows it
+	//	The driver also validates its own data, but some drivers crash on data from a different driver, so it is checked before it reaches the driver
+	struct PipelineCacheFileHeader
+	{
+		static constexpr uint32_t MAGIC = 0x43505657; // "WVPC"
+		static constexpr uint32_t VERSION = 1;
+
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint32_t vendorID = 0;
+		uint32_t deviceID = 0;
+		uint32_t driverVersion = 0;
+		uint8_t deviceUUID[VK_UUID_SIZE] = {};
+		uint8_t driverUUID[VK_UUID_SIZE] = {};
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+		uint64_t dataSize = 0;
+		uint64_t dataHash = 0;
+	};
+	inline uint64_t PipelineCacheDataHash(const uint8_t* data, size_t size)
+	{
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
 }
 using namespace Vulkan_Internal;
 
@@ -1543,174 +1574,185 @@ using namespace Vulkan_Internal;
 		);
 	}
 
-	void GraphicsDevice_Vulkan::pso_validate(CommandList cmd)
+	VkPipeline GraphicsDevice_Vulkan::CreatePipeline(const PipelineState* pso, const RenderPass* renderpass, const uint32_t* strides) const
 	{
-		if (!dirty_pso[cmd])
-			return;
-
-		const PipelineState* pso = active_pso[cmd];
-		size_t pipeline_hash = prev_pipeline_hash[cmd];
-		wiHelper::hash_combine(pipeline_hash, vb_hash[cmd]);
 		auto internal_state = to_internal(pso);
 
-		VkPipeline pipeline = VK_NULL_HANDLE;
-		auto it = pipelines_global.find(pipeline_hash);
-		if (it == pipelines_global.end())
+		VkGraphicsPipelineCreateInfo pipelineInfo = internal_state->pipelineInfo; // make a copy here
+		pipelineInfo.renderPass = renderpass == nullptr ? defaultRenderPass : to_internal(renderpass)->renderpass;
+		pipelineInfo.subpass = 0;
+
+		// MSAA:
+		VkPipelineMultisampleStateCreateInfo multisampling = {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		if (renderpass != nullptr && renderpass->desc.attachments.size() > 0)
 		{
-			for (auto& x : pipelines_worker[cmd])
+			multisampling.rasterizationSamples = (VkSampleCountFlagBits)renderpass->desc.attachments[0].texture->desc.SampleCount;
+		}
+		if (pso->desc.rs != nullptr)
+		{
+			const RasterizerState& desc = *pso->desc.rs;
+			if (desc.ForcedSampleCount > 1)
 			{
-				if (pipeline_hash == x.first)
-				{
-					pipeline = x.second;
-					break;
-				}
+				multisampling.rasterizationSamples = (VkSampleCountFlagBits)desc.ForcedSampleCount;
 			}
+		}
+		multisampling.minSampleShading = 1.0f;
+		VkSampleMask samplemask = pso->desc.sampleMask;
+		multisampling.pSampleMask = &samplemask;
+		multisampling.alphaToCoverageEnable = VK_FALSE;
+		multisampling.alphaToOneEnable = VK_FALSE;
 
-			if (pipeline == VK_NULL_HANDLE)
+		pipelineInfo.pMultisampleState = &multisampling;
+
+
+		// Blending:
+		uint32_t numBlendAttachments = 0;
+		VkPipelineColorBlendAttachmentState colorBlendAttachments[8] = {};
+		const size_t blend_loopCount = renderpass == nullptr ? 1 : renderpass->desc.attachments.size();
+		for (size_t i = 0; i < blend_loopCount; ++i)
+		{
+			if (renderpass != nullptr && renderpass->desc.attachments[i].type != RenderPassAttachment::RENDERTARGET)
 			{
-				VkGraphicsPipelineCreateInfo pipelineInfo = internal_state->pipelineInfo; // make a copy here
-				pipelineInfo.renderPass = active_renderpass[cmd] == nullptr ? defaultRenderPass : to_internal(active_renderpass[cmd])->renderpass;
-				pipelineInfo.subpass = 0;
+				continue;
+			}
 
-				// MSAA:
-				VkPipelineMultisampleStateCreateInfo multisampling = {};
-				multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-				multisampling.sampleShadingEnable = VK_FALSE;
-				multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-				if (active_renderpass[cmd] != nullptr && active_renderpass[cmd]->desc.attachments.size() > 0)
-				{
-					multisampling.rasterizationSamples = (VkSampleCountFlagBits)active_renderpass[cmd]->desc.attachments[0].texture->desc.SampleCount;
-				}
-				if (pso->desc.rs != nullptr)
-				{
-					const RasterizerState& desc = *pso->desc.rs;
-					if (desc.ForcedSampleCount > 1)
-					{
-						multisampling.rasterizationSamples = (VkSampleCountFlagBits)desc.ForcedSampleCount;
-					}
-				}
-				multisampling.minSampleShading = 1.0f;
-				VkSampleMask& samplemask = internal_state->samplemask;
-				samplemask = pso->desc.sampleMask;
-				multisampling.pSampleMask = &samplemask;
-				multisampling.alphaToCoverageEnable = VK_FALSE;
-				multisampling.alphaToOneEnable = VK_FALSE;
+			const auto& desc = pso->desc.bs->RenderTarget[numBlendAttachments];
+			VkPipelineColorBlendAttachmentState& attachment = colorBlendAttachments[numBlendAttachments];
+			numBlendAttachments++;
 
-				pipelineInfo.pMultisampleState = &multisampling;
+			attachment.blendEnable = desc.BlendEnable ? VK_TRUE : VK_FALSE;
 
+			attachment.colorWriteMask = 0;
+			if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_RED)
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_R_BIT;
+			}
+			if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_GREEN)
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_G_BIT;
+			}
+			if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_BLUE)
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_B_BIT;
+			}
+			if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_ALPHA)
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
+			}
 
-				// Blending:
-				uint32_t numBlendAttachments = 0;
-				VkPipelineColorBlendAttachmentState colorBlendAttachments[8] = {};
-				const size_t blend_loopCount = active_renderpass[cmd] == nullptr ? 1 : active_renderpass[cmd]->desc.attachments.size();
-				for (size_t i = 0; i < blend_loopCount; ++i)
-				{
-					if (active_renderpass[cmd] != nullptr && active_renderpass[cmd]->desc.attachments[i].type != RenderPassAttachment::RENDERTARGET)
-					{
-						continue;
-					}
+			attachment.srcColorBlendFactor = _ConvertBlend(desc.SrcBlend);
+			attachment.dstColorBlendFactor = _ConvertBlend(desc.DestBlend);
+			attachment.colorBlendOp = _ConvertBlendOp(desc.BlendOp);
+			attachment.srcAlphaBlendFactor = _ConvertBlend(desc.SrcBlendAlpha);
+			attachment.dstAlphaBlendFactor = _ConvertBlend(desc.DestBlendAlpha);
+			attachment.alphaBlendOp = _ConvertBlendOp(desc.BlendOpAlpha);
+		}
 
-					const auto& desc = pso->desc.bs->RenderTarget[numBlendAttachments];
-					VkPipelineColorBlendAttachmentState& attachment = colorBlendAttachments[numBlendAttachments];
-					numBlendAttachments++;
+		VkPipelineColorBlendStateCreateInfo colorBlending = {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.logicOp = VK_LOGIC_OP_COPY;
+		colorBlending.attachmentCount = numBlendAttachments;
+		colorBlending.pAttachments = colorBlendAttachments;
+		colorBlending.blendConstants[0] = 1.0f;
+		colorBlending.blendConstants[1] = 1.0f;
+		colorBlending.blendConstants[2] = 1.0f;
+		colorBlending.blendConstants[3] = 1.0f;
 
-					attachment.blendEnable = desc.BlendEnable ? VK_TRUE : VK_FALSE;
+		pipelineInfo.pColorBlendState = &colorBlending;
 
-					attachment.colorWriteMask = 0;
-					if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_RED)
-					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_R_BIT;
-					}
-					if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_GREEN)
-					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_G_BIT;
-					}
-					if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_BLUE)
-					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_B_BIT;
-					}
-					if (desc.RenderTargetWriteMask & COLOR_WRITE_ENABLE_ALPHA)
-					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
-					}
+		// Input layout:
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		std::vector<VkVertexInputBindingDescription> bindings;
+		std::vector<VkVertexInputAttributeDescription> attributes;
+		if (pso->desc.il != nullptr)
+		{
+			uint32_t lastBinding = 0xFFFFFFFF;
+			for (auto& x : pso->desc.il->elements)
+			{
+				if (x.InputSlot == lastBinding)
+					continue;
+				lastBinding = x.InputSlot;
+				VkVertexInputBindingDescription& bind = bindings.emplace_back();
+				bind.binding = x.InputSlot;
+				bind.inputRate = x.InputSlotClass == INPUT_PER_VERTEX_DATA ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
+				bind.stride = strides == nullptr ? 0 : strides[x.InputSlot];
+			}
 
-					attachment.srcColorBlendFactor = _ConvertBlend(desc.SrcBlend);
-					attachment.dstColorBlendFactor = _ConvertBlend(desc.DestBlend);
-					attachment.colorBlendOp = _ConvertBlendOp(desc.BlendOp);
-					attachment.srcAlphaBlendFactor = _ConvertBlend(desc.SrcBlendAlpha);
-					attachment.dstAlphaBlendFactor = _ConvertBlend(desc.DestBlendAlpha);
-					attachment.alphaBlendOp = _ConvertBlendOp(desc.BlendOpAlpha);
-				}
-
-				VkPipelineColorBlendStateCreateInfo colorBlending = {};
-				colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-				colorBlending.logicOpEnable = VK_FALSE;
-				colorBlending.logicOp = VK_LOGIC_OP_COPY;
-				colorBlending.attachmentCount = numBlendAttachments;
-				colorBlending.pAttachments = colorBlendAttachments;
-				colorBlending.blendConstants[0] = 1.0f;
-				colorBlending.blendConstants[1] = 1.0f;
-				colorBlending.blendConstants[2] = 1.0f;
-				colorBlending.blendConstants[3] = 1.0f;
-
-				pipelineInfo.pColorBlendState = &colorBlending;
-
-				// Input layout:
-				VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-				vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-				std::vector<VkVertexInputBindingDescription> bindings;
-				std::vector<VkVertexInputAttributeDescription> attributes;
-				if (pso->desc.il != nullptr)
+			uint32_t offset = 0;
+			uint32_t i = 0;
+			lastBinding = 0xFFFFFFFF;
+			for (auto& x : pso->desc.il->elements)
+			{
+				VkVertexInputAttributeDescription attr = {};
+				attr.binding = x.InputSlot;
+				if (attr.binding != lastBinding)
 				{
-					uint32_t lastBinding = 0xFFFFFFFF;
-					for (auto& x : pso->desc.il->elements)
-					{
-						if (x.InputSlot == lastBinding)
-							continue;
-						lastBinding = x.InputSlot;
-						VkVertexInputBindingDescription& bind = bindings.emplace_back();
-						bind.binding = x.InputSlot;
-						bind.inputRate = x.InputSlotClass == INPUT_PER_VERTEX_DATA ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
-						bind.stride = vb_strides[cmd][x.InputSlot];
-					}
+					lastBinding = attr.binding;
+					offset = 0;
+				}
+				attr.format = _ConvertFormat(x.Format);
+				attr.location = i;
+				attr.offset = x.AlignedByteOffset;
+				if (attr.offset == InputLayout::APPEND_ALIGNED_ELEMENT)
+				{
+					// need to manually resolve this from the format spec.
+					attr.offset = offset;
+					offset += GetFormatStride(x.Format);
+				}
 
-					uint32_t offset = 0;
-					uint32_t i = 0;
-					lastBinding = 0xFFFFFFFF;
-					for (auto& x : pso->desc.il->elements)
-					{
-						VkVertexInputAttributeDescription attr = {};
-						attr.binding = x.InputSlot;
-						if (attr.binding != lastBinding)
-						{
-							lastBinding = attr.binding;
-							offset = 0;
-						}
-						attr.format = _ConvertFormat(x.Format);
-						attr.location = i;
-						attr.offset = x.AlignedByteOffset;
-						if (attr.offset == InputLayout::APPEND_ALIGNED_ELEMENT)
-						{
-							// need to manually resolve this from the format spec.
-							attr.offset = offset;
-							offset += GetFormatStride(x.Format);
-						}
+				attributes.push_back(attr);
 
-						attributes.push_back(attr);
+				i++;
+			}
 
-						i++;
-					}
+			vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+			vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+			vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+		}
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
 
-					vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
-					vertexInputInfo.pVertexBindingDescriptions = bindings.data();
-					vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
-					vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
-				}
-				pipelineInfo.pVertexInputState = &vertexInputInfo;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkResult res = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+		assert(res == VK_SUCCESS);
 
-				VkResult res = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
-				assert(res == VK_SUCCESS);
+		return pipeline;
+	}
+
+	void GraphicsDevice_Vulkan::pso_validate(CommandList cmd)
+	{
+		if (!dirty_pso[cmd])
+			return;
+
+		const PipelineState* pso = active_pso[cmd];
+		size_t pipeline_hash = prev_pipeline_hash[cmd];
+		if (pso->desc.il != nullptr)
+		{
+			// vertex buffer strides are only part of the pipeline when there is an input layout:
+			wiHelper::hash_combine(pipeline_hash, vb_hash[cmd]);
+		}
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		auto it = pipelines_global.find(pipeline_hash);
+		if (it == pipelines_global.end())
+		{
+			for (auto& x : pipelines_worker[cmd])
+			{
+				if (pipeline_hash == x.first)
+				{
+					pipeline = x.second;
+					break;
+				}
+			}
 
+			if (pipeline == VK_NULL_HANDLE)
+			{
+				pipeline = CreatePipeline(pso, active_renderpass[cmd], vb_strides[cmd]);
 				pipelines_worker[cmd].push_back(std::make_pair(pipeline_hash, pipeline));
 			}
 		}
@@ -1838,8 +1880,10 @@ using namespace Vulkan_Internal;
 	}
 
 	// Engine functions
-	GraphicsDevice_Vulkan::GraphicsDevice_Vulkan(wiPlatform::window_type window, bool fullscreen, bool debuglayer)
+	GraphicsDevice_Vulkan::GraphicsDevice_Vulkan(wiPlatform::window_type window, bool fullscreen, bool debuglayer, const std::string& pipelinecache_filename)
 	{
+		pipelineCacheFileName = pipelinecache_filename;
+
 		TOPLEVEL_ACCELERATION_STRUCTURE_INSTANCE_SIZE = sizeof(VkAccelerationStructureInstanceKHR);
 
 		DEBUGDEVICE = debuglayer;
@@ -2598,11 +2642,14 @@ using namespace Vulkan_Internal;
 			allocationhandler->bindlessAccelerationStructures.init(device, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 32);
 		}
 
+		LoadPipelineCache();
 
 		wiBackLog::post("Created GraphicsDevice_Vulkan");
 	}
 	GraphicsDevice_Vulkan::~GraphicsDevice_Vulkan()
 	{
+		wiJobSystem::Wait(prewarm_ctx);
+
 		VkResult res = vkQueueWaitIdle(graphicsQueue);
 		assert(res == VK_SUCCESS);
 		res = vkQueueWaitIdle(presentQueue);
@@ -2646,6 +2693,13 @@ using namespace Vulkan_Internal;
 		{
 			vkDestroyPipeline(device, x.second, nullptr);
 		}
+		for (auto& x : pipelines_prewarm)
+		{
+			vkDestroyPipeline(device, x.second, nullptr);
+		}
+
+		SavePipelineCache();
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
 
 		vmaDestroyBuffer(allocationhandler->allocator, nullBuffer, nullBufferAllocation);
 		vkDestroyBufferView(device, nullBufferView, nullptr);
@@ -2677,6 +2731,157 @@ using namespace Vulkan_Internal;
 		vkDestroySurfaceKHR(instance, surface, nullptr);
 	}
 
+	void GraphicsDevice_Vulkan::LoadPipelineCache()
+	{
+		const VkPhysicalDeviceProperties& properties = properties2.properties;
+
+		std::vector<uint8_t> filedata;
+		const uint8_t* initialData = nullptr;
+		size_t initialDataSize = 0;
+		if (!pipelineCacheFileName.empty() && wiHelper::FileExists(pipelineCacheFileName) && wiHelper::FileRead(pipelineCacheFileName, filedata))
+		{
+			PipelineCacheFileHeader header;
+			const char* reason = nullptr;
+			if (filedata.size() < sizeof(header))
+			{
+				reason = "file is too small";
+			}
+			else
+			{
+				std::memcpy(&header, filedata.data(), sizeof(header));
+				if (header.magic != PipelineCacheFileHeader::MAGIC || header.version != PipelineCacheFileHeader::VERSION)
+				{
+					reason = "unknown file format";
+				}
+				else if (
+					header.vendorID != properties.vendorID ||
+					header.deviceID != properties.deviceID ||
+					header.driverVersion != properties.driverVersion ||
+					std::memcmp(header.deviceUUID, properties_1_1.deviceUUID, VK_UUID_SIZE) != 0 ||
+					std::memcmp(header.driverUUID, properties_1_1.driverUUID, VK_UUID_SIZE) != 0 ||
+					std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0
+					)
+				{
+					reason = "it was created with a different device or driver";
+				}
+				else if (
+					header.dataSize != filedata.size() - sizeof(header) ||
+					header.dataHash != PipelineCacheDataHash(filedata.data() + sizeof(header), filedata.size() - sizeof(header))
+					)
+				{
+					reason = "data is corrupted";
+				}
+			}
+
+			if (reason == nullptr)
+			{
+				initialData = filedata.data() + sizeof(header);
+				initialDataSize = filedata.size() - sizeof(header);
+			}
+			else
+			{
+				std::stringstream ss;
+				ss << "Vulkan pipeline cache " << pipelineCacheFileName << " discarded, " << reason;
+				wiBackLog::post(ss.str().c_str());
+			}
+		}
+
+		VkPipelineCacheCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = initialDataSize;
+		createInfo.pInitialData = initialData;
+		VkResult res = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+		if (res != VK_SUCCESS && initialData != nullptr)
+		{
+			// The driver can still reject the data, then start with an empty cache:
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+			res = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
+			initialDataSize = 0;
+		}
+		assert(res == VK_SUCCESS);
+
+		if (initialDataSize > 0)
+		{
+			std::stringstream ss;
+			ss << "Vulkan pipeline cache loaded: " << pipelineCacheFileName << " (" << initialDataSize << " bytes)";
+			wiBackLog::post(ss.str().c_str());
+		}
+	}
+	std::string GraphicsDevice_Vulkan::GetDefaultPipelineCacheFileName()
+	{
+		const std::string fileName = "pipelinecache_vulkan.bin";
+#ifdef _WIN32
+		const char* localappdata = std::getenv("LOCALAPPDATA");
+		if (localappdata != nullptr && localappdata[0] != '\0')
+		{
+			return std::string(localappdata) + "\\WickedEngine\\" + fileName;
+		}
+#else
+		const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+		if (xdg_cache_home != nullptr && xdg_cache_home[0] == '/')
+		{
+			return std::string(xdg_cache_home) + "/WickedEngine/" + fileName;
+		}
+		const char* home = std::getenv("HOME");
+		if (home != nullptr && home[0] != '\0')
+		{
+			return std::string(home) + "/.cache/WickedEngine/" + fileName;
+		}
+#endif // _WIN32
+		return fileName;
+	}
+	bool GraphicsDevice_Vulkan::SavePipelineCache() const
+	{
+		if (pipelineCacheFileName.empty() || pipelineCache == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+
+		size_t size = 0;
+		VkResult res = vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+		if (res != VK_SUCCESS || size == 0)
+		{
+			return false;
+		}
+
+		const VkPhysicalDeviceProperties& properties = properties2.properties;
+		PipelineCacheFileHeader header;
+		header.vendorID = properties.vendorID;
+		header.deviceID = properties.deviceID;
+		header.driverVersion = properties.driverVersion;
+		std::memcpy(header.deviceUUID, properties_1_1.deviceUUID, VK_UUID_SIZE);
+		std::memcpy(header.driverUUID, properties_1_1.driverUUID, VK_UUID_SIZE);
+		std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		std::vector<uint8_t> filedata(sizeof(header) + size);
+		res = vkGetPipelineCacheData(device, pipelineCache, &size, filedata.data() + sizeof(header));
+		if (res != VK_SUCCESS)
+		{
+			return false;
+		}
+		filedata.resize(sizeof(header) + size);
+		header.dataSize = size;
+		header.dataHash = PipelineCacheDataHash(filedata.data() + sizeof(header), size);
+		std::memcpy(filedata.data(), &header, sizeof(header));
+
+		const std::filesystem::path directory = std::filesystem::path(pipelineCacheFileName).parent_path();
+		if (!directory.empty())
+		{
+			std::error_code ec;
+			std::filesystem::create_directories(directory, ec);
+		}
+
+		// Write to a temporary file first, so a crash while writing doesn't leave a truncated cache behind:
+		const std::string tempFileName = pipelineCacheFileName + ".tmp";
+		if (!wiHelper::FileWrite(tempFileName, filedata.data(), filedata.size()))
+		{
+			return false;
+		}
+		std::remove(pipelineCacheFileName.c_str());
+		return std::rename(tempFileName.c_str(), pipelineCacheFileName.c_str()) == 0;
+	}
+
 	void GraphicsDevice_Vulkan::CreateBackBufferResources()
 	{
 		VkSurfaceFormatKHR surfaceFormat = {};
@@ -3749,7 +3954,7 @@ using namespace Vulkan_Internal;
 			pipelineInfo.stage = internal_state->stageInfo;
 
 
-			res = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &internal_state->pipeline_cs);
+			res = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &internal_state->pipeline_cs);
 			assert(res == VK_SUCCESS);
 		}
 
@@ -5002,7 +5207,7 @@ using namespace Vulkan_Internal;
 		VkResult res = vkCreateRayTracingPipelinesKHR(
 			device,
 			VK_NULL_HANDLE,
-			VK_NULL_HANDLE,
+			pipelineCache,
 			1,
 			&info,
 			nullptr,
@@ -5891,6 +6096,24 @@ using namespace Vulkan_Internal;
 				pipelines_worker[cmd].clear();
 			}
 
+			// Pipelines that finished compiling ahead of time:
+			prewarm_locker.lock();
+			for (auto& x : pipelines_prewarm)
+			{
+				if (pipelines_global.count(x.first) == 0)
+				{
+					pipelines_global[x.first] = x.second;
+				}
+				else
+				{
+					allocationhandler->destroylocker.lock();
+					allocationhandler->destroyer_pipelines.push_back(std::make_pair(x.second, FRAMECOUNT));
+					allocationhandler->destroylocker.unlock();
+				}
+			}
+			pipelines_prewarm.clear();
+			prewarm_locker.unlock();
+
 			VkSubmitInfo submitInfo = {};
 			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -5958,6 +6181,9 @@ using namespace Vulkan_Internal;
 	}
 	void GraphicsDevice_Vulkan::ClearPipelineStateCache()
 	{
+		// Pipeline states can be recreated after this, so ahead of time compilation must finish before they are invalidated:
+		wiJobSystem::Wait(prewarm_ctx);
+
 		allocationhandler->destroylocker.lock();
 
 		pso_layout_cache_mutex.lock();
@@ -5975,6 +6201,15 @@ using namespace Vulkan_Internal;
 		}
 		pipelines_global.clear();
 
+		prewarm_locker.lock();
+		for (auto& x : pipelines_prewarm)
+		{
+			allocationhandler->destroyer_pipelines.push_back(std::make_pair(x.second, FRAMECOUNT));
+		}
+		pipelines_prewarm.clear();
+		pipelines_prewarm_requested.clear();
+		prewarm_locker.unlock();
+
 		for (int i = 0; i < arraysize(pipelines_worker); ++i)
 		{
 			for (auto& x : pipelines_worker[i])
@@ -5985,6 +6220,109 @@ using namespace Vulkan_Internal;
 		}
 		allocationhandler->destroylocker.unlock();
 	}
+	void GraphicsDevice_Vulkan::PrewarmPipelineStates(const PipelineState* const* psos, uint32_t count, const RenderPass* renderpass, const uint32_t* strides, uint32_t strideCount)
+	{
+		if (count == 0 || (renderpass != nullptr && !renderpass->IsValid()))
+			return;
+
+		// The same vertex buffer hash that BindVertexBuffers() would compute:
+		size_t vb_hash_prewarm = 0;
+		uint32_t vb_strides_prewarm[arraysize(vb_strides[0])] = {};
+		assert(strideCount <= arraysize(vb_strides_prewarm));
+		for (uint32_t i = 0; i < strideCount; ++i)
+		{
+			wiHelper::hash_combine(vb_hash_prewarm, strides[i]);
+			vb_strides_prewarm[i] = strides[i];
+		}
+
+		// The pipeline states are copied, because the originals can be recreated while the jobs are running
+		//	The copy keeps the internal state alive, and the states that the description points to are also copied
+		struct PrewarmJob
+		{
+			size_t pipeline_hash;
+			PipelineState pso;
+			BlendState bs;
+			RasterizerState rs;
+			DepthStencilState dss;
+			InputLayout il;
+		};
+		struct PrewarmBatch
+		{
+			RenderPass renderpass; // copy keeps the Vulkan render pass alive while compiling
+			std::vector<Texture> attachment_textures; // the copied render pass attachments point to these
+			bool renderpass_valid = false;
+			uint32_t strides[arraysize(vb_strides[0])] = {};
+			std::vector<PrewarmJob> jobs;
+		};
+		auto batch = std::make_shared<PrewarmBatch>();
+		if (renderpass != nullptr)
+		{
+			batch->renderpass = *renderpass;
+			batch->renderpass_valid = true;
+			batch->attachment_textures.resize(renderpass->desc.attachments.size());
+			for (size_t i = 0; i < renderpass->desc.attachments.size(); ++i)
+			{
+				RenderPassAttachment& attachment = batch->renderpass.desc.attachments[i];
+				if (attachment.texture != nullptr)
+				{
+					batch->attachment_textures[i] = *attachment.texture;
+					attachment.texture = &batch->attachment_textures[i];
+				}
+			}
+		}
+		std::memcpy(batch->strides, vb_strides_prewarm, sizeof(vb_strides_prewarm));
+
+		prewarm_locker.lock();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const PipelineState* pso = psos[i];
+			if (pso == nullptr || !pso->IsValid())
+				continue;
+
+			// The same hash that BindPipelineState() and pso_validate() would compute:
+			size_t pipeline_hash = 0;
+			wiHelper::hash_combine(pipeline_hash, pso->hash);
+			if (renderpass != nullptr)
+			{
+				wiHelper::hash_combine(pipeline_hash, renderpass->hash);
+			}
+			if (pso->desc.il != nullptr)
+			{
+				wiHelper::hash_combine(pipeline_hash, vb_hash_prewarm);
+			}
+
+			if (pipelines_prewarm_requested.insert(pipeline_hash).second)
+			{
+				PrewarmJob job;
+				job.pipeline_hash = pipeline_hash;
+				job.pso = *pso;
+				if (pso->desc.bs != nullptr)
+					job.bs = *pso->desc.bs;
+				if (pso->desc.rs != nullptr)
+					job.rs = *pso->desc.rs;
+				if (pso->desc.dss != nullptr)
+					job.dss = *pso->desc.dss;
+				if (pso->desc.il != nullptr)
+					job.il = *pso->desc.il;
+				batch->jobs.push_back(std::move(job));
+			}
+		}
+		prewarm_locker.unlock();
+
+		prewarm_ctx.priority = wiJobSystem::Priority::Background;
+		wiJobSystem::Dispatch(prewarm_ctx, (uint32_t)batch->jobs.size(), 1, [this, batch](wiJobArgs args) {
+			const PrewarmJob& job = batch->jobs[args.jobIndex];
+			PipelineState pso = job.pso;
+			pso.desc.bs = pso.desc.bs != nullptr ? &job.bs : nullptr;
+			pso.desc.rs = pso.desc.rs != nullptr ? &job.rs : nullptr;
+			pso.desc.dss = pso.desc.dss != nullptr ? &job.dss : nullptr;
+			pso.desc.il = pso.desc.il != nullptr ? &job.il : nullptr;
+			VkPipeline pipeline = CreatePipeline(&pso, batch->renderpass_valid ? &batch->renderpass : nullptr, batch->strides);
+			prewarm_locker.lock();
+			pipelines_prewarm.push_back(std::make_pair(job.pipeline_hash, pipeline));
+			prewarm_locker.unlock();
+		});
+	}
 
 
 	void GraphicsDevice_Vulkan::RenderPassBegin(const RenderPass* renderpass, CommandList cmd)
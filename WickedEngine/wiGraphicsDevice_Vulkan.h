@@ -11,6 +11,7 @@
 #include "wiSpinLock.h"
 #include "wiContainers.h"
 #include "wiGraphicsDevice_SharedInternals.h"
+#include "wiJobSystem.h"
 
 #ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
@@ -24,6 +25,8 @@
 #include <vector>
 #include <unordered_map>
 #include <deque>
+#include <unordered_set>
+#include <string>
 #include <atomic>
 #include <mutex>
 #include <algorithm>
@@ -187,6 +190,19 @@ namespace wiGraphics
 
 		std::unordered_map<size_t, VkPipeline> pipelines_global;
 		std::vector<std::pair<size_t, VkPipeline>> pipelines_worker[COMMANDLIST_COUNT];
+
+		// Driver side pipeline cache that is persisted between runs, so pipelines are not compiled from scratch every launch
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		std::string pipelineCacheFileName;
+		void LoadPipelineCache();
+
+		// Pipelines that were compiled ahead of time by PrewarmPipelineStates(), they are merged into pipelines_global on submit
+		wiJobSystem::context prewarm_ctx;
+		std::mutex prewarm_locker;
+		std::vector<std::pair<size_t, VkPipeline>> pipelines_prewarm;
+		std::unordered_set<size_t> pipelines_prewarm_requested;
+
+		VkPipeline CreatePipeline(const PipelineState* pso, const RenderPass* renderpass, const uint32_t* strides) const;
 		size_t prev_pipeline_hash[COMMANDLIST_COUNT] = {};
 		const PipelineState* active_pso[COMMANDLIST_COUNT] = {};
 		const Shader* active_cs[COMMANDLIST_COUNT] = {};
@@ -216,9 +232,17 @@ namespace wiGraphics
 		std::vector<StaticSampler> common_samplers;
 
 	public:
-		GraphicsDevice_Vulkan(wiPlatform::window_type window, bool fullscreen = false, bool debuglayer = false);
+		// pipelinecache_filename	: file that the pipeline cache is loaded from and saved to, empty string disables the persistent pipeline cache
+		GraphicsDevice_Vulkan(wiPlatform::window_type window, bool fullscreen = false, bool debuglayer = false, const std::string& pipelinecache_filename = GetDefaultPipelineCacheFileName());
 		virtual ~GraphicsDevice_Vulkan();
 
+		// Returns the default pipeline cache file in the local cache directory of the user: %LOCALAPPDATA% on Windows, $XDG_CACHE_HOME or ~/.cache on Linux
+		//	If none of these are available, it's in the working directory
+		static std::string GetDefaultPipelineCacheFileName();
+
+		// Write the pipeline cache to disk. This is also done when the device is destroyed
+		bool SavePipelineCache() const;
+
 		bool CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *pBuffer) const override;
 		bool CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const override;
 		bool CreateShader(SHADERSTAGE stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const override;
@@ -255,6 +279,7 @@ namespace wiGraphics
 
 		void WaitForGPU() override;
 		void ClearPipelineStateCache() override;
+		void PrewarmPipelineStates(const PipelineState* const* psos, uint32_t count, const RenderPass* renderpass, const uint32_t* strides = nullptr, uint32_t strideCount = 0) override;
 
 		void SetResolution(int width, int height) override;
 
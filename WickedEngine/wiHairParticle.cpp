@@ -165,7 +165,12 @@ void wiHairParticle::UpdateGPU(const MeshComponent& mesh, const MaterialComponen
 	TextureDesc desc;
 	if (material.textures[MaterialComponent::BASECOLORMAP].resource != nullptr)
 	{
-		desc = material.textures[MaterialComponent::BASECOLORMAP].resource->texture.GetDesc();
+		// The texture can still be loading asynchronously, the aspect is updated when it becomes ready:
+		const Texture* texture = material.textures[MaterialComponent::BASECOLORMAP].resource->GetTexture();
+		if (texture != nullptr)
+		{
+			desc = texture->GetDesc();
+		}
 	}
 
 	HairParticleCB hcb;
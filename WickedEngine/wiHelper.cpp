@@ -33,6 +33,13 @@
 #include "Utility/portable-file-dialogs.h"
 #endif // _WIN32
 
+#ifdef PLATFORM_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // PLATFORM_LINUX
+
 using namespace std;
 
 namespace wiHelper
@@ -471,6 +478,41 @@ namespace wiHelper
 		return false;
 	}
 
+	bool FileMap(const std::string& fileName, std::shared_ptr<const uint8_t>& data, size_t& size)
+	{
+#ifdef PLATFORM_LINUX
+		std::string filepath = fileName;
+		std::replace(filepath.begin(), filepath.end(), '\\', '/');
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0)
+		{
+			close(fd);
+			return false;
+		}
+		const size_t mapsize = (size_t)info.st_size;
+		void* mapped = mmap(nullptr, mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps the file referenced
+		if (mapped == MAP_FAILED)
+		{
+			return false;
+		}
+		// The data is mostly read front to back:
+		madvise(mapped, mapsize, MADV_SEQUENTIAL);
+		data = std::shared_ptr<const uint8_t>((const uint8_t*)mapped, [mapsize](const uint8_t* ptr) {
+			munmap((void*)ptr, mapsize);
+		});
+		size = mapsize;
+		return true;
+#else
+		return false;
+#endif // PLATFORM_LINUX
+	}
+
 	bool FileWrite(const std::string& fileName, const uint8_t* data, size_t size)
 	{
 		if (size <= 0)
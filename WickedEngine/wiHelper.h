@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
 
 namespace wiHelper
 {
@@ -72,6 +73,10 @@ namespace wiHelper
 
 	bool FileRead(const std::string& fileName, std::vector<uint8_t>& data);
 
+	// Maps the file into memory for reading without copying it. The mapping stays valid while any copy of data is alive
+	//	Returns false if the file can't be mapped (or mapping is not supported on the platform), FileRead() can be used instead
+	bool FileMap(const std::string& fileName, std::shared_ptr<const uint8_t>& data, size_t& size);
+
 	bool FileWrite(const std::string& fileName, const uint8_t* data, size_t size);
 
 	bool FileExists(const std::string& fileName);
@@ -181,6 +181,17 @@ void AABB::Serialize(wiArchive& archive, wiECS::EntitySerializer& seri)
 		archive << _max;
 	}
 }
+void AABB_SoA::resize(uint32_t newCount)
+{
+	count = newCount;
+	const uint32_t newCapacity = (newCount + 31) / 32 * 32;
+	if (newCapacity != capacity)
+	{
+		capacity = newCapacity;
+		data.resize(capacity * COMPONENT_COUNT / 4);
+	}
+}
+
 
 
 
@@ -374,6 +385,122 @@ bool Frustum::CheckBoxFast(const AABB& box) const
 	}
 	return true;
 }
+Frustum::BoxFrustumIntersect Frustum::CheckBoxFastIntersect(const AABB& box) const
+{
+	XMVECTOR max = XMLoadFloat3(&box._max);
+	XMVECTOR min = XMLoadFloat3(&box._min);
+	XMVECTOR zero = XMVectorZero();
+	BoxFrustumIntersect result = BOX_FRUSTUM_INSIDE;
+	for (size_t p = 0; p < 6; ++p)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[p]);
+		auto lt = XMVectorLess(plane, zero);
+		auto furthestFromPlane = XMVectorSelect(max, min, lt);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, furthestFromPlane)) < 0.0f)
+		{
+			return BOX_FRUSTUM_OUTSIDE;
+		}
+		auto closestToPlane = XMVectorSelect(min, max, lt);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, closestToPlane)) < 0.0f)
+		{
+			result = BOX_FRUSTUM_INTERSECTS;
+		}
+	}
+	return result;
+}
+
+void Frustum::CheckBoxesFast(const AABB_SoA& boxes, uint32_t* visibility_mask, uint32_t firstBlock, uint32_t blockCount) const
+{
+	const uint32_t totalBlockCount = boxes.capacity / 32;
+	if (firstBlock >= totalBlockCount)
+		return;
+	blockCount = std::min(blockCount, totalBlockCount - firstBlock);
+
+	// The box corner that is furthest along the plane normal (the same as in CheckBoxFast) is selected per plane, not per box:
+	const float* X[6];
+	const float* Y[6];
+	const float* Z[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		X[p] = boxes.getComponent(planes[p].x < 0 ? AABB_SoA::MIN_X : AABB_SoA::MAX_X);
+		Y[p] = boxes.getComponent(planes[p].y < 0 ? AABB_SoA::MIN_Y : AABB_SoA::MAX_Y);
+		Z[p] = boxes.getComponent(planes[p].z < 0 ? AABB_SoA::MIN_Z : AABB_SoA::MAX_Z);
+	}
+
+#ifdef _XM_AVX_INTRINSICS_
+	// 8 boxes at once:
+	__m256 PX[6], PY[6], PZ[6], PW[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		PX[p] = _mm256_set1_ps(planes[p].x);
+		PY[p] = _mm256_set1_ps(planes[p].y);
+		PZ[p] = _mm256_set1_ps(planes[p].z);
+		PW[p] = _mm256_set1_ps(planes[p].w);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	for (uint32_t block = firstBlock; block < firstBlock + blockCount; ++block)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < 32; i += 8)
+		{
+			const uint32_t index = block * 32 + i;
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 dist = _mm256_mul_ps(_mm256_loadu_ps(X[p] + index), PX[p]);
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_loadu_ps(Y[p] + index), PY[p]));
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_loadu_ps(Z[p] + index), PZ[p]));
+				dist = _mm256_add_ps(dist, PW[p]);
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+			}
+			mask |= uint32_t(_mm256_movemask_ps(visible)) << i;
+		}
+		visibility_mask[block - firstBlock] = mask;
+	}
+#else
+	// 4 boxes at once:
+	XMVECTOR PX[6], PY[6], PZ[6], PW[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		PX[p] = XMVectorReplicate(planes[p].x);
+		PY[p] = XMVectorReplicate(planes[p].y);
+		PZ[p] = XMVectorReplicate(planes[p].z);
+		PW[p] = XMVectorReplicate(planes[p].w);
+	}
+	const XMVECTOR zero = XMVectorZero();
+	for (uint32_t block = firstBlock; block < firstBlock + blockCount; ++block)
+	{
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < 32; i += 4)
+		{
+			const uint32_t index = block * 32 + i;
+			XMVECTOR visible = XMVectorTrueInt();
+			for (int p = 0; p < 6; ++p)
+			{
+				XMVECTOR dist = XMVectorMultiply(XMLoadFloat4A((const XMFLOAT4A*)(X[p] + index)), PX[p]);
+				dist = XMVectorAdd(dist, XMVectorMultiply(XMLoadFloat4A((const XMFLOAT4A*)(Y[p] + index)), PY[p]));
+				dist = XMVectorAdd(dist, XMVectorMultiply(XMLoadFloat4A((const XMFLOAT4A*)(Z[p] + index)), PZ[p]));
+				dist = XMVectorAdd(dist, PW[p]);
+				visible = XMVectorAndInt(visible, XMVectorGreaterOrEqual(dist, zero));
+			}
+#ifdef _XM_SSE_INTRINSICS_
+			mask |= uint32_t(_mm_movemask_ps(visible)) << i;
+#else
+			XMUINT4 lanes;
+			XMStoreUInt4(&lanes, visible);
+			mask |= ((lanes.x & 1) | ((lanes.y & 1) << 1) | ((lanes.z & 1) << 2) | ((lanes.w & 1) << 3)) << i;
+#endif // _XM_SSE_INTRINSICS_
+		}
+		visibility_mask[block - firstBlock] = mask;
+	}
+#endif // _XM_AVX_INTRINSICS_
+
+	// Padding boxes are never visible:
+	if (firstBlock + blockCount == totalBlockCount && (boxes.count % 32) != 0)
+	{
+		visibility_mask[blockCount - 1] &= (1u << (boxes.count % 32)) - 1;
+	}
+}
 
 const XMFLOAT4& Frustum::getNearPlane() const { return planes[0]; }
 const XMFLOAT4& Frustum::getFarPlane() const { return planes[1]; }
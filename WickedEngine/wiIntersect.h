@@ -106,6 +106,49 @@ struct RAY
 	bool intersects(const SPHERE& b) const;
 };
 
+// Array of axis aligned bounding boxes in structure of arrays layout, for batched culling
+//	Every component is in a separate array, and the arrays are padded to a multiple of 32 boxes
+struct AABB_SoA
+{
+	enum COMPONENT
+	{
+		MIN_X,
+		MIN_Y,
+		MIN_Z,
+		MAX_X,
+		MAX_Y,
+		MAX_Z,
+		COMPONENT_COUNT
+	};
+	std::vector<XMFLOAT4A> data; // XMFLOAT4A storage keeps the arrays 16 byte aligned for XMLoadFloat4A
+	uint32_t count = 0;
+	uint32_t capacity = 0; // number of boxes including padding
+
+	void resize(uint32_t newCount); // box values must be set again after resize
+	inline float* getComponent(COMPONENT component) { return (float*)data.data() + component * capacity; }
+	inline const float* getComponent(COMPONENT component) const { return (const float*)data.data() + component * capacity; }
+	inline void set(uint32_t index, const AABB& aabb)
+	{
+		assert(index < count);
+		float* values = (float*)data.data() + index;
+		values[MIN_X * capacity] = aabb._min.x;
+		values[MIN_Y * capacity] = aabb._min.y;
+		values[MIN_Z * capacity] = aabb._min.z;
+		values[MAX_X * capacity] = aabb._max.x;
+		values[MAX_Y * capacity] = aabb._max.y;
+		values[MAX_Z * capacity] = aabb._max.z;
+	}
+	inline AABB get(uint32_t index) const
+	{
+		assert(index < count);
+		const float* values = (const float*)data.data() + index;
+		return AABB(
+			XMFLOAT3(values[MIN_X * capacity], values[MIN_Y * capacity], values[MIN_Z * capacity]),
+			XMFLOAT3(values[MAX_X * capacity], values[MAX_Y * capacity], values[MAX_Z * capacity])
+		);
+	}
+};
+
 struct Frustum
 {
 	XMFLOAT4 planes[6];
@@ -123,6 +166,10 @@ struct Frustum
 	};
 	BoxFrustumIntersect CheckBox(const AABB& box) const;
 	bool CheckBoxFast(const AABB& box) const;
+	BoxFrustumIntersect CheckBoxFastIntersect(const AABB& box) const; // same as CheckBoxFast, but it can also tell whether the box is fully inside
+	// Batched CheckBoxFast for blocks of 32 boxes, starting from box index firstBlock * 32
+	//	Writes one bit for every box into visibility_mask (bit i of visibility_mask[j] is box (firstBlock + j) * 32 + i), bits after the last box are cleared
+	void CheckBoxesFast(const AABB_SoA& boxes, uint32_t* visibility_mask, uint32_t firstBlock = 0, uint32_t blockCount = ~0u) const;
 
 	const XMFLOAT4& getNearPlane() const;
 	const XMFLOAT4& getFarPlane() const;
@@ -3,34 +3,337 @@
 #include "wiBackLog.h"
 #include "wiContainers.h"
 #include "wiPlatform.h"
+#include "wiStartupArguments.h"
 
 #include <thread>
 #include <condition_variable>
 #include <string>
 #include <algorithm>
+#include <deque>
+#include <memory>
+#include <cassert>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#define wiJobSystem_pause() _mm_pause()
+#else
+#define wiJobSystem_pause() std::this_thread::yield()
+#endif
+
+#ifdef PLATFORM_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fstream>
+#include <sstream>
+#endif // PLATFORM_LINUX
 
 namespace wiJobSystem
 {
+	// Jobs are trivially copyable, so they can be stored in the lock-free work stealing deques
 	struct Job
 	{
 		context* ctx;
-		std::function<void(wiJobArgs)> task;
+		Task* task;
 		uint32_t groupID;
 		uint32_t groupJobOffset;
 		uint32_t groupJobEnd;
 		uint32_t sharedmemory_size;
 	};
+	using JobQueue = wiContainers::WorkStealingDeque<Job>;
 
 	uint32_t numThreads = 0;
-	wiContainers::ThreadSafeRingBuffer<Job, 256> jobQueue;
-	std::condition_variable wakeCondition;
-	std::mutex wakeMutex;
+	uint32_t numQueues = 0;
+	thread_local uint32_t localQueueIndex = ~0u; // ~0u: this thread doesn't own job queues
+	std::vector<std::vector<uint32_t>> stealOrders; // for every queue owner thread, the order of other queues to steal from (closest first)
+	struct PriorityQueue
+	{
+		// [0] is owned by the thread that called Initialize(), [1..numThreads] by the worker threads
+		std::unique_ptr<JobQueue[]> jobQueues;
+
+		// Jobs submitted from threads that don't own a job queue will go here:
+		std::deque<Job> sharedQueue;
+		wiSpinLock sharedQueueLock;
+		std::atomic<uint32_t> sharedQueueCount{ 0 };
+
+		inline void submit(const Job& job)
+		{
+			if (localQueueIndex != ~0u)
+			{
+				jobQueues[localQueueIndex].push_back(job);
+			}
+			else
+			{
+				sharedQueueLock.lock();
+				sharedQueue.push_back(job);
+				sharedQueueCount.fetch_add(1, std::memory_order_release);
+				sharedQueueLock.unlock();
+			}
+		}
+
+		// Find a job: first from the own queue (newest first), then from the shared queue, then steal from an other thread (oldest first)
+		inline bool find(Job& job)
+		{
+			if (localQueueIndex != ~0u && jobQueues[localQueueIndex].pop_back(job))
+			{
+				return true;
+			}
+
+			if (sharedQueueCount.load(std::memory_order_acquire) > 0)
+			{
+				bool result = false;
+				sharedQueueLock.lock();
+				if (!sharedQueue.empty())
+				{
+					job = sharedQueue.front();
+					sharedQueue.pop_front();
+					sharedQueueCount.fetch_sub(1, std::memory_order_release);
+					result = true;
+				}
+				sharedQueueLock.unlock();
+				if (result)
+				{
+					return true;
+				}
+			}
+
+			if (localQueueIndex != ~0u)
+			{
+				for (uint32_t victim : stealOrders[localQueueIndex])
+				{
+					if (jobQueues[victim].steal(job))
+					{
+						return true;
+					}
+				}
+			}
+			else
+			{
+				for (uint32_t victim = 0; victim < numQueues; ++victim)
+				{
+					if (jobQueues[victim].steal(job))
+					{
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		// Check whether there could be any jobs available
+		inline bool has_work() const
+		{
+			if (sharedQueueCount.load(std::memory_order_acquire) > 0)
+			{
+				return true;
+			}
+			for (uint32_t i = 0; i < numQueues; ++i)
+			{
+				if (!jobQueues[i].empty())
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+	PriorityQueue priorityQueues[int(Priority::Count)];
+
+	// Task pool: freed tasks are cached by the job system threads, and exchanged in batches through the global pool
+	//	Threads that don't own job queues use the global pool directly, so nothing is lost in their caches when they exit
+	const uint32_t taskBatchSize = 64;
+	thread_local Task* localFreeTasks = nullptr;
+	thread_local uint32_t localFreeTaskCount = 0;
+	Task* globalFreeTasks = nullptr;
+	wiSpinLock globalFreeTasksLock;
+	std::atomic<uint32_t> allocationCount{ 0 };
+
+	Task* AllocateTask()
+	{
+		Task* task = nullptr;
+		if (localQueueIndex != ~0u)
+		{
+			if (localFreeTasks == nullptr)
+			{
+				// Refill the local cache with a batch from the global pool:
+				globalFreeTasksLock.lock();
+				while (globalFreeTasks != nullptr && localFreeTaskCount < taskBatchSize)
+				{
+					Task* item = globalFreeTasks;
+					globalFreeTasks = item->next;
+					item->next = localFreeTasks;
+					localFreeTasks = item;
+					localFreeTaskCount++;
+				}
+				globalFreeTasksLock.unlock();
+			}
+			if (localFreeTasks != nullptr)
+			{
+				task = localFreeTasks;
+				localFreeTasks = task->next;
+				localFreeTaskCount--;
+			}
+		}
+		else
+		{
+			globalFreeTasksLock.lock();
+			if (globalFreeTasks != nullptr)
+			{
+				task = globalFreeTasks;
+				globalFreeTasks = task->next;
+			}
+			globalFreeTasksLock.unlock();
+		}
+
+		if (task == nullptr)
+		{
+			CountAllocation();
+			task = new Task;
+		}
+		task->next = nullptr;
+		return task;
+	}
 
-	// This function executes the next item from the job queue. Returns true if successful, false if there was no job available
-	inline bool work()
+	inline void FreeTask(Task* task)
+	{
+		task->destroy(task->callable);
+		task->callable = nullptr;
+
+		if (localQueueIndex != ~0u)
+		{
+			task->next = localFreeTasks;
+			localFreeTasks = task;
+			localFreeTaskCount++;
+			if (localFreeTaskCount >= taskBatchSize * 2)
+			{
+				// Give back a batch to the global pool, because tasks are usually freed on different threads than they were allocated on:
+				globalFreeTasksLock.lock();
+				while (localFreeTaskCount > taskBatchSize)
+				{
+					Task* item = localFreeTasks;
+					localFreeTasks = item->next;
+					item->next = globalFreeTasks;
+					globalFreeTasks = item;
+					localFreeTaskCount--;
+				}
+				globalFreeTasksLock.unlock();
+			}
+		}
+		else
+		{
+			globalFreeTasksLock.lock();
+			task->next = globalFreeTasks;
+			globalFreeTasks = task;
+			globalFreeTasksLock.unlock();
+		}
+	}
+
+	uint32_t GetAllocationCount()
+	{
+		return allocationCount.load();
+	}
+
+	void CountAllocation()
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	inline bool has_work()
+	{
+		for (auto& queue : priorityQueues)
+		{
+			if (queue.has_work())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Every worker thread has its own wake signal, so threads can be woken up one by one instead of a broadcast to all of them
+	struct WorkerSignal
+	{
+		alignas(64) std::atomic<uint32_t> sleeping{ 0 }; // on Linux, this is also the futex word
+#ifndef PLATFORM_LINUX
+		std::mutex locker;
+		std::condition_variable condition;
+#endif // PLATFORM_LINUX
+	};
+	std::unique_ptr<WorkerSignal[]> workerSignals;
+	std::atomic<uint32_t> sleepingCount{ 0 };
+	std::atomic<uint32_t> wakeCursor{ 0 };
+	uint32_t spinCount = 1000; // how many times an idle worker looks for jobs before going to sleep
+	std::vector<std::thread> workers;
+	std::atomic_bool alive{ false }; // workers exit when this is cleared by ShutDown()
+
+	// Put the worker to sleep until it is woken up by wake_workers()
+	inline void sleep_worker(WorkerSignal& signal)
+	{
+		signal.sleeping.store(1);
+		sleepingCount.fetch_add(1);
+
+		// A job could have been submitted (or shutdown started) before the other thread noticed that this thread is going to sleep:
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (has_work() || !alive.load())
+		{
+			if (signal.sleeping.exchange(0) == 1)
+			{
+				sleepingCount.fetch_sub(1);
+			}
+			return;
+		}
+
+#ifdef PLATFORM_LINUX
+		while (signal.sleeping.load() == 1)
+		{
+			syscall(SYS_futex, (uint32_t*)&signal.sleeping, FUTEX_WAIT_PRIVATE, 1, nullptr, nullptr, 0);
+		}
+#else
+		std::unique_lock<std::mutex> lock(signal.locker);
+		signal.condition.wait(lock, [&] { return signal.sleeping.load() == 0; });
+#endif // PLATFORM_LINUX
+	}
+
+	// Wake up at most the specified number of sleeping workers
+	inline void wake_workers(uint32_t count)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (sleepingCount.load(std::memory_order_relaxed) == 0)
+		{
+			return;
+		}
+		const uint32_t cursor = wakeCursor.fetch_add(1, std::memory_order_relaxed);
+		for (uint32_t i = 0; i < numThreads && count > 0; ++i)
+		{
+			WorkerSignal& signal = workerSignals[(cursor + i) % numThreads];
+			if (signal.sleeping.load(std::memory_order_relaxed) == 1 && signal.sleeping.exchange(0) == 1)
+			{
+				sleepingCount.fetch_sub(1);
+				count--;
+#ifdef PLATFORM_LINUX
+				syscall(SYS_futex, (uint32_t*)&signal.sleeping, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+				signal.locker.lock();
+				signal.locker.unlock();
+				signal.condition.notify_one();
+#endif // PLATFORM_LINUX
+			}
+		}
+	}
+
+	// This function executes the next available job, jobs with lower priority than lowest_priority will not be considered
+	//	Returns true if successful, false if there was no job available
+	inline bool work(Priority lowest_priority = Priority::Background)
 	{
 		Job job;
-		if (jobQueue.pop_front(job))
+		bool found = false;
+		for (int priority = 0; priority <= int(lowest_priority) && !found; ++priority)
+		{
+			found = priorityQueues[priority].find(job);
+		}
+		if (found)
 		{
 			wiJobArgs args;
 			args.groupID = job.groupID;
@@ -49,7 +352,13 @@ namespace wiJobSystem
 				args.groupIndex = i - job.groupJobOffset;
 				args.isFirstJobInGroup = (i == job.groupJobOffset);
 				args.isLastJobInGroup = (i == job.groupJobEnd - 1);
-				job.task(args);
+				job.task->invoke(job.task->callable, args);
+			}
+
+			// The last group that finished will free the task:
+			if (job.task->refCount.fetch_sub(1) == 1)
+			{
+				FreeTask(job.task);
 			}
 
 			job.ctx->counter.fetch_sub(1);
@@ -58,25 +367,174 @@ namespace wiJobSystem
 		return false;
 	}
 
+#ifdef PLATFORM_LINUX
+	// Parse a cpu list in the format of "0-3,8,10-11"
+	inline std::vector<uint32_t> parse_cpulist(const std::string& cpulist)
+	{
+		std::vector<uint32_t> cpus;
+		std::stringstream ss(cpulist);
+		std::string range;
+		while (std::getline(ss, range, ','))
+		{
+			if (range.empty())
+				continue;
+			size_t dash = range.find('-');
+			uint32_t first = (uint32_t)std::stoul(range.substr(0, dash));
+			uint32_t last = dash == std::string::npos ? first : (uint32_t)std::stoul(range.substr(dash + 1));
+			for (uint32_t cpu = first; cpu <= last; ++cpu)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+		return cpus;
+	}
+
+	// Returns the cpus that this process can use for every NUMA node, or a single node with every cpu if the topology is not available
+	inline std::vector<std::vector<uint32_t>> get_numa_nodes(uint32_t numCores)
+	{
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0)
+		{
+			for (uint32_t cpu = 0; cpu < numCores && cpu < CPU_SETSIZE; ++cpu)
+			{
+				CPU_SET(cpu, &allowed);
+			}
+		}
+
+		std::vector<std::vector<uint32_t>> nodes;
+		for (uint32_t node = 0; ; ++node)
+		{
+			std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			if (!file.is_open())
+				break;
+			std::string cpulist;
+			std::getline(file, cpulist);
+			std::vector<uint32_t> cpus;
+			for (uint32_t cpu : parse_cpulist(cpulist))
+			{
+				if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+				{
+					cpus.push_back(cpu);
+				}
+			}
+			if (!cpus.empty())
+			{
+				nodes.push_back(cpus);
+			}
+		}
+		if (nodes.empty())
+		{
+			nodes.emplace_back();
+			for (uint32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			{
+				if (CPU_ISSET(cpu, &allowed))
+				{
+					nodes.back().push_back(cpu);
+				}
+			}
+			if (nodes.back().empty())
+			{
+				nodes.back().push_back(0);
+			}
+		}
+		return nodes;
+	}
+#endif // PLATFORM_LINUX
+
 	void Initialize()
 	{
 		// Retrieve the number of hardware threads in this system:
 		auto numCores = std::thread::hardware_concurrency();
 
-		// Calculate the actual number of worker threads we want (-1 main thread):
+		// Calculate the actual number of worker threads we want (-1 main thread), unless it was specified in startup arguments:
 		numThreads = std::max(1u, numCores - 1);
+		std::string threads_argument = wiStartupArguments::GetArgumentValue("jobthreads");
+		if (!threads_argument.empty())
+		{
+			numThreads = std::max(1, std::atoi(threads_argument.c_str()));
+		}
+
+		std::string spin_argument = wiStartupArguments::GetArgumentValue("jobspin");
+		if (!spin_argument.empty())
+		{
+			spinCount = (uint32_t)std::max(0, std::atoi(spin_argument.c_str()));
+		}
+
+		// Every worker thread and the calling thread will have its own job queues:
+		numQueues = numThreads + 1;
+		for (auto& queue : priorityQueues)
+		{
+			queue.jobQueues.reset(new JobQueue[numQueues]);
+		}
+		workerSignals.reset(new WorkerSignal[numThreads]);
+		localQueueIndex = 0;
+
+		// Which node every queue owner thread belongs to. Threads on the same node steal from each other first:
+		std::vector<uint32_t> queueNodes(numQueues, 0);
+
+#ifdef PLATFORM_LINUX
+		const bool numa = wiStartupArguments::HasArgument("jobnuma");
+		const bool affinity = numa || wiStartupArguments::HasArgument("jobaffinity");
+
+		// Cpus are ordered node by node, so neighbouring workers share the same memory node.
+		//	The calling thread is assumed to be on the first cpu, workers are placed after it:
+		std::vector<uint32_t> cpus;
+		std::vector<uint32_t> cpuNodes;
+		auto nodes = get_numa_nodes(numCores);
+		for (uint32_t node = 0; node < (uint32_t)nodes.size(); ++node)
+		{
+			for (uint32_t cpu : nodes[node])
+			{
+				cpus.push_back(cpu);
+				cpuNodes.push_back(numa ? node : 0);
+			}
+		}
+		for (uint32_t queueIndex = 0; queueIndex < numQueues; ++queueIndex)
+		{
+			queueNodes[queueIndex] = cpuNodes[queueIndex % cpus.size()];
+		}
+#endif // PLATFORM_LINUX
+
+		stealOrders.resize(numQueues);
+		for (uint32_t queueIndex = 0; queueIndex < numQueues; ++queueIndex)
+		{
+			auto& order = stealOrders[queueIndex];
+			for (uint32_t i = 1; i < numQueues; ++i)
+			{
+				order.push_back((queueIndex + i) % numQueues);
+			}
+			std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+				return (queueNodes[a] != queueNodes[queueIndex]) < (queueNodes[b] != queueNodes[queueIndex]);
+			});
+		}
 
+		alive.store(true);
 		for (uint32_t threadID = 0; threadID < numThreads; ++threadID)
 		{
-			std::thread worker([] {
+			std::thread worker([threadID] {
+
+				localQueueIndex = threadID + 1;
+				WorkerSignal& signal = workerSignals[threadID];
 
-				while (true)
+				uint32_t spin = 0;
+				while (alive.load(std::memory_order_relaxed))
 				{
-					if (!work())
+					if (work())
+					{
+						spin = 0;
+					}
+					else if (spin < spinCount)
+					{
+						// no job, but spin for a while because new jobs are likely to be submitted soon
+						spin++;
+						wiJobSystem_pause();
+					}
+					else
 					{
-						// no job, put thread to sleep
-						std::unique_lock<std::mutex> lock(wakeMutex);
-						wakeCondition.wait(lock);
+						// still no job, put thread to sleep
+						spin = 0;
+						sleep_worker(signal);
 					}
 				}
 
@@ -101,18 +559,79 @@ namespace wiJobSystem
 			assert(SUCCEEDED(hr));
 #endif // _WIN32
 
-			worker.detach();
+#ifdef PLATFORM_LINUX
+			// Do Linux-specific thread setup:
+			pthread_t handle = worker.native_handle();
+
+			// Put each thread on to dedicated core (optional, because the system could be shared with other processes):
+			if (affinity)
+			{
+				cpu_set_t cpuset;
+				CPU_ZERO(&cpuset);
+				CPU_SET(cpus[(threadID + 1) % cpus.size()], &cpuset);
+				int affinity_result = pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset);
+				assert(affinity_result == 0);
+			}
+
+			// Name the thread (maximum 15 characters):
+			std::string threadname = "wiJobSystem_" + std::to_string(threadID);
+			int name_result = pthread_setname_np(handle, threadname.substr(0, 15).c_str());
+			assert(name_result == 0);
+#endif // PLATFORM_LINUX
+
+			workers.push_back(std::move(worker));
 		}
 
 		wiBackLog::post(("wiJobSystem Initialized with [" + std::to_string(numCores) + " cores] [" + std::to_string(numThreads) + " threads]").c_str());
 	}
 
+	void ShutDown()
+	{
+		if (!alive.exchange(false))
+		{
+			return;
+		}
+
+		// Wake up every sleeping worker, they will see that the job system is not alive and exit:
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		for (uint32_t i = 0; i < numThreads; ++i)
+		{
+			WorkerSignal& signal = workerSignals[i];
+			if (signal.sleeping.exchange(0) == 1)
+			{
+				sleepingCount.fetch_sub(1);
+#ifdef PLATFORM_LINUX
+				syscall(SYS_futex, (uint32_t*)&signal.sleeping, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+				signal.locker.lock();
+				signal.locker.unlock();
+				signal.condition.notify_one();
+#endif // PLATFORM_LINUX
+			}
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		workers.clear();
+	}
+
+	// The worker threads must be stopped before the job queues are destroyed at exit
+	//	(this is declared after them, so it is destroyed first)
+	struct ShutDownAtExit
+	{
+		~ShutDownAtExit()
+		{
+			ShutDown();
+		}
+	} shutdown_at_exit;
+
 	uint32_t GetThreadCount()
 	{
 		return numThreads;
 	}
 
-	void Execute(context& ctx, const std::function<void(wiJobArgs)>& task)
+	void Execute(context& ctx, Priority priority, Task* task)
 	{
 		// Context state is updated:
 		ctx.counter.fetch_add(1);
@@ -120,22 +639,23 @@ namespace wiJobSystem
 		Job job;
 		job.ctx = &ctx;
 		job.task = task;
+		job.task->refCount.store(1);
 		job.groupID = 0;
 		job.groupJobOffset = 0;
 		job.groupJobEnd = 1;
 		job.sharedmemory_size = 0;
 
-		// Try to push a new job until it is pushed successfully:
-		while (!jobQueue.push_back(job)) { wakeCondition.notify_all(); work(); }
+		priorityQueues[int(priority)].submit(job);
 
-		// Wake any one thread that might be sleeping:
-		wakeCondition.notify_one();
+		// Wake one thread that might be sleeping:
+		wake_workers(1);
 	}
 
-	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, const std::function<void(wiJobArgs)>& task, size_t sharedmemory_size)
+	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, Task* task, size_t sharedmemory_size)
 	{
 		if (jobCount == 0 || groupSize == 0)
 		{
+			FreeTask(task);
 			return;
 		}
 
@@ -147,8 +667,10 @@ namespace wiJobSystem
 		Job job;
 		job.ctx = &ctx;
 		job.task = task;
+		job.task->refCount.store(groupCount);
 		job.sharedmemory_size = (uint32_t)sharedmemory_size;
 
+		PriorityQueue& queue = priorityQueues[int(ctx.priority)];
 		for (uint32_t groupID = 0; groupID < groupCount; ++groupID)
 		{
 			// For each group, generate one real job:
@@ -156,12 +678,11 @@ namespace wiJobSystem
 			job.groupJobOffset = groupID * groupSize;
 			job.groupJobEnd = std::min(job.groupJobOffset + groupSize, jobCount);
 
-			// Try to push a new job until it is pushed successfully:
-			while (!jobQueue.push_back(job)) { wakeCondition.notify_all(); work(); }
+			queue.submit(job);
 		}
 
-		// Wake any threads that might be sleeping:
-		wakeCondition.notify_all();
+		// Wake as many threads as there are groups to work on:
+		wake_workers(groupCount);
 	}
 
 	uint32_t DispatchGroupCount(uint32_t jobCount, uint32_t groupSize)
@@ -178,10 +699,84 @@ namespace wiJobSystem
 
 	void Wait(const context& ctx)
 	{
-		// Wake any threads that might be sleeping:
-		wakeCondition.notify_all();
+		// Waiting will also put the current thread to good use by working on an other job if it can
+		//	But it won't start background jobs unless it waits on background work, because those could take long to finish:
+		const Priority lowest_priority = ctx.priority == Priority::Background ? Priority::Background : Priority::Normal;
+		while (IsBusy(ctx)) { work(lowest_priority); }
+	}
 
-		// Waiting will also put the current thread to good use by working on an other job if it can:
-		while (IsBusy(ctx)) { work(); }
+	TaskGraph::NodeID TaskGraph::CreateNode(Priority priority)
+	{
+		NodeID id = (NodeID)nodes.size();
+		if (nodes.size() == nodes.capacity())
+		{
+			CountAllocation();
+		}
+		CountAllocation();
+		nodes.emplace_back(new Node);
+		nodes.back()->ctx.priority = priority;
+		return id;
+	}
+
+	void TaskGraph::AddEdge(NodeID from, NodeID to)
+	{
+		assert(from < nodes.size() && to < nodes.size() && from != to);
+		std::vector<NodeID>& successors = nodes[from]->successors;
+		if (successors.size() == successors.capacity())
+		{
+			CountAllocation();
+		}
+		successors.push_back(to);
+		nodes[to]->dependencyCount++;
+	}
+
+	void TaskGraph::Clear()
+	{
+		for (auto& node : nodes)
+		{
+			if (node->task.destroy != nullptr)
+			{
+				node->task.destroy(node->task.callable);
+			}
+		}
+		nodes.clear();
+	}
+
+	void TaskGraph::Run(context& ctx)
+	{
+		// Only the dependency counters are reset, the graph itself is reused
+		for (auto& node : nodes)
+		{
+			node->pendingDependencies.store(node->dependencyCount);
+		}
+		for (NodeID id = 0; id < (NodeID)nodes.size(); ++id)
+		{
+			if (nodes[id]->dependencyCount == 0)
+			{
+				Launch(ctx, id);
+			}
+		}
+	}
+
+	void TaskGraph::Launch(context& ctx, NodeID id)
+	{
+		Node& node = *nodes[id];
+		Task* task = AllocateTask();
+		task->Bind([this, &ctx, &node](wiJobArgs args) {
+			args.sharedmemory = &node.ctx;
+			node.task.invoke(node.task.callable, args);
+			Wait(node.ctx);
+
+			// Continuation: start every successor whose last dependency was this node
+			//	This is done before this job is finished, so the graph context can't become idle in between
+			for (NodeID successor : node.successors)
+			{
+				if (nodes[successor]->pendingDependencies.fetch_sub(1) == 1)
+				{
+					Launch(ctx, successor);
+				}
+			}
+		});
+		Execute(ctx, node.ctx.priority, task);
 	}
 }
@@ -2,6 +2,12 @@
 
 #include <functional>
 #include <atomic>
+#include <vector>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
 
 struct wiJobArgs
 {
@@ -17,22 +23,80 @@ namespace wiJobSystem
 {
 	void Initialize();
 
+	// Stop and join the worker threads, jobs that are still in the queues will not be executed. This is also done at exit
+	void ShutDown();
+
 	uint32_t GetThreadCount();
 
+	// Jobs with higher priority are always picked up first by idle threads
+	enum class Priority
+	{
+		High,		// latency critical work
+		Normal,		// per-frame work
+		Background,	// long running work that shouldn't hold back the frame (streaming, serialization...). Wait() on a non-background context will not pick these up
+		Count
+	};
+
 	// Defines a state of execution, can be waited on
 	struct context
 	{
 		std::atomic<uint32_t> counter{ 0 };
+		Priority priority = Priority::Normal; // priority of jobs that are added to this context
 	};
 
+	// The job function that is shared by all jobs of the same Execute() or Dispatch() call
+	//	Function objects (lambda captures) that fit into the inline storage don't allocate memory, and the task objects are pooled
+	struct Task
+	{
+		static constexpr size_t inline_storage_size = 128;
+		alignas(std::max_align_t) uint8_t storage[inline_storage_size];
+		void* callable = nullptr;
+		void(*invoke)(void* callable, wiJobArgs args) = nullptr;
+		void(*destroy)(void* callable) = nullptr;
+		std::atomic<uint32_t> refCount{ 0 };
+		Task* next = nullptr; // pool free list
+
+		template<typename F>
+		inline void Bind(F&& func);
+	};
+
+	// Get a task from the pool. It will be returned to the pool automatically when all its jobs are finished
+	Task* AllocateTask();
+
+	// Add a bound task to execute asynchronously with the specified priority
+	void Execute(context& ctx, Priority priority, Task* task);
+
+	// Divide a bound task onto multiple jobs and execute in parallel with the context priority
+	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, Task* task, size_t sharedmemory_size);
+
+	// Total number of heap allocations made by the job system
+	uint32_t GetAllocationCount();
+	void CountAllocation();
+
 	// Add a task to execute asynchronously. Any idle thread will execute this.
-	void Execute(context& ctx, const std::function<void(wiJobArgs)>& task);
+	template<typename F>
+	inline void Execute(context& ctx, F&& task)
+	{
+		Task* bound = AllocateTask();
+		bound->Bind(std::forward<F>(task));
+		Execute(ctx, ctx.priority, bound);
+	}
 
 	// Divide a task onto multiple jobs and execute in parallel.
 	//	jobCount	: how many jobs to generate for this task.
 	//	groupSize	: how many jobs to execute per thread. Jobs inside a group execute serially. It might be worth to increase for small jobs
 	//	task		: receives a wiJobArgs as parameter
-	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, const std::function<void(wiJobArgs)>& task, size_t sharedmemory_size = 0);
+	template<typename F>
+	inline void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, F&& task, size_t sharedmemory_size = 0)
+	{
+		if (jobCount == 0 || groupSize == 0)
+		{
+			return;
+		}
+		Task* bound = AllocateTask();
+		bound->Bind(std::forward<F>(task));
+		Dispatch(ctx, jobCount, groupSize, bound, sharedmemory_size);
+	}
 
 	// Returns the amount of job groups that will be created for a set number of jobs and group size
 	uint32_t DispatchGroupCount(uint32_t jobCount, uint32_t groupSize);
@@ -42,4 +106,78 @@ namespace wiJobSystem
 
 	// Wait until all threads become idle
 	void Wait(const context& ctx);
+
+	// Task graph: a set of nodes with dependencies between them
+	//	A node is started as soon as all of the nodes it depends on are finished, so there is no need for global Wait() barriers
+	//	Adding nodes and edges allocates memory (counted by GetAllocationCount()), so a graph should be built once and run many times
+	class TaskGraph
+	{
+	public:
+		using NodeID = uint32_t;
+
+		TaskGraph() = default;
+		TaskGraph(const TaskGraph&) = delete;
+		TaskGraph& operator=(const TaskGraph&) = delete;
+		~TaskGraph() { Clear(); }
+
+		// Add a node. The task can add more jobs into the context it receives, the node is only finished when all of those jobs are finished
+		//	The task is stored like the job tasks, small function objects don't allocate memory
+		template<typename F>
+		inline NodeID AddNode(F&& task, Priority priority = Priority::Normal);
+
+		// The "to" node will only start after the "from" node is finished
+		void AddEdge(NodeID from, NodeID to);
+
+		// Starts all nodes that don't have dependencies, the rest will start when their dependencies finish. Wait on the context to wait for every node
+		//	The graph must not be modified or destroyed until the context is finished
+		void Run(context& ctx);
+
+		// Remove every node. The graph must not be running
+		void Clear();
+
+		size_t GetNodeCount() const { return nodes.size(); }
+
+	private:
+		struct Node
+		{
+			Task task; // invoked with the node's context as the shared memory argument
+			std::vector<NodeID> successors;
+			uint32_t dependencyCount = 0;
+			std::atomic<uint32_t> pendingDependencies{ 0 };
+			context ctx;
+		};
+		std::vector<std::unique_ptr<Node>> nodes;
+
+		NodeID CreateNode(Priority priority);
+		void Launch(context& ctx, NodeID node);
+	};
+}
+
+template<typename F>
+inline void wiJobSystem::Task::Bind(F&& func)
+{
+	using T = typename std::decay<F>::type;
+	if constexpr (sizeof(T) <= inline_storage_size && alignof(T) <= alignof(std::max_align_t))
+	{
+		callable = new (storage) T(std::forward<F>(func));
+		destroy = [](void* ptr) { ((T*)ptr)->~T(); };
+	}
+	else
+	{
+		// Big function objects fall back to heap allocation:
+		CountAllocation();
+		callable = new T(std::forward<F>(func));
+		destroy = [](void* ptr) { delete (T*)ptr; };
+	}
+	invoke = [](void* ptr, wiJobArgs args) { (*(T*)ptr)(args); };
+}
+
+template<typename F>
+inline wiJobSystem::TaskGraph::NodeID wiJobSystem::TaskGraph::AddNode(F&& task, Priority priority)
+{
+	NodeID id = CreateNode(priority);
+	nodes[id]->task.Bind([task = std::forward<F>(task)](wiJobArgs args) mutable {
+		task(*(context*)args.sharedmemory);
+	});
+	return id;
 }
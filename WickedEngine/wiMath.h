@@ -2,6 +2,11 @@
 #include "CommonInclude.h"
 
 #include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif // _MSC_VER
 
 #define saturate(x) std::min(std::max(x,0.0f),1.0f)
 
@@ -151,6 +156,18 @@ namespace wiMath
 		x |= x >> 16;
 		return ++x;
 	}
+	// Returns the index of the lowest set bit, value must not be zero
+	inline uint32_t FirstBitLow(uint32_t value)
+	{
+		assert(value != 0);
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return (uint32_t)index;
+#else
+		return (uint32_t)__builtin_ctz(value);
+#endif // _MSC_VER
+	}
 
 	// A, B, C: trangle vertices
 	float TriangleArea(const XMVECTOR& A, const XMVECTOR& B, const XMVECTOR& C);
@@ -6,6 +6,7 @@
 #include "wiTimer.h"
 #include "wiTextureHelper.h"
 #include "wiHelper.h"
+#include "wiJobSystem.h"
 
 #include <sstream>
 #include <unordered_map>
@@ -28,6 +29,8 @@ namespace wiProfiler
 	std::atomic<uint32_t> nextQuery{ 0 };
 	uint32_t writtenQueries[arraysize(queryHeap)] = {};
 	int queryheap_idx = 0;
+	uint32_t jobsystem_allocations_last = 0;
+	uint32_t jobsystem_allocations_frame = 0;
 
 	struct Range
 	{
@@ -88,6 +91,10 @@ namespace wiProfiler
 
 		EndRange(cpu_frame);
 
+		const uint32_t jobsystem_allocations = wiJobSystem::GetAllocationCount();
+		jobsystem_allocations_frame = jobsystem_allocations - jobsystem_allocations_last;
+		jobsystem_allocations_last = jobsystem_allocations;
+
 		double gpu_frequency = (double)device->GetTimestampFrequency() / 1000.0;
 
 		device->QueryResolve(&queryHeap[queryheap_idx], 0, nextQuery.load(), cmd);
@@ -233,6 +240,7 @@ namespace wiProfiler
 				ss << x.second.name << ": " << fixed << x.second.time << " ms" << endl;
 			}
 		}
+		ss << "Job System allocations: " << jobsystem_allocations_frame << endl;
 		ss << endl;
 
 		// Print GPU ranges:
@@ -90,6 +90,7 @@ bool ldsSkinningEnabled = true;
 float GameSpeed = 1;
 bool debugLightCulling = false;
 bool occlusionCulling = false;
+bool pipelinePrewarm = false;
 bool temporalAA = false;
 bool temporalAADEBUG = false;
 uint32_t raytraceBounceCount = 2;
@@ -887,6 +888,12 @@ size_t GetShaderDumpCount()
 
 bool LoadShader(SHADERSTAGE stage, Shader& shader, const std::string& filename, SHADERMODEL minshadermodel)
 {
+	if (device->GetShaderFormat() == SHADERFORMAT_NONE)
+	{
+		// The device doesn't execute shaders (GraphicsDevice_Null), so they are not loaded or compiled:
+		return device->CreateShader(stage, nullptr, 0, &shader);
+	}
+
 	std::string shaderbinaryfilename = SHADERPATH + filename;
 
 #ifdef SHADERDUMP_ENABLED
@@ -2584,6 +2591,63 @@ void ReloadShaders()
 	wiEvent::FireEvent(SYSTEM_EVENT_RELOAD_SHADERS, 0);
 }
 
+void PrewarmObjectPipelineStates(RENDERPASS renderPass, bool transparent, const RenderPass* renderpass)
+{
+	std::vector<const PipelineState*> psos;
+	for (int shaderType = 0; shaderType < MaterialComponent::SHADERTYPE_COUNT; ++shaderType)
+	{
+		for (int blendMode = 0; blendMode < BLENDMODE_COUNT; ++blendMode)
+		{
+			if ((blendMode != BLENDMODE_OPAQUE) != transparent)
+				continue;
+			for (int doublesided = 0; doublesided < OBJECTRENDERING_DOUBLESIDED_COUNT; ++doublesided)
+			{
+				for (int tessellation = 0; tessellation < OBJECTRENDERING_TESSELLATION_COUNT; ++tessellation)
+				{
+					if (tessellation && !(GetTessellationEnabled() && device->CheckCapability(GRAPHICSDEVICE_CAPABILITY_TESSELLATION)))
+						continue;
+					for (int alphatest = 0; alphatest < OBJECTRENDERING_ALPHATEST_COUNT; ++alphatest)
+					{
+						psos.push_back(&PSO_object[shaderType][renderPass][blendMode][doublesided][tessellation][alphatest]);
+					}
+				}
+			}
+		}
+	}
+	if (!transparent)
+	{
+		psos.push_back(&PSO_object_terrain[renderPass]);
+	}
+
+	// The vertex buffer strides that RenderMeshes() binds:
+	uint32_t instanceDataSize = sizeof(Instance);
+	switch (instanceTypes[renderPass])
+	{
+	default:
+	case INSTANCETYPE_MATRIX_USERDATA:
+		break;
+	case INSTANCETYPE_MATRIX_USERDATA_ATLAS:
+		instanceDataSize += sizeof(InstanceAtlas);
+		break;
+	case INSTANCETYPE_MATRIX_USERDATA_MATRIXPREV:
+		instanceDataSize += sizeof(InstancePrev);
+		break;
+	}
+	const uint32_t strides[] = {
+		sizeof(MeshComponent::Vertex_POS),
+		sizeof(MeshComponent::Vertex_POS),
+		sizeof(MeshComponent::Vertex_TEX),
+		sizeof(MeshComponent::Vertex_TEX),
+		sizeof(MeshComponent::Vertex_TEX),
+		sizeof(MeshComponent::Vertex_COL),
+		sizeof(MeshComponent::Vertex_TAN),
+		instanceDataSize
+	};
+	static_assert(arraysize(strides) == INPUT_SLOT_COUNT, "This layout must conform to OBJECT_VERTEXINPUT enum!");
+
+	device->PrewarmPipelineStates(psos.data(), (uint32_t)psos.size(), renderpass, strides, arraysize(strides));
+}
+
 void Initialize()
 {
 	SetUpStates();
@@ -3343,6 +3407,188 @@ void ProcessDeferredMipGenRequests(CommandList cmd)
 	deferredMIPGenLock.unlock();
 }
 
+// Calls func(objectIndex) for every object whose bounding box is possibly inside the frustum
+//	The structure of arrays bounding boxes of the scene are culled in batches, objects created after the last scene update are checked one by one
+template<typename F>
+inline void ForEachObjectInFrustum(const Scene& scene, const Frustum& frustum, F&& func)
+{
+	const AABB_SoA& boxes = scene.aabb_objects_soa;
+	const uint32_t count = std::min(boxes.count, (uint32_t)scene.aabb_objects.GetCount());
+	const uint32_t blockCount = boxes.capacity / 32;
+	uint32_t visibility_mask[64];
+	for (uint32_t firstBlock = 0; firstBlock < blockCount; firstBlock += arraysize(visibility_mask))
+	{
+		const uint32_t batchBlockCount = std::min(blockCount - firstBlock, (uint32_t)arraysize(visibility_mask));
+		frustum.CheckBoxesFast(boxes, visibility_mask, firstBlock, batchBlockCount);
+		for (uint32_t block = 0; block < batchBlockCount; ++block)
+		{
+			uint32_t mask = visibility_mask[block];
+			while (mask != 0)
+			{
+				const uint32_t index = (firstBlock + block) * 32 + wiMath::FirstBitLow(mask);
+				mask &= mask - 1;
+				if (index < count)
+				{
+					func(index);
+				}
+			}
+		}
+	}
+	for (uint32_t index = count; index < (uint32_t)scene.aabb_objects.GetCount(); ++index)
+	{
+		if (frustum.CheckBoxFast(scene.aabb_objects[index]))
+		{
+			func(index);
+		}
+	}
+}
+
+// Culls the shadow casters of the visible lights that will render shadow maps (the light selection must match DrawShadowmaps())
+//	Every shadow camera is culled by a separate job, unless the result from the previous frame is still valid
+inline void CullShadowCasters(Visibility& vis, wiJobSystem::context& ctx)
+{
+	static_assert(CASCADE_COUNT <= Visibility::ShadowCasters::max_camera_count, "Not enough shadow caster lists for the cascades!");
+	const Scene& scene = *vis.scene;
+	const uint64_t update_frame = scene.object_update_frame;
+	const bool all_changed = scene.all_object_bounds_changed.load();
+
+	uint32_t shadowCounter_2D = SHADOWRES_2D > 0 ? 0 : SHADOWCOUNT_2D;
+	uint32_t shadowCounter_Cube = SHADOWRES_CUBE > 0 ? 0 : SHADOWCOUNT_CUBE;
+
+	for (const auto& visibleLight : vis.visibleLights)
+	{
+		if (shadowCounter_2D >= SHADOWCOUNT_2D && shadowCounter_Cube >= SHADOWCOUNT_CUBE)
+		{
+			break;
+		}
+
+		const LightComponent& light = scene.lights[visibleLight.index];
+		if (!light.IsCastingShadow() || light.IsStatic())
+		{
+			continue;
+		}
+
+		Visibility::ShadowCasters shadow;
+		switch (light.GetType())
+		{
+		case LightComponent::DIRECTIONAL:
+		{
+			if (shadowCounter_2D >= SHADOWCOUNT_2D - CASCADE_COUNT + 1)
+				continue;
+			shadowCounter_2D += CASCADE_COUNT;
+
+			std::array<SHCAM, CASCADE_COUNT> shcams;
+			CreateDirLightShadowCams(light, *vis.camera, shcams);
+			shadow.camera_count = CASCADE_COUNT;
+			for (uint32_t cascade = 0; cascade < CASCADE_COUNT; ++cascade)
+			{
+				shadow.frusta[cascade] = shcams[cascade].frustum;
+			}
+		}
+		break;
+		case LightComponent::SPOT:
+		{
+			if (shadowCounter_2D >= SHADOWCOUNT_2D)
+				continue;
+			shadowCounter_2D += 1;
+
+			SHCAM shcam;
+			CreateSpotLightShadowCam(light, shcam);
+			shadow.camera_count = 1;
+			shadow.frusta[0] = shcam.frustum;
+		}
+		break;
+		case LightComponent::POINT:
+		{
+			if (shadowCounter_Cube >= SHADOWCOUNT_CUBE)
+				continue;
+			shadowCounter_Cube += 1;
+
+			shadow.camera_count = 1;
+			shadow.sphere = SPHERE(light.position, light.GetRange());
+		}
+		break;
+		default:
+			continue;
+		}
+
+		Visibility::ShadowCasters& casters = vis.shadowCasters[scene.lights.GetEntity(visibleLight.index)];
+
+		// The previous result can be reused if the shadow cameras are the same, and no object moved inside them since the last frame:
+		bool valid =
+			casters.camera_count == shadow.camera_count &&
+			casters.object_count == (uint32_t)scene.aabb_objects.GetCount() &&
+			std::memcmp(casters.frusta, shadow.frusta, sizeof(shadow.frusta)) == 0 &&
+			std::memcmp(&casters.sphere, &shadow.sphere, sizeof(shadow.sphere)) == 0;
+		if (valid && casters.update_frame != update_frame)
+		{
+			valid = !all_changed && casters.update_frame + 1 == update_frame;
+			for (size_t i = 0; i < scene.changed_object_bounds.size() && valid; ++i)
+			{
+				const AABB& aabb = scene.changed_object_bounds[i];
+				if (light.GetType() == LightComponent::POINT)
+				{
+					valid = !shadow.sphere.intersects(aabb);
+				}
+				else
+				{
+					for (uint32_t camera = 0; camera < shadow.camera_count && valid; ++camera)
+					{
+						valid = !shadow.frusta[camera].CheckBoxFast(aabb);
+					}
+				}
+			}
+		}
+		casters.update_frame = update_frame;
+		if (valid)
+		{
+			continue;
+		}
+
+		casters.camera_count = shadow.camera_count;
+		casters.object_count = (uint32_t)scene.aabb_objects.GetCount();
+		std::memcpy(casters.frusta, shadow.frusta, sizeof(shadow.frusta));
+		casters.sphere = shadow.sphere;
+		for (uint32_t camera = 0; camera < casters.camera_count; ++camera)
+		{
+			const bool point = light.GetType() == LightComponent::POINT;
+			wiJobSystem::Execute(ctx, [&scene, &casters, camera, point](wiJobArgs args) {
+				std::vector<uint32_t>& objects = casters.objects[camera];
+				objects.clear();
+				if (point)
+				{
+					for (uint32_t i = 0; i < (uint32_t)scene.aabb_objects.GetCount(); ++i)
+					{
+						if (casters.sphere.intersects(scene.aabb_objects[i]))
+						{
+							objects.push_back(i);
+						}
+					}
+				}
+				else
+				{
+					ForEachObjectInFrustum(scene, casters.frusta[camera], [&](uint32_t i) {
+						objects.push_back(i);
+					});
+				}
+			});
+		}
+	}
+
+	// Lights that are not rendering shadows now will be culled again when they do:
+	for (auto it = vis.shadowCasters.begin(); it != vis.shadowCasters.end();)
+	{
+		if (it->second.update_frame != update_frame)
+		{
+			it = vis.shadowCasters.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
 void UpdateVisibility(Visibility& vis)
 {
 	// Perform parallel frustum culling and obtain closest reflector:
@@ -3359,6 +3605,7 @@ void UpdateVisibility(Visibility& vis)
 	//	more coherent (less randomly organized compared to original order)
 	static const uint32_t groupSize = 64;
 	static const size_t sharedmemory_size = (groupSize + 1) * sizeof(uint32_t); // list + counter per group
+	uint32_t object_subtrees[64]; // bounding volume hierarchy subtrees that are culled by separate jobs
 
 	// Initialize visible indices:
 	vis.Clear();
@@ -3426,63 +3673,114 @@ void UpdateVisibility(Visibility& vis)
 	{
 		// Cull objects:
 		vis.visibleObjects.resize(vis.scene->aabb_objects.GetCount());
-		wiJobSystem::Dispatch(ctx, (uint32_t)vis.scene->aabb_objects.GetCount(), groupSize, [&](wiJobArgs args) {
 
-			// Setup stream compaction:
-			uint32_t& group_count = *(uint32_t*)args.sharedmemory;
-			uint32_t* group_list = (uint32_t*)args.sharedmemory + 1;
-			if (args.isFirstJobInGroup)
+		// Returns true if the object is visible, the frustum check can be skipped when its bounding volume hierarchy node was fully inside:
+		auto cull_object = [&vis](uint32_t index, bool check_frustum) {
+			Entity entity = vis.scene->aabb_objects.GetEntity(index);
+			const LayerComponent* layer = vis.scene->layers.GetComponent(entity);
+			if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
 			{
-				group_count = 0; // first thread initializes local counter
+				return false;
 			}
-
-			Entity entity = vis.scene->aabb_objects.GetEntity(args.jobIndex);
-			const LayerComponent* layer = vis.scene->layers.GetComponent(entity);
-			if (layer == nullptr || (layer->GetLayerMask() & vis.layerMask))
+			const AABB& aabb = vis.scene->aabb_objects[index];
+			if (check_frustum ? !vis.frustum.CheckBoxFast(aabb) : aabb._min.x > aabb._max.x)
 			{
-				const AABB& aabb = vis.scene->aabb_objects[args.jobIndex];
+				return false; // note: empty boxes don't enlarge the hierarchy nodes, so they must be rejected even inside
+			}
 
-				if (vis.frustum.CheckBoxFast(aabb))
+			if (vis.flags & Visibility::ALLOW_REQUEST_REFLECTION)
+			{
+				const ObjectComponent& object = vis.scene->objects[index];
+				if (object.IsRequestPlanarReflection())
 				{
-					// Local stream compaction:
-					group_list[group_count++] = args.jobIndex;
+					float dist = wiMath::DistanceEstimated(vis.camera->Eye, object.center);
+					vis.locker.lock();
+					if (dist < vis.closestRefPlane)
+					{
+						vis.closestRefPlane = dist;
+						const TransformComponent& transform = vis.scene->transforms[object.transform_index];
+						XMVECTOR P = transform.GetPositionV();
+						XMVECTOR N = XMVectorSet(0, 1, 0, 0);
+						N = XMVector3TransformNormal(N, XMLoadFloat4x4(&transform.world));
+						XMVECTOR _refPlane = XMPlaneFromPointNormal(P, N);
+						XMStoreFloat4(&vis.reflectionPlane, _refPlane);
+
+						vis.planar_reflection_visible = true;
+					}
+					vis.locker.unlock();
+				}
+			}
+			return true;
+		};
+
+		const wiBVH& bvh = vis.scene->object_bvh;
+		if (bvh.IsValid() && vis.scene->object_bvh_generation == vis.scene->aabb_objects.GetGeneration())
+		{
+			// Hierarchical culling: the bounding volume hierarchy is split into subtrees, and each subtree is traversed by a separate job
+			//	Fully outside subtrees are rejected and fully inside subtrees are accepted without checking every object in them
+			const uint32_t subtreeCount = bvh.GetSubtrees(object_subtrees, std::min((uint32_t)arraysize(object_subtrees), (wiJobSystem::GetThreadCount() + 1) * 4));
+			wiJobSystem::Dispatch(ctx, subtreeCount, 1, [&](wiJobArgs args) {
+
+				// Local stream compaction, flushed to the global list when full:
+				uint32_t group_list[groupSize];
+				uint32_t group_count = 0;
+				auto flush = [&] {
+					uint32_t prev_count = vis.object_counter.fetch_add(group_count);
+					for (uint32_t i = 0; i < group_count; ++i)
+					{
+						vis.visibleObjects[prev_count + i] = group_list[i];
+					}
+					group_count = 0;
+				};
 
-					if (vis.flags & Visibility::ALLOW_REQUEST_REFLECTION)
+				bvh.Cull(vis.frustum, [&](uint32_t index, bool fully_inside) {
+					if (cull_object(index, !fully_inside))
 					{
-						const ObjectComponent& object = vis.scene->objects[args.jobIndex];
-						if (object.IsRequestPlanarReflection())
+						group_list[group_count++] = index;
+						if (group_count == groupSize)
 						{
-							float dist = wiMath::DistanceEstimated(vis.camera->Eye, object.center);
-							vis.locker.lock();
-							if (dist < vis.closestRefPlane)
-							{
-								vis.closestRefPlane = dist;
-								const TransformComponent& transform = vis.scene->transforms[object.transform_index];
-								XMVECTOR P = transform.GetPositionV();
-								XMVECTOR N = XMVectorSet(0, 1, 0, 0);
-								N = XMVector3TransformNormal(N, XMLoadFloat4x4(&transform.world));
-								XMVECTOR _refPlane = XMPlaneFromPointNormal(P, N);
-								XMStoreFloat4(&vis.reflectionPlane, _refPlane);
-
-								vis.planar_reflection_visible = true;
-							}
-							vis.locker.unlock();
+							flush();
 						}
 					}
+				}, object_subtrees[args.jobIndex]);
+
+				if (group_count > 0)
+				{
+					flush();
 				}
-			}
+			});
+		}
+		else
+		{
+			// The bounding volume hierarchy is not up to date (objects were added or removed since the last scene update), so check every object:
+			wiJobSystem::Dispatch(ctx, (uint32_t)vis.scene->aabb_objects.GetCount(), groupSize, [&](wiJobArgs args) {
 
-			// Global stream compaction:
-			if (args.isLastJobInGroup && group_count > 0)
-			{
-				uint32_t prev_count = vis.object_counter.fetch_add(group_count);
-				for (uint32_t i = 0; i < group_count; ++i)
+				// Setup stream compaction:
+				uint32_t& group_count = *(uint32_t*)args.sharedmemory;
+				uint32_t* group_list = (uint32_t*)args.sharedmemory + 1;
+				if (args.isFirstJobInGroup)
 				{
-					vis.visibleObjects[prev_count + i] = group_list[i];
+					group_count = 0; // first thread initializes local counter
 				}
-			}
 
-			}, sharedmemory_size);
+				if (cull_object(args.jobIndex, true))
+				{
+					// Local stream compaction:
+					group_list[group_count++] = args.jobIndex;
+				}
+
+				// Global stream compaction:
+				if (args.isLastJobInGroup && group_count > 0)
+				{
+					uint32_t prev_count = vis.object_counter.fetch_add(group_count);
+					for (uint32_t i = 0; i < group_count; ++i)
+					{
+						vis.visibleObjects[prev_count + i] = group_list[i];
+					}
+				}
+
+				}, sharedmemory_size);
+		}
 	}
 
 	if (vis.flags & Visibility::ALLOW_DECALS)
@@ -3589,6 +3887,11 @@ void UpdateVisibility(Visibility& vis)
 		vis.visibleLights.resize((size_t)vis.light_counter.load());
 		// Sort lights based on distance so that closer lights will receive shadow map priority:
 		std::sort(vis.visibleLights.begin(), vis.visibleLights.end());
+
+		if (vis.flags & Visibility::ALLOW_SHADOW_CASTERS)
+		{
+			CullShadowCasters(vis, ctx);
+		}
 	}
 
 	wiJobSystem::Wait(ctx);
@@ -3597,6 +3900,43 @@ void UpdateVisibility(Visibility& vis)
 	vis.visibleObjects.resize((size_t)vis.object_counter.load());
 	vis.visibleDecals.resize((size_t)vis.decal_counter.load());
 
+	if (wiResourceManager::IsTextureStreamingEnabled() && !vis.visibleObjects.empty())
+	{
+		// Texture streaming feedback: the material textures of visible objects request their on-screen resolution
+		//	The object's projected size is used as an estimate of the screen space size of its textures, multiplied by the texture tiling
+		const float screen_scale = vis.camera->height / std::tan(vis.camera->fov * 0.5f);
+		wiJobSystem::Dispatch(ctx, (uint32_t)vis.visibleObjects.size(), groupSize, [&](wiJobArgs args) {
+			const uint32_t index = vis.visibleObjects[args.jobIndex];
+			const ObjectComponent& object = vis.scene->objects[index];
+			const MeshComponent* mesh = vis.scene->meshes.GetComponent(object.meshID);
+			if (mesh == nullptr)
+			{
+				return;
+			}
+			const float radius = vis.scene->aabb_objects[index].getRadius();
+			const float distance = std::max(wiMath::Distance(vis.camera->Eye, object.center) - radius, vis.camera->zNearP);
+			const float screen_size = radius / distance * screen_scale;
+			for (auto& subset : mesh->subsets)
+			{
+				const MaterialComponent* material = vis.scene->materials.GetComponent(subset.materialID);
+				if (material == nullptr)
+				{
+					continue;
+				}
+				const float tiling = std::max(std::abs(material->texMulAdd.x), std::abs(material->texMulAdd.y));
+				const uint32_t resolution = (uint32_t)std::min(screen_size * tiling, 65536.0f);
+				for (auto& x : material->textures)
+				{
+					if (x.resource != nullptr && (x.resource->flags & wiResourceManager::IMPORT_STREAMING))
+					{
+						x.resource->RequestStreamingResolution(resolution);
+					}
+				}
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
 	if ((vis.flags & Visibility::ALLOW_REQUEST_REFLECTION) && vis.scene->weather.IsOceanEnabled())
 	{
 		// Ocean will override any current reflectors
@@ -4991,6 +5331,14 @@ void DrawShadowmaps(
 				continue;
 			}
 
+			// Shadow casters that were culled in UpdateVisibility() for this light (if they are not available, they will be culled here):
+			const Visibility::ShadowCasters* casters = nullptr;
+			auto it = vis.shadowCasters.find(vis.scene->lights.GetEntity(lightIndex));
+			if (it != vis.shadowCasters.end() && it->second.update_frame == vis.scene->object_update_frame)
+			{
+				casters = &it->second;
+			}
+
 			switch (light.GetType())
 			{
 			case LightComponent::DIRECTIONAL:
@@ -5007,32 +5355,38 @@ void DrawShadowmaps(
 				{
 					RenderQueue renderQueue;
 					bool transparentShadowsRequested = false;
-					for (size_t i = 0; i < vis.scene->aabb_objects.GetCount(); ++i)
-					{
-						const AABB& aabb = vis.scene->aabb_objects[i];
-						if (shcams[cascade].frustum.CheckBoxFast(aabb))
+					auto add_caster = [&](uint32_t i) {
+						const ObjectComponent& object = vis.scene->objects[i];
+						if (object.IsRenderable() && cascade >= object.cascadeMask && object.IsCastingShadow())
 						{
-							const ObjectComponent& object = vis.scene->objects[i];
-							if (object.IsRenderable() && cascade >= object.cascadeMask && object.IsCastingShadow())
+							Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
+							const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
+							if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
 							{
-								Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
-								const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
-								if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
-								{
-									continue;
-								}
+								return;
+							}
 
-								RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
-								size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
-								batch->Create(meshIndex, i, 0);
-								renderQueue.add(batch);
+							RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
+							size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
+							batch->Create(meshIndex, i, 0);
+							renderQueue.add(batch);
 
-								if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
-								{
-									transparentShadowsRequested = true;
-								}
+							if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
+							{
+								transparentShadowsRequested = true;
 							}
 						}
+					};
+					if (casters != nullptr && std::memcmp(&casters->frusta[cascade], &shcams[cascade].frustum, sizeof(Frustum)) == 0)
+					{
+						for (uint32_t i : casters->objects[cascade])
+						{
+							add_caster(i);
+						}
+					}
+					else
+					{
+						ForEachObjectInFrustum(*vis.scene, shcams[cascade].frustum, add_caster);
 					}
 					if (!renderQueue.empty())
 					{
@@ -5077,32 +5431,38 @@ void DrawShadowmaps(
 
 				RenderQueue renderQueue;
 				bool transparentShadowsRequested = false;
-				for (size_t i = 0; i < vis.scene->aabb_objects.GetCount(); ++i)
-				{
-					const AABB& aabb = vis.scene->aabb_objects[i];
-					if (shcam.frustum.CheckBoxFast(aabb))
+				auto add_caster = [&](uint32_t i) {
+					const ObjectComponent& object = vis.scene->objects[i];
+					if (object.IsRenderable() && object.IsCastingShadow())
 					{
-						const ObjectComponent& object = vis.scene->objects[i];
-						if (object.IsRenderable() && object.IsCastingShadow())
+						Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
+						const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
+						if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
 						{
-							Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
-							const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
-							if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
-							{
-								continue;
-							}
+							return;
+						}
 
-							RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
-							size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
-							batch->Create(meshIndex, i, 0);
-							renderQueue.add(batch);
+						RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
+						size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
+						batch->Create(meshIndex, i, 0);
+						renderQueue.add(batch);
 
-							if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
-							{
-								transparentShadowsRequested = true;
-							}
+						if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
+						{
+							transparentShadowsRequested = true;
 						}
 					}
+				};
+				if (casters != nullptr && std::memcmp(&casters->frusta[0], &shcam.frustum, sizeof(Frustum)) == 0)
+				{
+					for (uint32_t i : casters->objects[0])
+					{
+						add_caster(i);
+					}
+				}
+				else
+				{
+					ForEachObjectInFrustum(*vis.scene, shcam.frustum, add_caster);
 				}
 				if (!renderQueue.empty())
 				{
@@ -5143,30 +5503,42 @@ void DrawShadowmaps(
 
 				RenderQueue renderQueue;
 				bool transparentShadowsRequested = false;
-				for (size_t i = 0; i < vis.scene->aabb_objects.GetCount(); ++i)
-				{
-					const AABB& aabb = vis.scene->aabb_objects[i];
-					if (boundingsphere.intersects(aabb))
+				auto add_caster = [&](uint32_t i) {
+					const ObjectComponent& object = vis.scene->objects[i];
+					if (object.IsRenderable() && object.IsCastingShadow())
 					{
-						const ObjectComponent& object = vis.scene->objects[i];
-						if (object.IsRenderable() && object.IsCastingShadow())
+						Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
+						const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
+						if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
 						{
-							Entity cullable_entity = vis.scene->aabb_objects.GetEntity(i);
-							const LayerComponent* layer = vis.scene->layers.GetComponent(cullable_entity);
-							if (layer != nullptr && !(layer->GetLayerMask() & vis.layerMask))
-							{
-								continue;
-							}
+							return;
+						}
 
-							RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
-							size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
-							batch->Create(meshIndex, i, 0);
-							renderQueue.add(batch);
+						RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
+						size_t meshIndex = vis.scene->meshes.GetIndex(object.meshID);
+						batch->Create(meshIndex, i, 0);
+						renderQueue.add(batch);
 
-							if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
-							{
-								transparentShadowsRequested = true;
-							}
+						if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
+						{
+							transparentShadowsRequested = true;
+						}
+					}
+				};
+				if (casters != nullptr)
+				{
+					for (uint32_t i : casters->objects[0])
+					{
+						add_caster(i);
+					}
+				}
+				else
+				{
+					for (uint32_t i = 0; i < (uint32_t)vis.scene->aabb_objects.GetCount(); ++i)
+					{
+						if (boundingsphere.intersects(vis.scene->aabb_objects[i]))
+						{
+							add_caster(i);
 						}
 					}
 				}
@@ -12078,6 +12450,8 @@ void SetOcclusionCullingEnabled(bool value)
 	occlusionCulling = value;
 }
 bool GetOcclusionCullingEnabled() { return occlusionCulling; }
+void SetPipelinePrewarmEnabled(bool value) { pipelinePrewarm = value; }
+bool GetPipelinePrewarmEnabled() { return pipelinePrewarm; }
 void SetLDSSkinningEnabled(bool enabled) { ldsSkinningEnabled = enabled; }
 bool GetLDSSkinningEnabled() { return ldsSkinningEnabled; }
 void SetTemporalAAEnabled(bool enabled) { temporalAA = enabled; }
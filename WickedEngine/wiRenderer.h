@@ -8,6 +8,7 @@
 #include "shaders/ShaderInterop_Renderer.h"
 
 #include <memory>
+#include <unordered_map>
 
 struct RAY;
 struct wiResource;
@@ -60,6 +61,11 @@ namespace wiRenderer
 	void SetShaderSourcePath(const std::string& path);
 	// Reload shaders
 	void ReloadShaders();
+	// Compile the object pipeline states of a render pass ahead of time, so that objects don't stall the frame when they are drawn the first time
+	//	renderPass	: which object pipeline states
+	//	transparent	: selects the transparent blend modes instead of opaque
+	//	renderpass	: the graphics render pass that the objects will be drawn into
+	void PrewarmObjectPipelineStates(RENDERPASS renderPass, bool transparent, const wiGraphics::RenderPass* renderpass);
 	// Returns how many shaders are embedded (if wiShaderDump.h is used)
 	//	wiShaderDump.h can be generated by OfflineShaderCompiler.exe using shaderdump argument
 	size_t GetShaderDumpCount();
@@ -88,6 +94,7 @@ namespace wiRenderer
 			ALLOW_EMITTERS = 1 << 4,
 			ALLOW_HAIRS = 1 << 5,
 			ALLOW_REQUEST_REFLECTION = 1 << 6,
+			ALLOW_SHADOW_CASTERS = 1 << 7, // requires ALLOW_LIGHTS
 
 			ALLOW_EVERYTHING = ~0u
 		};
@@ -111,6 +118,20 @@ namespace wiRenderer
 		};
 		std::vector<VisibleLight> visibleLights;
 
+		// Objects that are inside the shadow cameras of a shadow casting light (the lists also contain objects that don't cast shadows)
+		//	The lists are kept from one frame to the next, and they are only culled again when the shadow cameras changed or an object moved inside them
+		struct ShadowCasters
+		{
+			static const uint32_t max_camera_count = 4;
+			std::vector<uint32_t> objects[max_camera_count]; // object indices for every shadow camera
+			uint32_t camera_count = 0;		// directional lights have a camera for every cascade, spot and point lights have one
+			Frustum frusta[max_camera_count];	// directional and spot light shadow cameras
+			SPHERE sphere;					// point light range
+			uint32_t object_count = 0;		// scene object count at the time of culling
+			uint64_t update_frame = ~0ull;	// scene update frame at the time of last validation
+		};
+		std::unordered_map<wiECS::Entity, ShadowCasters> shadowCasters; // filled when ALLOW_SHADOW_CASTERS is set, for the lights that will render shadow maps
+
 		std::atomic<uint32_t> object_counter;
 		std::atomic<uint32_t> light_counter;
 		std::atomic<uint32_t> decal_counter;
@@ -702,6 +723,9 @@ namespace wiRenderer
 	bool GetVariableRateShadingClassificationDebug();
 	void SetOcclusionCullingEnabled(bool enabled);
 	bool GetOcclusionCullingEnabled();
+	// Render paths will compile their object pipeline states ahead of time when they are loading (if the graphics device supports it)
+	void SetPipelinePrewarmEnabled(bool value);
+	bool GetPipelinePrewarmEnabled();
 	void SetLDSSkinningEnabled(bool enabled);
 	bool GetLDSSkinningEnabled();
 	void SetTemporalAAEnabled(bool enabled);
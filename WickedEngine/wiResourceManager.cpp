@@ -2,20 +2,49 @@
 #include "wiRenderer.h"
 #include "wiHelper.h"
 #include "wiTextureHelper.h"
+#include "wiTextureCooker.h"
+#include "wiEvent.h"
 
 #include "Utility/stb_image.h"
 #include "Utility/tinyddsloader.h"
 
 #include <algorithm>
+#include <deque>
+#include <thread>
 
 using namespace wiGraphics;
 
+const wiGraphics::Texture* wiResource::GetTexture(const wiGraphics::Texture* placeholder) const
+{
+	if (IsReady() && texture.IsValid())
+	{
+		return &texture;
+	}
+	return placeholder;
+}
+
 namespace wiResourceManager
 {
+	struct ResourceEntry
+	{
+		std::weak_ptr<wiResource> weak_resource;
+		std::shared_ptr<wiResource> cached_resource; // keeps the resource alive while it fits into the memory budget
+		uint64_t last_used_frame = 0;
+		bool evicted = false;
+	};
 	std::mutex locker;
-	std::unordered_map<std::string, std::weak_ptr<wiResource>> resources;
+	std::unordered_map<std::string, ResourceEntry> resources;
 	MODE mode = MODE_DISCARD_FILEDATA_AFTER_LOAD;
 
+	// Memory accounting:
+	std::atomic<size_t> texture_memory{ 0 };
+	std::atomic<size_t> filedata_memory{ 0 };
+	std::atomic<size_t> sound_memory{ 0 };
+	std::atomic<size_t> memory_budget{ 0 };
+	uint64_t current_frame = 0;
+	uint32_t evicted_count = 0;
+	uint32_t reloaded_count = 0;
+
 	void SetMode(MODE param)
 	{
 		mode = param;
@@ -36,78 +65,179 @@ namespace wiResourceManager
 		std::make_pair("OGG", wiResource::SOUND),
 	};
 
-	std::shared_ptr<wiResource> Load(const std::string& name, uint32_t flags, const uint8_t* filedata, size_t filesize)
+	// Loading a resource is done in two steps:
+	//	Decode() reads the file and decodes it into memory, this can run on any thread
+	//	Upload() creates the GPU resource from the decoded memory and finishes the resource
+	struct LoadTask
 	{
-		if (mode == MODE_DISCARD_FILEDATA_AFTER_LOAD)
+		std::shared_ptr<wiResource> resource;
+		std::string name;
+		uint32_t flags = EMPTY;
+		wiResource::DATA_TYPE type = wiResource::EMPTY;
+		const uint8_t* filedata = nullptr;	// external file data, or points into filebuffer
+		size_t filesize = 0;
+		std::vector<uint8_t> filebuffer;	// file data that was read from disk
+		bool success = false;
+
+		// Decoded image:
+		TextureDesc desc;
+		std::vector<SubresourceData> InitData;
+		tinyddsloader::DDSFile dds;
+		std::unique_ptr<unsigned char, void(*)(void*)> rgb{ nullptr, stbi_image_free };
+		std::vector<uint32_t> lut;
+		std::vector<uint8_t> pixels;	// downsampled image for streaming
+		size_t upload_size = 0;
+
+		// Texture streaming:
+		wiTextureStreaming::Texture streaming;
+		uint32_t lod = ~0u;				// the most detailed mip level to load (~0u = the least detailed allowed)
+		bool streaming_update = false;	// the resource is loaded, only its texture will be replaced
+
+		// Asynchronous loading:
+		int priority = 0;
+		uint64_t order = 0;
+	};
+
+	// Asynchronous loading state:
+	std::mutex async_locker;
+	std::vector<std::shared_ptr<LoadTask>> async_queue;		// heap of tasks waiting to be decoded
+	std::deque<std::shared_ptr<LoadTask>> async_uploads;	// decoded tasks waiting to be uploaded
+	uint64_t async_order = 0;
+	uint32_t async_loaders = 0;
+	std::atomic<uint32_t> async_pending{ 0 };
+	wiJobSystem::context async_ctx;
+	static constexpr size_t async_upload_budget = 64ull * 1024ull * 1024ull; // bytes that are uploaded at one safe point, to avoid hitches
+
+	// Texture streaming state:
+	bool streaming_enabled = false;
+	wiTextureStreaming::Settings streaming_settings;
+	static constexpr uint32_t streaming_max_requests = 16; // mip level changes that can be started in one frame
+
+	// Heap order: higher priority first, then the order of requests
+	inline bool async_compare(const std::shared_ptr<LoadTask>& a, const std::shared_ptr<LoadTask>& b)
+	{
+		if (a->priority != b->priority)
 		{
-			flags &= ~IMPORT_RETAIN_FILEDATA;
+			return a->priority < b->priority;
 		}
+		return a->order > b->order;
+	}
 
-		locker.lock();
-		std::weak_ptr<wiResource>& weak_resource = resources[name];
-		std::shared_ptr<wiResource> resource = weak_resource.lock();
-
-		if (resource == nullptr)
+	// Fills the streaming description of the full mip chain and returns the lod that will be loaded
+	//	If the texture can't be streamed, the streaming flag is removed and 0 is returned
+	uint32_t SetupStreaming(LoadTask& task)
+	{
+		const TextureDesc& desc = task.desc;
+		if ((task.flags & IMPORT_STREAMING) == 0 || desc.type != TextureDesc::TEXTURE_2D || desc.ArraySize != 1 || desc.MipLevels < 2 || (desc.MiscFlags & RESOURCE_MISC_TEXTURECUBE))
 		{
-			resource = std::make_shared<wiResource>();
-			resources[name] = resource;
-			locker.unlock();
+			task.flags &= ~IMPORT_STREAMING;
+			return 0;
 		}
-		else
+		const GraphicsDevice* device = wiRenderer::GetDevice();
+		task.streaming.width = desc.Width;
+		task.streaming.height = desc.Height;
+		task.streaming.mip_count = desc.MipLevels;
+		task.streaming.block_size = device->IsFormatBlockCompressed(desc.Format) ? 4 : 1;
+		task.streaming.block_bytes = device->GetFormatStride(desc.Format);
+		if (desc.Format == FORMAT_BC1_UNORM || desc.Format == FORMAT_BC1_UNORM_SRGB || desc.Format == FORMAT_BC4_UNORM || desc.Format == FORMAT_BC4_SNORM)
 		{
-			locker.unlock();
-			return resource;
+			task.streaming.block_bytes = 8;
 		}
 
-		if (filedata == nullptr || filesize == 0)
+		locker.lock();
+		const uint32_t max_lod = wiTextureStreaming::GetMaxLOD(task.streaming, streaming_settings);
+		locker.unlock();
+		task.lod = std::min(task.lod, max_lod);
+		task.streaming.resident_lod = task.lod;
+		task.streaming.target_lod = task.lod;
+		return task.lod;
+	}
+
+	// Halves the resolution of an RGBA8 image with a box filter
+	void Downsample(const uint8_t* src, uint32_t& width, uint32_t& height, std::vector<uint8_t>& dst)
+	{
+		const uint32_t dst_width = std::max(1u, width / 2);
+		const uint32_t dst_height = std::max(1u, height / 2);
+		dst.resize(size_t(dst_width) * size_t(dst_height) * 4);
+		for (uint32_t y = 0; y < dst_height; ++y)
 		{
-			if (!wiHelper::FileRead(name, resource->filedata))
+			const uint8_t* row0 = src + size_t(std::min(y * 2, height - 1)) * width * 4;
+			const uint8_t* row1 = src + size_t(std::min(y * 2 + 1, height - 1)) * width * 4;
+			for (uint32_t x = 0; x < dst_width; ++x)
 			{
-				resource.reset();
-				return nullptr;
+				const uint32_t x0 = std::min(x * 2, width - 1) * 4;
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+				uint8_t* texel = dst.data() + (size_t(y) * dst_width + x) * 4;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					texel[c] = uint8_t((uint32_t(row0[x0 + c]) + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
 			}
-			filedata = resource->filedata.data();
-			filesize = resource->filedata.size();
 		}
+		width = dst_width;
+		height = dst_height;
+	}
 
-		std::string ext = wiHelper::toUpper(wiHelper::GetExtensionFromFileName(name));
-		wiResource::DATA_TYPE type;
+	bool Decode(LoadTask& task)
+	{
+		std::string ext = wiHelper::toUpper(wiHelper::GetExtensionFromFileName(task.name));
 
 		// dynamic type selection:
 		{
 			auto it = types.find(ext);
 			if (it != types.end())
 			{
-				type = it->second;
+				task.type = it->second;
 			}
 			else
 			{
-				return nullptr;
+				return false;
+			}
+		}
+
+		if (task.filedata == nullptr || task.filesize == 0)
+		{
+			std::string fileName = task.name;
+			if (task.type == wiResource::IMAGE && ext.compare("DDS") && !(task.flags & IMPORT_COLORGRADINGLUT))
+			{
+				// The cooked texture is loaded instead of the source image if it's not older than the source:
+				if (wiTextureCooker::IsCookedFileUpToDate(task.name))
+				{
+					fileName = wiTextureCooker::GetCookedFileName(task.name);
+				}
 			}
+			if (!wiHelper::FileRead(fileName, task.filebuffer))
+			{
+				return false;
+			}
+			task.filedata = task.filebuffer.data();
+			task.filesize = task.filebuffer.size();
 		}
+		const uint8_t* filedata = task.filedata;
+		const size_t filesize = task.filesize;
 
 		bool success = false;
 
-		switch (type)
+		switch (task.type)
 		{
 		case wiResource::IMAGE:
 		{
-			GraphicsDevice* device = wiRenderer::GetDevice();
-			if (!ext.compare(std::string("DDS")))
+			TextureDesc& desc = task.desc;
+			// DDS is recognized by the file contents, because cooked textures are loaded with the name of the source image:
+			if (filesize >= 4 && std::memcmp(filedata, "DDS ", 4) == 0)
 			{
 				// Load dds
 
-				tinyddsloader::DDSFile dds;
+				tinyddsloader::DDSFile& dds = task.dds;
 				auto result = dds.Load(filedata, filesize);
 
 				if (result == tinyddsloader::Result::Success)
 				{
-					TextureDesc desc;
 					desc.ArraySize = 1;
 					desc.BindFlags = BIND_SHADER_RESOURCE;
 					desc.CPUAccessFlags = 0;
-					desc.Height = dds.GetWidth();
-					desc.Width = dds.GetHeight();
+					desc.Width = dds.GetWidth();
+					desc.Height = dds.GetHeight();
 					desc.Depth = dds.GetDepth();
 					desc.MipLevels = dds.GetMipCount();
 					desc.ArraySize = dds.GetArraySize();
@@ -189,20 +319,6 @@ namespace wiResourceManager
 						break;
 					}
 
-					std::vector<SubresourceData> InitData;
-					for (uint32_t arrayIndex = 0; arrayIndex < desc.ArraySize; ++arrayIndex)
-					{
-						for (uint32_t mip = 0; mip < desc.MipLevels; ++mip)
-						{
-							auto imageData = dds.GetImageData(mip, arrayIndex);
-							SubresourceData subresourceData;
-							subresourceData.pSysMem = imageData->m_mem;
-							subresourceData.SysMemPitch = imageData->m_memPitch;
-							subresourceData.SysMemSlicePitch = imageData->m_memSlicePitch;
-							InitData.push_back(subresourceData);
-						}
-					}
-
 					auto dim = dds.GetTextureDimension();
 					switch (dim)
 					{
@@ -226,8 +342,27 @@ namespace wiResourceManager
 						break;
 					}
 
-					success = device->CreateTexture(&desc, InitData.data(), &resource->texture);
-					device->SetName(&resource->texture, name.c_str());
+					// Streaming textures skip the most detailed mips:
+					const uint32_t lod = SetupStreaming(task);
+					desc.Width = std::max(1u, desc.Width >> lod);
+					desc.Height = std::max(1u, desc.Height >> lod);
+					desc.MipLevels -= lod;
+
+					for (uint32_t arrayIndex = 0; arrayIndex < desc.ArraySize; ++arrayIndex)
+					{
+						for (uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+						{
+							auto imageData = dds.GetImageData(lod + mip, arrayIndex);
+							SubresourceData subresourceData;
+							subresourceData.pSysMem = imageData->m_mem;
+							subresourceData.SysMemPitch = imageData->m_memPitch;
+							subresourceData.SysMemSlicePitch = imageData->m_memSlicePitch;
+							task.InitData.push_back(subresourceData);
+							task.upload_size += size_t(imageData->m_memSlicePitch) * imageData->m_depth;
+						}
+					}
+
+					success = true;
 				}
 				else assert(0); // failed to load DDS
 
@@ -238,16 +373,16 @@ namespace wiResourceManager
 
 				const int channelCount = 4;
 				int width, height, bpp;
-				unsigned char* rgb = stbi_load_from_memory(filedata, (int)filesize, &width, &height, &bpp, channelCount);
+				task.rgb.reset(stbi_load_from_memory(filedata, (int)filesize, &width, &height, &bpp, channelCount));
+				unsigned char* rgb = task.rgb.get();
 
 				if (rgb != nullptr)
 				{
-					TextureDesc desc;
 					desc.Height = uint32_t(height);
 					desc.Width = uint32_t(width);
 					desc.layout = IMAGE_LAYOUT_SHADER_RESOURCE;
 
-					if (flags & IMPORT_COLORGRADINGLUT)
+					if (task.flags & IMPORT_COLORGRADINGLUT)
 					{
 						if (desc.type != TextureDesc::TEXTURE_2D ||
 							desc.Width != 256 ||
@@ -257,7 +392,8 @@ namespace wiResourceManager
 						}
 						else
 						{
-							uint32_t data[16 * 16 * 16];
+							std::vector<uint32_t>& data = task.lut;
+							data.resize(16 * 16 * 16);
 							int pixel = 0;
 							for (int z = 0; z < 16; ++z)
 							{
@@ -270,6 +406,7 @@ namespace wiResourceManager
 									}
 								}
 							}
+							task.rgb.reset();
 
 							desc.type = TextureDesc::TEXTURE_3D;
 							desc.Width = 16;
@@ -278,11 +415,12 @@ namespace wiResourceManager
 							desc.Format = FORMAT_R8G8B8A8_UNORM;
 							desc.BindFlags = BIND_SHADER_RESOURCE;
 							SubresourceData InitData;
-							InitData.pSysMem = data;
+							InitData.pSysMem = data.data();
 							InitData.SysMemPitch = 16 * sizeof(uint32_t);
 							InitData.SysMemSlicePitch = 16 * InitData.SysMemPitch;
-							success = device->CreateTexture(&desc, &InitData, &resource->texture);
-							device->SetName(&resource->texture, name.c_str());
+							task.InitData.push_back(InitData);
+							task.upload_size = data.size() * sizeof(uint32_t);
+							success = true;
 						}
 					}
 					else
@@ -295,76 +433,690 @@ namespace wiResourceManager
 						desc.Usage = USAGE_DEFAULT;
 						desc.layout = IMAGE_LAYOUT_SHADER_RESOURCE;
 
-						uint32_t mipwidth = width;
-						std::vector<SubresourceData> InitData(desc.MipLevels);
-						for (uint32_t mip = 0; mip < desc.MipLevels; ++mip)
+						// Streaming textures are downsampled to the most detailed mip that will be resident, the rest are generated on the GPU:
+						const uint32_t lod = SetupStreaming(task);
+						if (lod > 0)
 						{
-							InitData[mip].pSysMem = rgb; // attention! we don't fill the mips here correctly, just always point to the mip0 data by default. Mip levels will be created using compute shader when needed!
-							InitData[mip].SysMemPitch = static_cast<uint32_t>(mipwidth * channelCount);
-							mipwidth = std::max(1u, mipwidth / 2);
+							std::vector<uint8_t> temp;
+							uint32_t w = desc.Width;
+							uint32_t h = desc.Height;
+							for (uint32_t i = 0; i < lod; ++i)
+							{
+								Downsample(i == 0 ? rgb : task.pixels.data(), w, h, temp);
+								std::swap(temp, task.pixels);
+							}
+							task.rgb.reset();
+							rgb = task.pixels.data();
+							width = int(w);
+							height = int(h);
+							desc.Width = w;
+							desc.Height = h;
+							desc.MipLevels -= lod;
 						}
 
-						success = device->CreateTexture(&desc, InitData.data(), &resource->texture);
-						device->SetName(&resource->texture, name.c_str());
-
-						for (uint32_t i = 0; i < resource->texture.desc.MipLevels; ++i)
+						uint32_t mipwidth = width;
+						task.InitData.resize(desc.MipLevels);
+						for (uint32_t mip = 0; mip < desc.MipLevels; ++mip)
 						{
-							int subresource_index;
-							subresource_index = device->CreateSubresource(&resource->texture, SRV, 0, 1, i, 1);
-							assert(subresource_index == i);
-							subresource_index = device->CreateSubresource(&resource->texture, UAV, 0, 1, i, 1);
-							assert(subresource_index == i);
+							task.InitData[mip].pSysMem = rgb; // attention! we don't fill the mips here correctly, just always point to the mip0 data by default. Mip levels will be created using compute shader when needed!
+							task.InitData[mip].SysMemPitch = static_cast<uint32_t>(mipwidth * channelCount);
+							mipwidth = std::max(1u, mipwidth / 2);
 						}
+						task.upload_size = size_t(width) * size_t(height) * channelCount;
+						success = true;
 					}
 				}
-
-				stbi_image_free(rgb);
 			}
 		}
 		break;
 		case wiResource::SOUND:
 		{
-			success = wiAudio::CreateSound(filedata, filesize, &resource->sound);
+			success = wiAudio::CreateSound(filedata, filesize, &task.resource->sound);
 		}
 		break;
 		};
 
-		if (success)
+		return success;
+	}
+
+	// Texture memory size in bytes, including every mip level and array slice
+	size_t ComputeTextureMemorySize(const TextureDesc& desc)
+	{
+		const GraphicsDevice* device = wiRenderer::GetDevice();
+		const bool block_compressed = device->IsFormatBlockCompressed(desc.Format);
+		size_t stride = device->GetFormatStride(desc.Format);
+		if (desc.Format == FORMAT_BC1_UNORM || desc.Format == FORMAT_BC1_UNORM_SRGB || desc.Format == FORMAT_BC4_UNORM || desc.Format == FORMAT_BC4_SNORM)
 		{
-			resource->type = type;
-			resource->flags = flags;
+			stride = 8; // 64 bit blocks
+		}
 
-			if (resource->filedata.empty() && (flags & IMPORT_RETAIN_FILEDATA))
+		size_t size = 0;
+		const uint32_t mips = std::max(1u, desc.MipLevels);
+		for (uint32_t mip = 0; mip < mips; ++mip)
+		{
+			size_t width = std::max(1u, desc.Width >> mip);
+			size_t height = std::max(1u, desc.Height >> mip);
+			const size_t depth = desc.type == TextureDesc::TEXTURE_3D ? std::max(1u, desc.Depth >> mip) : 1;
+			if (block_compressed)
 			{
-				// resource was loaded with external filedata, and we want to retain filedata
-				resource->filedata.resize(filesize);
-				std::memcpy(resource->filedata.data(), filedata, filesize);
+				width = (width + 3) / 4;
+				height = (height + 3) / 4;
 			}
-			else if (!resource->filedata.empty() && (flags & IMPORT_RETAIN_FILEDATA) == 0)
+			size += width * height * depth * stride;
+		}
+		return size * std::max(1u, desc.ArraySize);
+	}
+
+	void Upload(LoadTask& task)
+	{
+		wiResource& resource = *task.resource;
+
+		Texture texture;
+		if (task.success && task.type == wiResource::IMAGE)
+		{
+			GraphicsDevice* device = wiRenderer::GetDevice();
+			task.success = device->CreateTexture(&task.desc, task.InitData.data(), &texture);
+			device->SetName(&texture, task.name.c_str());
+
+			if (task.success && (task.desc.BindFlags & BIND_UNORDERED_ACCESS))
+			{
+				for (uint32_t i = 0; i < texture.desc.MipLevels; ++i)
+				{
+					int subresource_index;
+					subresource_index = device->CreateSubresource(&texture, SRV, 0, 1, i, 1);
+					assert(subresource_index == i);
+					subresource_index = device->CreateSubresource(&texture, UAV, 0, 1, i, 1);
+					assert(subresource_index == i);
+				}
+			}
+		}
+
+		if (task.streaming_update)
+		{
+			// Streaming only replaces the texture of a loaded resource with different mip levels resident:
+			if (task.success)
+			{
+				texture_memory.fetch_sub(resource.texture_memory);
+				resource.texture = texture;
+				resource.texture_memory = ComputeTextureMemorySize(resource.texture.desc);
+				texture_memory.fetch_add(resource.texture_memory);
+				resource.streaming.resident_lod = task.lod;
+				resource.texture_version.fetch_add(1);
+
+				if (resource.texture.desc.MipLevels > 1 && resource.texture.desc.BindFlags & BIND_UNORDERED_ACCESS)
+				{
+					wiRenderer::AddDeferredMIPGen(task.resource, true);
+				}
+			}
+			else
+			{
+				// The file can't be loaded again, so the texture will not be streamed any more:
+				resource.flags &= ~IMPORT_STREAMING;
+			}
+			resource.streaming_in_progress = false;
+		}
+		else if (task.success)
+		{
+			resource.texture = texture;
+			resource.streaming = task.streaming;
+			resource.type = task.type;
+			resource.flags = task.flags;
+
+			if (task.flags & IMPORT_RETAIN_FILEDATA)
+			{
+				if (task.filebuffer.empty())
+				{
+					// resource was loaded with external filedata, and we want to retain filedata
+					resource.filedata.resize(task.filesize);
+					std::memcpy(resource.filedata.data(), task.filedata, task.filesize);
+				}
+				else
+				{
+					// resource was loaded using file name, the file data is kept
+					resource.filedata = std::move(task.filebuffer);
+				}
+			}
+
+			if (task.type == wiResource::IMAGE && resource.texture.desc.MipLevels > 1 && resource.texture.desc.BindFlags & BIND_UNORDERED_ACCESS)
 			{
-				// resource was loaded using file name, and we want to discard filedata
-				resource->filedata.clear();
+				wiRenderer::AddDeferredMIPGen(task.resource, true);
+			}
+
+			// Memory accounting:
+			if (task.type == wiResource::IMAGE)
+			{
+				resource.texture_memory = ComputeTextureMemorySize(resource.texture.desc);
+				texture_memory.fetch_add(resource.texture_memory);
+			}
+			else if (task.type == wiResource::SOUND)
+			{
+				resource.sound_memory = wiAudio::GetSoundMemorySize(&resource.sound);
+				sound_memory.fetch_add(resource.sound_memory);
+			}
+			resource.filedata_memory = resource.filedata.size();
+			filedata_memory.fetch_add(resource.filedata_memory);
+
+			resource.texture_version.fetch_add(1);
+			resource.state.store(wiResource::READY, std::memory_order_release);
+
+			if (memory_budget > 0)
+			{
+				// The resource can stay in memory after it's not referenced any more:
+				locker.lock();
+				auto it = resources.find(task.name);
+				if (it != resources.end() && it->second.weak_resource.lock() == task.resource)
+				{
+					it->second.cached_resource = task.resource;
+				}
+				locker.unlock();
 			}
+		}
+		else
+		{
+			resource.state.store(wiResource::FAILED, std::memory_order_release);
+		}
+
+		// The decoded memory is not needed any more:
+		task.filebuffer.clear();
+		task.filebuffer.shrink_to_fit();
+		task.InitData.clear();
+		task.dds = tinyddsloader::DDSFile();
+		task.rgb.reset();
+		task.lut.clear();
+		task.pixels.clear();
+	}
+
+	// Finish loading a resource that is loading asynchronously or on an other thread
+	//	If the load didn't start yet or waits for upload, then it will be finished on this thread, otherwise wait until it's done
+	void FinishLoading(const std::shared_ptr<wiResource>& resource)
+	{
+		while (resource->IsLoading())
+		{
+			std::shared_ptr<LoadTask> task;
+			bool decoded = false;
+
+			async_locker.lock();
+			for (size_t i = 0; i < async_queue.size(); ++i)
+			{
+				if (async_queue[i]->resource == resource)
+				{
+					task = std::move(async_queue[i]);
+					async_queue[i] = std::move(async_queue.back());
+					async_queue.pop_back();
+					std::make_heap(async_queue.begin(), async_queue.end(), async_compare);
+					break;
+				}
+			}
+			if (task == nullptr)
+			{
+				for (auto it = async_uploads.begin(); it != async_uploads.end(); ++it)
+				{
+					if ((*it)->resource == resource)
+					{
+						task = std::move(*it);
+						async_uploads.erase(it);
+						decoded = true;
+						break;
+					}
+				}
+			}
+			async_locker.unlock();
+
+			if (task != nullptr)
+			{
+				if (!decoded)
+				{
+					task->success = Decode(*task);
+				}
+				Upload(*task);
+				async_pending.fetch_sub(1);
+				return;
+			}
+
+			// The resource is being decoded on an other thread:
+			std::this_thread::yield();
+		}
+	}
+
+	// Uploads, streaming and evictions are made at the thread safe point of every frame:
+	void SubscribeThreadSafePoint()
+	{
+		static wiEvent::Handle handle = wiEvent::Subscribe(SYSTEM_EVENT_THREAD_SAFE_POINT, [](uint64_t userdata) {
+			UpdateTextureStreaming();
+			UpdateAsyncLoads();
+			UpdateMemoryBudget();
+		});
+	}
+
+	// Returns the existing resource, or creates a new one in LOADING state
+	std::shared_ptr<wiResource> Acquire(const std::string& name, bool& created)
+	{
+		SubscribeThreadSafePoint();
+
+		locker.lock();
+		ResourceEntry& entry = resources[name];
+		std::shared_ptr<wiResource> resource = entry.weak_resource.lock();
+		created = resource == nullptr;
+		if (created)
+		{
+			resource = std::make_shared<wiResource>();
+			resource->state.store(wiResource::LOADING);
+			entry.weak_resource = resource;
+			if (entry.evicted)
+			{
+				entry.evicted = false;
+				reloaded_count++;
+			}
+		}
+		entry.last_used_frame = current_frame;
+		locker.unlock();
+		return resource;
+	}
 
-			if (type == wiResource::IMAGE && resource->texture.desc.MipLevels > 1 && resource->texture.desc.BindFlags & BIND_UNORDERED_ACCESS)
+	std::shared_ptr<wiResource> Load(const std::string& name, uint32_t flags, const uint8_t* filedata, size_t filesize)
+	{
+		if (mode == MODE_DISCARD_FILEDATA_AFTER_LOAD)
+		{
+			flags &= ~IMPORT_RETAIN_FILEDATA;
+		}
+
+		bool created;
+		std::shared_ptr<wiResource> resource = Acquire(name, created);
+
+		if (!created)
+		{
+			FinishLoading(resource);
+			if (resource->state.load() == wiResource::FAILED)
 			{
-				wiRenderer::AddDeferredMIPGen(resource, true);
+				return nullptr;
 			}
+			return resource;
+		}
+
+		LoadTask task;
+		task.resource = resource;
+		task.name = name;
+		task.flags = flags;
+		task.filedata = filedata;
+		task.filesize = filesize;
+		task.success = Decode(task);
+		Upload(task);
 
+		if (task.success)
+		{
 			return resource;
 		}
 
 		return nullptr;
 	}
 
+	// Loader job: decodes queued tasks in priority order until the queue is empty
+	void AsyncLoader()
+	{
+		while (true)
+		{
+			async_locker.lock();
+			if (async_queue.empty())
+			{
+				async_loaders--;
+				async_locker.unlock();
+				return;
+			}
+			std::pop_heap(async_queue.begin(), async_queue.end(), async_compare);
+			std::shared_ptr<LoadTask> task = std::move(async_queue.back());
+			async_queue.pop_back();
+			async_locker.unlock();
+
+			// The check is made under the resource lock, so Acquire() can't pick up the resource while it's being dropped
+			locker.lock();
+			const bool dropped = task->resource.use_count() == 1;
+			if (dropped && !task->streaming_update)
+			{
+				// Nobody is referencing the resource any more, so it's dropped without loading
+				//	The entry forgets it, so a later request will create and load a new resource instead of getting a FAILED one
+				auto it = resources.find(task->name);
+				if (it != resources.end() && it->second.weak_resource.lock() == task->resource)
+				{
+					it->second.weak_resource.reset();
+				}
+				task->resource->state.store(wiResource::FAILED);
+			}
+			locker.unlock();
+			if (dropped)
+			{
+				async_pending.fetch_sub(1);
+				continue;
+			}
+
+			task->success = Decode(*task);
+
+			async_locker.lock();
+			async_uploads.push_back(std::move(task));
+			async_locker.unlock();
+		}
+	}
+
+	// Add a task to the asynchronous queue and start a loader job if needed
+	void Enqueue(std::shared_ptr<LoadTask>&& task)
+	{
+		async_pending.fetch_add(1);
+		const uint32_t max_loaders = std::max(1u, wiJobSystem::GetThreadCount() / 2);
+		async_locker.lock();
+		task->order = async_order++;
+		async_queue.push_back(std::move(task));
+		std::push_heap(async_queue.begin(), async_queue.end(), async_compare);
+		const bool launch = async_loaders < max_loaders;
+		if (launch)
+		{
+			async_loaders++;
+		}
+		async_locker.unlock();
+
+		if (launch)
+		{
+			async_ctx.priority = wiJobSystem::Priority::Background;
+			wiJobSystem::Execute(async_ctx, [](wiJobArgs args) {
+				AsyncLoader();
+			});
+		}
+	}
+
+	std::shared_ptr<wiResource> LoadAsync(const std::string& name, uint32_t flags, int priority)
+	{
+		if (mode == MODE_DISCARD_FILEDATA_AFTER_LOAD)
+		{
+			flags &= ~IMPORT_RETAIN_FILEDATA;
+		}
+
+		bool created;
+		std::shared_ptr<wiResource> resource = Acquire(name, created);
+
+		if (!created)
+		{
+			if (resource->IsLoading())
+			{
+				// If it's still waiting in the queue, the priority can be raised:
+				async_locker.lock();
+				for (auto& task : async_queue)
+				{
+					if (task->resource == resource && task->priority < priority)
+					{
+						task->priority = priority;
+						std::make_heap(async_queue.begin(), async_queue.end(), async_compare);
+						break;
+					}
+				}
+				async_locker.unlock();
+			}
+			return resource;
+		}
+
+		std::shared_ptr<LoadTask> task = std::make_shared<LoadTask>();
+		task->resource = resource;
+		task->name = name;
+		task->flags = flags;
+		task->priority = priority;
+		Enqueue(std::move(task));
+
+		return resource;
+	}
+
+	void UpdateAsyncLoads(size_t budget)
+	{
+		size_t uploaded = 0;
+		while (uploaded < budget)
+		{
+			async_locker.lock();
+			if (async_uploads.empty())
+			{
+				async_locker.unlock();
+				break;
+			}
+			std::shared_ptr<LoadTask> task = std::move(async_uploads.front());
+			async_uploads.pop_front();
+			async_locker.unlock();
+
+			uploaded += std::max(task->upload_size, size_t(1));
+			Upload(*task);
+			async_pending.fetch_sub(1);
+		}
+	}
+	void UpdateAsyncLoads()
+	{
+		UpdateAsyncLoads(async_upload_budget);
+	}
+
+	uint32_t GetAsyncLoadCount()
+	{
+		return async_pending.load();
+	}
+
+	void WaitAsyncLoads()
+	{
+		while (GetAsyncLoadCount() > 0)
+		{
+			wiJobSystem::Wait(async_ctx);
+			UpdateAsyncLoads(~size_t(0));
+			std::this_thread::yield();
+		}
+	}
+
+	void SetMemoryBudget(size_t bytes)
+	{
+		SubscribeThreadSafePoint();
+		memory_budget.store(bytes);
+	}
+	size_t GetMemoryBudget()
+	{
+		return memory_budget.load();
+	}
+
+	void UpdateMemoryBudget()
+	{
+		struct Candidate
+		{
+			ResourceEntry* entry;
+			size_t memory;
+		};
+		std::vector<Candidate> candidates;
+
+		locker.lock();
+		current_frame++;
+		for (auto& it : resources)
+		{
+			ResourceEntry& entry = it.second;
+			if (entry.cached_resource == nullptr)
+			{
+				continue;
+			}
+			if (entry.cached_resource.use_count() > 1)
+			{
+				entry.last_used_frame = current_frame; // referenced outside of the resource manager
+			}
+			else
+			{
+				candidates.push_back({ &entry, entry.cached_resource->GetMemorySize() });
+			}
+		}
+
+		const size_t budget = memory_budget.load();
+		size_t total_memory = texture_memory.load() + filedata_memory.load() + sound_memory.load();
+		if (total_memory > budget && !candidates.empty())
+		{
+			// Least recently used are evicted first:
+			std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+				return a.entry->last_used_frame < b.entry->last_used_frame;
+			});
+			for (auto& candidate : candidates)
+			{
+				if (total_memory <= budget)
+				{
+					break;
+				}
+				total_memory -= std::min(total_memory, candidate.memory);
+				candidate.entry->cached_resource.reset(); // the resource is destroyed here, because nothing else references it
+				candidate.entry->evicted = true;
+				evicted_count++;
+			}
+		}
+		locker.unlock();
+	}
+
+	Stats GetStats()
+	{
+		Stats stats;
+		stats.texture_memory = texture_memory.load();
+		stats.filedata_memory = filedata_memory.load();
+		stats.sound_memory = sound_memory.load();
+
+		locker.lock();
+		stats.budget = memory_budget.load();
+		stats.evicted_count = evicted_count;
+		stats.reloaded_count = reloaded_count;
+		for (auto& it : resources)
+		{
+			const ResourceEntry& entry = it.second;
+			std::shared_ptr<wiResource> resource = entry.weak_resource.lock();
+			if (resource == nullptr || !resource->IsReady())
+			{
+				continue;
+			}
+			switch (resource->type)
+			{
+			case wiResource::IMAGE:
+				stats.texture_count++;
+				if (resource->flags & IMPORT_STREAMING)
+				{
+					stats.streaming_count++;
+					stats.streaming_memory += resource->texture_memory;
+					stats.streaming_memory_full += wiTextureStreaming::ComputeMemorySize(resource->streaming, 0);
+				}
+				break;
+			case wiResource::SOUND:
+				stats.sound_count++;
+				break;
+			default:
+				break;
+			}
+			if (entry.cached_resource != nullptr && resource.use_count() == 2)
+			{
+				// only referenced by the cache and this function:
+				stats.cached_count++;
+				stats.cached_memory += resource->GetMemorySize();
+			}
+		}
+		locker.unlock();
+
+		return stats;
+	}
+
+	void SetTextureStreamingEnabled(bool value)
+	{
+		streaming_enabled = value;
+	}
+	bool IsTextureStreamingEnabled()
+	{
+		return streaming_enabled;
+	}
+	void SetTextureStreamingSettings(const wiTextureStreaming::Settings& settings)
+	{
+		locker.lock();
+		streaming_settings = settings;
+		locker.unlock();
+	}
+	wiTextureStreaming::Settings GetTextureStreamingSettings()
+	{
+		locker.lock();
+		wiTextureStreaming::Settings settings = streaming_settings;
+		locker.unlock();
+		return settings;
+	}
+
+	void UpdateTextureStreaming()
+	{
+		std::vector<std::shared_ptr<wiResource>> streaming_resources;
+		std::vector<const std::string*> names;
+		std::vector<wiTextureStreaming::Texture> textures;
+
+		locker.lock();
+		for (auto& it : resources)
+		{
+			std::shared_ptr<wiResource> resource = it.second.weak_resource.lock();
+			if (resource != nullptr && (resource->flags & IMPORT_STREAMING) && resource->IsReady())
+			{
+				streaming_resources.push_back(std::move(resource));
+				names.push_back(&it.first);
+			}
+		}
+
+		if (streaming_resources.empty())
+		{
+			locker.unlock();
+			return;
+		}
+
+		textures.reserve(streaming_resources.size());
+		for (auto& resource : streaming_resources)
+		{
+			textures.push_back(resource->streaming);
+			textures.back().requested_resolution = (float)resource->streaming_request.exchange(0);
+		}
+
+		wiTextureStreaming::Update(textures.data(), textures.size(), streaming_settings);
+
+		// Promotions are started first, then the biggest changes:
+		std::vector<size_t> requests;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			wiResource& resource = *streaming_resources[i];
+			resource.streaming.target_lod = textures[i].target_lod;
+			resource.streaming.demote_frames = textures[i].demote_frames;
+			if (!resource.streaming_in_progress && resource.streaming.target_lod != resource.streaming.resident_lod)
+			{
+				requests.push_back(i);
+			}
+		}
+		std::sort(requests.begin(), requests.end(), [&](size_t a, size_t b) {
+			const int change_a = int(textures[a].target_lod) - int(textures[a].resident_lod);
+			const int change_b = int(textures[b].target_lod) - int(textures[b].resident_lod);
+			return change_a < change_b;
+		});
+		if (requests.size() > streaming_max_requests)
+		{
+			requests.resize(streaming_max_requests);
+		}
+
+		for (size_t i : requests)
+		{
+			std::shared_ptr<wiResource>& resource = streaming_resources[i];
+			resource->streaming_in_progress = true;
+
+			std::shared_ptr<LoadTask> task = std::make_shared<LoadTask>();
+			task->resource = resource;
+			task->name = *names[i];
+			task->flags = resource->flags;
+			task->lod = resource->streaming.target_lod;
+			task->streaming_update = true;
+			task->priority = resource->streaming.target_lod < resource->streaming.resident_lod ? 1 : -1;
+			if (!resource->filedata.empty())
+			{
+				task->filedata = resource->filedata.data();
+				task->filesize = resource->filedata.size();
+			}
+			Enqueue(std::move(task));
+		}
+		locker.unlock();
+	}
+
 	bool Contains(const std::string& name)
+
 	{
 		bool result = false;
 		locker.lock();
 		auto it = resources.find(name);
 		if (it != resources.end())
 		{
-			auto resource = it->second.lock();
+			auto resource = it->second.weak_resource.lock();
 			result = resource != nullptr && resource->type != wiResource::EMPTY;
 		}
 		locker.unlock();
@@ -390,7 +1142,8 @@ namespace wiResourceManager
 			{
 				std::string name;
 				uint32_t flags = 0;
-				std::vector<uint8_t> filedata;
+				const uint8_t* filedata = nullptr; // points into the archive, it's not copied out
+				size_t filesize = 0;
 			};
 			std::vector<TempResource> temp_resources;
 			temp_resources.resize(serializable_count);
@@ -403,14 +1156,14 @@ namespace wiResourceManager
 
 				archive >> resource.name;
 				archive >> resource.flags;
-				archive >> resource.filedata;
+				archive.ReadView(resource.filedata, resource.filesize);
 
 				resource.name = archive.GetSourceDirectory() + resource.name;
 
 				// "Loading" the resource can happen asynchronously to serialization of file data, to improve performance
 				wiJobSystem::Execute(ctx, [i, &temp_resources, &seri_locker, &seri](wiJobArgs args) {
 					auto& tmp_resource = temp_resources[i];
-					auto res = Load(tmp_resource.name, tmp_resource.flags, tmp_resource.filedata.data(), tmp_resource.filedata.size());
+					auto res = Load(tmp_resource.name, tmp_resource.flags, tmp_resource.filedata, tmp_resource.filesize);
 					seri_locker.lock();
 					seri.resources.push_back(res);
 					seri_locker.unlock();
@@ -435,7 +1188,7 @@ namespace wiResourceManager
 				// Count embedded resources:
 				for (auto& it : resources)
 				{
-					std::shared_ptr<wiResource> resource = it.second.lock();
+					std::shared_ptr<wiResource> resource = it.second.weak_resource.lock();
 					if (resource != nullptr && !resource->filedata.empty())
 					{
 						serializable_count++;
@@ -446,7 +1199,7 @@ namespace wiResourceManager
 				archive << serializable_count;
 				for (auto& it : resources)
 				{
-					std::shared_ptr<wiResource> resource = it.second.lock();
+					std::shared_ptr<wiResource> resource = it.second.weak_resource.lock();
 
 					if (resource != nullptr && !resource->filedata.empty())
 					{
@@ -454,7 +1207,7 @@ namespace wiResourceManager
 						wiHelper::MakePathRelative(archive.GetSourceDirectory(), name);
 
 						archive << name;
-						archive << resource->flags;
+						archive << (resource->flags & ~IMPORT_STREAMING);
 						archive << resource->filedata;
 					}
 				}
@@ -464,3 +1217,10 @@ namespace wiResourceManager
 	}
 
 }
+
+wiResource::~wiResource()
+{
+	wiResourceManager::texture_memory.fetch_sub(texture_memory);
+	wiResourceManager::filedata_memory.fetch_sub(filedata_memory);
+	wiResourceManager::sound_memory.fetch_sub(sound_memory);
+}
@@ -4,10 +4,12 @@
 #include "wiAudio.h"
 #include "wiArchive.h"
 #include "wiJobSystem.h"
+#include "wiTextureStreaming.h"
 
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <atomic>
 
 struct wiResource
 {
@@ -23,6 +25,44 @@ struct wiResource
 
 	uint32_t flags = 0;
 	std::vector<uint8_t> filedata;
+
+	// Resources that are loaded asynchronously are returned in LOADING state, the others are READY
+	enum STATE
+	{
+		LOADING,
+		READY,
+		FAILED,
+	};
+	std::atomic<uint32_t> state{ READY };
+
+	bool IsReady() const { return state.load(std::memory_order_acquire) == READY; }
+	bool IsLoading() const { return state.load(std::memory_order_acquire) == LOADING; }
+
+	// Returns the texture if it's ready, otherwise the placeholder (which can be nullptr)
+	const wiGraphics::Texture* GetTexture(const wiGraphics::Texture* placeholder = nullptr) const;
+
+	// Incremented every time the texture is created or replaced (by loading or streaming), the users can refresh their descriptors when it changes
+	std::atomic<uint32_t> texture_version{ 0 };
+
+	// Texture streaming state, only valid if the resource was loaded with IMPORT_STREAMING:
+	wiTextureStreaming::Texture streaming;
+	bool streaming_in_progress = false;
+	std::atomic<uint32_t> streaming_request{ 0 }; // highest resolution requested in the current frame
+
+	// Request the resolution (in pixels) that the texture will be displayed with in this frame, for streaming. This is thread safe
+	inline void RequestStreamingResolution(uint32_t resolution)
+	{
+		uint32_t prev = streaming_request.load(std::memory_order_relaxed);
+		while (prev < resolution && !streaming_request.compare_exchange_weak(prev, resolution, std::memory_order_relaxed));
+	}
+
+	// Memory usage in bytes, accounted when the loading is finished:
+	size_t texture_memory = 0;
+	size_t filedata_memory = 0;
+	size_t sound_memory = 0;
+	inline size_t GetMemorySize() const { return texture_memory + filedata_memory + sound_memory; }
+
+	~wiResource();
 };
 
 namespace wiResourceManager
@@ -42,6 +82,7 @@ namespace wiResourceManager
 		EMPTY = 0,
 		IMPORT_COLORGRADINGLUT = 1 << 0, // image import will convert resource to 3D color grading LUT
 		IMPORT_RETAIN_FILEDATA = 1 << 1, // file data will be kept for later reuse. This is necessary for keeping the resource serializable
+		IMPORT_STREAMING = 1 << 2, // image will be streamed: only the mip levels that are needed will be resident (not serialized)
 	};
 
 	// Load a resource
@@ -55,6 +96,66 @@ namespace wiResourceManager
 		const uint8_t* filedata = nullptr,
 		size_t filesize = 0
 	);
+	// Load a resource asynchronously, the handle is returned immediately in LOADING state
+	//	File reading and decoding is done by background jobs, ordered by priority, then by the order of requests
+	//	The GPU upload is made at the thread safe point of the frame, use wiResource::IsReady() to check when it's finished
+	//	If the last handle is released before loading started, the load is cancelled
+	//	Calling Load() with the same name finishes the loading on the calling thread
+	//	name : file name of resource
+	//	flags : specify flags that modify behaviour (optional)
+	//	priority : resources with higher priority are loaded sooner. Requesting a resource again with higher priority raises it (optional)
+	std::shared_ptr<wiResource> LoadAsync(
+		const std::string& name,
+		uint32_t flags = EMPTY,
+		int priority = 0
+	);
+	// Upload the asynchronously loaded resources that are decoded. This is called automatically at the thread safe point of the frame
+	void UpdateAsyncLoads();
+	// Returns the number of asynchronous loads that are not finished yet
+	uint32_t GetAsyncLoadCount();
+	// Wait until every asynchronous load is finished. The uploads will be made on the calling thread
+	void WaitAsyncLoads();
+	// Set the memory budget of resources in bytes (default: 0)
+	//	Resources that are not referenced any more are kept in memory while the total memory usage fits into the budget,
+	//	so they don't need to be loaded again when they are requested. When the budget is exceeded, the least recently
+	//	referenced ones are evicted, they will be loaded again on demand. Referenced resources are never evicted.
+	//	With 0 budget, resources are freed as soon as they are not referenced
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget();
+	// Evict resources that don't fit into the memory budget. This is called automatically at the thread safe point of the frame
+	void UpdateMemoryBudget();
+
+	struct Stats
+	{
+		size_t texture_memory = 0;	// GPU texture memory
+		size_t filedata_memory = 0;	// retained file data
+		size_t sound_memory = 0;	// decoded audio data
+		size_t cached_memory = 0;	// memory of resources that are only kept alive by the budget (included in the above)
+		size_t budget = 0;
+		uint32_t texture_count = 0;
+		uint32_t sound_count = 0;
+		uint32_t cached_count = 0;	// resources that are only kept alive by the budget
+		uint32_t evicted_count = 0;	// resources evicted since startup
+		uint32_t reloaded_count = 0;	// evicted resources that were requested and loaded again
+		uint32_t streaming_count = 0;	// textures that are streaming
+		size_t streaming_memory = 0;	// resident memory of streaming textures (included in texture_memory)
+		size_t streaming_memory_full = 0;	// memory that the streaming textures would use with every mip level resident
+		inline size_t GetTotalMemory() const { return texture_memory + filedata_memory + sound_memory; }
+	};
+	// Returns the current memory usage and residency of the resources
+	Stats GetStats();
+
+	// Texture streaming: textures loaded with IMPORT_STREAMING start with only their low resolution mips resident,
+	//	and more detailed mips are loaded or dropped over frames based on the resolution that they are requested with
+	//	The renderer requests the on-screen size of visible objects for their material textures
+	//	When enabled, scene materials load their textures with IMPORT_STREAMING
+	void SetTextureStreamingEnabled(bool value);
+	bool IsTextureStreamingEnabled();
+	void SetTextureStreamingSettings(const wiTextureStreaming::Settings& settings);
+	wiTextureStreaming::Settings GetTextureStreamingSettings();
+	// Make streaming decisions and start loading the mip level changes. This is called automatically at the thread safe point of the frame
+	void UpdateTextureStreaming();
+
 	// Check if a resource is currently loaded
 	bool Contains(const std::string& name);
 	// Invalidate all resources
@@ -345,11 +345,17 @@ namespace wiScene
 	}
 	void MaterialComponent::CreateRenderData()
 	{
+		// Textures are loaded in the background, the material is updated when they are ready:
+		uint32_t flags = wiResourceManager::IMPORT_RETAIN_FILEDATA;
+		if (wiResourceManager::IsTextureStreamingEnabled())
+		{
+			flags |= wiResourceManager::IMPORT_STREAMING;
+		}
 		for (auto& x : textures)
 		{
 			if (!x.name.empty())
 			{
-				x.resource = wiResourceManager::Load(x.name, wiResourceManager::IMPORT_RETAIN_FILEDATA);
+				x.resource = wiResourceManager::LoadAsync(x.name, flags);
 			}
 		}
 
@@ -380,6 +386,8 @@ namespace wiScene
 	{
 		GraphicsDevice* device = wiRenderer::GetDevice();
 
+		triangleBVH.state.store(TriangleBVH::STATE_NEEDS_REBUILD);
+
 		// Create index buffer GPU data:
 		{
 			GPUBufferDesc bd;
@@ -814,7 +822,99 @@ namespace wiScene
 		dest->blendmaterial3 = terrain_material3_index;
 		dest->subsetbuffer = device->GetDescriptorIndex(&subsetBuffer, SRV);
 	}
-	void MeshComponent::ComputeNormals(COMPUTE_NORMALS compute)
+	// Finds vertices by position within an epsilon distance per axis
+	//	The vertices are hashed into grid cells that are at least twice the epsilon, so only the neighbouring cells need to be searched
+	class VertexHashGrid
+	{
+	public:
+		VertexHashGrid(const std::vector<XMFLOAT3>& positions, float epsilon) :
+			positions(positions),
+			epsilon(epsilon),
+			cell_size(std::max(epsilon * 2, 0.00001f)),
+			next(positions.size()),
+			order(positions.size())
+		{
+			cells.reserve(positions.size());
+		}
+
+		void Clear()
+		{
+			cells.clear();
+			count = 0;
+		}
+
+		// Adds a vertex that can be found later
+		void Insert(uint32_t vertex)
+		{
+			const XMFLOAT3& position = positions[vertex];
+			const size_t hash = Hash(Cell(position.x), Cell(position.y), Cell(position.z));
+			auto it = cells.find(hash);
+			next[vertex] = it == cells.end() ? ~0u : it->second;
+			order[vertex] = count++;
+			cells[hash] = vertex;
+		}
+
+		// Returns the first inserted vertex that is near the position and accepted by match(vertex), or ~0u if there is none
+		template<typename F>
+		uint32_t Find(const XMFLOAT3& position, F match) const
+		{
+			const int64_t x0 = Cell(position.x - epsilon), x1 = Cell(position.x + epsilon);
+			const int64_t y0 = Cell(position.y - epsilon), y1 = Cell(position.y + epsilon);
+			const int64_t z0 = Cell(position.z - epsilon), z1 = Cell(position.z + epsilon);
+			uint32_t result = ~0u;
+			for (int64_t z = z0; z <= z1; ++z)
+			{
+				for (int64_t y = y0; y <= y1; ++y)
+				{
+					for (int64_t x = x0; x <= x1; ++x)
+					{
+						auto it = cells.find(Hash(x, y, z));
+						if (it == cells.end())
+						{
+							continue;
+						}
+						for (uint32_t vertex = it->second; vertex != ~0u; vertex = next[vertex])
+						{
+							const XMFLOAT3& p = positions[vertex];
+							if ((result == ~0u || order[vertex] < order[result]) &&
+								std::abs(p.x - position.x) <= epsilon &&
+								std::abs(p.y - position.y) <= epsilon &&
+								std::abs(p.z - position.z) <= epsilon &&
+								match(vertex))
+							{
+								result = vertex;
+							}
+						}
+					}
+				}
+			}
+			return result;
+		}
+
+	private:
+		const std::vector<XMFLOAT3>& positions;
+		float epsilon;
+		float cell_size;
+		std::unordered_map<size_t, uint32_t> cells; // cell hash -> last inserted vertex in the cell
+		std::vector<uint32_t> next; // linked list of vertices in the same cell
+		std::vector<uint32_t> order; // insertion order of vertices
+		uint32_t count = 0;
+
+		inline int64_t Cell(float value) const
+		{
+			return (int64_t)std::floor(std::clamp(double(value) / cell_size, -1e15, 1e15));
+		}
+		static inline size_t Hash(int64_t x, int64_t y, int64_t z)
+		{
+			size_t hash = 0;
+			wiHelper::hash_combine(hash, x);
+			wiHelper::hash_combine(hash, y);
+			wiHelper::hash_combine(hash, z);
+			return hash;
+		}
+	};
+
+	void MeshComponent::ComputeNormals(COMPUTE_NORMALS compute, float position_epsilon, float uv_epsilon)
 	{
 		// Start recalculating normals:
 
@@ -931,155 +1031,75 @@ namespace wiScene
 		{
 			// Compute smooth surface normals:
 
-			// 1.) Zero normals, they will be averaged later
-			for (size_t i = 0; i < vertex_normals.size(); i++)
+			// 1.) Find identical vertices by POSITION, every vertex is assigned to the first vertex with the same position
+			VertexHashGrid grid(vertex_positions, position_epsilon);
+			std::vector<uint32_t> positionGroups(vertex_positions.size());
+			for (uint32_t i = 0; i < (uint32_t)vertex_positions.size(); ++i)
 			{
-				vertex_normals[i] = XMFLOAT3(0, 0, 0);
-			}
-
-			// 2.) Find identical vertices by POSITION, accumulate face normals
-			for (size_t i = 0; i < vertex_positions.size(); i++)
-			{
-				XMFLOAT3& v_search_pos = vertex_positions[i];
-
-				for (size_t ind = 0; ind < indices.size() / 3; ++ind)
+				const uint32_t found = grid.Find(vertex_positions[i], [](uint32_t vertex) { return true; });
+				if (found == ~0u)
 				{
-					uint32_t i0 = indices[ind * 3 + 0];
-					uint32_t i1 = indices[ind * 3 + 1];
-					uint32_t i2 = indices[ind * 3 + 2];
-
-					XMFLOAT3& v0 = vertex_positions[i0];
-					XMFLOAT3& v1 = vertex_positions[i1];
-					XMFLOAT3& v2 = vertex_positions[i2];
-
-					bool match_pos0 =
-						fabs(v_search_pos.x - v0.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v0.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v0.z) < FLT_EPSILON;
-
-					bool match_pos1 =
-						fabs(v_search_pos.x - v1.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v1.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v1.z) < FLT_EPSILON;
-
-					bool match_pos2 =
-						fabs(v_search_pos.x - v2.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v2.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v2.z) < FLT_EPSILON;
-
-					if (match_pos0 || match_pos1 || match_pos2)
-					{
-						XMVECTOR U = XMLoadFloat3(&v2) - XMLoadFloat3(&v0);
-						XMVECTOR V = XMLoadFloat3(&v1) - XMLoadFloat3(&v0);
-
-						XMVECTOR N = XMVector3Cross(U, V);
-						N = XMVector3Normalize(N);
-
-						XMFLOAT3 normal;
-						XMStoreFloat3(&normal, N);
-
-						vertex_normals[i].x += normal.x;
-						vertex_normals[i].y += normal.y;
-						vertex_normals[i].z += normal.z;
-					}
-
+					grid.Insert(i);
+					positionGroups[i] = i;
 				}
-			}
-
-			// 3.) Find duplicated vertices by POSITION and UV0 and UV1 and ATLAS and SUBSET and remove them:
-			for (auto& subset : subsets)
-			{
-				for (uint32_t i = 0; i < subset.indexCount - 1; i++)
+				else
 				{
-					uint32_t ind0 = indices[subset.indexOffset + (uint32_t)i];
-					const XMFLOAT3& p0 = vertex_positions[ind0];
-					const XMFLOAT2& u00 = vertex_uvset_0.empty() ? XMFLOAT2(0, 0) : vertex_uvset_0[ind0];
-					const XMFLOAT2& u10 = vertex_uvset_1.empty() ? XMFLOAT2(0, 0) : vertex_uvset_1[ind0];
-					const XMFLOAT2& at0 = vertex_atlas.empty() ? XMFLOAT2(0, 0) : vertex_atlas[ind0];
-
-					for (uint32_t j = i + 1; j < subset.indexCount; j++)
-					{
-						uint32_t ind1 = indices[subset.indexOffset + (uint32_t)j];
-
-						if (ind1 == ind0)
-						{
-							continue;
-						}
-
-						const XMFLOAT3& p1 = vertex_positions[ind1];
-						const XMFLOAT2& u01 = vertex_uvset_0.empty() ? XMFLOAT2(0, 0) : vertex_uvset_0[ind1];
-						const XMFLOAT2& u11 = vertex_uvset_1.empty() ? XMFLOAT2(0, 0) : vertex_uvset_1[ind1];
-						const XMFLOAT2& at1 = vertex_atlas.empty() ? XMFLOAT2(0, 0) : vertex_atlas[ind1];
-
-						const bool duplicated_pos =
-							fabs(p0.x - p1.x) < FLT_EPSILON &&
-							fabs(p0.y - p1.y) < FLT_EPSILON &&
-							fabs(p0.z - p1.z) < FLT_EPSILON;
-
-						const bool duplicated_uv0 =
-							fabs(u00.x - u01.x) < FLT_EPSILON &&
-							fabs(u00.y - u01.y) < FLT_EPSILON;
+					positionGroups[i] = found;
+				}
+			}
 
-						const bool duplicated_uv1 =
-							fabs(u10.x - u11.x) < FLT_EPSILON &&
-							fabs(u10.y - u11.y) < FLT_EPSILON;
+			// 2.) Accumulate face normals per position, a face is counted only once for a position
+			const uint32_t faceCount = (uint32_t)(indices.size() / 3);
+			std::vector<XMFLOAT3> faceNormals(faceCount);
+			wiJobSystem::context ctx;
+			wiJobSystem::Dispatch(ctx, faceCount, 1024, [&](wiJobArgs args) {
+				const XMFLOAT3& v0 = vertex_positions[indices[args.jobIndex * 3 + 0]];
+				const XMFLOAT3& v1 = vertex_positions[indices[args.jobIndex * 3 + 1]];
+				const XMFLOAT3& v2 = vertex_positions[indices[args.jobIndex * 3 + 2]];
 
-						const bool duplicated_atl =
-							fabs(at0.x - at1.x) < FLT_EPSILON &&
-							fabs(at0.y - at1.y) < FLT_EPSILON;
+				XMVECTOR U = XMLoadFloat3(&v2) - XMLoadFloat3(&v0);
+				XMVECTOR V = XMLoadFloat3(&v1) - XMLoadFloat3(&v0);
 
-						if (duplicated_pos && duplicated_uv0 && duplicated_uv1 && duplicated_atl)
-						{
-							// Erase vertices[ind1] because it is a duplicate:
-							if (ind1 < vertex_positions.size())
-							{
-								vertex_positions.erase(vertex_positions.begin() + ind1);
-							}
-							if (ind1 < vertex_normals.size())
-							{
-								vertex_normals.erase(vertex_normals.begin() + ind1);
-							}
-							if (ind1 < vertex_uvset_0.size())
-							{
-								vertex_uvset_0.erase(vertex_uvset_0.begin() + ind1);
-							}
-							if (ind1 < vertex_uvset_1.size())
-							{
-								vertex_uvset_1.erase(vertex_uvset_1.begin() + ind1);
-							}
-							if (ind1 < vertex_atlas.size())
-							{
-								vertex_atlas.erase(vertex_atlas.begin() + ind1);
-							}
-							if (ind1 < vertex_boneindices.size())
-							{
-								vertex_boneindices.erase(vertex_boneindices.begin() + ind1);
-							}
-							if (ind1 < vertex_boneweights.size())
-							{
-								vertex_boneweights.erase(vertex_boneweights.begin() + ind1);
-							}
-
-							// The vertices[ind1] was removed, so each index after that needs to be updated:
-							for (auto& index : indices)
-							{
-								if (index > ind1 && index > 0)
-								{
-									index--;
-								}
-								else if (index == ind1)
-								{
-									index = ind0;
-								}
-							}
+				XMVECTOR N = XMVector3Cross(U, V);
+				N = XMVector3Normalize(N);
 
-						}
+				XMStoreFloat3(&faceNormals[args.jobIndex], N);
+			});
+			wiJobSystem::Wait(ctx);
 
-					}
+			std::vector<XMFLOAT3> groupNormals(vertex_positions.size(), XMFLOAT3(0, 0, 0));
+			for (uint32_t face = 0; face < faceCount; ++face)
+			{
+				const uint32_t g0 = positionGroups[indices[face * 3 + 0]];
+				const uint32_t g1 = positionGroups[indices[face * 3 + 1]];
+				const uint32_t g2 = positionGroups[indices[face * 3 + 2]];
+				const XMFLOAT3& normal = faceNormals[face];
+
+				groupNormals[g0].x += normal.x;
+				groupNormals[g0].y += normal.y;
+				groupNormals[g0].z += normal.z;
+				if (g1 != g0)
+				{
+					groupNormals[g1].x += normal.x;
+					groupNormals[g1].y += normal.y;
+					groupNormals[g1].z += normal.z;
+				}
+				if (g2 != g0 && g2 != g1)
+				{
+					groupNormals[g2].x += normal.x;
+					groupNormals[g2].y += normal.y;
+					groupNormals[g2].z += normal.z;
 				}
-
 			}
 
+			vertex_normals.resize(vertex_positions.size());
+			wiJobSystem::Dispatch(ctx, (uint32_t)vertex_normals.size(), 4096, [&](wiJobArgs args) {
+				vertex_normals[args.jobIndex] = groupNormals[positionGroups[args.jobIndex]];
+			});
+			wiJobSystem::Wait(ctx);
+
+			// 3.) Find duplicated vertices by POSITION and UV0 and UV1 and ATLAS and SUBSET and remove them:
+			WeldVertices(position_epsilon, uv_epsilon);
 		}
 		break;
 
@@ -1122,6 +1142,106 @@ namespace wiScene
 
 		CreateRenderData(); // <- normals will be normalized here!
 	}
+	void MeshComponent::WeldVertices(float position_epsilon, float uv_epsilon)
+	{
+		const uint32_t vertexCount = (uint32_t)vertex_positions.size();
+		auto match_uv = [&](const std::vector<XMFLOAT2>& uvs, uint32_t a, uint32_t b) {
+			return uvs.size() != vertexCount || (
+				std::abs(uvs[a].x - uvs[b].x) <= uv_epsilon &&
+				std::abs(uvs[a].y - uvs[b].y) <= uv_epsilon
+				);
+		};
+
+		// Every subset is welded separately, in index order, so the first occurence of a vertex is kept:
+		std::vector<uint32_t> remap(vertexCount); // the vertex that replaces a vertex in the current subset
+		std::vector<uint32_t> remapSubset(vertexCount, ~0u); // the subset that the remap was computed for
+		std::vector<uint8_t> merged(vertexCount, 0); // the vertex was replaced by an other in some subset
+		VertexHashGrid grid(vertex_positions, position_epsilon);
+		for (uint32_t subsetIndex = 0; subsetIndex < (uint32_t)subsets.size(); ++subsetIndex)
+		{
+			const MeshSubset& subset = subsets[subsetIndex];
+			grid.Clear();
+			for (uint32_t i = 0; i < subset.indexCount; ++i)
+			{
+				uint32_t& index = indices[subset.indexOffset + i];
+				const uint32_t vertex = index;
+				if (remapSubset[vertex] != subsetIndex)
+				{
+					remapSubset[vertex] = subsetIndex;
+					const uint32_t found = grid.Find(vertex_positions[vertex], [&](uint32_t candidate) {
+						return
+							match_uv(vertex_uvset_0, vertex, candidate) &&
+							match_uv(vertex_uvset_1, vertex, candidate) &&
+							match_uv(vertex_atlas, vertex, candidate);
+					});
+					if (found == ~0u)
+					{
+						grid.Insert(vertex);
+						remap[vertex] = vertex;
+					}
+					else
+					{
+						remap[vertex] = found;
+						merged[vertex] = 1;
+					}
+				}
+				index = remap[vertex];
+			}
+		}
+
+		// Remove the replaced vertices that are not referenced any more, the order of the remaining vertices is kept:
+		std::vector<uint8_t> referenced(vertexCount, 0);
+		for (uint32_t index : indices)
+		{
+			referenced[index] = 1;
+		}
+		std::vector<uint32_t> compacted(vertexCount, ~0u);
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			if (!merged[i] || referenced[i])
+			{
+				compacted[i] = count++;
+			}
+		}
+		if (count == vertexCount)
+		{
+			return;
+		}
+		for (auto& index : indices)
+		{
+			index = compacted[index];
+		}
+		auto compact = [&](auto& stream) {
+			if (stream.size() != vertexCount)
+			{
+				return;
+			}
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				if (compacted[i] != ~0u)
+				{
+					stream[compacted[i]] = stream[i];
+				}
+			}
+			stream.resize(count);
+		};
+		compact(vertex_positions);
+		compact(vertex_normals);
+		compact(vertex_tangents);
+		compact(vertex_uvset_0);
+		compact(vertex_uvset_1);
+		compact(vertex_boneindices);
+		compact(vertex_boneweights);
+		compact(vertex_atlas);
+		compact(vertex_colors);
+		compact(vertex_windweights);
+		for (auto& target : targets)
+		{
+			compact(target.vertex_positions);
+			compact(target.vertex_normals);
+		}
+	}
 	void MeshComponent::FlipCulling()
 	{
 		for (size_t face = 0; face < indices.size() / 3; face++)
@@ -1185,6 +1305,92 @@ namespace wiScene
 
 		return sphere;
 	}
+	const MeshComponent::TriangleBVH& MeshComponent::GetTriangleBVH(const ArmatureComponent* armature, const SoftBodyPhysicsComponent* softbody) const
+	{
+		TriangleBVH& tbvh = triangleBVH;
+		if (tbvh.state.load(std::memory_order_acquire) == TriangleBVH::STATE_COMPLETE)
+		{
+			return tbvh;
+		}
+
+		tbvh.locker.lock();
+		const uint32_t state = tbvh.state.load(std::memory_order_relaxed);
+		if (state == TriangleBVH::STATE_COMPLETE)
+		{
+			// An other thread finished it while this one was waiting
+			tbvh.locker.unlock();
+			return tbvh;
+		}
+
+		if (state == TriangleBVH::STATE_NEEDS_REBUILD || tbvh.triangles.empty())
+		{
+			tbvh.triangles.clear();
+			tbvh.triangle_subsets.clear();
+			uint32_t subsetIndex = 0;
+			for (auto& subset : subsets)
+			{
+				for (uint32_t i = 0; i + 2 < subset.indexCount; i += 3)
+				{
+					tbvh.triangles.push_back(subset.indexOffset + i);
+					tbvh.triangle_subsets.push_back(subsetIndex);
+				}
+				subsetIndex++;
+			}
+		}
+
+		// Deformed meshes keep their own copy of the vertex positions, so that the queries don't need to skin every tested triangle:
+		const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
+		const bool deformed = softbody_active || armature != nullptr || !vertex_positions_morphed.empty();
+		if (deformed)
+		{
+			tbvh.vertex_positions.resize(vertex_positions.size());
+			for (uint32_t i = 0; i < (uint32_t)vertex_positions.size(); ++i)
+			{
+				if (softbody_active)
+				{
+					XMStoreFloat3(&tbvh.vertex_positions[i], softbody->vertex_positions_simulation[i].LoadPOS());
+				}
+				else if (armature != nullptr)
+				{
+					XMStoreFloat3(&tbvh.vertex_positions[i], SkinVertex(*this, *armature, i));
+				}
+				else
+				{
+					tbvh.vertex_positions[i] = vertex_positions_morphed[i].pos;
+				}
+			}
+		}
+		else
+		{
+			tbvh.vertex_positions.clear();
+		}
+		const XMFLOAT3* positions = deformed ? tbvh.vertex_positions.data() : vertex_positions.data();
+
+		std::vector<AABB> triangle_aabbs(tbvh.triangles.size());
+		for (size_t i = 0; i < tbvh.triangles.size(); ++i)
+		{
+			const uint32_t triangle = tbvh.triangles[i];
+			const XMVECTOR p0 = XMLoadFloat3(&positions[indices[triangle + 0]]);
+			const XMVECTOR p1 = XMLoadFloat3(&positions[indices[triangle + 1]]);
+			const XMVECTOR p2 = XMLoadFloat3(&positions[indices[triangle + 2]]);
+			XMStoreFloat3(&triangle_aabbs[i]._min, XMVectorMin(p0, XMVectorMin(p1, p2)));
+			XMStoreFloat3(&triangle_aabbs[i]._max, XMVectorMax(p0, XMVectorMax(p1, p2)));
+		}
+
+		if (state == TriangleBVH::STATE_NEEDS_REBUILD)
+		{
+			tbvh.bvh.Build(triangle_aabbs.data(), (uint32_t)triangle_aabbs.size());
+		}
+		else
+		{
+			// Refit keeps the tree structure, and only falls back to a rebuild if the deformation made the tree too inefficient
+			tbvh.bvh.Update(triangle_aabbs.data(), (uint32_t)triangle_aabbs.size());
+		}
+
+		tbvh.state.store(TriangleBVH::STATE_COMPLETE, std::memory_order_release);
+		tbvh.locker.unlock();
+		return tbvh;
+	}
 
 	void ObjectComponent::ClearLightmap()
 	{
@@ -1428,53 +1634,74 @@ namespace wiScene
 			}
 		}
 
-		wiJobSystem::context ctx;
-
-		RunPreviousFrameTransformUpdateSystem(ctx);
-
-		RunAnimationUpdateSystem(ctx);
-
-		RunTransformUpdateSystem(ctx);
-
-		wiJobSystem::Wait(ctx); // dependencies
-
-		RunHierarchyUpdateSystem(ctx);
-
-		RunSpringUpdateSystem(ctx);
-
-		RunInverseKinematicsUpdateSystem(ctx);
-
-		RunArmatureUpdateSystem(ctx);
-
-		RunMeshUpdateSystem(ctx);
-
-		RunMaterialUpdateSystem(ctx);
-
-		RunImpostorUpdateSystem(ctx);
-
-		RunWeatherUpdateSystem(ctx);
-
-		wiPhysicsEngine::RunPhysicsUpdateSystem(ctx, *this, dt);
-
-		wiJobSystem::Wait(ctx); // dependencies
-
-		RunObjectUpdateSystem(ctx);
-
-		RunCameraUpdateSystem(ctx);
-
-		RunDecalUpdateSystem(ctx);
-
-		RunProbeUpdateSystem(ctx);
-
-		RunForceUpdateSystem(ctx);
-
-		RunLightUpdateSystem(ctx);
-
-		RunParticleUpdateSystem(ctx);
-
-		RunSoundUpdateSystem(ctx);
+		// The systems are executed as a task graph, each system starts as soon as the systems it depends on are finished
+		//	The graph is only built once, running it again doesn't allocate memory:
+		if (update_graph.GetNodeCount() == 0)
+		{
+			auto add_system = [&](void(Scene::*system)(wiJobSystem::context&)) {
+				return update_graph.AddNode([this, system](wiJobSystem::context& ctx) { (this->*system)(ctx); });
+			};
+
+			const auto previous_frame_transform = add_system(&Scene::RunPreviousFrameTransformUpdateSystem);
+			const auto animation = add_system(&Scene::RunAnimationUpdateSystem);
+			const auto transform = add_system(&Scene::RunTransformUpdateSystem);
+			const auto hierarchy = add_system(&Scene::RunHierarchyUpdateSystem);
+			const auto spring = add_system(&Scene::RunSpringUpdateSystem);
+			const auto inverse_kinematics = add_system(&Scene::RunInverseKinematicsUpdateSystem);
+			const auto armature = add_system(&Scene::RunArmatureUpdateSystem);
+			const auto mesh = add_system(&Scene::RunMeshUpdateSystem);
+			const auto material = add_system(&Scene::RunMaterialUpdateSystem);
+			const auto impostor = add_system(&Scene::RunImpostorUpdateSystem);
+			const auto weather = add_system(&Scene::RunWeatherUpdateSystem);
+			const auto physics = update_graph.AddNode([this](wiJobSystem::context& ctx) { wiPhysicsEngine::RunPhysicsUpdateSystem(ctx, *this, this->dt); });
+			const auto object = add_system(&Scene::RunObjectUpdateSystem);
+			const auto camera = add_system(&Scene::RunCameraUpdateSystem);
+			const auto decal = add_system(&Scene::RunDecalUpdateSystem);
+			const auto probe = add_system(&Scene::RunProbeUpdateSystem);
+			const auto force = add_system(&Scene::RunForceUpdateSystem);
+			const auto light = add_system(&Scene::RunLightUpdateSystem);
+			const auto particle = add_system(&Scene::RunParticleUpdateSystem);
+			const auto sound = add_system(&Scene::RunSoundUpdateSystem);
+			const auto object_bvh_update = update_graph.AddNode([this](wiJobSystem::context& ctx) {
+				object_bvh.Update(aabb_objects.GetCount() > 0 ? &aabb_objects[0] : nullptr, (uint32_t)aabb_objects.GetCount());
+				object_bvh_generation = aabb_objects.GetGeneration();
+			});
+
+			// Local transforms are written by animations, previous frame world matrices must be saved before the new ones are computed:
+			update_graph.AddEdge(previous_frame_transform, transform);
+			update_graph.AddEdge(animation, transform);
+
+			// The transform chain, these all modify world matrices:
+			update_graph.AddEdge(transform, hierarchy);
+			update_graph.AddEdge(hierarchy, spring);
+			update_graph.AddEdge(weather, spring); // wind
+			update_graph.AddEdge(spring, inverse_kinematics);
+			update_graph.AddEdge(inverse_kinematics, armature);
+
+			// Meshes use skinning and material state, physics modifies mesh buffers and transforms, and needs skinning for soft bodies:
+			update_graph.AddEdge(armature, mesh);
+			update_graph.AddEdge(material, mesh);
+			update_graph.AddEdge(mesh, physics);
+			update_graph.AddEdge(weather, physics); // wind
+
+			// After physics, transforms are final. The remaining systems only need final transforms (and some of them meshes and materials, which are finished too):
+			update_graph.AddEdge(physics, object);
+			update_graph.AddEdge(impostor, object);
+			update_graph.AddEdge(physics, camera);
+			update_graph.AddEdge(physics, decal);
+			update_graph.AddEdge(physics, probe);
+			update_graph.AddEdge(physics, force);
+			update_graph.AddEdge(physics, light);
+			update_graph.AddEdge(physics, particle);
+			update_graph.AddEdge(physics, sound);
+
+			// The object bounding boxes are computed by the object system:
+			update_graph.AddEdge(object, object_bvh_update);
+		}
 
-		wiJobSystem::Wait(ctx); // dependencies
+		wiJobSystem::context ctx;
+		update_graph.Run(ctx);
+		wiJobSystem::Wait(ctx);
 
 		// Merge parallel bounds computation (depends on object update system):
 		bounds = AABB();
@@ -1640,6 +1867,13 @@ namespace wiScene
 
 		TLAS = RaytracingAccelerationStructure();
 		BVH.Clear();
+		object_bvh.Clear();
+		object_bvh_generation = ~0ull;
+		aabb_objects_soa.resize(0);
+		changed_object_bounds.clear();
+		all_object_bounds_changed.store(true);
+		hierarchy_levels.clear();
+		hierarchy_level_offsets.clear();
 		packedDecals.clear();
 		waterRipples.clear();
 	}
@@ -2127,6 +2361,7 @@ namespace wiScene
 	}
 
 	const uint32_t small_subtask_groupsize = 64;
+	const size_t max_changed_object_bounds = 256; // beyond this, every cache that depends on object bounds is invalidated
 
 	void Scene::RunPreviousFrameTransformUpdateSystem(wiJobSystem::context& ctx)
 	{
@@ -2141,28 +2376,89 @@ namespace wiScene
 	}
 	void Scene::RunAnimationUpdateSystem(wiJobSystem::context& ctx)
 	{
-		for (size_t i = 0; i < animations.GetCount(); ++i)
+		// Animations that write the same target are blended on top of each other in component order, so those are updated serially in one job
+		//	The rest of the animations write their own targets only, so they are updated in parallel
+		std::vector<uint32_t> active_animations;
+		std::vector<uint8_t> shared_target(animations.GetCount(), 0);
+		std::vector<uint32_t> transform_writers(transforms.GetCount(), ~0u);
+		std::vector<uint32_t> mesh_writers(meshes.GetCount(), ~0u);
+		for (uint32_t i = 0; i < (uint32_t)animations.GetCount(); ++i)
 		{
 			AnimationComponent& animation = animations[i];
 			if (!animation.IsPlaying() && animation.timer == 0.0f)
 			{
 				continue;
 			}
+			active_animations.push_back(i);
 
-			for (const AnimationComponent::AnimationChannel& channel : animation.channels)
+			for (AnimationComponent::AnimationSampler& sampler : animation.samplers)
 			{
-				assert(channel.samplerIndex < (int)animation.samplers.size());
-				AnimationComponent::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
 				if (sampler.data == INVALID_ENTITY)
 				{
-					// backwards-compatibility mode
+					// backwards-compatibility mode (this creates components, so it's not done in the parallel part)
 					sampler.data = CreateEntity();
 					animation_datas.Create(sampler.data) = sampler.backwards_compatibility_data;
 					sampler.backwards_compatibility_data.keyframe_times.clear();
 					sampler.backwards_compatibility_data.keyframe_data.clear();
 				}
+			}
+
+			for (const AnimationComponent::AnimationChannel& channel : animation.channels)
+			{
+				uint32_t* writer = nullptr;
+				if (channel.path == AnimationComponent::AnimationChannel::Path::WEIGHTS)
+				{
+					const ObjectComponent* object = objects.GetComponent(channel.target);
+					const size_t mesh_index = object == nullptr ? ~size_t(0) : meshes.GetIndex(object->meshID);
+					if (mesh_index != ~size_t(0))
+					{
+						writer = &mesh_writers[mesh_index];
+					}
+				}
+				else
+				{
+					const size_t transform_index = transforms.GetIndex(channel.target);
+					if (transform_index != ~size_t(0))
+					{
+						writer = &transform_writers[transform_index];
+					}
+				}
+				if (writer != nullptr)
+				{
+					if (*writer == ~0u)
+					{
+						*writer = i;
+					}
+					else if (*writer != i)
+					{
+						shared_target[*writer] = 1;
+						shared_target[i] = 1;
+					}
+				}
+			}
+		}
+		std::vector<uint32_t> parallel_animations;
+		std::vector<uint32_t> serial_animations;
+		for (uint32_t i : active_animations)
+		{
+			if (shared_target[i])
+			{
+				serial_animations.push_back(i);
+			}
+			else
+			{
+				parallel_animations.push_back(i);
+			}
+		}
+
+		auto update_animation = [&](AnimationComponent& animation) {
+
+			for (AnimationComponent::AnimationChannel& channel : animation.channels)
+			{
+				assert(channel.samplerIndex < (int)animation.samplers.size());
+				const AnimationComponent::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
 				const AnimationDataComponent* animationdata = animation_datas.GetComponent(sampler.data);
-				if (animationdata == nullptr)
+				if (animationdata == nullptr || animationdata->keyframe_times.empty())
 				{
 					continue;
 				}
@@ -2170,16 +2466,31 @@ namespace wiScene
 				int keyLeft = 0;
 				int keyRight = 0;
 
-				if (animationdata->keyframe_times.back() < animation.timer)
+				const float* keyframe_times = animationdata->keyframe_times.data();
+				const int keyframe_count = (int)animationdata->keyframe_times.size();
+				if (keyframe_times[keyframe_count - 1] < animation.timer)
 				{
 					// Rightmost keyframe is already outside animation, so just snap to last keyframe:
-					keyLeft = keyRight = (int)animationdata->keyframe_times.size() - 1;
+					keyLeft = keyRight = keyframe_count - 1;
 				}
 				else
 				{
-					// Search for the right keyframe (greater/equal to anim time):
-					while (animationdata->keyframe_times[keyRight++] < animation.timer) {}
-					keyRight--;
+					// Search for the right keyframe (first one greater/equal to anim time):
+					//	The time usually only moves a little between updates, so first the keyframe of the previous update and the one after it are checked
+					const int cursor = std::max(0, std::min(channel.keyframe_cursor, keyframe_count - 1));
+					if (keyframe_times[cursor] >= animation.timer && (cursor == 0 || keyframe_times[cursor - 1] < animation.timer))
+					{
+						keyRight = cursor;
+					}
+					else if (cursor + 1 < keyframe_count && keyframe_times[cursor] < animation.timer && keyframe_times[cursor + 1] >= animation.timer)
+					{
+						keyRight = cursor + 1;
+					}
+					else
+					{
+						keyRight = int(std::lower_bound(keyframe_times, keyframe_times + keyframe_count, animation.timer) - keyframe_times);
+					}
+					channel.keyframe_cursor = keyRight;
 
 					// Left keyframe is just near right:
 					keyLeft = std::max(0, keyRight - 1);
@@ -2437,7 +2748,21 @@ namespace wiScene
 			{
 				animation.timer = animation.start;
 			}
+		};
+
+		wiJobSystem::Dispatch(ctx, (uint32_t)parallel_animations.size(), 1, [&](wiJobArgs args) {
+			update_animation(animations[parallel_animations[args.jobIndex]]);
+		});
+		if (!serial_animations.empty())
+		{
+			wiJobSystem::Execute(ctx, [&](wiJobArgs args) {
+				for (uint32_t i : serial_animations)
+				{
+					update_animation(animations[i]);
+				}
+			});
 		}
+		wiJobSystem::Wait(ctx); // the animation lists are local to this function
 	}
 	void Scene::RunTransformUpdateSystem(wiJobSystem::context& ctx)
 	{
@@ -2447,32 +2772,123 @@ namespace wiScene
 			transform.UpdateTransform();
 		});
 	}
-	void Scene::RunHierarchyUpdateSystem(wiJobSystem::context& ctx)
+	void Scene::UpdateHierarchyLevels()
 	{
-		// This needs serialized execution because there are dependencies enforced by component order!
-
-		for (size_t i = 0; i < hierarchy.GetCount(); ++i)
+		// Check whether the hierarchy is the same as when the levels were built:
+		bool changed = hierarchy_levels.size() != hierarchy.GetCount();
+		for (size_t i = 0; i < hierarchy_levels.size() && !changed; ++i)
+		{
+			const HierarchyUpdateItem& item = hierarchy_levels[i];
+			changed = hierarchy.GetEntity(item.hierarchy_index) != item.entity || hierarchy[item.hierarchy_index].parentID != item.parent;
+		}
+		if (!changed && !hierarchy_level_offsets.empty())
 		{
-			const HierarchyComponent& parentcomponent = hierarchy[i];
-			Entity entity = hierarchy.GetEntity(i);
+			return;
+		}
 
-			TransformComponent* transform_child = transforms.GetComponent(entity);
-			TransformComponent* transform_parent = transforms.GetComponent(parentcomponent.parentID);
-			if (transform_child != nullptr && transform_parent != nullptr)
+		// The level of a node is one more than its parent's, nodes whose parent is not in the hierarchy are on the first level:
+		const uint32_t count = (uint32_t)hierarchy.GetCount();
+		std::vector<uint32_t> levels(count);
+		uint32_t level_count = 0;
+		hierarchy_levels_serial = false;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const size_t parent_index = hierarchy.GetIndex(hierarchy[i].parentID);
+			if (parent_index == ~size_t(0))
 			{
-				transform_child->UpdateTransform_Parented(*transform_parent);
+				levels[i] = 0;
 			}
+			else if (parent_index < i)
+			{
+				levels[i] = levels[parent_index] + 1;
+			}
+			else
+			{
+				// A child is before its parent, the serial update would use the parent's transform from before its update, so it is kept that way
+				hierarchy_levels_serial = true;
+				break;
+			}
+			level_count = std::max(level_count, levels[i] + 1);
+		}
+		if (hierarchy_levels_serial)
+		{
+			std::fill(levels.begin(), levels.end(), 0);
+			level_count = count > 0 ? 1 : 0;
+		}
 
+		// Counting sort by level, which keeps the component order within a level:
+		hierarchy_level_offsets.clear();
+		hierarchy_level_offsets.resize(level_count + 1);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			hierarchy_level_offsets[levels[i] + 1]++;
+		}
+		for (uint32_t level = 0; level < level_count; ++level)
+		{
+			hierarchy_level_offsets[level + 1] += hierarchy_level_offsets[level];
+		}
+		std::vector<uint32_t> positions(hierarchy_level_offsets.begin(), hierarchy_level_offsets.end() - 1);
+		hierarchy_levels.clear();
+		hierarchy_levels.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			HierarchyUpdateItem& item = hierarchy_levels[positions[levels[i]]++];
+			item.hierarchy_index = i;
+			item.entity = hierarchy.GetEntity(i);
+			item.parent = hierarchy[i].parentID;
+		}
+	}
+	void Scene::UpdateHierarchy(wiJobSystem::context& ctx, bool update_layers)
+	{
+		UpdateHierarchyLevels();
 
-			LayerComponent* layer_child = layers.GetComponent(entity);
-			LayerComponent* layer_parent = layers.GetComponent(parentcomponent.parentID);
-			if (layer_child != nullptr && layer_parent != nullptr)
+		// The cached index is only looked up again if it doesn't refer to the entity any more:
+		auto resolve = [](const auto& manager, uint32_t& index, Entity entity) {
+			if (index >= manager.GetCount() || manager.GetEntity(index) != entity)
 			{
-				layer_child->propagationMask = layer_parent->GetLayerMask();
+				index = (uint32_t)manager.GetIndex(entity);
 			}
+			return index != ~0u;
+		};
+		auto update = [&](HierarchyUpdateItem& item) {
+			if (resolve(transforms, item.transform_child, item.entity) && resolve(transforms, item.transform_parent, item.parent))
+			{
+				transforms[item.transform_child].UpdateTransform_Parented(transforms[item.transform_parent]);
+			}
+			if (update_layers && resolve(layers, item.layer_child, item.entity) && resolve(layers, item.layer_parent, item.parent))
+			{
+				layers[item.layer_child].propagationMask = layers[item.layer_parent].GetLayerMask();
+			}
+		};
 
+		// One node is very cheap to update, so jobs must be big enough to be worth it:
+		const uint32_t groupsize = 256;
+		for (size_t level = 0; level + 1 < hierarchy_level_offsets.size(); ++level)
+		{
+			const uint32_t offset = hierarchy_level_offsets[level];
+			const uint32_t count = hierarchy_level_offsets[level + 1] - offset;
+			if (hierarchy_levels_serial || count <= groupsize)
+			{
+				for (uint32_t i = offset; i < offset + count; ++i)
+				{
+					update(hierarchy_levels[i]);
+				}
+			}
+			else
+			{
+				// Every node of a level only depends on the previous levels:
+				wiJobSystem::Dispatch(ctx, count, groupsize, [&](wiJobArgs args) {
+					update(hierarchy_levels[offset + args.jobIndex]);
+				});
+				wiJobSystem::Wait(ctx);
+			}
 		}
 	}
+	void Scene::RunHierarchyUpdateSystem(wiJobSystem::context& ctx)
+	{
+		// There are dependencies between parents and children, so this is executed level by level, and every level is processed in parallel
+		UpdateHierarchy(ctx, true);
+	}
 	void Scene::RunSpringUpdateSystem(wiJobSystem::context& ctx)
 	{
 		static float time = 0;
@@ -2646,18 +3062,7 @@ namespace wiScene
 			// (**)If there was IK, we need to recompute transform hierarchy. This is only necessary for transforms that have parent
 			//	transforms that are IK. Because the IK chain is computed from child to parent upwards, IK that have child would not update
 			//	its transform properly in some cases (such as if animation writes to that child)
-			for (size_t i = 0; i < hierarchy.GetCount(); ++i)
-			{
-				const HierarchyComponent& parentcomponent = hierarchy[i];
-				Entity entity = hierarchy.GetEntity(i);
-
-				TransformComponent* transform_child = transforms.GetComponent(entity);
-				TransformComponent* transform_parent = transforms.GetComponent(parentcomponent.parentID);
-				if (transform_child != nullptr && transform_parent != nullptr)
-				{
-					transform_child->UpdateTransform_Parented(*transform_parent);
-				}
-			}
+			UpdateHierarchy(ctx, false);
 		}
 	}
 	void Scene::RunArmatureUpdateSystem(wiJobSystem::context& ctx)
@@ -2741,6 +3146,13 @@ namespace wiScene
 				std::swap(mesh.streamoutBuffer_POS, mesh.vertexBuffer_PRE);
 			}
 
+			// Deformed meshes refit their triangle BVH when it's used the next time:
+			if ((mesh.IsSkinned() && armatures.Contains(mesh.armatureID)) || mesh.dirty_morph || softbodies.Contains(entity))
+			{
+				uint32_t expected = MeshComponent::TriangleBVH::STATE_COMPLETE;
+				mesh.triangleBVH.state.compare_exchange_strong(expected, MeshComponent::TriangleBVH::STATE_NEEDS_REFIT);
+			}
+
 			if (mesh.BLAS.IsValid())
 			{
 				uint32_t subsetIndex = 0;
@@ -2890,6 +3302,19 @@ namespace wiScene
 				material.SetDirty(); // will trigger constant buffer update later on
 			}
 
+			for (auto& x : material.textures)
+			{
+				if (x.resource != nullptr)
+				{
+					const uint32_t texture_version = x.resource->texture_version.load();
+					if (x.texture_version != texture_version)
+					{
+						x.texture_version = texture_version;
+						material.SetDirty(); // the texture was loaded or streamed
+					}
+				}
+			}
+
 			material.engineStencilRef = STENCILREF_DEFAULT;
 			if (material.IsCustomShader())
 			{
@@ -2980,7 +3405,12 @@ namespace wiScene
 
 		parallel_bounds.clear();
 		parallel_bounds.resize((size_t)wiJobSystem::DispatchGroupCount((uint32_t)objects.GetCount(), small_subtask_groupsize));
-		
+		// Changes of object bounding boxes are tracked for caches (like shadow caster culling) by comparing with the previous boxes:
+		object_update_frame++;
+		changed_object_bounds.clear();
+		all_object_bounds_changed.store(aabb_objects_soa.count != (uint32_t)aabb_objects.GetCount());
+		aabb_objects_soa.resize((uint32_t)aabb_objects.GetCount());
+
 		wiJobSystem::Dispatch(ctx, (uint32_t)objects.GetCount(), small_subtask_groupsize, [&](wiJobArgs args) {
 
 			ObjectComponent& object = objects[args.jobIndex];
@@ -3205,6 +3635,25 @@ namespace wiScene
 				}
 			}
 
+			if (!all_object_bounds_changed.load(std::memory_order_relaxed))
+			{
+				const AABB prev_aabb = aabb_objects_soa.get(args.jobIndex);
+				if (std::memcmp(&prev_aabb, &aabb, sizeof(AABB)) != 0)
+				{
+					locker.lock();
+					if (changed_object_bounds.size() < max_changed_object_bounds)
+					{
+						changed_object_bounds.push_back(AABB::Merge(prev_aabb, aabb));
+					}
+					else
+					{
+						all_object_bounds_changed.store(true);
+					}
+					locker.unlock();
+				}
+			}
+			aabb_objects_soa.set(args.jobIndex, aabb);
+
 		}, sizeof(AABB));
 	}
 	void Scene::RunCameraUpdateSystem(wiJobSystem::context& ctx)
@@ -3678,136 +4127,213 @@ namespace wiScene
 		return INVALID_ENTITY;
 	}
 
-	PickResult Pick(const RAY& ray, uint32_t renderTypeMask, uint32_t layerMask, const Scene& scene)
+	// Returns the distance where the ray enters the box, or FLT_MAX if the box is missed or it is entered farther than maxDistance
+	inline float RayIntersectAABB(const XMVECTOR& origin, const XMVECTOR& direction_inverse, const AABB& aabb, float maxDistance)
 	{
-		PickResult result;
+		// All three slabs are tested at once:
+		const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&aabb._min), origin), direction_inverse);
+		const XMVECTOR t2 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&aabb._max), origin), direction_inverse);
+		XMFLOAT3 tmin, tmax;
+		XMStoreFloat3(&tmin, XMVectorMin(t1, t2));
+		XMStoreFloat3(&tmax, XMVectorMax(t1, t2));
+		const float tnear = std::max(0.0f, std::max(tmin.x, std::max(tmin.y, tmin.z)));
+		const float tfar = std::min(maxDistance, std::min(tmax.x, std::min(tmax.y, tmax.z)));
+		return tnear <= tfar ? tnear : FLT_MAX;
+	}
+	// Intersects the ray with the triangles of one object. The result is only overwritten by hits that are closer than result.distance
+	//	any_hit : stop at the first hit instead of searching for the closest one
+	void RayIntersectObject(const Scene& scene, size_t objectIndex, const XMVECTOR& rayOrigin, const XMVECTOR& rayDirection, bool any_hit, PickResult& result)
+	{
+		const ObjectComponent& object = scene.objects[objectIndex];
+		const Entity entity = scene.aabb_objects.GetEntity(objectIndex);
+		const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
+		const SoftBodyPhysicsComponent* softbody = scene.softbodies.GetComponent(object.meshID);
+		const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
+
+		const XMMATRIX objectMat = object.transform_index >= 0 ? XMLoadFloat4x4(&scene.transforms[object.transform_index].world) : XMMatrixIdentity();
+		const XMMATRIX objectMat_Inverse = XMMatrixInverse(nullptr, objectMat);
+
+		const XMVECTOR rayOrigin_local = XMVector3Transform(rayOrigin, objectMat_Inverse);
+		const XMVECTOR rayDirection_local = XMVector3Normalize(XMVector3TransformNormal(rayDirection, objectMat_Inverse));
+		const XMVECTOR rayDirection_local_inverse = XMVectorReciprocal(rayDirection_local);
+
+		// The tree is in local space, a local distance along the ray is scaled by this to get the world space distance:
+		const float local_to_world = XMVectorGetX(XMVector3Length(XMVector3TransformNormal(rayDirection_local, objectMat)));
+
+		const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
+
+		const MeshComponent::TriangleBVH& bvh = mesh.GetTriangleBVH(armature, softbody_active ? softbody : nullptr);
+		const XMFLOAT3* positions = bvh.vertex_positions.empty() ? mesh.vertex_positions.data() : bvh.vertex_positions.data();
+
+		bvh.bvh.Intersect(
+			[&](const AABB& aabb) {
+				return RayIntersectAABB(rayOrigin_local, rayDirection_local_inverse, aabb, result.distance / local_to_world) != FLT_MAX;
+			},
+			[&](uint32_t primitive) {
+				const uint32_t triangle = bvh.triangles[primitive];
+				const uint32_t i0 = mesh.indices[triangle + 0];
+				const uint32_t i1 = mesh.indices[triangle + 1];
+				const uint32_t i2 = mesh.indices[triangle + 2];
+
+				XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+				XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+				XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
+
+				float distance;
+				XMFLOAT2 bary;
+				if (wiMath::RayTriangleIntersects(rayOrigin_local, rayDirection_local, p0, p1, p2, distance, bary))
+				{
+					const XMVECTOR pos = XMVector3Transform(XMVectorAdd(rayOrigin_local, rayDirection_local*distance), objectMat);
+					distance = wiMath::Distance(pos, rayOrigin);
+
+					if (distance < result.distance)
+					{
+						const XMVECTOR nor = XMVector3Normalize(XMVector3TransformNormal(XMVector3Cross(XMVectorSubtract(p2, p1), XMVectorSubtract(p1, p0)), objectMat));
+
+						result.entity = entity;
+						XMStoreFloat3(&result.position, pos);
+						XMStoreFloat3(&result.normal, nor);
+						result.distance = distance;
+						result.subsetIndex = (int)bvh.triangle_subsets[primitive];
+						result.vertexID0 = (int)i0;
+						result.vertexID1 = (int)i1;
+						result.vertexID2 = (int)i2;
+						result.bary = bary;
+
+						if (any_hit)
+						{
+							return false;
+						}
+					}
+				}
+				return true;
+			}
+		);
+	}
+	// Finds the closest (or any) intersection of one ray with the scene
+	void RayIntersectScene(const RayQuery& query, const Scene& scene, bool any_hit, PickResult& result)
+	{
+		result = PickResult();
+		result.distance = query.maxDistance;
 
 		if (scene.objects.GetCount() > 0)
 		{
-			const XMVECTOR rayOrigin = XMLoadFloat3(&ray.origin);
-			const XMVECTOR rayDirection = XMVector3Normalize(XMLoadFloat3(&ray.direction));
+			const XMVECTOR rayOrigin = XMLoadFloat3(&query.ray.origin);
+			const XMVECTOR rayDirection = XMVector3Normalize(XMLoadFloat3(&query.ray.direction));
+			const XMVECTOR rayDirection_inverse = XMVectorReciprocal(rayDirection);
 
-			for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
-			{
+			auto visit = [&](uint32_t i) {
 				const AABB& aabb = scene.aabb_objects[i];
-				if (!ray.intersects(aabb))
+				if (RayIntersectAABB(rayOrigin, rayDirection_inverse, aabb, result.distance) == FLT_MAX)
 				{
-					continue;
+					return true;
 				}
 
 				const ObjectComponent& object = scene.objects[i];
 				if (object.meshID == INVALID_ENTITY)
 				{
-					continue;
+					return true;
 				}
-				if (!(renderTypeMask & object.GetRenderTypes()))
+				if (!(query.renderTypeMask & object.GetRenderTypes()))
 				{
-					continue;
+					return true;
 				}
 
 				Entity entity = scene.aabb_objects.GetEntity(i);
 				const LayerComponent* layer = scene.layers.GetComponent(entity);
-				if (layer != nullptr && !(layer->GetLayerMask() & layerMask))
+				if (layer != nullptr && !(layer->GetLayerMask() & query.layerMask))
 				{
-					continue;
+					return true;
 				}
 
-				const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
-				const SoftBodyPhysicsComponent* softbody = scene.softbodies.GetComponent(object.meshID);
-				const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
-
-				const XMMATRIX objectMat = object.transform_index >= 0 ? XMLoadFloat4x4(&scene.transforms[object.transform_index].world) : XMMatrixIdentity();
-				const XMMATRIX objectMat_Inverse = XMMatrixInverse(nullptr, objectMat);
-
-				const XMVECTOR rayOrigin_local = XMVector3Transform(rayOrigin, objectMat_Inverse);
-				const XMVECTOR rayDirection_local = XMVector3Normalize(XMVector3TransformNormal(rayDirection, objectMat_Inverse));
+				RayIntersectObject(scene, i, rayOrigin, rayDirection, any_hit, result);
+				return !any_hit || result.entity == INVALID_ENTITY;
+			};
 
-				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
-
-				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+			if (scene.object_bvh_generation == scene.aabb_objects.GetGeneration())
+			{
+				// Subtrees that are farther than the closest hit so far are skipped:
+				scene.object_bvh.Intersect(
+					[&](const AABB& aabb) {
+						return RayIntersectAABB(rayOrigin, rayDirection_inverse, aabb, result.distance) != FLT_MAX;
+					},
+					visit
+				);
+			}
+			else
+			{
+				// Objects were added or removed since the last scene update, so the object BVH is not usable:
+				for (uint32_t i = 0; i < (uint32_t)scene.aabb_objects.GetCount(); ++i)
 				{
-					for (size_t i = 0; i < subset.indexCount; i += 3)
+					if (!visit(i))
 					{
-						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
-						const uint32_t i1 = mesh.indices[subset.indexOffset + i + 1];
-						const uint32_t i2 = mesh.indices[subset.indexOffset + i + 2];
-
-						XMVECTOR p0;
-						XMVECTOR p1;
-						XMVECTOR p2;
-
-						if (softbody_active)
-						{
-							p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
-							p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
-							p2 = softbody->vertex_positions_simulation[i2].LoadPOS();
-						}
-						else
-						{
-							if (armature == nullptr)
-							{
-								if (mesh.vertex_positions_morphed.empty())
-							    {
-									p0 = XMLoadFloat3(&mesh.vertex_positions[i0]);
-									p1 = XMLoadFloat3(&mesh.vertex_positions[i1]);
-									p2 = XMLoadFloat3(&mesh.vertex_positions[i2]);
-								}
-								else
-								{
-								    p0 = mesh.vertex_positions_morphed[i0].LoadPOS();
-								    p1 = mesh.vertex_positions_morphed[i1].LoadPOS();
-								    p2 = mesh.vertex_positions_morphed[i2].LoadPOS();
-								}
-							}
-							else
-							{
-								p0 = SkinVertex(mesh, *armature, i0);
-								p1 = SkinVertex(mesh, *armature, i1);
-								p2 = SkinVertex(mesh, *armature, i2);
-							}
-						}
-
-						float distance;
-						XMFLOAT2 bary;
-						if (wiMath::RayTriangleIntersects(rayOrigin_local, rayDirection_local, p0, p1, p2, distance, bary))
-						{
-							const XMVECTOR pos = XMVector3Transform(XMVectorAdd(rayOrigin_local, rayDirection_local*distance), objectMat);
-							distance = wiMath::Distance(pos, rayOrigin);
-
-							if (distance < result.distance)
-							{
-								const XMVECTOR nor = XMVector3Normalize(XMVector3TransformNormal(XMVector3Cross(XMVectorSubtract(p2, p1), XMVectorSubtract(p1, p0)), objectMat));
-
-								result.entity = entity;
-								XMStoreFloat3(&result.position, pos);
-								XMStoreFloat3(&result.normal, nor);
-								result.distance = distance;
-								result.subsetIndex = subsetCounter;
-								result.vertexID0 = (int)i0;
-								result.vertexID1 = (int)i1;
-								result.vertexID2 = (int)i2;
-								result.bary = bary;
-							}
-						}
+						break;
 					}
-					subsetCounter++;
 				}
-
 			}
 		}
 
+		if (result.entity == INVALID_ENTITY)
+		{
+			result.distance = FLT_MAX;
+		}
+
 		// Construct a matrix that will orient to position (P) according to surface normal (N):
 		XMVECTOR N = XMLoadFloat3(&result.normal);
 		XMVECTOR P = XMLoadFloat3(&result.position);
-		XMVECTOR E = XMLoadFloat3(&ray.origin);
+		XMVECTOR E = XMLoadFloat3(&query.ray.origin);
 		XMVECTOR T = XMVector3Normalize(XMVector3Cross(N, P - E));
 		XMVECTOR B = XMVector3Normalize(XMVector3Cross(T, N));
 		XMMATRIX M = { T, N, B, P };
 		XMStoreFloat4x4(&result.orientation, M);
+	}
+	// Runs the ray queries on the job system, or on the calling thread if there are only a few of them
+	template<typename F>
+	void DispatchRayQueries(uint32_t queryCount, F&& query)
+	{
+		const uint32_t groupSize = 64;
+		if (queryCount <= groupSize)
+		{
+			for (uint32_t i = 0; i < queryCount; ++i)
+			{
+				query(i);
+			}
+			return;
+		}
+
+		wiJobSystem::context ctx;
+		ctx.priority = wiJobSystem::Priority::High;
+		wiJobSystem::Dispatch(ctx, queryCount, groupSize, [&](wiJobArgs args) {
+			query(args.jobIndex);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	PickResult Pick(const RAY& ray, uint32_t renderTypeMask, uint32_t layerMask, const Scene& scene)
+	{
+		RayQuery query;
+		query.ray = ray;
+		query.renderTypeMask = renderTypeMask;
+		query.layerMask = layerMask;
 
+		PickResult result;
+		Pick(&query, 1, &result, scene);
 		return result;
 	}
+	void Pick(const RayQuery* queries, uint32_t queryCount, PickResult* results, const Scene& scene)
+	{
+		DispatchRayQueries(queryCount, [&](uint32_t i) {
+			RayIntersectScene(queries[i], scene, false, results[i]);
+		});
+	}
+	void PickAny(const RayQuery* queries, uint32_t queryCount, bool* results, const Scene& scene)
+	{
+		DispatchRayQueries(queryCount, [&](uint32_t i) {
+			PickResult result;
+			RayIntersectScene(queries[i], scene, true, result);
+			results[i] = result.entity != INVALID_ENTITY;
+		});
+	}
 
 	SceneIntersectSphereResult SceneIntersectSphere(const SPHERE& sphere, uint32_t renderTypeMask, uint32_t layerMask, const Scene& scene)
 	{
@@ -3815,6 +4341,8 @@ namespace wiScene
 		XMVECTOR Center = XMLoadFloat3(&sphere.center);
 		XMVECTOR Radius = XMVectorReplicate(sphere.radius);
 		XMVECTOR RadiusSq = XMVectorMultiply(Radius, Radius);
+		AABB sphere_aabb;
+		sphere_aabb.createFromHalfWidth(sphere.center, XMFLOAT3(sphere.radius, sphere.radius, sphere.radius));
 
 		if (scene.objects.GetCount() > 0)
 		{
@@ -3852,40 +4380,24 @@ namespace wiScene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
-				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
-				{
-					for (size_t i = 0; i < subset.indexCount; i += 3)
-					{
-						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
-						const uint32_t i1 = mesh.indices[subset.indexOffset + i + 1];
-						const uint32_t i2 = mesh.indices[subset.indexOffset + i + 2];
-
-						XMVECTOR p0;
-						XMVECTOR p1;
-						XMVECTOR p2;
-
-						if (softbody_active)
-						{
-							p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
-							p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
-							p2 = softbody->vertex_positions_simulation[i2].LoadPOS();
-						}
-						else
-						{
-							if (armature == nullptr)
-							{
-								p0 = XMLoadFloat3(&mesh.vertex_positions[i0]);
-								p1 = XMLoadFloat3(&mesh.vertex_positions[i1]);
-								p2 = XMLoadFloat3(&mesh.vertex_positions[i2]);
-							}
-							else
-							{
-								p0 = SkinVertex(mesh, *armature, i0);
-								p1 = SkinVertex(mesh, *armature, i1);
-								p2 = SkinVertex(mesh, *armature, i2);
-							}
-						}
+				const MeshComponent::TriangleBVH& bvh = mesh.GetTriangleBVH(armature, softbody_active ? softbody : nullptr);
+				const XMFLOAT3* positions = bvh.vertex_positions.empty() ? mesh.vertex_positions.data() : bvh.vertex_positions.data();
+
+				// The triangle BVH is in mesh local space, so the query bounds are transformed there:
+				const AABB sphere_aabb_local = sphere_aabb.transform(XMMatrixInverse(nullptr, objectMat));
+				bvh.bvh.Intersect(
+					[&](const AABB& aabb) {
+						return sphere_aabb_local.intersects(aabb) != AABB::OUTSIDE;
+					},
+					[&](uint32_t primitive) {
+						const uint32_t triangle = bvh.triangles[primitive];
+						const uint32_t i0 = mesh.indices[triangle + 0];
+						const uint32_t i1 = mesh.indices[triangle + 1];
+						const uint32_t i2 = mesh.indices[triangle + 2];
+
+						XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+						XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+						XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 
 						p0 = XMVector3Transform(p0, objectMat);
 						p1 = XMVector3Transform(p1, objectMat);
@@ -3897,7 +4409,7 @@ namespace wiScene
 						AABB aabb_triangle(min, max);
 						if (sphere.intersects(aabb_triangle) == AABB::OUTSIDE)
 						{
-							continue;
+							return true;
 						}
 
 						// Compute the plane of the triangle (has to be normalized).
@@ -3911,7 +4423,7 @@ namespace wiScene
 
 						if (!mesh.IsDoubleSided() && XMVectorGetX(Dist) > 0)
 						{
-							continue; // pass through back faces
+							return true; // pass through back faces
 						}
 
 						// If the center of the sphere is farther from the plane of the triangle than
@@ -3999,10 +4511,14 @@ namespace wiScene
 							result.depth = sphere.radius - XMVectorGetX(intersectionVecLen);
 							XMStoreFloat3(&result.position, bestPoint);
 							XMStoreFloat3(&result.normal, intersectionVec / intersectionVecLen);
-							return result;
+							return false;
 						}
+						return true;
 					}
-					subsetCounter++;
+				);
+				if (result.entity != INVALID_ENTITY)
+				{
+					return result;
 				}
 
 			}
@@ -4058,40 +4574,24 @@ namespace wiScene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
-				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
-				{
-					for (size_t i = 0; i < subset.indexCount; i += 3)
-					{
-						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
-						const uint32_t i1 = mesh.indices[subset.indexOffset + i + 1];
-						const uint32_t i2 = mesh.indices[subset.indexOffset + i + 2];
-
-						XMVECTOR p0;
-						XMVECTOR p1;
-						XMVECTOR p2;
-
-						if (softbody_active)
-						{
-							p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
-							p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
-							p2 = softbody->vertex_positions_simulation[i2].LoadPOS();
-						}
-						else
-						{
-							if (armature == nullptr)
-							{
-								p0 = XMLoadFloat3(&mesh.vertex_positions[i0]);
-								p1 = XMLoadFloat3(&mesh.vertex_positions[i1]);
-								p2 = XMLoadFloat3(&mesh.vertex_positions[i2]);
-							}
-							else
-							{
-								p0 = SkinVertex(mesh, *armature, i0);
-								p1 = SkinVertex(mesh, *armature, i1);
-								p2 = SkinVertex(mesh, *armature, i2);
-							}
-						}
+				const MeshComponent::TriangleBVH& bvh = mesh.GetTriangleBVH(armature, softbody_active ? softbody : nullptr);
+				const XMFLOAT3* positions = bvh.vertex_positions.empty() ? mesh.vertex_positions.data() : bvh.vertex_positions.data();
+
+				// The triangle BVH is in mesh local space, so the query bounds are transformed there:
+				const AABB capsule_aabb_local = capsule_aabb.transform(XMMatrixInverse(nullptr, objectMat));
+				bvh.bvh.Intersect(
+					[&](const AABB& aabb) {
+						return capsule_aabb_local.intersects(aabb) != AABB::OUTSIDE;
+					},
+					[&](uint32_t primitive) {
+						const uint32_t triangle = bvh.triangles[primitive];
+						const uint32_t i0 = mesh.indices[triangle + 0];
+						const uint32_t i1 = mesh.indices[triangle + 1];
+						const uint32_t i2 = mesh.indices[triangle + 2];
+
+						XMVECTOR p0 = XMLoadFloat3(&positions[i0]);
+						XMVECTOR p1 = XMLoadFloat3(&positions[i1]);
+						XMVECTOR p2 = XMLoadFloat3(&positions[i2]);
 						
 						p0 = XMVector3Transform(p0, objectMat);
 						p1 = XMVector3Transform(p1, objectMat);
@@ -4103,7 +4603,7 @@ namespace wiScene
 						AABB aabb_triangle(min, max);
 						if (capsule_aabb.intersects(aabb_triangle) == AABB::OUTSIDE)
 						{
-							continue;
+							return true;
 						}
 
 						// Compute the plane of the triangle (has to be normalized).
@@ -4188,7 +4688,7 @@ namespace wiScene
 
 						if (!mesh.IsDoubleSided() && XMVectorGetX(Dist) > 0)
 						{
-							continue; // pass through back faces
+							return true; // pass through back faces
 						}
 
 						// If the center of the sphere is farther from the plane of the triangle than
@@ -4276,10 +4776,14 @@ namespace wiScene
 							result.depth = capsule.radius - XMVectorGetX(intersectionVecLen);
 							XMStoreFloat3(&result.position, bestPoint);
 							XMStoreFloat3(&result.normal, intersectionVec / intersectionVecLen);
-							return result;
+							return false;
 						}
+						return true;
 					}
-					subsetCounter++;
+				);
+				if (result.entity != INVALID_ENTITY)
+				{
+					return result;
 				}
 
 			}
@@ -10,6 +10,7 @@
 #include "wiResourceManager.h"
 #include "wiSpinLock.h"
 #include "wiGPUBVH.h"
+#include "wiBVH.h"
 #include "wiOcean.h"
 #include "wiSprite.h"
 
@@ -207,13 +208,14 @@ struct MaterialComponent {
 		std::string name;
 		uint32_t uvset = 0;
 		std::shared_ptr<wiResource> resource;
+		uint32_t texture_version = 0; // the material is updated when the resource texture is replaced
 		const wiGraphics::GPUResource* GetGPUResource() const {
-			if (resource == nullptr || !resource->texture.IsValid())
+			if (resource == nullptr)
 				return nullptr;
-			return &resource->texture;
+			return resource->GetTexture();
 		}
 		int GetUVSet() const {
-			if (resource == nullptr || !resource->texture.IsValid())
+			if (GetGPUResource() == nullptr)
 				return -1;
 			return (int)uvset;
 		}
@@ -531,6 +533,45 @@ struct MeshComponent {
 	};
 	mutable BLAS_STATE BLAS_state = BLAS_STATE_NEEDS_REBUILD;
 
+	// CPU triangle BVH in mesh local space, used by the scene queries (Pick, SceneIntersectSphere, SceneIntersectCapsule)
+	//	It is built by the first query that needs it, and refitted instead of rebuilt when the mesh is deformed (skinning, morph targets, soft body)
+	struct TriangleBVH {
+		enum STATE {
+			STATE_NEEDS_REBUILD,
+			STATE_NEEDS_REFIT,
+			STATE_COMPLETE,
+		};
+		std::atomic<uint32_t> state{ STATE_NEEDS_REBUILD };
+		wiSpinLock locker;
+		wiBVH bvh;
+		std::vector<uint32_t> triangles;		// first index (into indices) of every triangle, the BVH primitives refer to these
+		std::vector<uint32_t> triangle_subsets; // subset index of every triangle
+		std::vector<XMFLOAT3> vertex_positions; // deformed vertex positions that the BVH was last refitted to, empty if the mesh is not deformed
+
+		TriangleBVH() = default;
+		// Copies don't share the tree, they will build their own when first used:
+		TriangleBVH(const TriangleBVH& other) {}
+		TriangleBVH& operator=(const TriangleBVH& other) {
+			bvh.Clear();
+			triangles.clear();
+			triangle_subsets.clear();
+			vertex_positions.clear();
+			state.store(STATE_NEEDS_REBUILD);
+			return *this;
+		}
+		TriangleBVH(TriangleBVH&& other) noexcept { *this = std::move(other); }
+		TriangleBVH& operator=(TriangleBVH&& other) noexcept {
+			bvh = std::move(other.bvh);
+			triangles = std::move(other.triangles);
+			triangle_subsets = std::move(other.triangle_subsets);
+			vertex_positions = std::move(other.vertex_positions);
+			state.store(other.state.load());
+			other.state.store(STATE_NEEDS_REBUILD);
+			return *this;
+		}
+	};
+	mutable TriangleBVH triangleBVH;
+
 	// Only valid for 1 frame material component indices:
 	int terrain_material1_index = -1;
 	int terrain_material2_index = -1;
@@ -600,16 +641,25 @@ struct MeshComponent {
 
 	enum COMPUTE_NORMALS {
 		COMPUTE_NORMALS_HARD,		 // hard face normals, can result in additional vertices generated
-		COMPUTE_NORMALS_SMOOTH,		 // smooth per vertex normals, this can remove/simplyfy geometry, but slow
+		COMPUTE_NORMALS_SMOOTH,		 // smooth per vertex normals, this can remove/simplyfy geometry (see WeldVertices())
 		COMPUTE_NORMALS_SMOOTH_FAST	 // average normals, vertex count will be unchanged, fast
 	};
-	void ComputeNormals(COMPUTE_NORMALS compute);
+	// position_epsilon, uv_epsilon : tolerance of finding identical vertices for COMPUTE_NORMALS_SMOOTH
+	void ComputeNormals(COMPUTE_NORMALS compute, float position_epsilon = FLT_EPSILON, float uv_epsilon = FLT_EPSILON);
+	// Merges the vertices that are used by the same subset and have the same position, uv sets and atlas coordinates within the epsilons
+	//	The first occurence in the index buffer is kept from the merged vertices, the order of vertices is otherwise unchanged
+	void WeldVertices(float position_epsilon = FLT_EPSILON, float uv_epsilon = FLT_EPSILON);
 	void FlipCulling();
 	void FlipNormals();
 	void Recenter();
 	void RecenterToBottom();
 	SPHERE GetBoundingSphere() const;
 
+	// Returns the triangle BVH for scene queries, building or refitting it first if needed. This is thread safe
+	//	armature	: if not null, the tree is fitted to the skinned vertex positions
+	//	softbody	: if not null and simulated, the tree is fitted to the simulated vertex positions
+	const TriangleBVH& GetTriangleBVH(const ArmatureComponent* armature = nullptr, const SoftBodyPhysicsComponent* softbody = nullptr) const;
+
 	void Serialize(wiArchive& archive, wiECS::EntitySerializer& seri);
 
 	struct Vertex_POS {
@@ -1359,6 +1409,9 @@ struct AnimationComponent {
 			UNKNOWN,
 			TYPE_FORCE_UINT32 = 0xFFFFFFFF
 		} path = TRANSLATION;
+
+		// Non-serialized attributes:
+		int keyframe_cursor = 0; // the right keyframe of the last update, the next keyframe search starts from here
 	};
 	struct AnimationSampler {
 		enum FLAGS {
@@ -1628,16 +1681,17 @@ struct SpringComponent {
 };
 
 struct Scene {
-	wiECS::ComponentManager<NameComponent> names;
-	wiECS::ComponentManager<LayerComponent> layers;
-	wiECS::ComponentManager<TransformComponent> transforms;
-	wiECS::ComponentManager<PreviousFrameTransformComponent> prev_transforms;
-	wiECS::ComponentManager<HierarchyComponent> hierarchy;
+	// Most entities have these, so they use the paged lookup table instead of hashing (see wiECS::EntityLookup):
+	wiECS::ComponentManager<NameComponent, wiECS::EntityLookup> names;
+	wiECS::ComponentManager<LayerComponent, wiECS::EntityLookup> layers;
+	wiECS::ComponentManager<TransformComponent, wiECS::EntityLookup> transforms;
+	wiECS::ComponentManager<PreviousFrameTransformComponent, wiECS::EntityLookup> prev_transforms;
+	wiECS::ComponentManager<HierarchyComponent, wiECS::EntityLookup> hierarchy;
 	wiECS::ComponentManager<MaterialComponent> materials;
 	wiECS::ComponentManager<MeshComponent> meshes;
 	wiECS::ComponentManager<ImpostorComponent> impostors;
-	wiECS::ComponentManager<ObjectComponent> objects;
-	wiECS::ComponentManager<AABB> aabb_objects;
+	wiECS::ComponentManager<ObjectComponent, wiECS::EntityLookup> objects;
+	wiECS::ComponentManager<AABB, wiECS::EntityLookup> aabb_objects;
 	wiECS::ComponentManager<RigidBodyPhysicsComponent> rigidbodies;
 	wiECS::ComponentManager<SoftBodyPhysicsComponent> softbodies;
 	wiECS::ComponentManager<ArmatureComponent> armatures;
@@ -1668,6 +1722,29 @@ struct Scene {
 	wiSpinLock locker;
 	AABB bounds;
 	std::vector<AABB> parallel_bounds;
+	wiBVH object_bvh; // CPU bounding volume hierarchy over aabb_objects, it is kept up to date by Update()
+	uint64_t object_bvh_generation = ~0ull; // the aabb_objects generation that object_bvh was last updated with
+	AABB_SoA aabb_objects_soa; // copy of aabb_objects in structure of arrays layout for batched culling, it is kept up to date by Update()
+	uint64_t object_update_frame = 0; // incremented every time object bounding boxes are updated
+	std::vector<AABB> changed_object_bounds; // old and new bounds of every object whose bounding box changed in the last update
+	std::atomic_bool all_object_bounds_changed{ true }; // the object count changed (or too many objects changed), changed_object_bounds is not usable
+	wiJobSystem::TaskGraph update_graph; // the systems of Update() with their dependencies, it is built at the first Update()
+
+	// The hierarchy sorted by depth levels, parents are always in an earlier level than their children, so one level can be updated in parallel
+	struct HierarchyUpdateItem
+	{
+		uint32_t hierarchy_index = 0;
+		wiECS::Entity entity = wiECS::INVALID_ENTITY;
+		wiECS::Entity parent = wiECS::INVALID_ENTITY;
+		// Component indices are cached, they are only looked up again when they became invalid:
+		uint32_t transform_child = ~0u;
+		uint32_t transform_parent = ~0u;
+		uint32_t layer_child = ~0u;
+		uint32_t layer_parent = ~0u;
+	};
+	std::vector<HierarchyUpdateItem> hierarchy_levels;
+	std::vector<uint32_t> hierarchy_level_offsets; // start of each level in hierarchy_levels, the last element is the item count
+	bool hierarchy_levels_serial = false; // the hierarchy is not ordered parent before child, so it must be updated serially in component order
 	WeatherComponent weather;
 	wiGraphics::RaytracingAccelerationStructure TLAS;
 	std::vector<uint8_t> TLAS_instances;
@@ -1790,7 +1867,15 @@ struct Scene {
 	void Component_DetachChildren(wiECS::Entity parent);
 	void Component_RemoveChildren(wiECS::Entity parent);
 
+	// Rebuilds the hierarchy levels if the hierarchy changed since the last call
+	void UpdateHierarchyLevels();
+	// Propagates parent world matrices (and optionally layer masks) to the children level by level
+	void UpdateHierarchy(wiJobSystem::context& ctx, bool update_layers);
+
 	void Serialize(wiArchive& archive);
+	// Chunked layout of the component managers (archive version 67+), the chunks are read in parallel
+	//	chunks: the chunk archives must be kept alive until the entity serializer waited for its subtasks
+	void Serialize_Chunked(wiArchive& archive, wiECS::EntitySerializer& seri, std::vector<wiArchive>& chunks);
 
 	void RunPreviousFrameTransformUpdateSystem(wiJobSystem::context& ctx);
 	void RunAnimationUpdateSystem(wiJobSystem::context& ctx);
@@ -1869,6 +1954,22 @@ struct PickResult {
 //	scene			:	the scene that will be traced against the ray
 PickResult Pick(const RAY& ray, uint32_t renderTypeMask = RENDERTYPE_OPAQUE, uint32_t layerMask = ~0, const Scene& scene = GetScene());
 
+// A ray of a batched scene query, with its own filters
+struct RayQuery {
+	RAY ray;
+	uint32_t renderTypeMask = RENDERTYPE_OPAQUE;
+	uint32_t layerMask		= ~0u;
+	float maxDistance		= FLT_MAX; // intersections farther than this from the ray origin are ignored
+};
+// Finds the closest intersection for every ray, the work is distributed with the job system
+//	queries			:	array of queryCount rays
+//	results			:	array of queryCount results, that will be written in the same order as the queries
+//	scene			:	the scene that will be traced against the rays
+void Pick(const RayQuery* queries, uint32_t queryCount, PickResult* results, const Scene& scene = GetScene());
+// Occlusion test for every ray, it only tells if there is any intersection closer than maxDistance, so it can stop at the first one
+//	results			:	array of queryCount bools, true if the ray was occluded
+void PickAny(const RayQuery* queries, uint32_t queryCount, bool* results, const Scene& scene = GetScene());
+
 struct SceneIntersectSphereResult {
 	wiECS::Entity entity = wiECS::INVALID_ENTITY;
 	XMFLOAT3 position	 = XMFLOAT3(0, 0, 0);
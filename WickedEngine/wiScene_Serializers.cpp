@@ -7,6 +7,8 @@
 
 #include <chrono>
 #include <string>
+#include <functional>
+#include <algorithm>
 
 using namespace wiECS;
 
@@ -1110,49 +1112,59 @@ namespace wiScene
 			wiResourceManager::Serialize(archive, resource_seri);
 		}
 
+		// Chunks are kept alive until the entity serializer finished waiting for the component subtasks:
+		std::vector<wiArchive> chunks;
+
 		// With this we will ensure that serialized entities are unique and persistent across the scene:
 		EntitySerializer seri;
 
-		names.Serialize(archive, seri);
-		layers.Serialize(archive, seri);
-		transforms.Serialize(archive, seri);
-		prev_transforms.Serialize(archive, seri);
-		hierarchy.Serialize(archive, seri);
-		materials.Serialize(archive, seri);
-		meshes.Serialize(archive, seri);
-		impostors.Serialize(archive, seri);
-		objects.Serialize(archive, seri);
-		aabb_objects.Serialize(archive, seri);
-		rigidbodies.Serialize(archive, seri);
-		softbodies.Serialize(archive, seri);
-		armatures.Serialize(archive, seri);
-		lights.Serialize(archive, seri);
-		aabb_lights.Serialize(archive, seri);
-		cameras.Serialize(archive, seri);
-		probes.Serialize(archive, seri);
-		aabb_probes.Serialize(archive, seri);
-		forces.Serialize(archive, seri);
-		decals.Serialize(archive, seri);
-		aabb_decals.Serialize(archive, seri);
-		animations.Serialize(archive, seri);
-		emitters.Serialize(archive, seri);
-		hairs.Serialize(archive, seri);
-		weathers.Serialize(archive, seri);
-		if (archive.GetVersion() >= 30)
-		{
-			sounds.Serialize(archive, seri);
-		}
-		if (archive.GetVersion() >= 37)
-		{
-			inverse_kinematics.Serialize(archive, seri);
-		}
-		if (archive.GetVersion() >= 38)
+		if (archive.GetVersion() >= 67)
 		{
-			springs.Serialize(archive, seri);
+			Serialize_Chunked(archive, seri, chunks);
 		}
-		if (archive.GetVersion() >= 46)
+		else
 		{
-			animation_datas.Serialize(archive, seri);
+			names.Serialize(archive, seri);
+			layers.Serialize(archive, seri);
+			transforms.Serialize(archive, seri);
+			prev_transforms.Serialize(archive, seri);
+			hierarchy.Serialize(archive, seri);
+			materials.Serialize(archive, seri);
+			meshes.Serialize(archive, seri);
+			impostors.Serialize(archive, seri);
+			objects.Serialize(archive, seri);
+			aabb_objects.Serialize(archive, seri);
+			rigidbodies.Serialize(archive, seri);
+			softbodies.Serialize(archive, seri);
+			armatures.Serialize(archive, seri);
+			lights.Serialize(archive, seri);
+			aabb_lights.Serialize(archive, seri);
+			cameras.Serialize(archive, seri);
+			probes.Serialize(archive, seri);
+			aabb_probes.Serialize(archive, seri);
+			forces.Serialize(archive, seri);
+			decals.Serialize(archive, seri);
+			aabb_decals.Serialize(archive, seri);
+			animations.Serialize(archive, seri);
+			emitters.Serialize(archive, seri);
+			hairs.Serialize(archive, seri);
+			weathers.Serialize(archive, seri);
+			if (archive.GetVersion() >= 30)
+			{
+				sounds.Serialize(archive, seri);
+			}
+			if (archive.GetVersion() >= 37)
+			{
+				inverse_kinematics.Serialize(archive, seri);
+			}
+			if (archive.GetVersion() >= 38)
+			{
+				springs.Serialize(archive, seri);
+			}
+			if (archive.GetVersion() >= 46)
+			{
+				animation_datas.Serialize(archive, seri);
+			}
 		}
 
 		std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
@@ -1161,6 +1173,226 @@ namespace wiScene
 		wiBackLog::post((std::string("Scene serialize took ") + std::to_string(sec) + std::string(" sec")).c_str());
 	}
 
+	void Scene::Serialize_Chunked(wiArchive& archive, EntitySerializer& seri, std::vector<wiArchive>& chunks)
+	{
+		// Type erased component managers. The index of a component manager in this list is serialized, so new ones must only be appended!
+		struct ChunkedManager
+		{
+			std::function<void(wiArchive&, EntitySerializer&)> entities;
+			std::function<void(wiArchive&, EntitySerializer&, size_t, size_t)> components;
+			size_t count;
+		};
+		std::vector<ChunkedManager> managers;
+		auto add = [&](auto& manager) {
+			ChunkedManager x;
+			x.entities = [&manager](wiArchive& archive, EntitySerializer& seri) { manager.SerializeEntities(archive, seri); };
+			x.components = [&manager](wiArchive& archive, EntitySerializer& seri, size_t offset, size_t count) { manager.SerializeComponents(archive, seri, offset, count); };
+			x.count = manager.GetCount();
+			managers.push_back(std::move(x));
+		};
+		add(names);
+		add(layers);
+		add(transforms);
+		add(prev_transforms);
+		add(hierarchy);
+		add(materials);
+		add(meshes);
+		add(impostors);
+		add(objects);
+		add(aabb_objects);
+		add(rigidbodies);
+		add(softbodies);
+		add(armatures);
+		add(lights);
+		add(aabb_lights);
+		add(cameras);
+		add(probes);
+		add(aabb_probes);
+		add(forces);
+		add(decals);
+		add(aabb_decals);
+		add(animations);
+		add(emitters);
+		add(hairs);
+		add(weathers);
+		add(sounds);
+		add(inverse_kinematics);
+		add(springs);
+		add(animation_datas);
+
+		// Table of contents entry: a range of components of one component manager
+		struct ChunkDesc
+		{
+			uint32_t manager;
+			uint64_t offset;
+			uint64_t count;
+			uint64_t size;
+		};
+		std::vector<ChunkDesc> toc;
+
+		wiJobSystem::context ctx;
+
+		if (archive.IsReadMode())
+		{
+			// The entity table contains every entity that is referenced by the chunks, so the remap table is complete before the chunks are read:
+			std::vector<uint64_t> entity_table;
+			archive >> entity_table;
+			seri.remap.reserve(entity_table.size());
+			for (uint64_t mem : entity_table)
+			{
+				seri.remap[mem] = CreateEntity();
+			}
+			seri.remap_readonly = true;
+
+			uint32_t managerCount;
+			archive >> managerCount;
+			assert(managerCount <= managers.size());
+			managerCount = std::min(managerCount, (uint32_t)managers.size());
+			size_t entity_lists_size;
+			archive >> entity_lists_size;
+			wiArchive entity_lists = archive.ReadChunk(entity_lists_size);
+			for (uint32_t i = 0; i < managerCount; ++i)
+			{
+				managers[i].entities(entity_lists, seri);
+			}
+
+			uint32_t chunkCount;
+			archive >> chunkCount;
+			toc.resize(chunkCount);
+			for (auto& desc : toc)
+			{
+				archive >> desc.manager;
+				archive >> desc.offset;
+				archive >> desc.count;
+				archive >> desc.size;
+			}
+
+			chunks.reserve(chunkCount);
+			for (auto& desc : toc)
+			{
+				chunks.push_back(archive.ReadChunk((size_t)desc.size));
+			}
+
+			wiJobSystem::Dispatch(ctx, chunkCount, 1, [&](wiJobArgs args) {
+				const ChunkDesc& desc = toc[args.jobIndex];
+				if (desc.manager < managerCount)
+				{
+					managers[desc.manager].components(chunks[args.jobIndex], seri, (size_t)desc.offset, (size_t)desc.count);
+				}
+			});
+			wiJobSystem::Wait(ctx);
+
+			// Subtasks that were spawned by the components don't remap entities, so from here it is allowed to write the remap table again:
+			seri.remap_readonly = false;
+			for (auto& x : seri.remap_late)
+			{
+				seri.remap.insert(x);
+			}
+			seri.remap_late.clear();
+		}
+		else
+		{
+			// Components are written into chunks of about this size, so large meshes will get their own chunks:
+			static constexpr size_t chunk_size = 256 * 1024;
+
+			struct ChunkData
+			{
+				ChunkDesc desc;
+				wiArchive archive;
+				std::vector<uint64_t> entities;
+			};
+			std::vector<std::vector<ChunkData>> manager_chunks(managers.size());
+
+			wiJobSystem::Dispatch(ctx, (uint32_t)managers.size(), 1, [&](wiJobArgs args) {
+				const uint32_t manager = args.jobIndex;
+				const size_t count = managers[manager].count;
+				size_t offset = 0;
+				while (offset < count)
+				{
+					ChunkData chunk;
+					chunk.archive = archive.CreateChunk();
+					EntitySerializer chunk_seri;
+					chunk_seri.remap_collect = true;
+					size_t chunk_count = 0;
+					while (offset + chunk_count < count && chunk.archive.GetSize() < chunk_size)
+					{
+						managers[manager].components(chunk.archive, chunk_seri, offset + chunk_count, 1);
+						chunk_count++;
+					}
+					chunk.desc.manager = manager;
+					chunk.desc.offset = offset;
+					chunk.desc.count = chunk_count;
+					chunk.desc.size = chunk.archive.GetSize();
+					chunk.entities.reserve(chunk_seri.remap.size());
+					for (auto& x : chunk_seri.remap)
+					{
+						chunk.entities.push_back(x.first);
+					}
+					manager_chunks[manager].push_back(std::move(chunk));
+					offset += chunk_count;
+				}
+			});
+			wiJobSystem::Wait(ctx);
+
+			// The entities of the component managers are also collected into the remap table of seri while they are written:
+			wiArchive entity_lists = archive.CreateChunk();
+			seri.remap_collect = true;
+			for (auto& x : managers)
+			{
+				x.entities(entity_lists, seri);
+			}
+			seri.remap_collect = false;
+
+			// Merge the entities that were referenced by the chunks into the entity table:
+			for (auto& chunks_of_manager : manager_chunks)
+			{
+				for (auto& chunk : chunks_of_manager)
+				{
+					for (uint64_t mem : chunk.entities)
+					{
+						seri.remap.emplace(mem, (Entity)mem);
+					}
+				}
+			}
+			std::vector<uint64_t> entity_table;
+			entity_table.reserve(seri.remap.size());
+			for (auto& x : seri.remap)
+			{
+				entity_table.push_back(x.first);
+			}
+			std::sort(entity_table.begin(), entity_table.end()); // entities will be created in their original order when reading
+			archive << entity_table;
+
+			archive << (uint32_t)managers.size();
+			archive << entity_lists.GetSize();
+			archive.WriteChunk(entity_lists);
+
+			uint32_t chunkCount = 0;
+			for (auto& chunks_of_manager : manager_chunks)
+			{
+				chunkCount += (uint32_t)chunks_of_manager.size();
+			}
+			archive << chunkCount;
+			for (auto& chunks_of_manager : manager_chunks)
+			{
+				for (auto& chunk : chunks_of_manager)
+				{
+					archive << chunk.desc.manager;
+					archive << chunk.desc.offset;
+					archive << chunk.desc.count;
+					archive << chunk.desc.size;
+				}
+			}
+			for (auto& chunks_of_manager : manager_chunks)
+			{
+				for (auto& chunk : chunks_of_manager)
+				{
+					archive.WriteChunk(chunk.archive);
+				}
+			}
+		}
+	}
+
 	Entity Scene::Entity_Serialize(wiArchive& archive, Entity entity)
 	{
 		EntitySerializer seri;
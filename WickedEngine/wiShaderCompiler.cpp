@@ -3,9 +3,15 @@
 #include "wiPlatform.h"
 #include "wiHelper.h"
 #include "wiArchive.h"
+#include "wiStartupArguments.h"
+#include "wiVersion.h"
 
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstring>
 #include <unordered_set>
+#include <algorithm>
 #include <filesystem>
 
 
@@ -503,6 +509,333 @@ namespace wiShaderCompiler
 	}
 #endif // SHADERCOMPILER_ENABLED_D3DCOMPILER
 
+	// Shader cache:
+	//	A compiled shader is stored by the hash of everything that affects its compilation, so it can be reused after branch switches, on fresh checkouts and by other machines
+	std::string compiler_version[wiGraphics::SHADERFORMAT_COUNT];
+	std::string cache_directory;
+	std::atomic<uint32_t> cache_hits{ 0 };
+	std::atomic<uint32_t> cache_misses{ 0 };
+	std::atomic<uint32_t> cache_writes{ 0 };
+	std::atomic<uint32_t> cache_tempfile_counter{ 0 };
+
+	static const char* shadercacheextension = "wishadercache";
+	struct CacheFileHeader
+	{
+		static constexpr uint32_t MAGIC = 0x43535657; // "WVSC"
+		static constexpr uint32_t VERSION = 1;
+
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint64_t shadersize = 0;
+		uint64_t shaderhashsize = 0;
+		uint64_t datahash = 0;
+	};
+
+	// MurmurHash3 x64 128-bit, the cache key must not collide between machines that share the cache
+	void Hash128(const uint8_t* data, size_t size, uint64_t& h1, uint64_t& h2)
+	{
+		auto rotl64 = [](uint64_t x, int8_t r) { return (x << r) | (x >> (64 - r)); };
+		auto fmix64 = [](uint64_t k) {
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdull;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ull;
+			k ^= k >> 33;
+			return k;
+		};
+		const uint64_t c1 = 0x87c37b91114253d5ull;
+		const uint64_t c2 = 0x4cf5ad432745937full;
+		h1 = 0;
+		h2 = 0;
+
+		const size_t nblocks = size / 16;
+		for (size_t i = 0; i < nblocks; ++i)
+		{
+			uint64_t k1, k2;
+			std::memcpy(&k1, data + i * 16, sizeof(k1));
+			std::memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+
+			k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+			h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+			k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+			h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+		}
+
+		const uint8_t* tail = data + nblocks * 16;
+		uint64_t k1 = 0;
+		uint64_t k2 = 0;
+		const size_t tail_size = size & 15;
+		for (size_t i = tail_size; i > 8; --i)
+		{
+			k2 ^= uint64_t(tail[i - 1]) << ((i - 9) * 8);
+		}
+		if (tail_size > 8)
+		{
+			k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		}
+		for (size_t i = std::min(tail_size, size_t(8)); i > 0; --i)
+		{
+			k1 ^= uint64_t(tail[i - 1]) << ((i - 1) * 8);
+		}
+		if (tail_size > 0)
+		{
+			k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		}
+
+		h1 ^= (uint64_t)size;
+		h2 ^= (uint64_t)size;
+		h1 += h2;
+		h2 += h1;
+		h1 = fmix64(h1);
+		h2 = fmix64(h2);
+		h1 += h2;
+		h2 += h1;
+	}
+
+	// Appends the contents of a source file and all the files that it includes (recursively) to the key data
+	//	Includes are resolved like the compilers do: relative to the including file first, then the include directories
+	//	Every #include directive is followed, even in inactive preprocessor branches, so the key can only be more conservative than the real dependencies
+	void GatherSource(const std::string& filename, const std::string& includename, const std::vector<std::string>& include_directories, std::vector<uint8_t>& keydata, std::vector<std::string>& dependencies, std::unordered_set<std::string>& visited)
+	{
+		// The include name is hashed instead of the path, which is different on every machine:
+		keydata.insert(keydata.end(), includename.begin(), includename.end());
+		keydata.push_back(0);
+
+		if (!visited.insert(filename).second)
+		{
+			return; // included multiple times, the name is enough to make the key unique
+		}
+
+		std::vector<uint8_t> filedata;
+		if (!wiHelper::FileRead(filename, filedata))
+		{
+			return;
+		}
+		dependencies.push_back(filename);
+		for (uint8_t x : filedata)
+		{
+			if (x != '\r') // line endings depend on the checkout settings of the machine
+			{
+				keydata.push_back(x);
+			}
+		}
+		keydata.push_back(0);
+
+		const std::string directory = wiHelper::GetDirectoryFromPath(filename);
+		const char* text = (const char*)filedata.data();
+		const size_t size = filedata.size();
+		size_t pos = 0;
+		while (pos < size)
+		{
+			size_t end = pos;
+			while (end < size && text[end] != '\n')
+			{
+				end++;
+			}
+
+			size_t i = pos;
+			auto skip_whitespace = [&]() {
+				while (i < end && (text[i] == ' ' || text[i] == '\t'))
+				{
+					i++;
+				}
+			};
+			skip_whitespace();
+			if (i < end && text[i] == '#')
+			{
+				i++;
+				skip_whitespace();
+				static const char include_directive[] = "include";
+				const size_t directive_length = sizeof(include_directive) - 1;
+				if (end - i > directive_length && std::strncmp(text + i, include_directive, directive_length) == 0)
+				{
+					i += directive_length;
+					skip_whitespace();
+					if (i < end && (text[i] == '"' || text[i] == '<'))
+					{
+						const char terminator = text[i] == '"' ? '"' : '>';
+						const size_t name_begin = ++i;
+						while (i < end && text[i] != terminator)
+						{
+							i++;
+						}
+						if (i < end)
+						{
+							const std::string name(text + name_begin, i - name_begin);
+							std::string resolved = directory + name;
+							if (!wiHelper::FileExists(resolved))
+							{
+								resolved.clear();
+								for (auto& x : include_directories)
+								{
+									if (wiHelper::FileExists(x + name))
+									{
+										resolved = x + name;
+										break;
+									}
+								}
+							}
+							if (!resolved.empty())
+							{
+								wiHelper::MakePathAbsolute(resolved);
+								GatherSource(resolved, name, include_directories, keydata, dependencies, visited);
+							}
+						}
+					}
+				}
+			}
+
+			pos = end + 1;
+		}
+	}
+
+	// Computes the cache file name of a compilation, returns empty string if the shader can't be cached
+	std::string GetCacheFileName(const CompilerInput& input, std::vector<std::string>& dependencies)
+	{
+		if (cache_directory.empty() || input.format >= wiGraphics::SHADERFORMAT_COUNT || compiler_version[input.format].empty())
+		{
+			return "";
+		}
+
+		std::vector<uint8_t> keydata;
+		auto append = [&](const std::string& str) {
+			keydata.insert(keydata.end(), str.begin(), str.end());
+			keydata.push_back(0);
+		};
+		append(std::to_string(CacheFileHeader::VERSION));
+		append(wiVersion::GetVersionString()); // the engine decides the compiler arguments
+		append(compiler_version[input.format]);
+		append(std::to_string(input.format));
+		append(std::to_string(input.stage));
+		append(std::to_string(input.minshadermodel));
+		append(std::to_string(input.flags));
+		append(input.entrypoint);
+		for (auto& x : input.defines)
+		{
+			append(x);
+		}
+		append("");
+
+		std::string sourcefilename = input.shadersourcefilename;
+		wiHelper::MakePathAbsolute(sourcefilename);
+		std::unordered_set<std::string> visited;
+		GatherSource(sourcefilename, wiHelper::GetFileNameFromPath(sourcefilename), input.include_directories, keydata, dependencies, visited);
+		if (dependencies.empty())
+		{
+			return ""; // source file doesn't exist, let the compiler report the error
+		}
+
+		uint64_t h1, h2;
+		Hash128(keydata.data(), keydata.size(), h1, h2);
+		char name[33] = {};
+		snprintf(name, arraysize(name), "%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+		return cache_directory + name + "." + shadercacheextension;
+	}
+
+	uint64_t CacheDataHash(const uint8_t* data, size_t size)
+	{
+		uint64_t h1, h2;
+		Hash128(data, size, h1, h2);
+		return h1;
+	}
+
+	bool LoadFromCache(const std::string& cachefilename, CompilerOutput& output)
+	{
+		if (!wiHelper::FileExists(cachefilename))
+		{
+			return false;
+		}
+		auto filedata = std::make_shared<std::vector<uint8_t>>();
+		if (!wiHelper::FileRead(cachefilename, *filedata) || filedata->size() < sizeof(CacheFileHeader))
+		{
+			return false;
+		}
+		CacheFileHeader header;
+		std::memcpy(&header, filedata->data(), sizeof(header));
+		const uint8_t* data = filedata->data() + sizeof(header);
+		const size_t datasize = filedata->size() - sizeof(header);
+		if (
+			header.magic != CacheFileHeader::MAGIC ||
+			header.version != CacheFileHeader::VERSION ||
+			header.shadersize == 0 ||
+			header.shadersize + header.shaderhashsize != datasize ||
+			header.datahash != CacheDataHash(data, datasize)
+			)
+		{
+			return false; // incomplete or corrupted, it will be overwritten by a successful compilation
+		}
+
+		output.shaderdata = data;
+		output.shadersize = (size_t)header.shadersize;
+		output.shaderhash.assign(data + header.shadersize, data + datasize);
+		output.internal_state = filedata; // keep the file data alive == keep shader pointer valid!
+		return true;
+	}
+
+	void StoreToCache(const std::string& cachefilename, const CompilerOutput& output)
+	{
+		CacheFileHeader header;
+		header.shadersize = output.shadersize;
+		header.shaderhashsize = output.shaderhash.size();
+
+		std::vector<uint8_t> filedata(sizeof(header) + output.shadersize + output.shaderhash.size());
+		uint8_t* data = filedata.data() + sizeof(header);
+		std::memcpy(data, output.shaderdata, output.shadersize);
+		if (!output.shaderhash.empty())
+		{
+			std::memcpy(data + output.shadersize, output.shaderhash.data(), output.shaderhash.size());
+		}
+		header.datahash = CacheDataHash(data, filedata.size() - sizeof(header));
+		std::memcpy(filedata.data(), &header, sizeof(header));
+
+		// Other threads and machines can write the same entry at the same time, so the file is written under a unique temporary name and then moved in place
+		//	Readers never see a partially written entry, and if multiple writers race, any of them can win because they contain the same shader
+		std::string tempfilename = cachefilename + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "_" + std::to_string(cache_tempfile_counter.fetch_add(1)) + ".tmp";
+		if (!wiHelper::FileWrite(tempfilename, filedata.data(), filedata.size()))
+		{
+			return;
+		}
+		std::error_code ec;
+		std::filesystem::rename(tempfilename, cachefilename, ec);
+		if (ec)
+		{
+			std::filesystem::remove(tempfilename, ec); // the destination can be locked by a reader on some platforms, it was written by someone else then
+			return;
+		}
+		cache_writes.fetch_add(1);
+	}
+
+	void SetCacheDirectory(const std::string& path)
+	{
+		cache_directory = path;
+		if (!cache_directory.empty())
+		{
+			if (cache_directory.back() != '/' && cache_directory.back() != '\\')
+			{
+				cache_directory += "/";
+			}
+			wiHelper::DirectoryCreate(cache_directory);
+		}
+	}
+	const std::string& GetCacheDirectory()
+	{
+		return cache_directory;
+	}
+	CacheStatistics GetCacheStatistics()
+	{
+		CacheStatistics statistics;
+		statistics.hits = cache_hits.load();
+		statistics.misses = cache_misses.load();
+		statistics.writes = cache_writes.load();
+		return statistics;
+	}
+	void ResetCacheStatistics()
+	{
+		cache_hits.store(0);
+		cache_misses.store(0);
+		cache_writes.store(0);
+	}
+
 	void Initialize()
 	{
 #ifdef SHADERCOMPILER_ENABLED_DXCOMPILER
@@ -518,6 +851,31 @@ namespace wiShaderCompiler
 				assert(SUCCEEDED(hr));
 				hr = dxcUtils->CreateDefaultIncludeHandler(&dxcIncludeHandler);
 				assert(SUCCEEDED(hr));
+
+				std::string version = "dxcompiler";
+				CComPtr<IDxcVersionInfo> versionInfo;
+				if (SUCCEEDED(dxcCompiler->QueryInterface(IID_PPV_ARGS(&versionInfo))))
+				{
+					UINT32 major = 0, minor = 0;
+					if (SUCCEEDED(versionInfo->GetVersion(&major, &minor)))
+					{
+						version += " " + std::to_string(major) + "." + std::to_string(minor);
+					}
+					CComPtr<IDxcVersionInfo2> versionInfo2;
+					if (SUCCEEDED(versionInfo->QueryInterface(IID_PPV_ARGS(&versionInfo2))))
+					{
+						UINT32 commitCount = 0;
+						char* commitHash = nullptr;
+						if (SUCCEEDED(versionInfo2->GetCommitInfo(&commitCount, &commitHash)) && commitHash != nullptr)
+						{
+							version += " " + std::to_string(commitCount) + " " + commitHash;
+							CoTaskMemFree(commitHash);
+						}
+					}
+				}
+				compiler_version[wiGraphics::SHADERFORMAT_HLSL6] = version;
+				compiler_version[wiGraphics::SHADERFORMAT_SPIRV] = version;
+
 				wiBackLog::post("wiShaderCompiler: loaded dxcompiler.dll");
 			}
 		}
@@ -530,11 +888,19 @@ namespace wiShaderCompiler
 			D3DCompile = (PFN_D3DCOMPILE)wiGetProcAddress(d3dcompiler, "D3DCompile");
 			if (D3DCompile != nullptr)
 			{
+				compiler_version[wiGraphics::SHADERFORMAT_HLSL5] = "d3dcompiler_47";
 				wiBackLog::post("wiShaderCompiler: loaded d3dcompiler_47.dll");
 			}
 		}
 #endif // SHADERCOMPILER_ENABLED_D3DCOMPILER
 
+		std::string cache_argument = wiStartupArguments::GetArgumentValue("shadercache");
+		if (!cache_argument.empty())
+		{
+			SetCacheDirectory(cache_argument);
+			wiBackLog::post(("wiShaderCompiler: shader cache directory: " + cache_directory).c_str());
+		}
+
 	}
 
 	void Compile(const CompilerInput& input, CompilerOutput& output)
@@ -542,6 +908,19 @@ namespace wiShaderCompiler
 		output = CompilerOutput();
 
 #ifdef SHADERCOMPILER_ENABLED
+		std::vector<std::string> dependencies;
+		const std::string cachefilename = GetCacheFileName(input, dependencies);
+		if (!cachefilename.empty())
+		{
+			if (LoadFromCache(cachefilename, output))
+			{
+				output.dependencies = dependencies;
+				cache_hits.fetch_add(1);
+				return;
+			}
+			cache_misses.fetch_add(1);
+		}
+
 		switch (input.format)
 		{
 		default:
@@ -561,6 +940,11 @@ namespace wiShaderCompiler
 #endif // SHADERCOMPILER_ENABLED_D3DCOMPILER
 
 		}
+
+		if (!cachefilename.empty() && output.IsValid())
+		{
+			StoreToCache(cachefilename, output);
+		}
 #endif // SHADERCOMPILER_ENABLED
 	}
 
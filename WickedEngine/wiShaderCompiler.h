@@ -39,6 +39,23 @@ namespace wiShaderCompiler
 	};
 	void Compile(const CompilerInput& input, CompilerOutput& output);
 
+	// Compiled shaders are stored in the cache directory by the hash of their source and include file contents, defines, entry point, target format, shader model and compiler version
+	//	Compile() returns a shader from the cache if it was compiled before with the same inputs, on this or any other machine that shares the directory
+	//	Multiple threads and processes can write to the cache at the same time
+	//	It can also be set with the shadercache=<path> startup argument. Empty path disables the cache (default)
+	void SetCacheDirectory(const std::string& path);
+	const std::string& GetCacheDirectory();
+	struct CacheStatistics
+	{
+		uint32_t hits = 0;		// compilations that were served from the cache
+		uint32_t misses = 0;	// compilations that were not found in the cache
+		uint32_t writes = 0;	// compiled shaders that were stored in the cache
+
+		inline float GetHitRate() const { return hits + misses > 0 ? float(hits) / float(hits + misses) : 0.0f; }
+	};
+	CacheStatistics GetCacheStatistics();
+	void ResetCacheStatistics();
+
 	bool SaveShaderAndMetadata(const std::string& shaderfilename, const CompilerOutput& output);
 	bool IsShaderOutdated(const std::string& shaderfilename);
 
@@ -41,4 +41,15 @@ namespace wiStartupArguments
 		return params.find(value) != params.end();
 	}
 
+	string GetArgumentValue(const string& name)
+	{
+		const string prefix = name + "=";
+		auto it = params.lower_bound(prefix);
+		if (it != params.end() && it->compare(0, prefix.length(), prefix) == 0)
+		{
+			return it->substr(prefix.length());
+		}
+		return "";
+	}
+
 }
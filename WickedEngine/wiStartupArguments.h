@@ -7,4 +7,6 @@ namespace wiStartupArguments
 	void Parse(const wchar_t* args);
     void Parse(int argc, char *argv[]);
 	bool HasArgument(const std::string& value);
+	// Returns the value of an argument that was specified in the form of name=value, or empty string if not found
+	std::string GetArgumentValue(const std::string& name);
 }
@@ -0,0 +1,1057 @@
+#include "wiTextureCooker.h"
+#include "wiJobSystem.h"
+#include "wiHelper.h"
+
+#include "Utility/stb_image.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+using namespace wiGraphics;
+
+namespace wiTextureCooker
+{
+	// Tables for the conversion between sRGB and linear color
+	struct ColorTables
+	{
+		float srgb_to_linear[256];
+		uint8_t linear_to_srgb[4096];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				const float c = i / 255.0f;
+				srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < 4096; ++i)
+			{
+				const float c = i / 4095.0f;
+				const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+				linear_to_srgb[i] = (uint8_t)std::min(255.0f, s * 255.0f + 0.5f);
+			}
+		}
+	};
+	const ColorTables& GetColorTables()
+	{
+		static ColorTables tables;
+		return tables;
+	}
+
+	// DDS file layout, with the DX10 extended header:
+	struct DDS_PIXELFORMAT
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+	struct DDS_HEADER
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDS_PIXELFORMAT ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+	struct DDS_HEADER_DXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+	static_assert(sizeof(DDS_HEADER) == 124, "DDS header size mismatch");
+
+	inline bool IsSRGB(FORMAT format)
+	{
+		return format == FORMAT_BC1_UNORM_SRGB || format == FORMAT_BC3_UNORM_SRGB || format == FORMAT_BC7_UNORM_SRGB;
+	}
+	inline uint32_t GetBlockBytes(FORMAT format)
+	{
+		return (format == FORMAT_BC1_UNORM || format == FORMAT_BC1_UNORM_SRGB || format == FORMAT_BC4_UNORM) ? 8 : 16;
+	}
+	inline uint32_t GetDXGIFormat(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1_UNORM: return 71;
+		case FORMAT_BC1_UNORM_SRGB: return 72;
+		case FORMAT_BC3_UNORM: return 77;
+		case FORMAT_BC3_UNORM_SRGB: return 78;
+		case FORMAT_BC4_UNORM: return 80;
+		case FORMAT_BC5_UNORM: return 83;
+		case FORMAT_BC7_UNORM: return 98;
+		case FORMAT_BC7_UNORM_SRGB: return 99;
+		default: return 0;
+		}
+	}
+
+	bool IsFormatSupported(FORMAT format)
+	{
+		return GetDXGIFormat(format) != 0;
+	}
+
+	size_t GetCompressedSize(uint32_t width, uint32_t height, FORMAT format)
+	{
+		return size_t((width + 3) / 4) * size_t((height + 3) / 4) * GetBlockBytes(format);
+	}
+
+	// Gathers a 4x4 block of pixels, the pixels outside the image are clamped to the edge
+	inline void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[16][4])
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const size_t row = size_t(std::min(by * 4 + y, height - 1)) * width;
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				std::memcpy(block[y * 4 + x], rgba + (row + std::min(bx * 4 + x, width - 1)) * 4, 4);
+			}
+		}
+	}
+	inline void GetChannel(const uint8_t block[16][4], uint32_t channel, uint8_t values[16])
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			values[i] = block[i][channel];
+		}
+	}
+
+	// Computes the mean and the principal axis (direction of the largest variance) of the points
+	void PrincipalAxis(const XMVECTOR* points, uint32_t count, XMVECTOR& mean, XMVECTOR& axis)
+	{
+		XMVECTOR sum = XMVectorZero();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			sum = XMVectorAdd(sum, points[i]);
+		}
+		mean = XMVectorScale(sum, 1.0f / count);
+
+		XMVECTOR covariance[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const XMVECTOR d = XMVectorSubtract(points[i], mean);
+			covariance[0] = XMVectorMultiplyAdd(d, XMVectorSplatX(d), covariance[0]);
+			covariance[1] = XMVectorMultiplyAdd(d, XMVectorSplatY(d), covariance[1]);
+			covariance[2] = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), covariance[2]);
+			covariance[3] = XMVectorMultiplyAdd(d, XMVectorSplatW(d), covariance[3]);
+		}
+
+		// Power iteration, starting from the covariance row with the largest magnitude:
+		axis = covariance[0];
+		float magnitude = XMVectorGetX(XMVector4LengthSq(covariance[0]));
+		for (uint32_t i = 1; i < 4; ++i)
+		{
+			const float m = XMVectorGetX(XMVector4LengthSq(covariance[i]));
+			if (m > magnitude)
+			{
+				magnitude = m;
+				axis = covariance[i];
+			}
+		}
+		if (magnitude < 1e-6f)
+		{
+			axis = XMVectorSet(0.57735f, 0.57735f, 0.57735f, 0); // solid color
+			return;
+		}
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			XMVECTOR v = XMVectorMultiply(covariance[0], XMVectorSplatX(axis));
+			v = XMVectorMultiplyAdd(covariance[1], XMVectorSplatY(axis), v);
+			v = XMVectorMultiplyAdd(covariance[2], XMVectorSplatZ(axis), v);
+			v = XMVectorMultiplyAdd(covariance[3], XMVectorSplatW(axis), v);
+			axis = XMVector4Normalize(v);
+		}
+	}
+
+	// Computes the endpoints as the extents of the points projected onto the axis
+	void AxisExtents(const XMVECTOR* points, uint32_t count, XMVECTOR mean, XMVECTOR axis, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float tmin = FLT_MAX;
+		float tmax = -FLT_MAX;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(points[i], mean), axis));
+			tmin = std::min(tmin, t);
+			tmax = std::max(tmax, t);
+		}
+		const XMVECTOR lo = XMVectorZero();
+		const XMVECTOR hi = XMVectorReplicate(255);
+		e0 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(tmax), mean), lo, hi);
+		e1 = XMVectorClamp(XMVectorMultiplyAdd(axis, XMVectorReplicate(tmin), mean), lo, hi);
+	}
+
+	// Least squares fit of the endpoints to the points with fixed interpolation weights: point = e0 * weight + e1 * (1 - weight)
+	//	Returns false if it can't be solved (all weights are the same)
+	bool LeastSquares(const XMVECTOR* points, const float* weights, uint32_t count, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float aa = 0;
+		float ab = 0;
+		float bb = 0;
+		XMVECTOR ax = XMVectorZero();
+		XMVECTOR bx = XMVectorZero();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const float a = weights[i];
+			const float b = 1 - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax = XMVectorMultiplyAdd(points[i], XMVectorReplicate(a), ax);
+			bx = XMVectorMultiplyAdd(points[i], XMVectorReplicate(b), bx);
+		}
+		const float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f)
+		{
+			return false;
+		}
+		const float inv = 1.0f / det;
+		const XMVECTOR lo = XMVectorZero();
+		const XMVECTOR hi = XMVectorReplicate(255);
+		e0 = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(ax, bb), XMVectorScale(bx, ab)), inv), lo, hi);
+		e1 = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(bx, aa), XMVectorScale(ax, ab)), inv), lo, hi);
+		return true;
+	}
+
+	inline uint32_t GetIterationCount(Quality quality)
+	{
+		switch (quality)
+		{
+		case Quality::Fast:
+			return 1;
+		case Quality::High:
+			return 4;
+		default:
+			return 2;
+		}
+	}
+
+
+	// BC1: two RGB565 endpoints and 2 bit indices, the color block of BC3 is the same
+
+	inline uint16_t PackRGB565(XMVECTOR color)
+	{
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, color);
+		const uint32_t r = (uint32_t)std::round(c.x * 31.0f / 255.0f);
+		const uint32_t g = (uint32_t)std::round(c.y * 63.0f / 255.0f);
+		const uint32_t b = (uint32_t)std::round(c.z * 31.0f / 255.0f);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+	inline void UnpackRGB565(uint16_t color, int rgb[3])
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+	// In three color mode the last entry is transparent black
+	inline void PaletteBC1(uint16_t c0, uint16_t c1, bool three_color, int palette[4][3])
+	{
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			if (three_color)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+			else
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+		}
+	}
+
+	// The alpha is only used for punch-through transparency (alpha < 128) if it's enabled
+	void EncodeBC1(const uint8_t block[16][4], Quality quality, bool punchthrough, uint8_t* dst)
+	{
+		static constexpr float weights4[] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static constexpr float weights3[] = { 1.0f, 0.0f, 0.5f };
+
+		XMVECTOR points[16];
+		uint32_t opaque[16];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			if (!punchthrough || block[i][3] >= 128)
+			{
+				opaque[count] = i;
+				points[count] = XMVectorSet(block[i][0], block[i][1], block[i][2], 0);
+				count++;
+			}
+		}
+		const bool three_color = count < 16; // transparent pixels need the three color mode
+
+		// Fully transparent block is in three color mode, with every index pointing to transparent:
+		uint16_t best_c0 = 0;
+		uint16_t best_c1 = 0;
+		uint32_t best_indices = ~0u;
+
+		if (count > 0)
+		{
+			XMVECTOR mean, axis, e0, e1;
+			PrincipalAxis(points, count, mean, axis);
+			AxisExtents(points, count, mean, axis, e0, e1);
+
+			uint32_t best_error = ~0u;
+			const uint32_t iterations = GetIterationCount(quality);
+			for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+			{
+				uint16_t c0 = PackRGB565(e0);
+				uint16_t c1 = PackRGB565(e1);
+				// Four color mode requires c0 > c1, three color mode requires c0 <= c1:
+				if (three_color ? (c0 > c1) : (c0 < c1))
+				{
+					std::swap(c0, c1);
+					std::swap(e0, e1);
+				}
+				int palette[4][3];
+				PaletteBC1(c0, c1, three_color, palette);
+				const uint32_t palette_size = (three_color || c0 == c1) ? 3 : 4; // equal endpoints would be decoded as three color mode
+
+				uint32_t indices = three_color ? ~0u : 0u; // transparent pixels keep index 3
+				uint32_t error = 0;
+				float weights[16];
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const uint8_t* pixel = block[opaque[i]];
+					uint32_t index = 0;
+					uint32_t distance = ~0u;
+					for (uint32_t j = 0; j < palette_size; ++j)
+					{
+						const int dr = pixel[0] - palette[j][0];
+						const int dg = pixel[1] - palette[j][1];
+						const int db = pixel[2] - palette[j][2];
+						const uint32_t d = uint32_t(dr * dr + dg * dg + db * db);
+						if (d < distance)
+						{
+							distance = d;
+							index = j;
+						}
+					}
+					error += distance;
+					const uint32_t shift = opaque[i] * 2;
+					indices = (indices & ~(3u << shift)) | (index << shift);
+					weights[i] = three_color ? weights3[index] : weights4[index];
+				}
+
+				if (error < best_error)
+				{
+					best_error = error;
+					best_c0 = c0;
+					best_c1 = c1;
+					best_indices = indices;
+				}
+				if (error == 0 || iteration + 1 == iterations || !LeastSquares(points, weights, count, e0, e1))
+				{
+					break;
+				}
+			}
+		}
+
+		dst[0] = uint8_t(best_c0 & 0xFF);
+		dst[1] = uint8_t(best_c0 >> 8);
+		dst[2] = uint8_t(best_c1 & 0xFF);
+		dst[3] = uint8_t(best_c1 >> 8);
+		std::memcpy(dst + 4, &best_indices, sizeof(best_indices)); // little endian
+	}
+
+	void DecodeBC1(const uint8_t* src, bool allow_three_color, uint8_t block[16][4])
+	{
+		const uint16_t c0 = uint16_t(src[0] | (src[1] << 8));
+		const uint16_t c1 = uint16_t(src[2] | (src[3] << 8));
+		uint32_t indices;
+		std::memcpy(&indices, src + 4, sizeof(indices));
+		const bool three_color = allow_three_color && c0 <= c1; // BC3 color blocks are always four color mode
+		int palette[4][3];
+		PaletteBC1(c0, c1, three_color, palette);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t index = (indices >> (i * 2)) & 3;
+			block[i][0] = uint8_t(palette[index][0]);
+			block[i][1] = uint8_t(palette[index][1]);
+			block[i][2] = uint8_t(palette[index][2]);
+			block[i][3] = (three_color && index == 3) ? 0 : 255;
+		}
+	}
+
+
+	// BC4: single channel with two 8 bit endpoints and 3 bit indices, BC3 alpha and the two channels of BC5 are the same
+
+	// If a0 > a1, there are 6 interpolated values, otherwise 4 interpolated values and exact 0 and 255
+	inline void PaletteBC4(int a0, int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+	// Returns the squared error of the best indices for the endpoints
+	inline uint32_t FitBC4(const uint8_t values[16], int a0, int a1, uint64_t& indices)
+	{
+		int palette[8];
+		PaletteBC4(a0, a1, palette);
+		indices = 0;
+		uint32_t error = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t index = 0;
+			uint32_t distance = ~0u;
+			for (uint32_t j = 0; j < 8; ++j)
+			{
+				const int d = values[i] - palette[j];
+				if (uint32_t(d * d) < distance)
+				{
+					distance = uint32_t(d * d);
+					index = j;
+				}
+			}
+			error += distance;
+			indices |= uint64_t(index) << (i * 3);
+		}
+		return error;
+	}
+
+	void EncodeBC4(const uint8_t values[16], Quality quality, uint8_t* dst)
+	{
+		int minimum = 255;
+		int maximum = 0;
+		int inner_minimum = 255; // range of the values that are not exactly 0 or 255
+		int inner_maximum = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			minimum = std::min(minimum, int(values[i]));
+			maximum = std::max(maximum, int(values[i]));
+			if (values[i] > 0 && values[i] < 255)
+			{
+				inner_minimum = std::min(inner_minimum, int(values[i]));
+				inner_maximum = std::max(inner_maximum, int(values[i]));
+			}
+		}
+
+		int best_a0 = maximum;
+		int best_a1 = minimum;
+		uint64_t best_indices;
+		uint32_t best_error = FitBC4(values, best_a0, best_a1, best_indices);
+
+		auto attempt = [&](int a0, int a1) {
+			uint64_t indices;
+			const uint32_t error = FitBC4(values, a0, a1, indices);
+			if (error < best_error)
+			{
+				best_error = error;
+				best_a0 = a0;
+				best_a1 = a1;
+				best_indices = indices;
+			}
+		};
+		if (quality != Quality::Fast && best_error > 0 && inner_minimum <= inner_maximum)
+		{
+			attempt(inner_minimum, inner_maximum); // exact 0 and 255 with the rest interpolated
+		}
+		if (quality == Quality::High && best_error > 0)
+		{
+			// Search around the endpoints, the interpolated values are rounded so the extents are not always the best:
+			const int a0 = best_a0;
+			const int a1 = best_a1;
+			for (int d0 = -2; d0 <= 2; ++d0)
+			{
+				for (int d1 = -2; d1 <= 2; ++d1)
+				{
+					const int b0 = std::clamp(a0 + d0, 0, 255);
+					const int b1 = std::clamp(a1 + d1, 0, 255);
+					if ((b0 > b1) == (a0 > a1)) // stay in the same mode
+					{
+						attempt(b0, b1);
+					}
+				}
+			}
+		}
+
+		dst[0] = uint8_t(best_a0);
+		dst[1] = uint8_t(best_a1);
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			dst[2 + i] = uint8_t(best_indices >> (i * 8));
+		}
+	}
+
+	void DecodeBC4(const uint8_t* src, uint32_t channel, uint8_t block[16][4])
+	{
+		int palette[8];
+		PaletteBC4(src[0], src[1], palette);
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			indices |= uint64_t(src[2 + i]) << (i * 8);
+		}
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			block[i][channel] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+		}
+	}
+
+
+	// BC7: only mode 6 is used, which has a single subset with RGBA 7 bit endpoints, a p-bit per endpoint and 4 bit indices
+	//	This handles color and alpha together, which is a good fit for most textures without the partition search of the other modes
+
+	static constexpr int bc7_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter
+	{
+		uint8_t* data;
+		uint32_t position = 0;
+
+		inline void write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++position)
+			{
+				if ((value >> i) & 1)
+				{
+					data[position >> 3] |= uint8_t(1u << (position & 7));
+				}
+			}
+		}
+	};
+	struct BitReader
+	{
+		const uint8_t* data;
+		uint32_t position = 0;
+
+		inline uint32_t read(uint32_t bits)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < bits; ++i, ++position)
+			{
+				value |= uint32_t((data[position >> 3] >> (position & 7)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	// Quantizes an endpoint to 7 bits per channel with the p-bit as the lowest bit, returns the squared error
+	inline float QuantizeBC7(XMVECTOR endpoint, uint32_t pbit, int quantized[4])
+	{
+		XMFLOAT4 e;
+		XMStoreFloat4(&e, endpoint);
+		const float v[4] = { e.x, e.y, e.z, e.w };
+		float error = 0;
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			quantized[c] = std::clamp((int)std::round((v[c] - pbit) * 0.5f), 0, 127);
+			const float d = float(quantized[c] * 2 + (int)pbit) - v[c];
+			error += d * d;
+		}
+		return error;
+	}
+	inline uint32_t FitBC7(const uint8_t block[16][4], const int q0[4], const int q1[4], uint32_t p0, uint32_t p1, uint8_t indices[16])
+	{
+		int palette[16][4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const int e0 = q0[c] * 2 + (int)p0;
+			const int e1 = q1[c] * 2 + (int)p1;
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				palette[i][c] = ((64 - bc7_weights4[i]) * e0 + bc7_weights4[i] * e1 + 32) >> 6;
+			}
+		}
+		uint32_t error = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			uint32_t index = 0;
+			uint32_t distance = ~0u;
+			for (uint32_t j = 0; j < 16; ++j)
+			{
+				const int dr = block[i][0] - palette[j][0];
+				const int dg = block[i][1] - palette[j][1];
+				const int db = block[i][2] - palette[j][2];
+				const int da = block[i][3] - palette[j][3];
+				const uint32_t d = uint32_t(dr * dr + dg * dg + db * db + da * da);
+				if (d < distance)
+				{
+					distance = d;
+					index = j;
+				}
+			}
+			error += distance;
+			indices[i] = uint8_t(index);
+		}
+		return error;
+	}
+
+	void EncodeBC7(const uint8_t block[16][4], Quality quality, uint8_t* dst)
+	{
+		XMVECTOR points[16];
+		bool opaque = true;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			points[i] = XMVectorSet(block[i][0], block[i][1], block[i][2], block[i][3]);
+			opaque &= block[i][3] == 255;
+		}
+		XMVECTOR mean, axis, e0, e1;
+		PrincipalAxis(points, 16, mean, axis);
+		AxisExtents(points, 16, mean, axis, e0, e1);
+
+		uint32_t best_error = ~0u;
+		int best_q0[4] = {};
+		int best_q1[4] = {};
+		uint32_t best_p0 = 0;
+		uint32_t best_p1 = 0;
+		uint8_t best_indices[16] = {};
+
+		const uint32_t iterations = GetIterationCount(quality);
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+		{
+			uint32_t iteration_error = ~0u;
+			uint8_t iteration_indices[16];
+			for (uint32_t pbits = 0; pbits < 4; ++pbits)
+			{
+				int q0[4];
+				int q1[4];
+				uint32_t p0 = pbits & 1;
+				uint32_t p1 = pbits >> 1;
+				if (opaque)
+				{
+					// Opaque blocks use both p-bits, so that the alpha is exactly 255:
+					if (pbits > 0)
+					{
+						break;
+					}
+					p0 = 1;
+					p1 = 1;
+					QuantizeBC7(e0, p0, q0);
+					QuantizeBC7(e1, p1, q1);
+				}
+				else if (quality == Quality::High)
+				{
+					QuantizeBC7(e0, p0, q0);
+					QuantizeBC7(e1, p1, q1);
+				}
+				else
+				{
+					// The p-bits are chosen by the smallest endpoint error instead of trying every combination:
+					if (pbits > 0)
+					{
+						break;
+					}
+					int t[4];
+					p0 = QuantizeBC7(e0, 1, t) < QuantizeBC7(e0, 0, q0) ? 1 : 0;
+					p1 = QuantizeBC7(e1, 1, t) < QuantizeBC7(e1, 0, q1) ? 1 : 0;
+					QuantizeBC7(e0, p0, q0);
+					QuantizeBC7(e1, p1, q1);
+				}
+
+				uint8_t indices[16];
+				const uint32_t error = FitBC7(block, q0, q1, p0, p1, indices);
+				if (error < iteration_error)
+				{
+					iteration_error = error;
+					std::memcpy(iteration_indices, indices, sizeof(indices));
+				}
+				if (error < best_error)
+				{
+					best_error = error;
+					std::memcpy(best_q0, q0, sizeof(q0));
+					std::memcpy(best_q1, q1, sizeof(q1));
+					best_p0 = p0;
+					best_p1 = p1;
+					std::memcpy(best_indices, indices, sizeof(indices));
+				}
+			}
+
+			if (best_error == 0 || iteration + 1 == iterations)
+			{
+				break;
+			}
+			float weights[16];
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				weights[i] = 1.0f - bc7_weights4[iteration_indices[i]] / 64.0f;
+			}
+			if (!LeastSquares(points, weights, 16, e0, e1))
+			{
+				break;
+			}
+		}
+
+		// The highest bit of the first index is implicit zero, so the endpoints are swapped if needed:
+		if (best_indices[0] & 8)
+		{
+			std::swap(best_q0, best_q1);
+			std::swap(best_p0, best_p1);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				best_indices[i] = uint8_t(15 - best_indices[i]);
+			}
+		}
+
+		std::memset(dst, 0, 16);
+		BitWriter writer = { dst };
+		writer.write(1u << 6, 7); // mode 6
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			writer.write(best_q0[c], 7);
+			writer.write(best_q1[c], 7);
+		}
+		writer.write(best_p0, 1);
+		writer.write(best_p1, 1);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			writer.write(best_indices[i], i == 0 ? 3 : 4);
+		}
+	}
+
+	bool DecodeBC7(const uint8_t* src, uint8_t block[16][4])
+	{
+		BitReader reader = { src };
+		if (reader.read(7) != (1u << 6))
+		{
+			std::memset(block, 0, 16 * 4);
+			return false; // not mode 6
+		}
+		int e0[4];
+		int e1[4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			e0[c] = int(reader.read(7)) << 1;
+			e1[c] = int(reader.read(7)) << 1;
+		}
+		const int p0 = int(reader.read(1));
+		const int p1 = int(reader.read(1));
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const int w = bc7_weights4[reader.read(i == 0 ? 3 : 4)];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				block[i][c] = uint8_t(((64 - w) * (e0[c] | p0) + w * (e1[c] | p1) + 32) >> 6);
+			}
+		}
+		return true;
+	}
+
+
+	bool Compress(const uint8_t* rgba, uint32_t width, uint32_t height, FORMAT format, Quality quality, uint8_t* dst)
+	{
+		if (!IsFormatSupported(format) || width == 0 || height == 0)
+		{
+			return false;
+		}
+		const uint32_t blocks_x = (width + 3) / 4;
+		const uint32_t blocks_y = (height + 3) / 4;
+		const uint32_t block_bytes = GetBlockBytes(format);
+
+		// Every row of blocks is a job:
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, blocks_y, 1, [&](wiJobArgs args) {
+			const uint32_t by = args.jobIndex;
+			uint8_t block[16][4];
+			uint8_t values[16];
+			for (uint32_t bx = 0; bx < blocks_x; ++bx)
+			{
+				LoadBlock(rgba, width, height, bx, by, block);
+				uint8_t* dst_block = dst + (size_t(by) * blocks_x + bx) * block_bytes;
+				switch (format)
+				{
+				case FORMAT_BC1_UNORM:
+				case FORMAT_BC1_UNORM_SRGB:
+					EncodeBC1(block, quality, true, dst_block);
+					break;
+				case FORMAT_BC3_UNORM:
+				case FORMAT_BC3_UNORM_SRGB:
+					GetChannel(block, 3, values);
+					EncodeBC4(values, quality, dst_block);
+					EncodeBC1(block, quality, false, dst_block + 8);
+					break;
+				case FORMAT_BC4_UNORM:
+					GetChannel(block, 0, values);
+					EncodeBC4(values, quality, dst_block);
+					break;
+				case FORMAT_BC5_UNORM:
+					GetChannel(block, 0, values);
+					EncodeBC4(values, quality, dst_block);
+					GetChannel(block, 1, values);
+					EncodeBC4(values, quality, dst_block + 8);
+					break;
+				default:
+					EncodeBC7(block, quality, dst_block);
+					break;
+				}
+			}
+		});
+		wiJobSystem::Wait(ctx);
+		return true;
+	}
+
+	bool Decompress(const uint8_t* src, uint32_t width, uint32_t height, FORMAT format, std::vector<uint8_t>& rgba)
+	{
+		if (!IsFormatSupported(format))
+		{
+			return false;
+		}
+		rgba.resize(size_t(width) * size_t(height) * 4);
+		const uint32_t blocks_x = (width + 3) / 4;
+		const uint32_t blocks_y = (height + 3) / 4;
+		const uint32_t block_bytes = GetBlockBytes(format);
+		bool success = true;
+		for (uint32_t by = 0; by < blocks_y; ++by)
+		{
+			for (uint32_t bx = 0; bx < blocks_x; ++bx)
+			{
+				const uint8_t* src_block = src + (size_t(by) * blocks_x + bx) * block_bytes;
+				uint8_t block[16][4] = {};
+				switch (format)
+				{
+				case FORMAT_BC1_UNORM:
+				case FORMAT_BC1_UNORM_SRGB:
+					DecodeBC1(src_block, true, block);
+					break;
+				case FORMAT_BC3_UNORM:
+				case FORMAT_BC3_UNORM_SRGB:
+					DecodeBC1(src_block + 8, false, block);
+					DecodeBC4(src_block, 3, block);
+					break;
+				case FORMAT_BC4_UNORM:
+					DecodeBC4(src_block, 0, block);
+					for (uint32_t i = 0; i < 16; ++i)
+					{
+						block[i][3] = 255;
+					}
+					break;
+				case FORMAT_BC5_UNORM:
+					DecodeBC4(src_block, 0, block);
+					DecodeBC4(src_block + 8, 1, block);
+					for (uint32_t i = 0; i < 16; ++i)
+					{
+						block[i][3] = 255;
+					}
+					break;
+				default:
+					success &= DecodeBC7(src_block, block);
+					break;
+				}
+				for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+				{
+					for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+					{
+						std::memcpy(rgba.data() + (size_t(by * 4 + y) * width + bx * 4 + x) * 4, block[y * 4 + x], 4);
+					}
+				}
+			}
+		}
+		return success;
+	}
+
+	// Computes the next mip level with a box filter, fetch() returns the texels of the current level in linear space
+	template<typename Fetch>
+	void Downsample(uint32_t width, uint32_t height, bool normalmap, const Fetch& fetch, std::vector<XMFLOAT4>& dst)
+	{
+		const uint32_t dst_width = std::max(1u, width / 2);
+		const uint32_t dst_height = std::max(1u, height / 2);
+		dst.resize(size_t(dst_width) * size_t(dst_height));
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, dst_height, 1, [&](wiJobArgs args) {
+			const uint32_t y = args.jobIndex;
+			const uint32_t y0 = std::min(y * 2, height - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < dst_width; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				XMVECTOR color = XMVectorAdd(XMVectorAdd(fetch(x0, y0), fetch(x1, y0)), XMVectorAdd(fetch(x0, y1), fetch(x1, y1)));
+				color = XMVectorScale(color, 0.25f);
+				if (normalmap)
+				{
+					XMVECTOR normal = XMVector3Normalize(XMVectorMultiplyAdd(color, XMVectorReplicate(2), XMVectorReplicate(-1)));
+					normal = XMVectorMultiplyAdd(normal, XMVectorReplicate(0.5f), XMVectorReplicate(0.5f));
+					color = XMVectorSelect(color, normal, XMVectorSelectControl(1, 1, 1, 0));
+				}
+				XMStoreFloat4(&dst[size_t(y) * dst_width + x], color);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	bool Cook(const uint8_t* rgba, uint32_t width, uint32_t height, const Settings& settings, std::vector<uint8_t>& filedata)
+	{
+		if (rgba == nullptr || width == 0 || height == 0 || !IsFormatSupported(settings.format))
+		{
+			return false;
+		}
+		const FORMAT format = settings.format;
+		const bool srgb = !settings.normalmap && (settings.srgb || IsSRGB(format));
+		const uint32_t mip_count = settings.mipmaps ? (uint32_t)std::log2(std::max(width, height)) + 1 : 1;
+
+		const size_t header_size = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+		size_t size = header_size;
+		for (uint32_t mip = 0; mip < mip_count; ++mip)
+		{
+			size += GetCompressedSize(std::max(1u, width >> mip), std::max(1u, height >> mip), format);
+		}
+		filedata.resize(size);
+
+		const uint32_t magic = 0x20534444; // "DDS "
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000; // caps, height, width, pixelformat, linearsize
+		header.height = height;
+		header.width = width;
+		header.pitchOrLinearSize = (uint32_t)GetCompressedSize(width, height, format);
+		header.mipMapCount = mip_count;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = 0x4; // fourcc
+		header.ddspf.fourCC = 0x30315844; // "DX10"
+		header.caps = 0x1000; // texture
+		if (mip_count > 1)
+		{
+			header.flags |= 0x20000; // mipmapcount
+			header.caps |= 0x8 | 0x400000; // complex, mipmap
+		}
+		DDS_HEADER_DXT10 header10 = {};
+		header10.dxgiFormat = GetDXGIFormat(format);
+		header10.resourceDimension = 3; // texture2D
+		header10.arraySize = 1;
+
+		uint8_t* dst = filedata.data();
+		std::memcpy(dst, &magic, sizeof(magic));
+		dst += sizeof(magic);
+		std::memcpy(dst, &header, sizeof(header));
+		dst += sizeof(header);
+		std::memcpy(dst, &header10, sizeof(header10));
+		dst += sizeof(header10);
+
+		const ColorTables& tables = GetColorTables();
+		auto fetch_source = [&](uint32_t x, uint32_t y) {
+			const uint8_t* texel = rgba + (size_t(y) * width + x) * 4;
+			if (srgb)
+			{
+				return XMVectorSet(tables.srgb_to_linear[texel[0]], tables.srgb_to_linear[texel[1]], tables.srgb_to_linear[texel[2]], texel[3] / 255.0f);
+			}
+			return XMVectorScale(XMVectorSet(texel[0], texel[1], texel[2], texel[3]), 1.0f / 255.0f);
+		};
+
+		std::vector<XMFLOAT4> current;
+		std::vector<XMFLOAT4> next;
+		std::vector<uint8_t> pixels;
+		uint32_t mip_width = width;
+		uint32_t mip_height = height;
+		for (uint32_t mip = 0; mip < mip_count; ++mip)
+		{
+			const uint8_t* level = rgba;
+			if (mip > 0)
+			{
+				// The mips are filtered from the previous mip in floating point, only the compressor input is quantized:
+				if (mip == 1)
+				{
+					Downsample(mip_width, mip_height, settings.normalmap, fetch_source, next);
+				}
+				else
+				{
+					const uint32_t current_width = mip_width;
+					Downsample(mip_width, mip_height, settings.normalmap, [&](uint32_t x, uint32_t y) {
+						return XMLoadFloat4(&current[size_t(y) * current_width + x]);
+					}, next);
+				}
+				std::swap(current, next);
+				mip_width = std::max(1u, mip_width / 2);
+				mip_height = std::max(1u, mip_height / 2);
+
+				pixels.resize(current.size() * 4);
+				for (size_t i = 0; i < current.size(); ++i)
+				{
+					const XMFLOAT4& texel = current[i];
+					const float color[] = { texel.x, texel.y, texel.z };
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						const float value = std::clamp(color[c], 0.0f, 1.0f);
+						pixels[i * 4 + c] = srgb ? tables.linear_to_srgb[uint32_t(value * 4095.0f + 0.5f)] : uint8_t(value * 255.0f + 0.5f);
+					}
+					pixels[i * 4 + 3] = uint8_t(std::clamp(texel.w, 0.0f, 1.0f) * 255.0f + 0.5f);
+				}
+				level = pixels.data();
+			}
+
+			Compress(level, mip_width, mip_height, format, settings.quality, dst);
+			dst += GetCompressedSize(mip_width, mip_height, format);
+		}
+
+		return true;
+	}
+
+	bool CookFile(const std::string& fileName, const Settings& settings)
+	{
+		std::vector<uint8_t> filedata;
+		if (!wiHelper::FileRead(fileName, filedata))
+		{
+			return false;
+		}
+		int width, height, bpp;
+		uint8_t* rgba = stbi_load_from_memory(filedata.data(), (int)filedata.size(), &width, &height, &bpp, 4);
+		if (rgba == nullptr)
+		{
+			return false;
+		}
+		std::vector<uint8_t> cooked;
+		const bool success = Cook(rgba, (uint32_t)width, (uint32_t)height, settings, cooked);
+		stbi_image_free(rgba);
+		return success && wiHelper::FileWrite(GetCookedFileName(fileName), cooked.data(), cooked.size());
+	}
+
+	std::string GetCookedFileName(const std::string& fileName)
+	{
+		return fileName + ".cooked.dds";
+	}
+
+	bool IsCookedFileUpToDate(const std::string& fileName)
+	{
+		std::error_code ec;
+		const auto cooked_time = std::filesystem::last_write_time(GetCookedFileName(fileName), ec);
+		if (ec)
+		{
+			return false; // not cooked
+		}
+		const auto source_time = std::filesystem::last_write_time(fileName, ec);
+		if (ec)
+		{
+			return true; // only the cooked file is shipped
+		}
+		return cooked_time >= source_time;
+	}
+}
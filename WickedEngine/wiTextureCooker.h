@@ -0,0 +1,62 @@
+#pragma once
+#include "wiGraphics.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Offline texture cooking: converts images to block compressed DDS files with precomputed mip chains
+//	The block compression is multithreaded with the job system, every 4x4 block is compressed independently
+//	The resource manager loads the cooked DDS file instead of the source image when it's up to date (see IsCookedFileUpToDate())
+namespace wiTextureCooker
+{
+	// Speed versus quality setting for block compression
+	enum class Quality
+	{
+		Fast,		// endpoints from the principal axis of the block colors
+		Default,	// least squares refinement of the endpoints
+		High,		// more refinement iterations and exhaustive BC7 p-bit and BC4 mode search
+	};
+
+	struct Settings
+	{
+		// Supported formats: BC1, BC3, BC4, BC5, BC7 (UNORM or UNORM_SRGB)
+		wiGraphics::FORMAT format = wiGraphics::FORMAT_BC7_UNORM;
+		Quality quality = Quality::Default;
+		// The color is stored in sRGB space, so the mips are filtered in linear space (always true for the SRGB formats)
+		//	The renderer applies the gamma in the shaders for material color textures, so those should be cooked with UNORM formats and srgb = true
+		bool srgb = true;
+		// The mips are renormalized (tangent space normal map in RGB, or RG for BC5)
+		bool normalmap = false;
+		bool mipmaps = true;
+	};
+
+	// Returns whether the format can be compressed by the cooker
+	bool IsFormatSupported(wiGraphics::FORMAT format);
+
+	// Returns the size of the compressed data of one image
+	size_t GetCompressedSize(uint32_t width, uint32_t height, wiGraphics::FORMAT format);
+
+	// Compresses an RGBA8 image into dst, which must be at least GetCompressedSize() bytes
+	//	Returns false if the format is not supported
+	bool Compress(const uint8_t* rgba, uint32_t width, uint32_t height, wiGraphics::FORMAT format, Quality quality, uint8_t* dst);
+
+	// Decompresses the blocks of one image into RGBA8, which is resized to width * height * 4 bytes
+	//	This is meant for validation of the cooked data, BC7 is only decoded from mode 6 blocks (which is what Compress() writes)
+	//	Returns false if the format or a block is not supported
+	bool Decompress(const uint8_t* src, uint32_t width, uint32_t height, wiGraphics::FORMAT format, std::vector<uint8_t>& rgba);
+
+	// Creates the DDS file data from an RGBA8 image, with mips generated on the CPU
+	bool Cook(const uint8_t* rgba, uint32_t width, uint32_t height, const Settings& settings, std::vector<uint8_t>& filedata);
+
+	// Loads an image file (png, jpg, tga, etc.) and writes the cooked DDS file next to it (see GetCookedFileName())
+	bool CookFile(const std::string& fileName, const Settings& settings);
+
+	// Returns the file name of the cooked texture for a source image: the full source name with .cooked.dds suffix
+	//	The suffix keeps it apart from DDS files that are next to the source image with the same name
+	std::string GetCookedFileName(const std::string& fileName);
+
+	// Returns true if the cooked texture of a source image exists and it was written after the source image was last modified
+	bool IsCookedFileUpToDate(const std::string& fileName);
+}
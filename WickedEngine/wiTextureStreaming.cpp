@@ -0,0 +1,111 @@
+#include "wiTextureStreaming.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace wiTextureStreaming
+{
+	inline uint32_t GetResolution(const Texture& texture, uint32_t lod)
+	{
+		return std::max(1u, std::max(texture.width, texture.height) >> lod);
+	}
+
+	uint32_t GetMaxLOD(const Texture& texture, const Settings& settings)
+	{
+		uint32_t lod = 0;
+		while (lod + 1 < texture.mip_count && GetResolution(texture, lod + 1) >= settings.min_resolution)
+		{
+			lod++;
+		}
+		return lod;
+	}
+
+	uint32_t GetDesiredLOD(const Texture& texture, const Settings& settings)
+	{
+		const uint32_t max_lod = GetMaxLOD(texture, settings);
+		if (texture.requested_resolution <= 0)
+		{
+			return max_lod;
+		}
+		// The chosen mip has at least the requested resolution:
+		const float ratio = float(GetResolution(texture, 0)) / texture.requested_resolution;
+		const float lod = std::floor(std::log2(std::max(ratio, 1.0f)) + settings.bias);
+		return std::min(max_lod, (uint32_t)std::max(lod, 0.0f));
+	}
+
+	size_t ComputeMemorySize(const Texture& texture, uint32_t lod)
+	{
+		size_t size = 0;
+		for (uint32_t mip = lod; mip < texture.mip_count; ++mip)
+		{
+			const size_t width = (std::max(1u, texture.width >> mip) + texture.block_size - 1) / texture.block_size;
+			const size_t height = (std::max(1u, texture.height >> mip) + texture.block_size - 1) / texture.block_size;
+			size += width * height * texture.block_bytes;
+		}
+		return size;
+	}
+
+	size_t Update(Texture* textures, size_t count, const Settings& settings)
+	{
+		size_t memory = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			Texture& texture = textures[i];
+			const uint32_t desired = GetDesiredLOD(texture, settings);
+			if (desired < texture.resident_lod)
+			{
+				texture.target_lod = desired;
+				texture.demote_frames = 0;
+			}
+			else if (desired > texture.resident_lod)
+			{
+				texture.demote_frames++;
+				texture.target_lod = texture.demote_frames >= settings.demote_delay ? desired : texture.resident_lod;
+			}
+			else
+			{
+				texture.target_lod = desired;
+				texture.demote_frames = 0;
+			}
+			memory += ComputeMemorySize(texture, texture.target_lod);
+		}
+
+		if (settings.budget == 0 || memory <= settings.budget)
+		{
+			return memory;
+		}
+
+		// Over budget: the texture that has the most resolution compared to what was requested will drop its top mip
+		struct Candidate
+		{
+			float need; // requested resolution relative to the target resolution
+			size_t index;
+			bool operator<(const Candidate& other) const { return need > other.need; } // smallest need on top
+		};
+		std::priority_queue<Candidate> candidates;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Texture& texture = textures[i];
+			if (texture.target_lod < GetMaxLOD(texture, settings))
+			{
+				candidates.push({ texture.requested_resolution / GetResolution(texture, texture.target_lod), i });
+			}
+		}
+		while (memory > settings.budget && !candidates.empty())
+		{
+			Candidate candidate = candidates.top();
+			candidates.pop();
+			Texture& texture = textures[candidate.index];
+			memory -= ComputeMemorySize(texture, texture.target_lod) - ComputeMemorySize(texture, texture.target_lod + 1);
+			texture.target_lod++;
+			if (texture.target_lod < GetMaxLOD(texture, settings))
+			{
+				candidate.need *= 2;
+				candidates.push(candidate);
+			}
+		}
+		return memory;
+	}
+}
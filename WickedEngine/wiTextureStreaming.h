@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Texture streaming decisions: which mip levels of the streaming textures should be resident
+//	This is only CPU side logic without dependency on the graphics device, the resource manager applies the decisions
+//	A texture is streamed by its "lod": the most detailed resident mip level, the mips after it are all resident
+namespace wiTextureStreaming
+{
+	struct Settings
+	{
+		size_t budget = 0;				// memory budget of the streaming textures in bytes (0 = unlimited)
+		uint32_t min_resolution = 64;	// mips up to this resolution are always resident
+		float bias = 0;					// positive values request lower resolution, negative values request higher resolution
+		uint32_t demote_delay = 60;		// number of frames a texture must be requested at lower resolution before its mips are dropped
+	};
+
+	// Streaming state of a 2D texture
+	struct Texture
+	{
+		// Description of the full mip chain:
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mip_count = 1;
+		uint32_t block_size = 1;		// texels per block side (4 for block compressed formats)
+		uint32_t block_bytes = 4;		// bytes per block (or texel)
+
+		// The highest resolution (in pixels along the longest side) that the texture was requested with in this frame
+		float requested_resolution = 0;
+
+		uint32_t resident_lod = 0;		// most detailed resident mip level
+		uint32_t target_lod = 0;		// most detailed mip level that should be resident, computed by Update()
+		uint32_t demote_frames = 0;		// how many consecutive frames the texture was requested with lower resolution than resident
+	};
+
+	// Returns the least detailed lod that is allowed
+	uint32_t GetMaxLOD(const Texture& texture, const Settings& settings);
+	// Returns the lod that matches the requested resolution, without hysteresis and budget
+	uint32_t GetDesiredLOD(const Texture& texture, const Settings& settings);
+	// Returns the memory size of the mip chain starting from lod
+	size_t ComputeMemorySize(const Texture& texture, uint32_t lod);
+
+	// Computes the target_lod of every texture from the requested resolutions:
+	//	Higher resolution is requested immediately to avoid visible pop-in, but mips are only dropped after demote_delay frames
+	//	If the budget is exceeded, the textures whose resolution is the least needed are reduced until it fits
+	//	Returns the memory size of the textures at their target lods
+	size_t Update(Texture* textures, size_t count, const Settings& settings);
+}